@@ -0,0 +1,263 @@
+#include "analyzer.hpp"
+
+// Instructions after which control does not continue at the next address
+static const std::vector<std::string> ROUTINE_ENDS = {"rts", "rti", "hlt", "brk"};
+static const std::vector<std::string> BRANCHES = {"bcc", "bcs", "beq", "bmi", "bne", "bpl", "bvc", "bvs"};
+
+static bool isInList(const std::vector<std::string>& list, std::string_view name) {
+    return std::find(list.begin(), list.end(), name) != list.end();
+}
+
+// Helper Functions
+
+int TimingAnalyzer::_operand(const CodeGen::ListingEntry& entry) {
+    const std::vector<uint8_t>& code = _codeGen.machineCode();
+    return code[entry.address + 1] | (code[entry.address + 2] << 8);
+}
+
+int TimingAnalyzer::_nodeAt(int address) {
+    auto found = _addressToNode.find(address);
+    return found == _addressToNode.end() ? PATH_EXIT : found->second;
+}
+
+void TimingAnalyzer::_merge(_Paths& into, const _Paths& from, const _Cost& shift) {
+    for (const auto& [terminal, cost] : from) {
+        _Cost shifted = {cost.best + shift.best, cost.worst + shift.worst};
+
+        auto found = into.find(terminal);
+        if (found == into.end()) into[terminal] = shifted;
+        else {
+            found->second.best = std::min(found->second.best, shifted.best);
+            found->second.worst = std::max(found->second.worst, shifted.worst);
+        }
+    }
+}
+
+std::string TimingAnalyzer::_formatCost(const _Paths& paths) {
+    auto exit = paths.find(PATH_EXIT);
+    if (exit == paths.end()) return paths.count(PATH_LOOP) ? "unbounded" : "does not return";
+
+    std::string worst = paths.count(PATH_LOOP) ? "unbounded" : std::to_string(exit->second.worst);
+    return std::to_string(exit->second.best) + " / " + worst;
+}
+
+std::string TimingAnalyzer::_formatOperand(const ASTNode* node) {
+    const Token& token = *node->data;
+    std::string text;
+
+    switch (token.type) {
+        case TokenType::HEX: return "$" + token.substring;
+        case TokenType::BINARY: return "%" + token.substring;
+        case TokenType::CHAR: return "'" + token.substring + "'";
+        case TokenType::REG: return "r" + token.substring;
+        case TokenType::IMMEDIATE: return "#";
+        case TokenType::COMMA: return node->children.empty() ? "," : "," + _formatOperand(node->children[0].get());
+        case TokenType::LOW:
+        case TokenType::HIGH: return token.substring + _formatOperand(node->children[0].get());
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::MUL:
+        case TokenType::DIV:
+            if (node->children.size() != 2) return token.substring;
+            return _formatOperand(node->children[0].get()) + token.substring + _formatOperand(node->children[1].get());
+        case TokenType::BRACKET:
+            for (const auto& child : node->children) text += _formatOperand(child.get());
+            return "(" + text + ")";
+        default: return token.substring;
+    }
+}
+
+std::string TimingAnalyzer::_formatInstruction(const ASTNode* node) {
+    std::string text = node->data->substring;
+    if (!node->children.empty()) text += " ";
+    for (const auto& child : node->children) text += _formatOperand(child.get());
+    return text;
+}
+
+// Graph Functions
+
+void TimingAnalyzer::_buildGraph() {
+    _listing = _codeGen.listing();
+    std::sort(_listing.begin(), _listing.end(), [](const CodeGen::ListingEntry& a, const CodeGen::ListingEntry& b) { return a.address < b.address; });
+
+    for (size_t i = 0; i < _listing.size(); i++) {
+        _addressToNode[_listing[i].address] = i;
+        _nodes.push_back({&_listing[i], {}});
+    }
+
+    for (const auto& [address, count] : _codeGen.loopBounds()) {
+        int node = _nodeAt(address);
+        if (node == PATH_EXIT || count < 1) {
+            std::cerr << "Error: .bound must come before an instruction and be at least 1" << std::endl;
+            exit(ERROR::SYNTAX_ERROR);
+        }
+        _nodes[node].bound = count;
+    }
+
+    for (auto& node : _nodes) {
+        const CodeGen::ListingEntry& entry = *node.entry;
+        const Opcode& instr = OPCODE_TABLE[entry.opcode];
+        int next = _nodeAt(entry.address + entry.size);
+
+        if (isInList(ROUTINE_ENDS, instr.mnemonic) || (instr.mnemonic == "jmp" && instr.mode != AddressingMode::ABSOLUTE)) {
+            node.edges.push_back({PATH_EXIT, {instr.maxCycles, instr.maxCycles}});
+        }
+        else if (instr.mnemonic == "jmp") node.edges.push_back({_nodeAt(_operand(entry)), {instr.maxCycles, instr.maxCycles}});
+        else if (instr.mnemonic == "jsr") {
+            int callee = _nodeAt(_operand(entry));
+            node.edges.push_back({next, {instr.maxCycles, instr.maxCycles}, true, callee});
+        }
+        else if (isInList(BRANCHES, instr.mnemonic)) {
+            node.edges.push_back({next, {instr.minCycles, instr.minCycles}});
+            node.edges.push_back({_nodeAt(_operand(entry)), {instr.maxCycles, instr.maxCycles}});
+        }
+        else node.edges.push_back({next, {instr.maxCycles, instr.maxCycles}});
+    }
+}
+
+TimingAnalyzer::_Paths TimingAnalyzer::_routine(int node) {
+    if (node == PATH_EXIT) return {{PATH_EXIT, {0, 0}}};                // Called code was not assembled here
+    if (std::find(_callStack.begin(), _callStack.end(), node) != _callStack.end()) return {{PATH_LOOP, {0, 0}}};
+
+    auto found = _routineMemo.find(node);
+    if (found != _routineMemo.end()) return found->second;
+
+    // Each routine gets its own walk so a caller's path does not look like a loop
+    std::vector<int> active;
+    std::vector<int> visiting;
+    std::swap(_visiting, visiting);
+    int cutDepth = _cutDepth;
+    _cutDepth = INT_MAX;
+    _callStack.push_back(node);
+
+    _Paths paths = _paths(node, active);
+
+    _callStack.pop_back();
+    std::swap(_visiting, visiting);
+    _cutDepth = cutDepth;
+    return _routineMemo[node] = paths;
+}
+
+TimingAnalyzer::_Paths TimingAnalyzer::_paths(int node, std::vector<int>& active) {
+    if (std::find(active.begin(), active.end(), node) != active.end()) return {{node, {0, 0}}};
+    auto visiting = std::find(_visiting.begin(), _visiting.end(), node);
+    if (visiting != _visiting.end()) {
+        _cutDepth = std::min<int>(_cutDepth, visiting - _visiting.begin());
+        return {{PATH_LOOP, {0, 0}}};
+    }
+
+    auto key = std::make_pair(node, active);
+    auto found = _pathMemo.find(key);
+    if (found != _pathMemo.end()) return found->second;
+
+    int depth = _visiting.size();
+    int outerCut = _cutDepth;
+    _cutDepth = INT_MAX;
+    _visiting.push_back(node);
+    _Paths paths;
+
+    if (_nodes[node].bound) {
+        // Body paths either come back to the head for another iteration or leave the loop
+        active.push_back(node);
+        _Paths body = _successors(node, active);
+        active.pop_back();
+
+        auto iteration = body.find(node);
+        long repeat = iteration == body.end() ? 0 : (_nodes[node].bound - 1) * iteration->second.worst;
+        for (const auto& [terminal, cost] : body) {
+            if (terminal != node) paths[terminal] = {cost.best, cost.worst + repeat};
+        }
+    }
+    else paths = _successors(node, active);
+
+    _visiting.pop_back();
+
+    // Cut at a node further up the stack, the same node reached another way may not be cut
+    bool cutAbove = _cutDepth < depth;
+    _cutDepth = std::min(outerCut, _cutDepth);
+    if (!cutAbove) _pathMemo[key] = paths;
+    return paths;
+}
+
+TimingAnalyzer::_Paths TimingAnalyzer::_successors(int node, std::vector<int>& active) {
+    _Paths paths;
+
+    for (const auto& edge : _nodes[node].edges) {
+        _Cost cost = edge.cost;
+
+        if (edge.call) {
+            _Paths called = _routine(edge.callee);
+            if (called.count(PATH_LOOP)) paths[PATH_LOOP] = {0, 0};
+            if (!called.count(PATH_EXIT)) continue;                         // Never returns to the caller
+
+            cost.best += called[PATH_EXIT].best;
+            cost.worst += called[PATH_EXIT].worst;
+        }
+
+        if (edge.target == PATH_EXIT) _merge(paths, {{PATH_EXIT, {0, 0}}}, cost);
+        else _merge(paths, _paths(edge.target, active), cost);
+    }
+
+    return paths;
+}
+
+// Main Functions
+
+void TimingAnalyzer::analyze() {
+    _buildGraph();
+
+    std::vector<CodeGen::Symbol> labels = _codeGen.labels();
+    std::sort(labels.begin(), labels.end(), [](const CodeGen::Symbol& a, const CodeGen::Symbol& b) { return a.value < b.value; });
+
+    for (const auto& label : labels) {
+        int node = _nodeAt(label.value);
+        if (node == PATH_EXIT) continue;                                    // Data, not code
+        _routines.push_back({label.name, node, _routine(node)});
+    }
+}
+
+void TimingAnalyzer::printReport() {
+    char line[96];
+
+    std::cout << "\nTiming (cycles, best / worst)" << std::endl;
+    for (const auto& routine : _routines) {
+        std::snprintf(line, sizeof(line), "  $%04x  %-24s %s", _nodes[routine.node].entry->address, routine.name.c_str(), _formatCost(routine.paths).c_str());
+        std::cout << line << std::endl;
+    }
+}
+
+void TimingAnalyzer::printListing(const std::string& listingPath) {
+    std::ofstream listingFile(listingPath);
+    if (!listingFile) {
+        std::cerr << "Error opening file for writing." << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+
+    const std::vector<uint8_t>& code = _codeGen.machineCode();
+    char line[128];
+    size_t routine = 0;
+
+    listingFile << "; addr  bytes     cycles  source (branch cycles are not taken/taken)" << std::endl;
+
+    for (const auto& node : _nodes) {
+        const CodeGen::ListingEntry& entry = *node.entry;
+
+        for (; routine < _routines.size() && _nodes[_routines[routine].node].entry->address <= entry.address; routine++) {
+            listingFile << std::endl << _routines[routine].name << ":    ; " << _formatCost(_routines[routine].paths) << std::endl;
+        }
+        if (node.bound) listingFile << "    .bound " << node.bound << std::endl;
+
+        std::string bytes;
+        for (int i = 0; i < entry.size; i++) {
+            std::snprintf(line, sizeof(line), "%02x ", code[entry.address + i]);
+            bytes += line;
+        }
+
+        const Opcode& instr = OPCODE_TABLE[entry.opcode];
+        std::string cost = std::to_string(instr.minCycles);
+        if (instr.maxCycles != instr.minCycles) cost += "/" + std::to_string(instr.maxCycles);
+
+        std::snprintf(line, sizeof(line), "$%04x  %-9s %-7s %s", entry.address, bytes.c_str(), cost.c_str(), _formatInstruction(entry.node).c_str());
+        listingFile << line << std::endl;
+    }
+}
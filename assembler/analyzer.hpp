@@ -0,0 +1,82 @@
+#ifndef ANALYZER_HPP
+#define ANALYZER_HPP
+
+#include "main.hpp"
+#include "parser.hpp"
+#include "codegen.hpp"
+
+#include <climits>
+#include <map>
+#include <unordered_map>
+
+#define PATH_EXIT       -1                                  // Routine returns (rts/rti), halts or leaves known code
+#define PATH_LOOP       -2                                  // Runs through a loop without a .bound, or recursion
+
+// Static timing of the generated code. The control flow graph has one node per emitted
+// instruction with edges for fall through, branches, jmp and jsr, and each node costs the
+// microcode steps of its opcode. A loop head marked with .bound N runs at most N times.
+class TimingAnalyzer {
+public:
+    TimingAnalyzer(const CodeGen& codeGen)
+    : _codeGen(codeGen) {}
+
+    void analyze();
+    void printReport();
+    void printListing(const std::string& listingPath);
+
+private:
+    const CodeGen& _codeGen;
+
+    struct _Cost {
+        long best;
+        long worst;
+    };
+
+    // Terminal (PATH_EXIT, PATH_LOOP or an enclosing loop head) to the cycles spent reaching it
+    typedef std::map<int, _Cost> _Paths;
+
+    struct _Edge {
+        int target;                                         // Node index or PATH_EXIT
+        _Cost cost;
+        bool call = false;                                  // jsr: the callee runs before the edge is taken
+        int callee = PATH_EXIT;
+    };
+
+    struct _Node {
+        const CodeGen::ListingEntry* entry;
+        std::vector<_Edge> edges;
+        int bound = 0;
+    };
+
+    struct _Routine {
+        std::string name;
+        int node;
+        _Paths paths;
+    };
+
+    std::vector<CodeGen::ListingEntry> _listing;
+    std::vector<_Node> _nodes;
+    std::unordered_map<int, int> _addressToNode;
+    std::vector<_Routine> _routines;
+
+    std::map<std::pair<int, std::vector<int>>, _Paths> _pathMemo;
+    std::unordered_map<int, _Paths> _routineMemo;
+    std::vector<int> _visiting;
+    int _cutDepth = INT_MAX;                                // Shallowest _visiting entry the current walk was cut at
+    std::vector<int> _callStack;
+
+    void _buildGraph();
+    int _operand(const CodeGen::ListingEntry& entry);
+    int _nodeAt(int address);
+
+    _Paths _routine(int node);
+    _Paths _paths(int node, std::vector<int>& active);
+    _Paths _successors(int node, std::vector<int>& active);
+    void _merge(_Paths& into, const _Paths& from, const _Cost& shift);
+
+    std::string _formatCost(const _Paths& paths);
+    std::string _formatOperand(const ASTNode* node);
+    std::string _formatInstruction(const ASTNode* node);
+};
+
+#endif
@@ -1,28 +1,113 @@
 #include "assembler.hpp"
 
-const std::vector<Instruction> Assembler::_instructionSet = createInstructionSet();
-
-Assembler::Assembler(const std::string& sourcePath, const std::string& outputPath)
-: _sourceFilePath(sourcePath), _outputFilePath(outputPath) {}
+Assembler::Assembler(const std::string& sourcePath, const std::string& outputPath, bool optimize, bool timing, bool debug, bool verbose, const std::string& profilePath)
+: _sourceFilePath(sourcePath), _outputFilePath(outputPath), _optimize(optimize), _timing(timing), _debug(debug), _verbose(verbose),
+  _profilePath(profilePath) {}
 
 
 void Assembler::assemble() {
 
     Preprocessor preprocessor;
-    std::string sourceCode;
-
-    preprocessor.processFile(_sourceFilePath, sourceCode);
+    preprocessor.processFile(_sourceFilePath);
+    _sources = preprocessor.sources();
 
-    Lexer lexer(sourceCode, _instructionSet);
+    Lexer lexer(preprocessor, _lexerThreads);
 
     lexer.tokenize();
-    lexer.print();
+    if (_verbose) lexer.print();
 
     Parser parser(lexer);
     parser.parseProgram();
-    parser.printAST();
+    if (_verbose) parser.printAST();
+
+    if (_optimize) {
+        Optimizer optimizer(parser);
+        optimizer.optimize();
+        optimizer.printReport();
+    }
+
+    CodeGen code_generator(parser);
+    if (!_profilePath.empty()) {
+        AccessProfile profile;
+        if (!profile.read(_profilePath)) exit(ERROR::FILE_ERROR);
+        code_generator.setAccessProfile(profile.bySymbol());
+    }
 
-    CodeGen code_generator(parser, _instructionSet);
     code_generator.generateCode();
+    code_generator.printRelaxation();
+    if (!_profilePath.empty()) code_generator.printPlacement();
     code_generator.printFile(_outputFilePath);
+
+    // Listing and symbol map go next to the image
+    std::string outputStem = _outputFilePath.substr(0, _outputFilePath.find_last_of('.'));
+    if (_debug) code_generator.printSymbols(outputStem + ".sym", preprocessor);
+
+    if (_timing) {
+        TimingAnalyzer analyzer(code_generator);
+        analyzer.analyze();
+        analyzer.printReport();
+        analyzer.printListing(outputStem + ".lst");
+    }
+}
+
+void Assembler::assembleObject() {
+
+    Preprocessor preprocessor;
+    preprocessor.processFile(_sourceFilePath);
+    _sources = preprocessor.sources();
+
+    Lexer lexer(preprocessor, _lexerThreads);
+    lexer.tokenize();
+
+    Parser parser(lexer, true);
+    parser.parseProgram();
+
+    // Module name is the source file name without directory or extension
+    size_t nameStart = _sourceFilePath.find_last_of('/') + 1;
+    std::string moduleName = _sourceFilePath.substr(nameStart, _sourceFilePath.find_last_of('.') - nameStart);
+
+    if (_optimize) {
+        Optimizer optimizer(parser);
+        optimizer.optimize();
+        optimizer.printReport(moduleName);
+    }
+
+    CodeGen code_generator(parser, true);
+    code_generator.generateCode();
+    code_generator.printObject(_outputFilePath, moduleName);
+}
+
+void Assembler::assembleSource(std::string_view source, AssembledProgram& program) {
+
+    // The same stages as assemble(), on text the caller holds, into memory instead of files
+    Preprocessor preprocessor;
+    preprocessor.processSource(source, _sourceFilePath);
+    _sources = preprocessor.sources();
+
+    Lexer lexer(preprocessor, _lexerThreads);
+    lexer.tokenize();
+
+    Parser parser(lexer);
+    parser.parseProgram();
+
+    if (_optimize) {
+        Optimizer optimizer(parser);
+        optimizer.optimize();
+    }
+
+    CodeGen code_generator(parser);
+    code_generator.generateCode();
+
+    program.sources = _sources;
+    program.memory = code_generator.machineCode();
+    program.ranges = code_generator.usedRanges();
+    code_generator.buildSymbols(program.symbols, preprocessor);
+}
+
+AssembledProgram assembleProgram(std::string_view source, const std::string& name, bool optimize) {
+    AssembledProgram program;
+    std::string noOutput;
+    Assembler assembler(name, noOutput, optimize);
+    assembler.assembleSource(source, program);
+    return program;
 }
@@ -0,0 +1,218 @@
+#include "assembler.hpp"
+#include "charclass.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <malloc.h>
+#include <map>
+#include <sys/resource.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Times each assembler stage on one project, e.g. one made by generate_source.py:
+//   ./tasml_bench [-r <runs>] [-b <baseline>] [-x <percent>] [-w <baseline>] <main.tasml>
+// Reports lines/sec, heap allocations and peak heap per stage, best of the runs. With -b the
+// run fails when a stage is more than -x percent (default 20) slower than the baseline file.
+// The scan table compares the lexer's character classification in bytes/cycle: the <cctype>
+// loops it used to run and the lookup table.
+
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<int64_t> liveBytes{0};
+static std::atomic<int64_t> peakBytes{0};
+
+static void* allocate(size_t size) {
+    void* pointer = malloc(size ? size : 1);
+    if (!pointer) std::abort();
+
+    allocationCount++;
+    int64_t live = liveBytes += malloc_usable_size(pointer);
+    for (int64_t peak = peakBytes; live > peak && !peakBytes.compare_exchange_weak(peak, live);) {}
+    return pointer;
+}
+
+static void release(void* pointer) {
+    if (!pointer) return;
+    liveBytes -= malloc_usable_size(pointer);
+    free(pointer);
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+
+struct StageResult {
+    double seconds = 0;
+    uint64_t allocations = 0;
+    int64_t peak = 0;                       // Heap high water mark above the stage's start
+};
+
+static const char* const STAGES[] = {"preprocess", "lex", "parse", "codegen"};
+
+template <typename Function>
+static void measure(StageResult& result, bool first, Function stage) {
+    uint64_t allocations = allocationCount;
+    int64_t live = liveBytes;
+    peakBytes = live;
+
+    auto start = std::chrono::steady_clock::now();
+    stage();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (first || seconds < result.seconds) result.seconds = seconds;
+    result.allocations = allocationCount - allocations;
+    result.peak = peakBytes - live;
+}
+
+// Time stamp counter, or nanoseconds where there is none
+static uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Splits text into identifier, number and whitespace runs the way the lexer does, returning
+// the run count so the work can't be optimized away
+static size_t scanCctype(std::string_view text) {
+    size_t runs = 0;
+    for (size_t i = 0; i < text.length(); i++, runs++) {
+        if (std::isalpha(text[i])) {
+            while (i < text.length() && (std::isalnum(text[i]) || text[i] == '_')) i++;
+        } else if (std::isdigit(text[i])) {
+            while (i < text.length() && std::isdigit(text[i])) i++;
+        } else if (std::isspace(text[i]) && text[i] != '\n') {
+            while (i < text.length() && std::isspace(text[i]) && text[i] != '\n') i++;
+        } else continue;
+        i--;
+    }
+    return runs;
+}
+
+static size_t scanCharClass(std::string_view text) {
+    size_t runs = 0;
+    for (size_t i = 0; i < text.length(); i++, runs++) {
+        if (isCharClass(text[i], CHAR_ALPHA)) i = skipCharClass(text, i, CHAR_IDENTIFIER) - 1;
+        else if (isCharClass(text[i], CHAR_DIGIT)) i = skipCharClass(text, i, CHAR_DIGIT) - 1;
+        else if (isCharClass(text[i], CHAR_SPACE)) i = skipCharClass(text, i, CHAR_SPACE) - 1;
+    }
+    return runs;
+}
+
+template <typename Function>
+static double bytesPerCycle(const Preprocessor& preprocessor, int runs, Function scan) {
+    uint64_t best = UINT64_MAX;
+    size_t checksum = 0;
+
+    for (int run = 0; run < runs; run++) {
+        uint64_t start = cycles();
+        for (const auto& chunk : preprocessor.chunks) checksum += scan(chunk.text);
+        best = std::min(best, cycles() - start);
+    }
+
+    if (checksum == 0) std::printf("(empty source)\n");
+    return static_cast<double>(preprocessor.size()) / std::max<uint64_t>(best, 1);
+}
+
+static void usage() {
+    std::cerr << "Usage: ./tasml_bench [-r <runs>] [-b <baseline>] [-x <percent>] [-w <baseline>] <main.tasml>" << std::endl;
+    exit(ERROR::FILE_ERROR);
+}
+
+int main(int argc, char* argv[]) {
+    std::string sourcePath, baselinePath, writePath;
+    int runs = 5;
+    double threshold = 20;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-r" && i + 1 < argc) runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "-b" && i + 1 < argc) baselinePath = argv[++i];
+        else if (arg == "-x" && i + 1 < argc) threshold = std::atof(argv[++i]);
+        else if (arg == "-w" && i + 1 < argc) writePath = argv[++i];
+        else if (arg[0] == '-' || !sourcePath.empty()) usage();
+        else sourcePath = arg;
+    }
+
+    if (sourcePath.empty()) usage();
+
+    StageResult results[4];
+    size_t lines = 0;
+
+    for (int run = 0; run < runs; run++) {
+        Preprocessor preprocessor;
+        measure(results[0], run == 0, [&]() { preprocessor.processFile(sourcePath); });
+
+        Lexer lexer(preprocessor);
+        measure(results[1], run == 0, [&]() { lexer.tokenize(); });
+
+        Parser parser(lexer);
+        measure(results[2], run == 0, [&]() { parser.parseProgram(); });
+
+        CodeGen codeGenerator(parser);
+        measure(results[3], run == 0, [&]() { codeGenerator.generateCode(); });
+
+        lines = 0;
+        for (const auto& chunk : preprocessor.chunks) lines += std::count(chunk.text.begin(), chunk.text.end(), '\n');
+    }
+
+    std::map<std::string, double> current;
+    double total = 0;
+
+    std::printf("%zu lines, best of %d runs\n\n", lines, runs);
+    std::printf("%-12s %10s %14s %12s %12s\n", "stage", "ms", "lines/sec", "allocations", "peak KB");
+    for (int i = 0; i < 4; i++) {
+        const StageResult& result = results[i];
+        current[STAGES[i]] = lines / result.seconds;
+        total += result.seconds;
+        std::printf("%-12s %10.2f %14.0f %12llu %12lld\n", STAGES[i], result.seconds * 1000, lines / result.seconds,
+            static_cast<unsigned long long>(result.allocations), static_cast<long long>(result.peak / 1024));
+    }
+    current["total"] = lines / total;
+    std::printf("%-12s %10.2f %14.0f\n", "total", total * 1000, lines / total);
+
+    Preprocessor preprocessor;
+    preprocessor.processFile(sourcePath);
+
+    std::printf("\n%-12s %12s\n", "scan", "bytes/cycle");
+    std::printf("%-12s %12.3f\n", "cctype", bytesPerCycle(preprocessor, runs, scanCctype));
+    std::printf("%-12s %12.3f\n", "table", bytesPerCycle(preprocessor, runs, scanCharClass));
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::printf("\npeak RSS %ld KB\n", usage.ru_maxrss);
+
+    if (!writePath.empty()) {
+        std::ofstream baseline(writePath);
+        for (const auto& stage : current) baseline << stage.first << " " << stage.second << "\n";
+    }
+
+    if (baselinePath.empty()) return 0;
+
+    // Throughput below the baseline by more than the threshold is a regression
+    std::ifstream baseline(baselinePath);
+    if (!baseline.is_open()) {
+        std::cerr << "Error: unable to open baseline '" << baselinePath << "'" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+
+    bool regressed = false;
+    std::string stage;
+    double expected;
+    while (baseline >> stage >> expected) {
+        if (!current.count(stage)) continue;
+
+        double change = (current[stage] - expected) / expected * 100;
+        bool slow = change < -threshold;
+        regressed |= slow;
+        std::printf("%-12s %+7.1f%% against baseline%s\n", stage.c_str(), change, slow ? "  REGRESSION" : "");
+    }
+
+    return regressed ? 1 : 0;
+}
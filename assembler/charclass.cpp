@@ -0,0 +1,30 @@
+#include "charclass.hpp"
+
+static constexpr uint8_t classOf(int c) {
+    if (c >= '0' && c <= '9') return CHAR_DIGIT;
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) return CHAR_ALPHA;
+    if (c == '_') return CHAR_UNDERSCORE;
+    if (c == '\n') return CHAR_NEWLINE;
+    if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r') return CHAR_SPACE;
+    return 0;
+}
+
+const uint8_t CHAR_CLASSES[256] = {
+#define ROW(n) classOf(n), classOf(n + 1), classOf(n + 2), classOf(n + 3), classOf(n + 4), classOf(n + 5), classOf(n + 6), classOf(n + 7)
+    ROW(0), ROW(8), ROW(16), ROW(24), ROW(32), ROW(40), ROW(48), ROW(56),
+    ROW(64), ROW(72), ROW(80), ROW(88), ROW(96), ROW(104), ROW(112), ROW(120),
+    ROW(128), ROW(136), ROW(144), ROW(152), ROW(160), ROW(168), ROW(176), ROW(184),
+    ROW(192), ROW(200), ROW(208), ROW(216), ROW(224), ROW(232), ROW(240), ROW(248),
+#undef ROW
+};
+
+// Main Functions
+
+size_t skipCharClass(std::string_view text, size_t pos, CharClass charClass) {
+    while (pos < text.size() && isCharClass(text[pos], charClass)) pos++;
+    return pos;
+}
+
+size_t countNewlines(std::string_view text, size_t from, size_t to) {
+    return std::count(text.begin() + from, text.begin() + to, '\n');
+}
@@ -0,0 +1,28 @@
+#ifndef CHARCLASS_HPP
+#define CHARCLASS_HPP
+
+#include "main.hpp"
+
+#include <string_view>
+
+// Locale independent character classes for the lexer, from one lookup table
+enum CharClass : uint8_t {
+    CHAR_DIGIT          = 0x01,
+    CHAR_ALPHA          = 0x02,
+    CHAR_UNDERSCORE     = 0x04,
+    CHAR_SPACE          = 0x08,         // Whitespace other than newline
+    CHAR_NEWLINE        = 0x10,
+
+    CHAR_ALNUM          = CHAR_DIGIT | CHAR_ALPHA,
+    CHAR_IDENTIFIER     = CHAR_ALNUM | CHAR_UNDERSCORE,
+};
+
+extern const uint8_t CHAR_CLASSES[256];
+
+inline bool isCharClass(char c, uint8_t mask) { return CHAR_CLASSES[static_cast<uint8_t>(c)] & mask; }
+
+// First index at or after pos whose byte is not in the class (digit, alnum, identifier or space)
+size_t skipCharClass(std::string_view text, size_t pos, CharClass charClass);
+size_t countNewlines(std::string_view text, size_t from, size_t to);
+
+#endif
@@ -16,16 +16,38 @@ int CodeGen::_convertToInt(const std::unique_ptr<Token>& token) {
         case TokenType::CHAR:
             return static_cast<int>(token->substring[0]);
 
-        case TokenType::IDENTIFIER:
-            for (const auto& element : _varTable) {
-                if (element.name == token->substring) return element.value;
+        case TokenType::IDENTIFIER: {
+            int value = 0;
+            if (_findSymbol(_varTable, token->substring, value)) return value;
+            if (_findSymbol(_prevVarTable, token->substring, value)) {         // Declared further down
+                _forwardReference = _sawForwardReference = true;
+                return value;
+            }
+            if (_firstPass) {                                                   // Optimistic until the next pass
+                _forwardReference = _sawForwardReference = true;
+                return 0;
+            }
+            if (_relocatable) {                                                 // Still undefined, imported from another module
+                _relocation = true;
+                return 0xffff;
             }
             std::cerr << "Error: Variable used but not declared" << std::endl;
             exit(ERROR::VAR_ERROR);
+        }
+
+        case TokenType::LABEL: {
+            _labelReference = true;
+            if (_relocatable) {                                                 // Always relocated by the linker
+                _relocation = true;
+                return 0xffff;
+            }
 
-        case TokenType::LABEL:
-            _labelReplacementLocation.push_back({_address+1, token->substring});
-            return 0xffff;
+            int value = 0;
+            if (_findSymbol(_labelTable, token->substring, value)) return value;
+            _forwardReference = _sawForwardReference = true;
+            _findSymbol(_prevLabelTable, token->substring, value);
+            return value;
+        }
 
         default:
             break;
@@ -39,11 +61,17 @@ int CodeGen::_evaluateExpression(const std::shared_ptr<ASTNode>& node) {
 
     
     if (node->data->type == TokenType::NUMBER || node->data->type == TokenType::HEX || node->data->type == TokenType::BINARY || 
-        node->data->type == TokenType::CHAR || node->data->type == TokenType::IDENTIFIER) {
+        node->data->type == TokenType::CHAR || node->data->type == TokenType::IDENTIFIER || node->data->type == TokenType::LABEL) {
             return _convertToInt(node->data);
     }
 
-    if (node->data->type == TokenType::PLUS) {
+    if (node->data->type == TokenType::LOW) {
+        return _evaluateExpression(node->children[0]) & 0xff;
+    }
+    else if (node->data->type == TokenType::HIGH) {
+        return (_evaluateExpression(node->children[0]) >> 8) & 0xff;
+    }
+    else if (node->data->type == TokenType::PLUS) {
         return _evaluateExpression(node->children[0]) + _evaluateExpression(node->children[1]);
     }
     else if (node->data->type == TokenType::MINUS) {
@@ -65,7 +93,35 @@ int CodeGen::_evaluateExpression(const std::shared_ptr<ASTNode>& node) {
     exit(ERROR::OP_ERROR);
 }
 
-void CodeGen::_updateSymbolTable(std::vector<_SymbolTable>& table, const std::string& name, const int& value) {
+int CodeGen::_operandValue(const std::shared_ptr<ASTNode>& node, int location, int width) {
+    _labelReference = _relocation = false;
+    int value = _evaluateExpression(node);
+
+    if (_relocation) {
+        // Object relocations patch a whole word with the symbol's address
+        if (!node->children.empty() || width == 1) {
+            std::cerr << "Error: only a bare label can be used as a 16 bit operand in an object" << std::endl;
+            exit(ERROR::OBJECT_ERROR);
+        }
+        _labelReplacementLocation.push_back({location, node->data->substring});
+    }
+    else if (_labelReference) _fixups.push_back({location, width, node});
+    else if (width) _checkRange(value, width);
+
+    return value;
+}
+
+void CodeGen::_checkRange(int value, int width) {
+    int low = width == 1 ? -0x80 : -0x8000;
+    int high = width == 1 ? 0xff : 0xffff;
+
+    if (value < low || value > high) {
+        std::cerr << "Error: value " << value << " does not fit in " << width * 8 << " bits" << std::endl;
+        exit(ERROR::LARGE_VALUE_ERROR);
+    }
+}
+
+void CodeGen::_updateSymbolTable(std::vector<Symbol>& table, const std::string& name, const int& value) {
     for (auto& element : table) {
         if (element.name == name) {
             element.value = value;
@@ -76,10 +132,9 @@ void CodeGen::_updateSymbolTable(std::vector<_SymbolTable>& table, const std::st
     table.push_back({name, value});
 }
 
-int CodeGen::_getOpcode(const std::string& name, const std::string& addressing_mode) {
-    for (const Instruction& instr : _instructionsSet) {
-        if (instr.name == name && instr.addr_mode == addressing_mode) return instr.opcode;
-    }
+int CodeGen::_getOpcode(const std::string& name, AddressingMode mode) {
+    int opcode = findOpcode(name, mode);
+    if (opcode >= 0) return opcode;
 
     std::cerr << "Error: not a valid instructon or addressing mode" << std::endl;
     exit(ERROR::INSTR_ERROR);
@@ -102,13 +157,94 @@ std::string CodeGen::_getReg(const std::shared_ptr<ASTNode>& node) {
     return node->children[0]->data->substring;
 }
 
-int CodeGen::_findLabelVal(const std::string& name) {
-    for (const auto& label : _labelTable) {
-        if (label.name == name) return label.value;
+AddressingMode CodeGen::_indexedMode(const std::shared_ptr<ASTNode>& node, AddressingMode x, AddressingMode y) {
+    std::string reg = _getReg(node);
+    if (reg == "X") return x;
+    if (reg == "Y") return y;
+
+    std::cerr << "Error: not a valid instructon or addressing mode" << std::endl;
+    exit(ERROR::INSTR_ERROR);
+}
+
+bool CodeGen::_findSymbol(const std::vector<Symbol>& table, const std::string& name, int& value) {
+    for (const auto& element : table) {
+        if (element.name == name) {
+            value = element.value;
+            return true;
+        }
     }
+    return false;
+}
 
-    std::cerr << "Error: label used but not found" << std::endl;
-    exit(ERROR::LABEL_ERROR);
+bool CodeGen::_sameSymbols(const std::vector<Symbol>& a, const std::vector<Symbol>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].name != b[i].name || a[i].value != b[i].value) return false;
+    }
+    return true;
+}
+
+bool CodeGen::_needsAbsolute(const std::shared_ptr<ASTNode>& node, int value, AddressingMode zeropageMode) {
+    if (value > 0xff || _absoluteOperands.count(node.get()) || findOpcode(node->data->substring, zeropageMode) < 0) {
+        _absoluteOperands.insert(node.get());
+        return true;
+    }
+
+    // Zero page only reached through a forward reference would have been absolute without relaxation
+    if (_forwardReference) _shrunkOperands.insert(node.get());
+    return false;
+}
+
+void CodeGen::_emit(uint8_t byte) {
+    if (_address > MAX_MEMORY) {
+        std::cerr << "Error: code runs past the end of memory" << std::endl;
+        exit(ERROR::LARGE_VALUE_ERROR);
+    }
+
+    // Extend the current range, or open a new one after an .org jump
+    if (_usedRanges.empty() || _usedRanges.back().end != _address) _usedRanges.push_back({_address, _address});
+
+    _machineCode[_address++] = byte;
+    _usedRanges.back().end = _address;
+}
+
+void CodeGen::_mergeUsedRanges() {
+    std::sort(_usedRanges.begin(), _usedRanges.end(), [](const ImageRange& a, const ImageRange& b) { return a.start < b.start; });
+
+    std::vector<ImageRange> merged;
+    for (const auto& range : _usedRanges) {
+        if (!merged.empty() && range.start <= merged.back().end) merged.back().end = std::max(merged.back().end, range.end);
+        else merged.push_back(range);
+    }
+    _usedRanges = merged;
+}
+
+void CodeGen::_beginSection(const std::string& name, bool relocatable) {
+    _endSection();
+    _sections.push_back({name, relocatable, _address, _address});
+}
+
+void CodeGen::_endSection() {
+    if (_sections.empty()) return;
+
+    _Section& section = _sections.back();
+    section.end = std::max(section.end, _address);
+
+    // Relocatable code is assembled from address 0 and must stay clear of the .org region
+    if (section.relocatable && section.end > OFFSET) {
+        std::cerr << "Error: relocatable section is larger than " << OFFSET << " bytes" << std::endl;
+        exit(ERROR::OBJECT_ERROR);
+    }
+}
+
+int CodeGen::_findSection(int address, bool inclusiveEnd) {
+    for (size_t i = 0; i < _sections.size(); i++) {
+        const _Section& section = _sections[i];
+        if (address >= section.start && (address < section.end || (inclusiveEnd && address == section.end))) return i;
+    }
+
+    std::cerr << "Error: address " << address << " is outside of every section" << std::endl;
+    exit(ERROR::OBJECT_ERROR);
 }
 
 // Assigment Functions
@@ -121,22 +257,34 @@ void CodeGen::_orgAssigment(const std::shared_ptr<ASTNode>& node) {
         exit(ERROR::ORG_ERROR);
     }
 
+    if (_relocatable) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "org_%04x", _address);
+        _beginSection(name, false);
+    }
+
     //std::cout << _address << std::endl;
 }
 
 void CodeGen::_directiveAssignment(const std::shared_ptr<ASTNode>& node) {
     if (node->data->substring == "tx") {
         for (const char& c: node->value->substring) {
-            _machineCode[_address++] = static_cast<uint8_t>(c); 
+            _emit(static_cast<uint8_t>(c)); 
         }
 
-        _machineCode[_address++] = 0;
+        _emit(0);
     }
     else if (node->data->substring == "db") {
         for (const auto& child : node->children) {
-            _machineCode[_address++] = static_cast<uint8_t>(_convertToInt(child->data)); 
+            _emit(static_cast<uint8_t>(_operandValue(child, _address, 1))); 
         }
     }
+    else if (node->data->substring == "bound") {                        // Applies to the next instruction
+        _loopBounds.push_back({_address, _convertToInt(node->value)});
+    }
+    else if (node->data->substring == "var") {
+        _storageAssignment(node);
+    }
 }
 
 void CodeGen::_labelAssignment(const std::shared_ptr<ASTNode>& node) {
@@ -152,18 +300,88 @@ void CodeGen::_varAssignment(const std::shared_ptr<ASTNode>& node) {
     
 }
 
+void CodeGen::_storageAssignment(const std::shared_ptr<ASTNode>& node) {
+    const std::string& name = node->value->substring;
+
+    if (_relocatable) {
+        std::cerr << "Error: .var storage is only placed when assembling a full image" << std::endl;
+        exit(ERROR::OBJECT_ERROR);
+    }
+
+    // Declared on the first pass with a provisional zero page address, placed after it
+    if (_firstPass) {
+        if (_findStorage(name)) {
+            std::cerr << "Error: storage '" << name << "' is declared twice" << std::endl;
+            exit(ERROR::VAR_ERROR);
+        }
+
+        int size = node->children.empty() ? 1 : _convertToInt(node->children[0]->data);
+        if (size < 1 || size >= IMAGE_ROM_START) {
+            std::cerr << "Error: storage '" << name << "' has an invalid size" << std::endl;
+            exit(ERROR::LARGE_VALUE_ERROR);
+        }
+
+        auto accesses = _accesses.find(name);
+        _storage.push_back({name, size, 0, accesses == _accesses.end() ? 0 : accesses->second});
+        _sawForwardReference = true;
+    }
+
+    _updateSymbolTable(_varTable, name, _findStorage(name)->address);
+}
+
+CodeGen::Storage* CodeGen::_findStorage(const std::string& name) {
+    for (auto& storage : _storage) {
+        if (storage.name == name) return &storage;
+    }
+    return nullptr;
+}
+
+void CodeGen::_placeStorage() {
+    // Addresses named by ordinary variables, the stack page and the bus registers are never handed out
+    std::vector<bool> used(IMAGE_ROM_START, false);
+    std::fill(used.begin() + 0x100, used.begin() + 0x200, true);
+    std::fill(used.begin() + BUS_DEVICE_START, used.begin() + BUS_DEVICE_END, true);
+    for (const auto& var : _varTable) {
+        if (!_findStorage(var.name) && var.value >= 0 && var.value < IMAGE_ROM_START) used[var.value] = true;
+    }
+
+    std::vector<Storage*> order;
+    for (auto& storage : _storage) order.push_back(&storage);
+    std::stable_sort(order.begin(), order.end(), [](const Storage* a, const Storage* b) {
+        return a->accesses * b->size > b->accesses * a->size;
+    });
+
+    auto place = [&](Storage& storage, int start, int end) {
+        for (int address = start; address + storage.size <= end; address++) {
+            if (std::find(used.begin() + address, used.begin() + address + storage.size, true) != used.begin() + address + storage.size) continue;
+
+            std::fill(used.begin() + address, used.begin() + address + storage.size, true);
+            storage.address = address;
+            return true;
+        }
+        return false;
+    };
+
+    for (Storage* storage : order) {
+        if (place(*storage, 0, 0x100) || place(*storage, 0x200, IMAGE_ROM_START)) continue;
+
+        std::cerr << "Error: no RAM left for storage '" << storage->name << "'" << std::endl;
+        exit(ERROR::LARGE_VALUE_ERROR);
+    }
+}
+
 void CodeGen::_instructionCode(const std::shared_ptr<ASTNode>& node) {
     const std::string name = node->data->substring;
-    std::string addressing_mode;
+    AddressingMode mode = AddressingMode::IMPLIED;
     int opcode = 0;
     int operand_num = 0;
     auto operand = node->children; 
+    int start = _address;
 
     if (operand.empty()) {                                                                                                      // Implied
         
-        addressing_mode = "implied";
-        opcode =_getOpcode(name, addressing_mode);
-        _machineCode[_address++] = static_cast<uint8_t>(opcode);
+        opcode =_getOpcode(name, AddressingMode::IMPLIED);
+        _emit(static_cast<uint8_t>(opcode));
     } 
     else if (operand[0]->data->type == TokenType::IMMEDIATE) {                                                                  // Immediate
                
@@ -174,133 +392,274 @@ void CodeGen::_instructionCode(const std::shared_ptr<ASTNode>& node) {
         }
 
         if (operand[1]->data->type == TokenType::LABEL) {
-            std::cerr << "Error: Label can not be used as arguement for immediate" << std::endl;
+            std::cerr << "Error: Label can not be used as arguement for immediate, use <label or >label" << std::endl;
             exit(ERROR::SYNTAX_ERROR);
         }
 
         // Decode instruction
-        operand_num = _convertToInt(operand[1]->data);
+        operand_num = _operandValue(operand[1], _address + 1, 1);
 
-        if (operand_num > 0xff) {
-            std::cerr << "Error: Number must be 8 bit long for immediate" << std::endl;
-            exit(ERROR::SYNTAX_ERROR);
-        }
-
-        addressing_mode = "immediate";
-        opcode =_getOpcode(name, addressing_mode);
-        _machineCode[_address++] = static_cast<uint8_t>(opcode);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num);
+        opcode =_getOpcode(name, AddressingMode::IMMEDIATE);
+        _emit(static_cast<uint8_t>(opcode));
+        _emit(static_cast<uint8_t>(operand_num));
 
     }
     else if (operand[0]->data->type != TokenType::BRACKET && operand.size() == 1) {                                             // Zeropage/Absolute
-        operand_num = _convertToInt(operand[0]->data);
+        _forwardReference = false;
+        operand_num = _operandValue(operand[0], _address + 1, 0);
     
         // Figure out if it is zeropage or not
-        if (operand_num > 0xff && operand_num <= 0xffff) {                                                      // Absolute
-            addressing_mode = "absolute";
-            opcode =_getOpcode(name, addressing_mode);
-            _machineCode[_address++] = static_cast<uint8_t>(opcode);
-            _machineCode[_address++] = static_cast<uint8_t>(operand_num);
-            _machineCode[_address++] = static_cast<uint8_t>(operand_num >> 8);
-        }
-        else if (operand_num <= 0xff) {                                                                         // Zeropage
-            addressing_mode = "zeropage";
-            opcode =_getOpcode(name, addressing_mode);
-
-            _machineCode[_address++] = static_cast<uint8_t>(opcode);
-            _machineCode[_address++] = static_cast<uint8_t>(operand_num);
-        } 
-        else {
+        if (operand_num > 0xffff && !_labelReference) {
             std::cerr << "Error: Number can only be 16 bits long" << std::endl;
             exit(ERROR::SYNTAX_ERROR);
         }
+        else if (_needsAbsolute(node, operand_num, AddressingMode::ZEROPAGE)) {                                        // Absolute
+            opcode =_getOpcode(name, AddressingMode::ABSOLUTE);
+            _emit(static_cast<uint8_t>(opcode));
+            _emit(static_cast<uint8_t>(operand_num));
+            _emit(static_cast<uint8_t>(operand_num >> 8));
+        }
+        else {                                                                                                  // Zeropage
+            opcode =_getOpcode(name, AddressingMode::ZEROPAGE);
+
+            _emit(static_cast<uint8_t>(opcode));
+            _emit(static_cast<uint8_t>(operand_num));
+        } 
 
     }
     else if (operand[0]->data->type != TokenType::BRACKET && operand[1]->data->type == TokenType::COMMA) {                      // Zeropage/Absolute , X/Y
-        operand_num = _convertToInt(operand[0]->data);
+        _forwardReference = false;
+        operand_num = _operandValue(operand[0], _address + 1, 0);
+        mode = _indexedMode(operand[1], AddressingMode::ZEROPAGE_X, AddressingMode::ZEROPAGE_Y);
 
         // Figure out if it is zeropage or not
-        if (operand_num > 0xff && operand_num <= 0xffff) {                                                      // Absolute
-            addressing_mode = "absolute," + _getReg(operand[1]);
-            opcode =_getOpcode(name, addressing_mode);
+        if (operand_num > 0xffff && !_labelReference) {
+            std::cerr << "Error: Number can only be 16 bits long" << std::endl;
+            exit(ERROR::SYNTAX_ERROR);
+        }
+        else if (_needsAbsolute(node, operand_num, mode)) {                                                     // Absolute
+            opcode =_getOpcode(name, absoluteMode(mode));
 
-            _machineCode[_address++] = static_cast<uint8_t>(opcode);
-            _machineCode[_address++] = static_cast<uint8_t>(operand_num);
-            _machineCode[_address++] = static_cast<uint8_t>(operand_num >> 8);
+            _emit(static_cast<uint8_t>(opcode));
+            _emit(static_cast<uint8_t>(operand_num));
+            _emit(static_cast<uint8_t>(operand_num >> 8));
         }
-        else if (operand_num <= 0xff) {                                                                         // Zeropage
-            addressing_mode = "zeropage," + _getReg(operand[1]);
-            opcode =_getOpcode(name, addressing_mode);
+        else {                                                                                                  // Zeropage
+            opcode =_getOpcode(name, mode);
 
-            _machineCode[_address++] = static_cast<uint8_t>(opcode);
-            _machineCode[_address++] = static_cast<uint8_t>(operand_num);
+            _emit(static_cast<uint8_t>(opcode));
+            _emit(static_cast<uint8_t>(operand_num));
         } 
-        else {
-            std::cerr << "Error: Number can only be 16 bits long" << std::endl;
-            exit(ERROR::SYNTAX_ERROR);
-        }
 
     }
     else if (operand[0]->data->type == TokenType::BRACKET && operand.size() == 1 && operand[0]->children.size() == 1) {         // (indirect)
         
-        operand_num = _convertToInt(operand[0]->children[0]->data);
+        operand_num = _operandValue(operand[0]->children[0], _address + 1, 2);
 
-        addressing_mode = "(indirect)";
-        opcode =_getOpcode(name, addressing_mode);
-        _machineCode[_address++] = static_cast<uint8_t>(opcode);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num >> 8);
+        opcode =_getOpcode(name, AddressingMode::INDIRECT);
+        _emit(static_cast<uint8_t>(opcode));
+        _emit(static_cast<uint8_t>(operand_num));
+        _emit(static_cast<uint8_t>(operand_num >> 8));
 
     }
     else if (operand[0]->data->type == TokenType::BRACKET && operand.size() == 1) {                                             // (indirect , X/Y)
         auto bracketNodeChildren = operand[0]->children;
         auto commaNode = bracketNodeChildren[1];
 
-        operand_num = _convertToInt(bracketNodeChildren[0]->data);
-        addressing_mode = "(indirect," + _getReg(commaNode) + ")";
-        opcode =_getOpcode(name, addressing_mode);
+        operand_num = _operandValue(bracketNodeChildren[0], _address + 1, 2);
+        mode = _indexedMode(commaNode, AddressingMode::INDIRECT_X, AddressingMode::INDIRECT_Y);
+        opcode =_getOpcode(name, mode);
 
-        _machineCode[_address++] = static_cast<uint8_t>(opcode);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num >> 8);
+        _emit(static_cast<uint8_t>(opcode));
+        _emit(static_cast<uint8_t>(operand_num));
+        _emit(static_cast<uint8_t>(operand_num >> 8));
     }
     else if (operand[0]->data->type == TokenType::BRACKET && operand[1]->data->type == TokenType::COMMA) {                      // (indirect) , X/Y
         auto bracketNodeChildren = operand[0]->children;
         auto commaNode = operand[1];
 
-        operand_num = _convertToInt(bracketNodeChildren[0]->data);
+        operand_num = _operandValue(bracketNodeChildren[0], _address + 1, 2);
         
-        addressing_mode = "(indirect)," + _getReg(commaNode);
-        opcode =_getOpcode(name, addressing_mode);
+        mode = _indexedMode(commaNode, AddressingMode::INDIRECT_POST_X, AddressingMode::INDIRECT_POST_Y);
+        opcode =_getOpcode(name, mode);
+
+        _emit(static_cast<uint8_t>(opcode));
+        _emit(static_cast<uint8_t>(operand_num));
+        _emit(static_cast<uint8_t>(operand_num >> 8));
+    }
 
-        _machineCode[_address++] = static_cast<uint8_t>(opcode);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num);
-        _machineCode[_address++] = static_cast<uint8_t>(operand_num >> 8);
+    // The operand runs to the end of the instruction, one byte once relaxed to zero page
+    for (auto fixup = _fixups.rbegin(); fixup != _fixups.rend() && fixup->width == 0; fixup++) {
+        fixup->width = _address - fixup->address;
     }
+
+    _listing.push_back({start, _address - start, static_cast<uint8_t>(opcode), node.get()});
 }
 
 // Main Functions
 
+void CodeGen::printRelaxation() {
+    // Only worth reporting when some operand actually shrank
+    if (_shrunkOperands.empty()) return;
+
+    std::cout << "\nRelaxation: " << _passes << " passes, " << _shrunkOperands.size() << " instructions shrunk to zero page" << std::endl;
+}
+
+void CodeGen::printPlacement() {
+    if (_storage.empty()) return;
+
+    // Each instruction that names a storage variable, and the cycles its zero page form saves
+    std::map<std::string, std::pair<int, int>> references;          // Name to references, cycles saved by all of them
+    std::map<std::string, int> zeropageReferences;
+
+    for (const auto& entry : _listing) {
+        const Opcode& instr = OPCODE_TABLE[entry.opcode];
+
+        std::vector<const ASTNode*> pending(1, entry.node);
+        while (!pending.empty()) {
+            const ASTNode* operand = pending.back();
+            pending.pop_back();
+            for (const auto& child : operand->children) pending.push_back(child.get());
+            if (operand->data->type != TokenType::IDENTIFIER || !_findStorage(operand->data->substring)) continue;
+
+            auto& reference = references[operand->data->substring];
+            reference.first++;
+
+            if (!isZeropage(instr.mode)) continue;
+            int absolute = findOpcode(instr.mnemonic, absoluteMode(instr.mode));
+            if (absolute < 0) continue;
+
+            reference.second += OPCODE_TABLE[absolute].maxCycles - instr.maxCycles;
+            zeropageReferences[operand->data->substring]++;
+        }
+    }
+
+    // Profiled accesses are spread evenly over the instructions that name the variable
+    char row[96];
+    double totalCycles = 0;
+    int totalBytes = 0;
+
+    std::cout << "\nStorage placement (zero page by accesses per byte)" << std::endl;
+    std::snprintf(row, sizeof(row), "  %-24s %7s %5s %12s %6s %12s", "name", "address", "size", "accesses", "zp ops", "cycles saved");
+    std::cout << row << std::endl;
+
+    for (const auto& storage : _storage) {
+        auto reference = references[storage.name];
+        double saved = reference.first ? static_cast<double>(storage.accesses) * reference.second / reference.first : 0;
+        totalCycles += saved;
+        totalBytes += zeropageReferences[storage.name];
+
+        std::snprintf(row, sizeof(row), "  %-24s   $%04x %5d %12llu %6d %12.0f", storage.name.c_str(), storage.address, storage.size,
+            static_cast<unsigned long long>(storage.accesses), zeropageReferences[storage.name], saved);
+        std::cout << row << std::endl;
+    }
+
+    std::snprintf(row, sizeof(row), "Estimated saving: %.0f cycles, %d bytes against absolute placement", totalCycles, totalBytes);
+    std::cout << row << std::endl;
+}
+
 void CodeGen::printFile(const std::string& outputPath) {
-    std::ofstream outFile(outputPath, std::ios::binary);
-    if (!outFile) {
-        std::cerr << "Error opening file for writing." << std::endl;
-        return;
+    _mergeUsedRanges();
+    if (!writeImage(outputPath, _machineCode, _usedRanges)) exit(ERROR::FILE_ERROR);
+}
+
+void CodeGen::printObject(const std::string& outputPath, const std::string& moduleName) {
+    ObjectFile object;
+    object.module = moduleName;
+
+    for (const auto& section : _sections) {
+        object.sections.push_back({section.name, section.relocatable, section.start,
+            std::vector<uint8_t>(_machineCode.begin() + section.start, _machineCode.begin() + section.end)});
     }
-    outFile.write(reinterpret_cast<const char*>(&_machineCode[OFFSET]), MAX_MEMORY - OFFSET + 1);
+
+    for (const auto& label : _labelTable) {
+        int section = _findSection(label.value, true);
+        object.symbols.push_back({label.name, section, label.value - _sections[section].start});
+    }
+
+    for (const auto& element : _labelReplacementLocation) {
+        int section = _findSection(element.first, false);
+        object.relocations.push_back({section, element.first - _sections[section].start, element.second});
+    }
+
+    object.write(outputPath);
+}
+
+const std::vector<ImageRange>& CodeGen::usedRanges() {
+    _mergeUsedRanges();
+    return _usedRanges;
+}
+
+void CodeGen::printSymbols(const std::string& symbolPath, const Preprocessor& preprocessor) {
+    SymbolMap symbols;
+    buildSymbols(symbols, preprocessor);
+    if (!symbols.write(symbolPath)) exit(ERROR::FILE_ERROR);
+}
+
+void CodeGen::buildSymbols(SymbolMap& symbols, const Preprocessor& preprocessor) {
+    symbols.files = preprocessor.files;
+
+    // A label covers its block of code up to the next label or the end of the populated range
+    _mergeUsedRanges();
+    std::vector<Symbol> labels = _labelTable;
+    std::stable_sort(labels.begin(), labels.end(), [](const Symbol& a, const Symbol& b) { return a.value < b.value; });
+
+    for (size_t i = 0; i < labels.size(); i++) {
+        int end = labels[i].value;
+        for (const auto& range : _usedRanges) {
+            if (labels[i].value >= range.start && labels[i].value < range.end) end = range.end;
+        }
+        for (size_t j = i + 1; j < labels.size(); j++) {
+            if (labels[j].value > labels[i].value) {
+                end = std::min(end, labels[j].value);
+                break;
+            }
+        }
+        symbols.labels.push_back({labels[i].name, labels[i].value, end});
+    }
+
+    // Storage is a label over its bytes, so emulator -m can attribute accesses to it
+    for (const auto& storage : _storage) symbols.labels.push_back({storage.name, storage.address, storage.address + storage.size});
+
+    for (const auto& var : _varTable) symbols.variables.push_back({var.name, var.value & 0xffff});
+
+    for (const auto& entry : _listing) {
+        const Token& token = *entry.node->data;
+        if (token.line > 0) symbols.lines.push_back({entry.address, entry.size, token.file, token.line});
+    }
+
+    symbols.sort();
 }
 
 void CodeGen::_updateLabels() {
 
-    for (auto element : _labelReplacementLocation) {
-        _address = element.first;
-        int value = _findLabelVal(element.second);
+    for (const auto& fixup : _fixups) {
+        _address = fixup.address;
+        int value = _evaluateExpression(fixup.expression);
 
+        _checkRange(value, fixup.width);
         _machineCode[_address++] = static_cast<uint8_t>(value);
-        _machineCode[_address++] = static_cast<uint8_t>(value >> 8);
+        if (fixup.width == 2) _machineCode[_address++] = static_cast<uint8_t>(value >> 8);
     }
 }
 
+void CodeGen::_resetPass() {
+    _prevVarTable = std::move(_varTable);
+    _prevLabelTable = std::move(_labelTable);
+    _varTable.clear();
+    _labelTable.clear();
+
+    _fixups.clear();
+    _labelReplacementLocation.clear();
+    _listing.clear();
+    _loopBounds.clear();
+    _usedRanges.clear();
+    _sections.clear();
+    _shrunkOperands.clear();
+    std::fill(_machineCode.begin(), _machineCode.end(), 0);
+    _address = 0;
+}
+
 void CodeGen::_generateNodeCode(const std::shared_ptr<ASTNode>& node) {
     if (!node) return;
 
@@ -337,14 +696,35 @@ void CodeGen::generateCode() {
     // Ensure AST's first node is a org with a valid
     std::shared_ptr<ASTNode> firstChild = _ast->children.front();
 
-    if (firstChild->data->type != TokenType::ORG) {
+    if (!_relocatable && firstChild->data->type != TokenType::ORG) {
         std::cerr << "Error: First child of the root is not an 'org'. Code generation aborted." << std::endl;
         exit(ERROR::ORG_ERROR);
     }
 
-    // Now generate code
-    _generateNodeCode(_ast);
-    _updateLabels();
+    // Now generate code, repeating until every symbol and operand size is stable. Names the first
+    // pass had to guess always get a second pass, where only those still undefined are imports
+    size_t absoluteOperands;
+    do {
+        if (_passes == MAX_PASSES) {
+            std::cerr << "Error: symbol values do not converge" << std::endl;
+            exit(ERROR::VAR_ERROR);
+        }
+        _firstPass = _passes++ == 0;
+        if (!_firstPass) _resetPass();
+        absoluteOperands = _absoluteOperands.size();
+        _sawForwardReference = false;
+
+        // Code before the first .org becomes the section the linker places
+        if (_relocatable && firstChild->data->type != TokenType::ORG) _beginSection("text", true);
+
+        _generateNodeCode(_ast);
+        if (_firstPass && !_storage.empty()) _placeStorage();
+    } while (_sawForwardReference && (_firstPass || absoluteOperands != _absoluteOperands.size() || !_sameSymbols(_varTable, _prevVarTable) ||
+                                      !_sameSymbols(_labelTable, _prevLabelTable)));
+
+    // Objects keep their label references as relocations for the linker
+    if (_relocatable) _endSection();
+    else _updateLabels();
 
     /*
     for (auto& element : _varTable) {
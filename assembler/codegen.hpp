@@ -4,36 +4,119 @@
 #include "main.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "object.hpp"
+#include "preprocessor.hpp"
+#include "image.hpp"
+#include "symbols.hpp"
+#include "profile.hpp"
+#include "isa.hpp"
+#include "devices.hpp"
+
+#include <unordered_set>
+#include <map>
+
+#define MAX_PASSES      64
 
 class CodeGen {
 public:
-    CodeGen(const Parser& parser, const std::vector<Instruction>& instructionSet)
-    : _ast(parser.rootNode), _instructionsSet(instructionSet) {}
+    CodeGen(const Parser& parser, bool relocatable = false)
+    : _ast(parser.rootNode), _relocatable(relocatable) {}
 
     void generateCode();
+    void printRelaxation();
     void printFile(const std::string& outputPath);
+    void printObject(const std::string& outputPath, const std::string& moduleName);
+    void printSymbols(const std::string& symbolPath, const Preprocessor& preprocessor);
+    void buildSymbols(SymbolMap& symbols, const Preprocessor& preprocessor);
+
+    struct Symbol {
+        std::string name;
+        int value;
+    };
+
+    // Relocatable storage from .var, placed once the first pass has seen every declaration
+    struct Storage {
+        std::string name;
+        int size;
+        int address;
+        uint64_t accesses;                                  // Reads and writes in the access profile
+    };
+
+    void setAccessProfile(const std::map<std::string, uint64_t>& accesses) { _accesses = accesses; }
+    void printPlacement();
+
+    // One emitted instruction, kept for the timing analyzer's listing
+    struct ListingEntry {
+        int address;
+        int size;
+        uint8_t opcode;
+        const ASTNode* node;
+    };
+
+    const std::vector<uint8_t>& machineCode() const { return _machineCode; }
+    const std::vector<ImageRange>& usedRanges();
+    const std::vector<Symbol>& labels() const { return _labelTable; }
+    const std::vector<ListingEntry>& listing() const { return _listing; }
+    const std::vector<std::pair<int, int>>& loopBounds() const { return _loopBounds; }
+    const std::vector<Storage>& storage() const { return _storage; }
 
 private:
     const std::shared_ptr<ASTNode> _ast;
-    const std::vector<Instruction> _instructionsSet;
+    const bool _relocatable;
 
     int _address = 0;
     std::vector<uint8_t> _machineCode = std::vector<uint8_t>(MAX_MEMORY + 1, 0);
+    std::vector<ImageRange> _usedRanges;                    // Grown by _emit as code is generated
 
-    struct _SymbolTable {
-        std::string name;
-        int value;
+    std::vector<Symbol> _varTable;
+    std::vector<Symbol> _labelTable;
+
+    // Addressing mode relaxation: forward references use the previous pass' values and an
+    // operand that ever needed absolute addressing stays absolute, so passes only grow code
+    std::vector<Symbol> _prevVarTable;
+    std::vector<Symbol> _prevLabelTable;
+    std::unordered_set<const ASTNode*> _absoluteOperands;
+    std::unordered_set<const ASTNode*> _shrunkOperands;
+    bool _forwardReference = false;                         // Set by _convertToInt for the current operand
+    bool _labelReference = false;
+    bool _relocation = false;                               // Value is left to the linker
+    bool _sawForwardReference = false;
+    bool _firstPass = true;
+    int _passes = 0;
+
+    // Operands and data that use labels, evaluated again once every label is known.
+    // Instruction operands are recorded with a width of 0 until their addressing mode is chosen.
+    struct _Fixup {
+        int address;
+        int width;
+        std::shared_ptr<ASTNode> expression;
     };
 
-    std::vector<_SymbolTable> _varTable;
-    std::vector<_SymbolTable> _labelTable;
+    std::vector<_Fixup> _fixups;
+    std::vector<std::pair<int, std::string>> _labelReplacementLocation;     // Object relocations
+    std::vector<ListingEntry> _listing;
+    std::vector<std::pair<int, int>> _loopBounds;          // .bound: address of the loop head, iterations
 
-    std::vector<std::pair<int, std::string>> _labelReplacementLocation;
+    // Zero page goes to the storage with the most accesses per byte, the rest to RAM above the stack
+    std::map<std::string, uint64_t> _accesses;
+    std::vector<Storage> _storage;
+
+    // Sections are only tracked when generating a relocatable object
+    struct _Section {
+        std::string name;
+        bool relocatable;
+        int start;
+        int end;
+    };
+
+    std::vector<_Section> _sections;
 
     int _convertToInt(const std::unique_ptr<Token>& node);
     int _evaluateExpression(const std::shared_ptr<ASTNode>& node);
-    void _updateSymbolTable(std::vector<_SymbolTable>& table, const std::string& name, const int& value);
-    int _getOpcode(const std::string& name, const std::string& addressing_mode);
+    int _operandValue(const std::shared_ptr<ASTNode>& node, int location, int width);
+    void _checkRange(int value, int width);
+    void _updateSymbolTable(std::vector<Symbol>& table, const std::string& name, const int& value);
+    int _getOpcode(const std::string& name, AddressingMode mode);
     
     void _generateNodeCode(const std::shared_ptr<ASTNode>& node);
     void _updateLabels();
@@ -42,9 +125,23 @@ private:
     void _directiveAssignment(const std::shared_ptr<ASTNode>& node);
     void _labelAssignment(const std::shared_ptr<ASTNode>& node);
     void _varAssignment(const std::shared_ptr<ASTNode>& node);
+    void _storageAssignment(const std::shared_ptr<ASTNode>& node);
+    Storage* _findStorage(const std::string& name);
+    void _placeStorage();
     void _instructionCode(const std::shared_ptr<ASTNode>& node);
     std::string _getReg(const std::shared_ptr<ASTNode>& node);
-    int _findLabelVal(const std::string& name);
+    AddressingMode _indexedMode(const std::shared_ptr<ASTNode>& node, AddressingMode x, AddressingMode y);
+    bool _findSymbol(const std::vector<Symbol>& table, const std::string& name, int& value);
+    bool _sameSymbols(const std::vector<Symbol>& a, const std::vector<Symbol>& b);
+    bool _needsAbsolute(const std::shared_ptr<ASTNode>& node, int value, AddressingMode zeropageMode);
+    void _resetPass();
+
+    void _emit(uint8_t byte);
+    void _mergeUsedRanges();
+
+    void _beginSection(const std::string& name, bool relocatable);
+    void _endSection();
+    int _findSection(int address, bool inclusiveEnd);
 };
 
 #endif
\ No newline at end of file
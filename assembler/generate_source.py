@@ -0,0 +1,175 @@
+import argparse
+import os
+import random
+
+# Generates a synthetic tasml project for benchmarking the assembler (see bench.cpp).
+# The ROM only has room for 48K of code, so code is spread over 4K .org windows that are
+# reused once they are all full; the image is meaningless but every line is assembled.
+
+WINDOWS = [0x5000 + 0x1000 * i for i in range(10)]
+WINDOW_SIZE = 0x1000
+
+IMPLIED = ["inx", "dex", "iny", "dey", "clc", "sec", "tax", "tay", "pha", "pla", "nop", "out"]
+IMMEDIATE = ["lda", "ldx", "ldy", "adc", "sub", "and", "ora", "eor", "cmp"]
+ZEROPAGE = ["lda", "sta", "inc", "dec", "asl", "lsr", "adc", "cmp"]
+BRANCHES = ["beq", "bne", "bcc", "bcs", "bmi", "bpl"]
+WORDS = ["alpha", "beta", "gamma", "delta", "loop", "value", "table", "index", "count", "print", "hello", "world"]
+
+
+class SourceFile:
+    def __init__(self, name, prefix, rng, args, state):
+        self.name = name
+        self.prefix = prefix
+        self.rng = rng
+        self.args = args
+        self.state = state
+        self.lines = []
+        self.labels = []
+        self.variables = []
+        self.pages = []                         # Zero page variables, usable as memory operands
+
+    def label(self):
+        name = f"{self.prefix}_l{len(self.labels)}"
+        self.labels.append(name)
+        return name
+
+    def org(self):
+        window = WINDOWS[self.state["window"] % len(WINDOWS)]
+        self.state["window"] += 1
+        self.state["used"] = 0
+        self.lines.append(f".org ${window:04x}")
+
+    def reserve(self, size):
+        # Open the next window before code would run off the end of this one
+        if self.state["used"] + size > WINDOW_SIZE:
+            self.org()
+        self.state["used"] += size
+
+    def value(self, depth):
+        # Numbers and earlier variables combined into an expression tree
+        if depth == 0 or self.rng.random() < 0.3:
+            if self.variables and self.rng.random() < 0.4:
+                return self.rng.choice(self.variables)
+            return self.rng.choice([str(self.rng.randint(0, 99)), f"${self.rng.randint(0, 255):02x}", f"%{self.rng.randint(0, 15):04b}"])
+
+        operator = self.rng.choice(["+", "-", "*", "/"])
+        left = self.value(depth - 1)
+        if operator in "*/":
+            # The parser groups * and / to the right, so keep divisors from folding to zero
+            return f"({left}) {operator} {self.rng.randint(1, 9)}"
+        right = self.value(depth - 1)
+        return f"({left} {operator} {right})" if self.rng.random() < 0.5 else f"{left} {operator} {right}"
+
+    def variable(self):
+        name = f"{self.prefix}_v{len(self.variables)}"
+        self.lines.append(f"{name} = {self.value(self.args.expression_depth)}")
+        self.variables.append(name)
+
+    def zeropage(self):
+        name = f"{self.prefix}_zp{len(self.pages)}"
+        self.lines.append(f"{name} = ${self.rng.randint(0x10, 0xff):02x}")
+        self.pages.append(name)
+
+    def data(self):
+        if self.rng.random() < 0.5:
+            text = " ".join(self.rng.choice(WORDS) for _ in range(self.rng.randint(1, 8)))
+            self.reserve(len(text) + 1)
+            self.lines.append(f"    .tx \"{text}\"")
+        else:
+            items = [self.rng.choice([str(self.rng.randint(0, 255)), f"${self.rng.randint(0, 255):02x}",
+                                      f"%{self.rng.randint(0, 255):08b}", f"'{self.rng.choice('abcxyz')}'"])
+                     for _ in range(self.rng.randint(1, 12))]
+            self.reserve(len(items))
+            self.lines.append("    .db " + " ".join(items))
+
+    def instruction(self):
+        self.reserve(3)
+        kind = self.rng.random()
+        target = self.rng.choice(self.labels) if self.labels else None
+
+        if kind < 0.2 or not target:
+            text = self.rng.choice(IMPLIED)
+        elif kind < 0.45:
+            value = self.rng.choice([str(self.rng.randint(0, 255)), f"<{target}", f">{target}"])
+            text = f"{self.rng.choice(IMMEDIATE)} #{value}"
+        elif kind < 0.65 and self.pages:
+            text = f"{self.rng.choice(ZEROPAGE)} {self.rng.choice(self.pages)}"
+        elif kind < 0.8:
+            offset = self.rng.randint(0, 15)
+            operand = f"{target}+{offset}" if offset else target
+            text = f"lda {operand},rX" if self.rng.random() < 0.3 else f"lda {operand}"
+        elif kind < 0.95:
+            text = f"{self.rng.choice(BRANCHES)} {target}"
+        else:
+            text = f"jmp ({target})"
+
+        if self.rng.random() < 0.1:
+            text += "            ; " + " ".join(self.rng.choice(WORDS) for _ in range(3))
+        self.lines.append("    " + text)
+
+    def body(self, count):
+        self.org()
+        self.lines.append(f"{self.prefix}_entry:")
+        self.labels.append(f"{self.prefix}_entry")
+        self.zeropage()
+
+        while len(self.lines) < count:
+            roll = self.rng.random()
+            if roll < self.args.label_density:
+                self.lines.append(f"{self.label()}:")
+            elif roll < self.args.label_density + self.args.data:
+                self.data()
+            elif roll < self.args.label_density + self.args.data + 0.05:
+                self.variable()
+            elif roll < self.args.label_density + self.args.data + 0.07:
+                self.zeropage()
+            elif roll < self.args.label_density + self.args.data + 0.08:
+                self.lines.append("/* " + " ".join(self.rng.choice(WORDS) for _ in range(6)) + " */")
+            else:
+                self.instruction()
+
+        self.reserve(1)
+        self.lines.append("    rts")
+
+    def write(self, directory):
+        with open(os.path.join(directory, self.name), "w") as file:
+            file.write("\n".join(self.lines) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a synthetic tasml project")
+    parser.add_argument("output", help="directory to write main.tasml and its includes to")
+    parser.add_argument("--lines", type=int, default=100000, help="total source lines")
+    parser.add_argument("--label-density", type=float, default=0.1, help="fraction of lines that declare a label")
+    parser.add_argument("--expression-depth", type=int, default=3, help="depth of variable expressions")
+    parser.add_argument("--data", type=float, default=0.1, help="fraction of lines that are .tx/.db data")
+    parser.add_argument("--includes", type=int, default=8, help="number of included files")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    state = {"window": 0, "used": 0}
+    os.makedirs(args.output, exist_ok=True)
+
+    files = [SourceFile(f"lib{i}.tasml", f"lib{i}", rng, args, state) for i in range(args.includes)]
+    perFile = max(16, args.lines // (args.includes + 1))
+
+    # main calls every library, which follow it in include order
+    main = SourceFile("main.tasml", "main", rng, args, state)
+    main.lines += [".org $4000", "main:"]
+    main.lines += [f"    jsr {library.prefix}_entry" for library in files]
+    main.lines += ["    hlt"]
+    state["used"] = WINDOW_SIZE
+    main.body(perFile)
+    main.lines += [f".include <{library.name}>" for library in files]
+    main.write(args.output)
+
+    for library in files:
+        library.body(perFile)
+        library.write(args.output)
+
+    print(f"Wrote {sum(len(f.lines) for f in files) + len(main.lines)} lines to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,51 +1,46 @@
-import csv
-
-def append_instructions_to_header(csv_filename, header_filename):
-    # Read instructions from CSV file
-    with open(csv_filename, 'r') as file:
-        reader = csv.reader(file, delimiter='|')
-        instructions = [row for row in reader if row]
-
-    # Generate C++ code for the instruction set
-    cpp_code = "\ninline const std::vector<Instruction> createInstructionSet() {\n"
-    cpp_code += "    std::vector<Instruction> instructionSet;\n"
-    for name, opcode, addr_mode in instructions:
-        cpp_code += f"    instructionSet.push_back({{\"{name}\", {opcode}, \"{addr_mode}\"}});\n"
-    cpp_code += "    return instructionSet;\n"
-    cpp_code += "}\n"
-
-    # Read the current contents of the header file
+import re
+import sys
+
+def read_opcodes(header_filename):
+    # Rows of the OPCODES table in isa.hpp: {opcode, "mnemonic", MODE, min, max}
+    row = re.compile(r'\{\s*(\d+),\s*"(\w+)",\s*(\w+),\s*(\d+),\s*(\d+)\}')
+
     with open(header_filename, 'r') as file:
-        lines = file.readlines()
-
-    # Check if the function already exists
-    func_start = None
-    func_end = None
-    for i, line in enumerate(lines):
-        if 'inline const std::vector<Instruction> createInstructionSet()' in line:
-            func_start = i
-        if func_start is not None and line.strip() == '}' and func_end is None:
-            func_end = i
-            break
-
-    # Replace or insert the function
-    if func_start is not None and func_end is not None:
-        # Ensure only one newline before the function
-        if func_start > 0 and lines[func_start - 1].strip() != '':
-            cpp_code = '\n' + cpp_code
-        lines[func_start-1:func_end + 1] = [cpp_code]
-    else:
-        # Find the position to insert the generated code
-        insert_pos = next(i for i, line in enumerate(lines) if line.strip() == '#endif') - 1
-        # Ensure only one newline before the function
-        lines.insert(insert_pos, cpp_code)
-
-    # Write back to the header file
-    with open(header_filename, 'w') as file:
-        file.writelines(lines)
+        return [(int(opcode), name, mode, int(low), int(high)) for opcode, name, mode, low, high in row.findall(file.read())]
+
+def microcode_cycles(rom, opcode):
+    # Count the microcode substeps of an opcode up to the one that ends the instruction (EP).
+    # Conditional branches take a different number of steps depending on the flags, so keep
+    # the fastest and the slowest variant over all flag states.
+    EP = 1 << 19
+    FLAG_STATES, SUBSTEPS = 128, 8
+
+    def control_word(address):
+        return int.from_bytes(rom[address * 5:address * 5 + 5], 'little')
+
+    counts = set()
+    for flag in range(FLAG_STATES):
+        words = [control_word((flag << 11) | (opcode << 3) | substep) for substep in range(SUBSTEPS)]
+        steps = next((i + 1 for i, word in enumerate(words) if word & EP), None)
+        # Instructions without an end step (hlt) stop the clock after their last step
+        counts.add(steps if steps is not None else sum(1 for word in words if word))
+    return min(counts), max(counts)
+
+def check_cycles(header_filename, microcode_filename):
+    # The ISA lives in isa.hpp, this only makes sure its cycle counts still match the microcode
+    with open(microcode_filename, 'rb') as file:
+        rom = file.read()
+
+    errors = 0
+    for opcode, name, mode, low, high in read_opcodes(header_filename):
+        steps = microcode_cycles(rom, opcode)
+        if steps != (low, high):
+            print(f"Error: {opcode} {name} {mode} takes {steps[0]}/{steps[1]} steps in {microcode_filename}, isa.hpp says {low}/{high}")
+            errors += 1
+    return errors
 
 def main():
-    append_instructions_to_header("instructions.csv", "assembler.hpp")
+    if check_cycles("../common/isa.hpp", "../microcode.bin"): sys.exit(1)
 
 if __name__ == '__main__':    
-    main()
\ No newline at end of file
+    main()
@@ -1,4 +1,11 @@
 #include "lexer.hpp"
+#include "macro.hpp"
+#include "charclass.hpp"
+
+#include <atomic>
+#include <thread>
+
+static constexpr size_t SLICE_SIZE = 32 * 1024;        // Source bytes per lexer work item
 
 void Lexer::print() {
     for (size_t i = 0; i < _tokenList.size(); i++) {
@@ -28,12 +35,6 @@ std::shared_ptr<Token> Lexer::getToken() {
     return std::make_shared<Token>(_tokenList[_tokenIndex++]);
 }
 
-bool Lexer::_isInInstructionSet() {
-    for (size_t i = 0; i < _instructionSet.size(); i++) 
-        if (_buf == _instructionSet[i].name) return true;
-    return false;
-}
-
 bool Lexer::_isInList(const std::vector<Token>& list, const Token& token) {
     for (size_t i = 0; i < list.size(); i++) {
         if (token.substring == list[i].substring) return true;
@@ -58,173 +59,268 @@ void Lexer::_sortLabels() {
     }
 }
 
-void Lexer::tokenize() {
+void Lexer::_tokenizeSlice(_Slice& slice, bool inBlockComment) const {
+    std::string_view text = slice.text;
+    std::vector<Token>& tokens = slice.tokens;
+    std::string buf;
+    int lineNumber = 0;
 
-    for (size_t i = 0; i < _sourceCode.length(); i++) {
+    tokens.clear();
+    slice.clean = false;
+    slice.decimalPoint = false;
 
-        if (i+1 < _sourceCode.length() && _sourceCode[i] == '/' && _sourceCode[i+1] == '*') {                    // Comment Block
-            i += 2;
-            while (i < _sourceCode.length() && !(_sourceCode[i] == '*' && _sourceCode[i+1] == '/')) {
-                //if (_sourceCode[i] == '\n') _lineNumber++;
-                i++;
-            }
-            i++;   
-            //_tokenList.push_back({"Comment Block", TokenType::COMMENT, _lineNumber});
+    for (size_t i = 0; i < text.length(); i++) {
+        size_t tokenCount = tokens.size();
+        int line = lineNumber;
+
+        if (inBlockComment || (i+1 < text.length() && text[i] == '/' && text[i+1] == '*')) {                     // Comment Block
+            if (!inBlockComment) i += 2;
+            size_t end = std::min(text.find("*/", i), text.length());
+            lineNumber += countNewlines(text, i, end);
+            i = end;
+            inBlockComment = i >= text.length();
+            if (!inBlockComment) i++;
+            //tokens.push_back({"Comment Block", TokenType::COMMENT, lineNumber});
         }
-        else if (_sourceCode[i] == ';') {                                                                        // Comment
-            while (_sourceCode[i] != '\n') i++;
-            i--;
-            //_tokenList.push_back({"Inline Comment", TokenType::COMMENT, _lineNumber});
+        else if (text[i] == ';') {                                                                               // Comment
+            i = text.find('\n', i) - 1;
+            //tokens.push_back({"Inline Comment", TokenType::COMMENT, lineNumber});
         }
-        else if (_sourceCode[i] == '.' && std::isalpha(_sourceCode[i+1])) {                                      // Preprocessor
-            _buf.clear();
-
-            i++;
-            while (i < _sourceCode.length() && std::isalnum(_sourceCode[i])) {
-                _buf.push_back(_sourceCode[i]);
-                i++;
-            }
-            i--;
+        else if (text[i] == '.' && isCharClass(text[i+1], CHAR_ALPHA)) {                                         // Preprocessor
+            size_t end = skipCharClass(text, i + 1, CHAR_ALNUM);
+            buf.assign(text.substr(i + 1, end - i - 1));
+            i = end - 1;
 
-            if(_buf == "db" || _buf == "tx") {
-                _tokenList.push_back({_buf, TokenType::DIRECTIVE});
-            } else if (_buf == "org") {
-                _tokenList.push_back({_buf, TokenType::ORG});
+            if(buf == "db" || buf == "tx" || buf == "bound" || buf == "macro" || buf == "endm" || buf == "rept" || buf == "endr" || buf == "table" || buf == "var") {
+                tokens.push_back({buf, TokenType::DIRECTIVE});
+            } else if (buf == "org") {
+                tokens.push_back({buf, TokenType::ORG});
             }
 
         }
-        else if (std::isalpha(_sourceCode[i])) {                                                                 // Alpha Character
-            _buf.clear();
+        else if (isCharClass(text[i], CHAR_ALPHA)) {                                                             // Alpha Character
+            size_t end = skipCharClass(text, i, CHAR_IDENTIFIER);
+            buf.assign(text.substr(i, end - i));
+            i = end - 1;
 
-            while (i < _sourceCode.length() && (std::isalnum(_sourceCode[i]) || _sourceCode[i] == '_')) {
-                _buf.push_back(_sourceCode[i]);
-                i++;
-            }
-            i--;
-
-            if (_isInInstructionSet()) {                                                                        // Instruction
-                _tokenList.push_back({_buf, TokenType::INSTRUCTION});
-            } else if (_sourceCode[i+1] == ':') {                                                                // Label Declaration
-                _tokenList.push_back({_buf, TokenType::LABEL_DECLARE});
-            } else if (_buf == "rX" || _buf == "rY") {                                                          // Registers
-                _tokenList.push_back({_buf.erase(0,1), TokenType::REG});
+            if (isMnemonic(buf)) {                                                                              // Instruction
+                tokens.push_back({buf, TokenType::INSTRUCTION});
+            } else if (text[i+1] == ':') {                                                                      // Label Declaration
+                tokens.push_back({buf, TokenType::LABEL_DECLARE});
+            } else if (buf == "rX" || buf == "rY") {                                                            // Registers
+                tokens.push_back({buf.erase(0,1), TokenType::REG});
             } else {
-                _tokenList.push_back({_buf, TokenType::IDENTIFIER});
+                tokens.push_back({buf, TokenType::IDENTIFIER});
             }
         }
-        else if (_sourceCode[i] == '=') {                                                                        // Equals
-            _tokenList.push_back({"=", TokenType::EQUAL});
+        else if (text[i] == '=') {                                                                               // Equals
+            tokens.push_back({"=", TokenType::EQUAL});
+        }
+        else if (text[i] == '#') {                                                                               // Immediate
+            tokens.push_back({"#", TokenType::IMMEDIATE});                              
         }
-        else if (_sourceCode[i] == '#') {                                                                        // Immediate
-            _tokenList.push_back({"#", TokenType::IMMEDIATE});                              
+        else if (text[i] == '(') {                                                                               // Left Paren
+            tokens.push_back({"(", TokenType::L_PAREN});                              
         }
-        else if (_sourceCode[i] == '(') {                                                                        // Left Paren
-            _tokenList.push_back({"(", TokenType::L_PAREN});                              
+        else if (text[i] == ')') {                                                                               // Right Paren
+            tokens.push_back({")", TokenType::R_PAREN});                              
         }
-        else if (_sourceCode[i] == ')') {                                                                        // Right Paren
-            _tokenList.push_back({")", TokenType::R_PAREN});                              
+        else if (text[i] == '-') {                                                                               // Minus
+            tokens.push_back({"-", TokenType::MINUS});                                
         }
-        else if (_sourceCode[i] == '-') {                                                                        // Minus
-            _tokenList.push_back({"-", TokenType::MINUS});                                
+        else if (text[i] == '+') {                                                                               // Plus
+            tokens.push_back({"+", TokenType::PLUS});                                
         }
-        else if (_sourceCode[i] == '+') {                                                                        // Plus
-            _tokenList.push_back({"+", TokenType::PLUS});                                
+        else if (text[i] == '/') {                                                                               // Divide
+            tokens.push_back({"/", TokenType::DIV});                                
         }
-        else if (_sourceCode[i] == '/') {                                                                        // Divide
-            _tokenList.push_back({"/", TokenType::DIV});                                
+        else if (text[i] == '*') {                                                                               // Multiply
+            tokens.push_back({"*", TokenType::MUL});                                
         }
-        else if (_sourceCode[i] == '*') {                                                                        // Multiply
-            _tokenList.push_back({"*", TokenType::MUL});                                
+        else if (text[i] == '<') {                                                                               // Low Byte
+            tokens.push_back({"<", TokenType::LOW});
         }
-        else if (_sourceCode[i] == ',') {                                                                        // Comma
-            _tokenList.push_back({",", TokenType::COMMA});                                      
+        else if (text[i] == '>') {                                                                               // High Byte
+            tokens.push_back({">", TokenType::HIGH});
         }
-        else if (_sourceCode[i] == '\'') {                                                                       // Char
-            _buf.clear();
+        else if (text[i] == ',') {                                                                               // Comma
+            tokens.push_back({",", TokenType::COMMA});                                      
+        }
+        else if (text[i] == '\'') {                                                                              // Char
+            buf.clear();
             i++;
 
-            while (i < _sourceCode.length() && (_sourceCode[i] != '\'' || _sourceCode[i-1] == '\\')) {
+            while (i < text.length() && (text[i] != '\'' || text[i-1] == '\\')) {
                 // Handle the escape sequence for single quote
-                if (_sourceCode[i] == '\\' && i + 1 < _sourceCode.length() && _sourceCode[i+1] == '\'') {
-                    _buf.push_back('\'');
+                if (text[i] == '\\' && i + 1 < text.length() && text[i+1] == '\'') {
+                    buf.push_back('\'');
                     i++;
-                } else _buf.push_back(_sourceCode[i]);
+                } else buf.push_back(text[i]);
                 i++;
             }
 
-            _tokenList.push_back({_buf, TokenType::CHAR});
+            tokens.push_back({buf, TokenType::CHAR});
         }
-        else if (_sourceCode[i] == '"') {                                                                        // String  
-            _buf.clear();
+        else if (text[i] == '"') {                                                                               // String  
+            buf.clear();
             i++;
 
-            while (i < _sourceCode.length() && (_sourceCode[i] != '"' || _sourceCode[i-1] == '\\')) {
+            while (i < text.length() && (text[i] != '"' || text[i-1] == '\\')) {
                 // Handle the escape sequence for double quote
-                if (_sourceCode[i] == '\\') {
+                if (text[i] == '\\') {
                     i++;
-                    if (i < _sourceCode.length()) {
-                        switch (_sourceCode[i]) {
-                            case '"': _buf.push_back('"'); break;
-                            case 'n': _buf.push_back('\n'); break;
-                            case 't': _buf.push_back('\t'); break;
-                            case '\\': _buf.push_back('\\'); break;
-                            default: _buf.push_back(_sourceCode[i]);
+                    if (i < text.length()) {
+                        switch (text[i]) {
+                            case '"': buf.push_back('"'); break;
+                            case 'n': buf.push_back('\n'); break;
+                            case 't': buf.push_back('\t'); break;
+                            case '\\': buf.push_back('\\'); break;
+                            default: buf.push_back(text[i]);
                         }
                     }
-                } else _buf.push_back(_sourceCode[i]);
+                } else buf.push_back(text[i]);
                 i++;
             }
 
-            _tokenList.push_back({_buf, TokenType::STRING});
+            tokens.push_back({buf, TokenType::STRING});
         }
-        else if (_sourceCode[i] == '$') {                                                                        // Hex
-            _buf.clear();
-            i++;
-
-            while (i < _sourceCode.length() && std::isalnum(_sourceCode[i])) {
-                _buf.push_back(_sourceCode[i]);
-                i++;
+        else if (text[i] == '$') {                                                                               // Hex
+            size_t end = skipCharClass(text, i + 1, CHAR_ALNUM);
+            buf.assign(text.substr(i + 1, end - i - 1));
+            i = end - 1;
+            tokens.push_back({buf, TokenType::HEX});
+        }
+        else if (text[i] == '%') {                                                                               // Binary
+            size_t end = skipCharClass(text, i + 1, CHAR_ALNUM);
+            buf.assign(text.substr(i + 1, end - i - 1));
+            i = end - 1;
+            tokens.push_back({buf, TokenType::BINARY});
+        }
+        else if (isCharClass(text[i], CHAR_DIGIT)) {                                                             // Number
+            size_t end = skipCharClass(text, i, CHAR_DIGIT);
+            if (end < text.length() && text[end] == '.') {
+                // Only an error if the slice really starts outside a comment, stitching decides
+                slice.decimalPoint = true;
+                break;
             }
-            i--;
-            _tokenList.push_back({_buf, TokenType::HEX});
+
+            buf.assign(text.substr(i, end - i));
+            i = end - 1;
+
+            tokens.push_back({buf, TokenType::NUMBER});
+        }
+        else if (isCharClass(text[i], CHAR_SPACE)) {                                                             // Whitespace
+            i = skipCharClass(text, i, CHAR_SPACE) - 1;
+            //tokens.push_back({"Whitespace", TokenType::WHITESPACE, lineNumber});
+        }
+        else if (text[i] == '\n') {                                                                              // Newline
+            tokens.push_back({"Newline", TokenType::NEWLINE});
+            lineNumber++;
+            slice.clean = i + 1 == text.length();
         }
-        else if (_sourceCode[i] == '%') {                                                                        // Binary
-            _buf.clear();
-            i++;
 
-            while (i < _sourceCode.length() && std::isalnum(_sourceCode[i])) {
-                _buf.push_back(_sourceCode[i]);
-                i++;
-            }
-            i--;
-            _tokenList.push_back({_buf, TokenType::BINARY});
-        }
-        else if (std::isdigit(_sourceCode[i])) {                                                                 // Number
-            _buf.clear();
-            while (i < _sourceCode.length() && (std::isdigit(_sourceCode[i]) || _sourceCode[i] == '.')) {
-                if (_sourceCode[i] == '.') {
-                    // Error handling for decimal point
-                    std::cerr << "Error: Unexpected decimal point in number." << std::endl;
-                    exit(ERROR::FLOAT_ERROR);
-                }
-
-                _buf.push_back(_sourceCode[i]);
-                i++;
-            }
-            i--;
+        for (size_t j = tokenCount; j < tokens.size(); j++) {
+            tokens[j].line = line;
+            tokens[j].file = slice.file;
+        }
+    }
+
+    slice.lines = lineNumber;
+    slice.inBlockComment = inBlockComment;
+}
 
-            _tokenList.push_back({_buf, TokenType::NUMBER});
+std::vector<Lexer::_Slice> Lexer::_sliceChunks() const {
+    std::vector<_Slice> slices;
+
+    for (size_t i = 0; i < _preprocessor.chunks.size(); i++) {
+        const Preprocessor::SourceChunk& chunk = _preprocessor.chunks[i];
+
+        // Cut at the first newline past every SLICE_SIZE bytes; chunks always end in one
+        for (size_t begin = 0; begin < chunk.text.size();) {
+            size_t end = chunk.text.size();
+            if (begin + SLICE_SIZE < end) end = chunk.text.find('\n', begin + SLICE_SIZE) + 1;
+
+            slices.push_back({i, chunk.file, chunk.text.substr(begin, end - begin)});
+            begin = end;
         }
-        else if (std::isspace(_sourceCode[i]) && _sourceCode[i] != '\n') {                                       // Whitespace
-            while (i < _sourceCode.length() && std::isspace(_sourceCode[i]) && _sourceCode[i] != '\n') i++;
-            i--;
-            //_tokenList.push_back({"Whitespace", TokenType::WHITESPACE, _lineNumber});
+    }
+
+    return slices;
+}
+
+void Lexer::_tokenizeSlices(std::vector<_Slice>& slices) const {
+    size_t threads = std::min<size_t>(_threads ? _threads : std::max(1u, std::thread::hardware_concurrency()), slices.size());
+
+    if (threads <= 1) {
+        for (auto& slice : slices) _tokenizeSlice(slice, false);
+        return;
+    }
+
+    // Largest first, so a big data file starts early instead of finishing last
+    std::vector<size_t> order(slices.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return slices[a].text.size() > slices[b].text.size(); });
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < order.size(); i = next++) _tokenizeSlice(slices[order[i]], false);
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; i++) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+}
+
+void Lexer::_stitchSlices(std::vector<_Slice>& slices) {
+    bool inBlockComment = false;
+
+    for (size_t first = 0; first < slices.size();) {
+        size_t last = first;
+        while (last + 1 < slices.size() && slices[last + 1].chunk == slices[first].chunk) last++;
+
+        const Preprocessor::SourceChunk& chunk = _preprocessor.chunks[slices[first].chunk];
+        size_t next = last + 1;
+
+        // Slices were tokenized as if each began a line outside any comment or string. When that
+        // doesn't hold the chunk is tokenized again in one piece, as a serial lexer would see it.
+        bool valid = !inBlockComment;
+        for (size_t i = first; i < last; i++) valid &= slices[i].clean;
+
+        if (!valid) {
+            _Slice whole = {slices[first].chunk, chunk.file, chunk.text};
+            _tokenizeSlice(whole, inBlockComment);
+            slices[first] = std::move(whole);
+            last = first;
         }
-        else if (_sourceCode[i] == '\n') {                                                                       // Newline
-            _tokenList.push_back({"Newline", TokenType::NEWLINE});
+
+        for (size_t i = first; i <= last; i++) {
+            if (!slices[i].decimalPoint) continue;
+            std::cerr << "Error: Unexpected decimal point in number." << std::endl;
+            exit(ERROR::FLOAT_ERROR);
         }
-    
+
+        int line = chunk.line;
+        for (size_t i = first; i <= last; i++) {
+            for (auto& token : slices[i].tokens) {
+                token.line += line;
+                _tokenList.push_back(std::move(token));
+            }
+            line += slices[i].lines;
+        }
+
+        inBlockComment = slices[last].inBlockComment;
+        first = next;
     }
+}
+
+void Lexer::tokenize() {
+    std::vector<_Slice> slices = _sliceChunks();
+    _tokenizeSlices(slices);
+    _stitchSlices(slices);
 
     _sortLabels();
+
+    MacroExpander expander(_tokenList, _preprocessor);
+    _tokenList = expander.expand();
 };
@@ -2,6 +2,8 @@
 #define LEXER_HPP
 
 #include "main.hpp"
+#include "preprocessor.hpp"
+#include "isa.hpp"
 
 enum TokenType {
     // Whitespace
@@ -17,7 +19,7 @@ enum TokenType {
     COMMENT,
 
     // Single-Character Tokens
-    L_PAREN, R_PAREN, COMMA, IMMEDIATE, MINUS, EQUAL, PLUS, DIV, MUL,
+    L_PAREN, R_PAREN, COMMA, IMMEDIATE, MINUS, EQUAL, PLUS, DIV, MUL, LOW, HIGH,
 
     // Literals
     IDENTIFIER, LABEL_DECLARE, STRING, CHAR, NUMBER, BINARY, HEX, LABEL,
@@ -29,12 +31,15 @@ enum TokenType {
 struct Token {
     std::string      substring;
     TokenType        type;
+    int              line = 0;                  // Source line, from 1
+    int              file = 0;                  // Index into Preprocessor::files
 };
 
 class Lexer {
 public:
-    Lexer(const std::string& sourceCode, const std::vector<Instruction>& instructionSet)
-    :   _sourceCode(sourceCode), _instructionSet(instructionSet) {}
+    // Threads 0 is one per core
+    Lexer(const Preprocessor& preprocessor, unsigned threads = 0)
+    :   _preprocessor(preprocessor), _threads(threads) {}
 
     void tokenize();
     void print();
@@ -44,14 +49,29 @@ public:
     bool hasToken();
 
 private:
-    const std::string& _sourceCode;
-    const std::vector<Instruction>& _instructionSet;
+    // Part of one chunk, cut after a newline and tokenized on its own worker
+    struct _Slice {
+        size_t chunk;
+        int file;
+        std::string_view text;
+        std::vector<Token> tokens;              // Lines relative to the start of the slice
+        int lines = 0;
+        bool inBlockComment = false;            // Ended inside a comment block
+        bool clean = false;                     // Ended on its last newline, so the next slice starts fresh
+        bool decimalPoint = false;              // Stopped at a number with a decimal point
+    };
+
+    const Preprocessor& _preprocessor;
+    const unsigned _threads;
     std::vector<Token> _tokenList; 
      
-    std::string _buf;
     long unsigned int _tokenIndex = 0;
 
-    bool _isInInstructionSet();
+    std::vector<_Slice> _sliceChunks() const;
+    void _tokenizeSlices(std::vector<_Slice>& slices) const;
+    void _tokenizeSlice(_Slice& slice, bool inBlockComment) const;
+    void _stitchSlices(std::vector<_Slice>& slices);
+
     void _resetTokenList();
     void _sortLabels();
     bool _isInList(const std::vector<Token>& list, const Token& token);
@@ -0,0 +1,244 @@
+#include "linker.hpp"
+
+// Helper Functions
+
+int Linker::_parseNumber(const std::string& str) {
+    const char* digits = str.c_str();
+    int base = 10;
+
+    if (str[0] == '$') { digits++; base = 16; }
+    else if (str[0] == '%') { digits++; base = 2; }
+
+    char* end = nullptr;
+    long value = std::strtol(digits, &end, base);
+    if (*digits == '\0' || *end != '\0') {
+        std::cerr << "Error: invalid number '" << str << "' in link script" << std::endl;
+        exit(ERROR::CONVER_ERROR);
+    }
+    return static_cast<int>(value);
+}
+
+int Linker::_placeAt(int address, int size) {
+    // Slide past every placed section the candidate range collides with
+    bool moved = true;
+    while (moved && size > 0) {
+        moved = false;
+        for (const auto& placed : _sections) {
+            if (placed.address < 0 || placed.size == 0) continue;
+            if (address < placed.address + placed.size && placed.address < address + size) {
+                address = placed.address + placed.size;
+                moved = true;
+            }
+        }
+    }
+
+    if (address + size - 1 > MAX_MEMORY) {
+        std::cerr << "Error: not enough memory to place section of " << size << " bytes" << std::endl;
+        exit(ERROR::LINK_ERROR);
+    }
+    return address;
+}
+
+// Link Stages
+
+void Linker::_loadObjects() {
+    _objects.resize(_objectPaths.size());
+
+    for (size_t i = 0; i < _objectPaths.size(); i++) {
+        _objects[i].read(_objectPaths[i]);
+        _sectionBase.push_back(_sections.size());
+
+        for (size_t j = 0; j < _objects[i].sections.size(); j++) {
+            _sections.push_back({static_cast<int>(i), static_cast<int>(j), static_cast<int>(_objects[i].sections[j].data.size())});
+        }
+    }
+}
+
+void Linker::_collectSymbols() {
+    for (size_t i = 0; i < _objects.size(); i++) {
+        for (const auto& symbol : _objects[i].symbols) {
+            auto found = _symbols.find(symbol.name);
+            if (found != _symbols.end()) {
+                std::cerr << "Error: label '" << symbol.name << "' defined in both '" << _objects[_sections[found->second.linkSection].object].module
+                          << "' and '" << _objects[i].module << "'" << std::endl;
+                exit(ERROR::LINK_ERROR);
+            }
+            _symbols[symbol.name] = {_sectionBase[i] + symbol.section, symbol.offset};
+        }
+    }
+}
+
+void Linker::_readScript() {
+    if (_scriptFilePath.empty()) {
+        // Default: the module holding main goes first at the start of ROM, the rest follow
+        const std::string& mainModule = _objects[_sections[_symbols["main"].linkSection].object].module;
+        _rules.push_back({OFFSET, {mainModule, "*"}});
+        return;
+    }
+
+    std::ifstream scriptFile(_scriptFilePath);
+    if (!scriptFile.is_open()) {
+        std::cerr << "Error: unable to open file '" << _scriptFilePath << "'" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+
+    std::string line;
+    while (std::getline(scriptFile, line)) {
+        line = line.substr(0, line.find(';'));
+
+        std::istringstream words(line);
+        std::string word;
+        while (words >> word) {
+            if (word == ".org") {
+                words >> word;
+                int address = _parseNumber(word);
+                if (address < OFFSET || address > MAX_MEMORY) {
+                    std::cerr << "Error: org value is out of bounds" << std::endl;
+                    exit(ERROR::ORG_ERROR);
+                }
+                _rules.push_back({address, {}});
+            }
+            else if (_rules.empty()) {
+                std::cerr << "Error: link script must start with an .org" << std::endl;
+                exit(ERROR::LINK_ERROR);
+            }
+            else _rules.back().modules.push_back(word);
+        }
+    }
+}
+
+void Linker::_markLiveSections() {
+    std::vector<int> worklist;
+
+    // Roots are the entry point and everything pinned with .org
+    for (size_t i = 0; i < _sections.size(); i++) {
+        if (!_objects[_sections[i].object].sections[_sections[i].section].relocatable) worklist.push_back(i);
+    }
+    worklist.push_back(_symbols["main"].linkSection);
+
+    while (!worklist.empty()) {
+        int current = worklist.back();
+        worklist.pop_back();
+        if (_sections[current].live) continue;
+        _sections[current].live = true;
+
+        const ObjectFile& object = _objects[_sections[current].object];
+        for (const auto& relocation : object.relocations) {
+            if (relocation.section != _sections[current].section) continue;
+
+            auto symbol = _symbols.find(relocation.symbol);
+            if (symbol == _symbols.end()) {
+                std::cerr << "Error: label '" << relocation.symbol << "' used in '" << object.module << "' but not found" << std::endl;
+                exit(ERROR::LABEL_ERROR);
+            }
+            worklist.push_back(symbol->second.linkSection);
+        }
+    }
+}
+
+void Linker::_placeSections() {
+    // Sections fixed with .org may not overlap each other
+    for (auto& section : _sections) {
+        const ObjectSection& data = _objects[section.object].sections[section.section];
+        if (!section.live || data.relocatable) continue;
+
+        if (_placeAt(data.origin, section.size) != data.origin) {
+            std::cerr << "Error: section '" << _objects[section.object].module << "." << data.name << "' overlaps another .org section" << std::endl;
+            exit(ERROR::ORG_ERROR);
+        }
+        section.address = data.origin;
+    }
+
+    for (const auto& rule : _rules) {
+        int cursor = rule.address;
+
+        for (const auto& module : rule.modules) {
+            for (auto& section : _sections) {
+                const ObjectFile& object = _objects[section.object];
+                if (!section.live || section.address >= 0 || !object.sections[section.section].relocatable) continue;
+                if (module != "*" && module != object.module) continue;
+
+                section.address = _placeAt(cursor, section.size);
+                cursor = section.address + section.size;
+            }
+        }
+    }
+
+    for (const auto& section : _sections) {
+        if (section.live && section.address < 0) {
+            std::cerr << "Error: section '" << _objects[section.object].module << "." << _objects[section.object].sections[section.section].name
+                      << "' is not placed by the link script" << std::endl;
+            exit(ERROR::LINK_ERROR);
+        }
+    }
+}
+
+void Linker::_applyRelocations() {
+    for (const auto& section : _sections) {
+        if (!section.live) continue;
+        const std::vector<uint8_t>& data = _objects[section.object].sections[section.section].data;
+        std::copy(data.begin(), data.end(), _image.begin() + section.address);
+    }
+
+    for (const auto& section : _sections) {
+        if (!section.live) continue;
+
+        for (const auto& relocation : _objects[section.object].relocations) {
+            if (relocation.section != section.section) continue;
+
+            const _LinkSymbol& symbol = _symbols[relocation.symbol];
+            int value = _sections[symbol.linkSection].address + symbol.offset;
+            int location = section.address + relocation.offset;
+
+            _image[location] = static_cast<uint8_t>(value);
+            _image[location + 1] = static_cast<uint8_t>(value >> 8);
+        }
+    }
+}
+
+void Linker::_printMap() {
+    std::vector<const _LinkSection*> ordered;
+    for (const auto& section : _sections) ordered.push_back(&section);
+    std::sort(ordered.begin(), ordered.end(), [](const _LinkSection* a, const _LinkSection* b) { return a->address < b->address; });
+
+    char range[32];
+    for (const _LinkSection* section : ordered) {
+        const ObjectFile& object = _objects[section->object];
+        const std::string name = object.module + "." + object.sections[section->section].name;
+
+        if (section->live) {
+            std::snprintf(range, sizeof(range), "$%04x-$%04x", section->address, section->address + std::max(section->size, 1) - 1);
+            std::cout << range << "  " << name << std::endl;
+        } else std::cout << "stripped     " << name << " (" << section->size << " bytes)" << std::endl;
+    }
+}
+
+void Linker::_printFile() {
+    // Placed sections are exactly the populated ranges of the image
+    std::vector<ImageRange> ranges;
+    for (const auto& section : _sections) {
+        if (section.live && section.size > 0) ranges.push_back({section.address, section.address + section.size});
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const ImageRange& a, const ImageRange& b) { return a.start < b.start; });
+
+    if (!writeImage(_outputFilePath, _image, ranges)) exit(ERROR::FILE_ERROR);
+}
+
+// Main Functions
+
+void Linker::link() {
+    _loadObjects();
+    _collectSymbols();
+
+    if (_symbols.find("main") == _symbols.end()) {
+        std::cerr << "Error: no main function" << std::endl;
+        exit(ERROR::MAIN_ERROR);
+    }
+
+    _readScript();
+    _markLiveSections();
+    _placeSections();
+    _applyRelocations();
+    _printMap();
+    _printFile();
+}
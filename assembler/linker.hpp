@@ -0,0 +1,63 @@
+#ifndef LINKER_HPP
+#define LINKER_HPP
+
+#include "main.hpp"
+#include "object.hpp"
+#include "image.hpp"
+
+#include <unordered_map>
+#include <sstream>
+
+class Linker {
+public:
+    Linker(const std::vector<std::string>& objectPaths, const std::string& outputPath, const std::string& scriptPath)
+    : _objectPaths(objectPaths), _outputFilePath(outputPath), _scriptFilePath(scriptPath) {}
+
+    void link();
+
+private:
+    std::vector<std::string> _objectPaths;
+    std::string _outputFilePath;
+    std::string _scriptFilePath;
+
+    std::vector<ObjectFile> _objects;
+    std::vector<uint8_t> _image = std::vector<uint8_t>(MAX_MEMORY + 1, 0);
+
+    struct _LinkSection {
+        int object;
+        int section;
+        int size;
+        int address = -1;                           // -1 until placed
+        bool live = false;
+    };
+
+    struct _LinkSymbol {
+        int linkSection;
+        int offset;
+    };
+
+    // A link script rule: relocatable sections of the listed modules are placed from address on
+    struct _PlacementRule {
+        int address;
+        std::vector<std::string> modules;           // "*" matches every module
+    };
+
+    std::vector<_LinkSection> _sections;
+    std::vector<int> _sectionBase;                  // Index of each object's first section in _sections
+    std::unordered_map<std::string, _LinkSymbol> _symbols;
+    std::vector<_PlacementRule> _rules;
+
+    void _loadObjects();
+    void _readScript();
+    void _collectSymbols();
+    void _markLiveSections();
+    void _placeSections();
+    void _applyRelocations();
+    void _printMap();
+    void _printFile();
+
+    int _placeAt(int address, int size);
+    int _parseNumber(const std::string& str);
+};
+
+#endif
@@ -0,0 +1,340 @@
+#include "macro.hpp"
+
+#include <unordered_set>
+
+static bool isName(const Token& token) {
+    return token.type == TokenType::IDENTIFIER || token.type == TokenType::LABEL;
+}
+
+static bool isDirective(const Token& token, const char* name) {
+    return token.type == TokenType::DIRECTIVE && token.substring == name;
+}
+
+// Helper Functions
+
+std::string MacroExpander::_location(const Token& token) {
+    return _preprocessor.describe({token.file, token.line});
+}
+
+size_t MacroExpander::_lineEnd(const std::vector<Token>& tokens, size_t start) {
+    while (start < tokens.size() && tokens[start].type != TokenType::NEWLINE) start++;
+    return start;
+}
+
+size_t MacroExpander::_collectBody(const std::vector<Token>& tokens, size_t start, const char* open, const char* close, std::vector<Token>& body) {
+    int depth = 0;
+
+    for (size_t i = start; i < tokens.size(); i++) {
+        if (isDirective(tokens[i], open)) depth++;
+        else if (isDirective(tokens[i], close) && depth-- == 0) return i + 1;
+        body.push_back(tokens[i]);
+    }
+
+    std::cerr << "Error: ." << open << " at " << _location(tokens[start - 1]) << " has no ." << close << std::endl;
+    exit(ERROR::MACRO_ERROR);
+}
+
+std::vector<std::pair<size_t, size_t>> MacroExpander::_splitArguments(const std::vector<Token>& tokens, size_t start, size_t end) {
+    // Commas inside parentheses belong to the argument, e.g. (ptr,rX)
+    std::vector<std::pair<size_t, size_t>> arguments;
+    int depth = 0;
+    size_t argument = start;
+
+    for (size_t i = start; i < end; i++) {
+        if (tokens[i].type == TokenType::L_PAREN) depth++;
+        else if (tokens[i].type == TokenType::R_PAREN) depth--;
+        else if (tokens[i].type == TokenType::COMMA && depth == 0) {
+            arguments.push_back({argument, i});
+            argument = i + 1;
+        }
+    }
+
+    if (argument < end || !arguments.empty()) arguments.push_back({argument, end});
+    return arguments;
+}
+
+int MacroExpander::_evaluateInteger(const std::vector<Token>& tokens, size_t start, size_t end, const char* directive) {
+    size_t pos = start;
+    double value = 0;
+
+    if (start == end || !_evaluate(tokens, pos, end, value) || pos != end) {
+        std::cerr << "Error: ." << directive << " at " << _location(tokens[start - 1]) << " needs a constant expression" << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+    return static_cast<int>(std::lround(value));
+}
+
+void MacroExpander::_recordConstant(const std::string& name, const std::vector<Token>& tokens, size_t start, size_t end) {
+    // Only used for .rept counts and .table formulas, CodeGen still evaluates the assignment itself
+    size_t pos = start;
+    double value = 0;
+
+    if (_evaluate(tokens, pos, end, value) && pos == end) _constants[name] = value;
+    else _constants.erase(name);
+}
+
+// Expression Functions
+
+bool MacroExpander::_evaluate(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value) {
+    if (!_evaluateProduct(tokens, pos, end, value)) return false;
+
+    while (pos < end && (tokens[pos].type == TokenType::PLUS || tokens[pos].type == TokenType::MINUS)) {
+        bool plus = tokens[pos++].type == TokenType::PLUS;
+        double right = 0;
+        if (!_evaluateProduct(tokens, pos, end, right)) return false;
+        value = plus ? value + right : value - right;
+    }
+    return true;
+}
+
+bool MacroExpander::_evaluateProduct(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value) {
+    if (!_evaluateUnary(tokens, pos, end, value)) return false;
+
+    while (pos < end && (tokens[pos].type == TokenType::MUL || tokens[pos].type == TokenType::DIV)) {
+        bool multiply = tokens[pos++].type == TokenType::MUL;
+        double right = 0;
+        if (!_evaluateUnary(tokens, pos, end, right)) return false;
+
+        if (!multiply && right == 0) {
+            std::cerr << "Error: zero in denominator" << std::endl;
+            exit(ERROR::ZERO_ERROR);
+        }
+        value = multiply ? value * right : value / right;
+    }
+    return true;
+}
+
+bool MacroExpander::_evaluateUnary(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value) {
+    if (pos < end && tokens[pos].type == TokenType::MINUS) {
+        pos++;
+        if (!_evaluateUnary(tokens, pos, end, value)) return false;
+        value = -value;
+        return true;
+    }
+    return _evaluatePrimary(tokens, pos, end, value);
+}
+
+bool MacroExpander::_evaluatePrimary(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value) {
+    if (pos >= end) return false;
+    const Token& token = tokens[pos++];
+
+    switch (token.type) {
+        case TokenType::NUMBER: value = std::strtol(token.substring.c_str(), nullptr, 10); return true;
+        case TokenType::HEX: value = std::strtol(token.substring.c_str(), nullptr, 16); return true;
+        case TokenType::BINARY: value = std::strtol(token.substring.c_str(), nullptr, 2); return true;
+        case TokenType::CHAR: value = static_cast<unsigned char>(token.substring[0]); return true;
+        case TokenType::L_PAREN:
+            if (!_evaluate(tokens, pos, end, value) || pos >= end || tokens[pos].type != TokenType::R_PAREN) return false;
+            pos++;
+            return true;
+        default: break;
+    }
+
+    if (!isName(token)) return false;
+
+    // Functions for generating tables, angles in radians
+    static const std::unordered_map<std::string, double (*)(double)> functions = {
+        {"sin", std::sin}, {"cos", std::cos}, {"sqrt", std::sqrt}, {"abs", std::fabs}, {"floor", std::floor}, {"round", std::round},
+    };
+
+    auto function = functions.find(token.substring);
+    if (function != functions.end() && pos < end && tokens[pos].type == TokenType::L_PAREN) {
+        if (!_evaluatePrimary(tokens, pos, end, value)) return false;
+        value = function->second(value);
+        return true;
+    }
+
+    if (token.substring == "pi") {
+        value = M_PI;
+        return true;
+    }
+
+    auto constant = _constants.find(token.substring);
+    if (constant == _constants.end()) return false;
+    value = constant->second;
+    return true;
+}
+
+// Directive Functions
+
+size_t MacroExpander::_defineMacro(const std::vector<Token>& tokens, size_t start) {
+    size_t end = _lineEnd(tokens, start);
+
+    if (start + 1 >= end || !isName(tokens[start + 1])) {
+        std::cerr << "Error: .macro at " << _location(tokens[start]) << " needs a name" << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+
+    _Macro macro;
+    for (const auto& [first, last] : _splitArguments(tokens, start + 2, end)) {
+        if (last != first + 1 || !isName(tokens[first])) {
+            std::cerr << "Error: invalid parameter list for macro '" << tokens[start + 1].substring << "'" << std::endl;
+            exit(ERROR::MACRO_ERROR);
+        }
+        macro.params.push_back(tokens[first].substring);
+    }
+
+    size_t next = _collectBody(tokens, end + 1, "macro", "endm", macro.body);
+    _macros[tokens[start + 1].substring] = std::move(macro);
+    return next;
+}
+
+size_t MacroExpander::_invokeMacro(const std::vector<Token>& tokens, size_t start) {
+    const std::string& name = tokens[start].substring;
+    const _Macro& macro = _macros[name];
+    size_t end = _lineEnd(tokens, start);
+
+    std::vector<std::pair<size_t, size_t>> arguments = _splitArguments(tokens, start + 1, end);
+    if (arguments.size() != macro.params.size()) {
+        std::cerr << "Error: macro '" << name << "' at " << _location(tokens[start]) << " takes " << macro.params.size()
+                  << " arguments but got " << arguments.size() << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+
+    std::unordered_map<std::string, std::vector<Token>> substitutions;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        substitutions[macro.params[i]].assign(tokens.begin() + arguments[i].first, tokens.begin() + arguments[i].second);
+    }
+
+    _expandBody(macro.body, substitutions);
+    return end;
+}
+
+size_t MacroExpander::_repeat(const std::vector<Token>& tokens, size_t start) {
+    size_t end = _lineEnd(tokens, start);
+    std::vector<std::pair<size_t, size_t>> arguments = _splitArguments(tokens, start + 1, end);
+
+    if (arguments.empty() || arguments.size() > 2 || (arguments.size() == 2 && (arguments[1].second != arguments[1].first + 1 || !isName(tokens[arguments[1].first])))) {
+        std::cerr << "Error: .rept at " << _location(tokens[start]) << " must be '.rept <count>' or '.rept <count>, <counter>'" << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+
+    int count = _evaluateInteger(tokens, arguments[0].first, arguments[0].second, "rept");
+    if (count < 0 || count > MAX_MEMORY) {
+        std::cerr << "Error: .rept count " << count << " is out of range" << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+
+    std::vector<Token> body;
+    size_t next = _collectBody(tokens, end + 1, "rept", "endr", body);
+
+    std::unordered_map<std::string, std::vector<Token>> substitutions;
+    std::vector<Token>* counter = nullptr;
+    if (arguments.size() == 2) counter = &substitutions[tokens[arguments[1].first].substring];
+
+    for (int i = 0; i < count; i++) {
+        if (counter) *counter = {{std::to_string(i), TokenType::NUMBER, tokens[start].line, tokens[start].file}};
+        _expandBody(body, substitutions);
+    }
+    return next;
+}
+
+size_t MacroExpander::_table(const std::vector<Token>& tokens, size_t start) {
+    size_t end = _lineEnd(tokens, start);
+    std::vector<std::pair<size_t, size_t>> arguments = _splitArguments(tokens, start + 1, end);
+
+    if (arguments.size() != 4 || arguments[0].second != arguments[0].first + 1 || !isName(tokens[arguments[0].first])) {
+        std::cerr << "Error: .table at " << _location(tokens[start]) << " must be '.table <var>, <first>, <last>, <expression>'" << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+
+    const std::string& name = tokens[arguments[0].first].substring;
+    int first = _evaluateInteger(tokens, arguments[1].first, arguments[1].second, "table");
+    int last = _evaluateInteger(tokens, arguments[2].first, arguments[2].second, "table");
+    int step = first <= last ? 1 : -1;
+
+    auto previous = _constants.find(name);
+    bool shadowed = previous != _constants.end();
+    double saved = shadowed ? previous->second : 0;
+
+    // The table becomes one .db line
+    int line = tokens[start].line;
+    int file = tokens[start].file;
+    _output.push_back({"db", TokenType::DIRECTIVE, line, file});
+
+    for (int i = first; ; i += step) {
+        _constants[name] = i;
+        int value = _evaluateInteger(tokens, arguments[3].first, arguments[3].second, "table");
+        if (value < -128 || value > 0xff) {
+            std::cerr << "Error: .table value " << value << " for " << name << " = " << i << " does not fit in a byte" << std::endl;
+            exit(ERROR::LARGE_VALUE_ERROR);
+        }
+        _output.push_back({std::to_string(value & 0xff), TokenType::NUMBER, line, file});
+        if (i == last) break;
+    }
+
+    if (shadowed) _constants[name] = saved;
+    else _constants.erase(name);
+    return end;
+}
+
+// Expansion Functions
+
+void MacroExpander::_expandBody(const std::vector<Token>& body, const std::unordered_map<std::string, std::vector<Token>>& substitutions) {
+    if (++_depth > MAX_MACRO_DEPTH) {
+        std::cerr << "Error: macros nested deeper than " << MAX_MACRO_DEPTH << " levels, is a macro calling itself?" << std::endl;
+        exit(ERROR::MACRO_ERROR);
+    }
+
+    // Labels declared in the body are local to this expansion
+    std::unordered_set<std::string> locals;
+    for (const auto& token : body) {
+        if (token.type == TokenType::LABEL_DECLARE) locals.insert(token.substring);
+    }
+    std::string suffix = "." + std::to_string(_expansions++);
+
+    std::vector<Token> expanded;
+    expanded.reserve(body.size());
+
+    for (const auto& token : body) {
+        auto substitution = isName(token) ? substitutions.find(token.substring) : substitutions.end();
+
+        if (substitution != substitutions.end()) expanded.insert(expanded.end(), substitution->second.begin(), substitution->second.end());
+        else if ((token.type == TokenType::LABEL_DECLARE || token.type == TokenType::LABEL) && locals.count(token.substring)) {
+            expanded.push_back({token.substring + suffix, token.type, token.line, token.file});
+        }
+        else expanded.push_back(token);
+    }
+
+    _expand(expanded);
+    _depth--;
+}
+
+void MacroExpander::_expand(const std::vector<Token>& tokens) {
+    bool lineStart = true;
+
+    for (size_t i = 0; i < tokens.size();) {
+        const Token& token = tokens[i];
+
+        if (token.type == TokenType::DIRECTIVE) {
+            if (token.substring == "macro") { i = _defineMacro(tokens, i); continue; }
+            if (token.substring == "rept") { i = _repeat(tokens, i); continue; }
+            if (token.substring == "table") { i = _table(tokens, i); continue; }
+            if (token.substring == "endm" || token.substring == "endr") {
+                std::cerr << "Error: ." << token.substring << " at " << _location(token) << " without a matching start" << std::endl;
+                exit(ERROR::MACRO_ERROR);
+            }
+        }
+
+        if (lineStart && isName(token) && _macros.count(token.substring)) {
+            i = _invokeMacro(tokens, i);
+            continue;
+        }
+
+        if (lineStart && token.type == TokenType::IDENTIFIER && i + 1 < tokens.size() && tokens[i + 1].type == TokenType::EQUAL) {
+            _recordConstant(token.substring, tokens, i + 2, _lineEnd(tokens, i));
+        }
+
+        _output.push_back(token);
+        lineStart = token.type == TokenType::NEWLINE || token.type == TokenType::LABEL_DECLARE;
+        i++;
+    }
+}
+
+// Main Functions
+
+std::vector<Token> MacroExpander::expand() {
+    _output.reserve(_tokens.size());
+    _expand(_tokens);
+    return std::move(_output);
+}
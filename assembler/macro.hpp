@@ -0,0 +1,60 @@
+#ifndef MACRO_HPP
+#define MACRO_HPP
+
+#include "main.hpp"
+#include "lexer.hpp"
+
+#include <unordered_map>
+
+#define MAX_MACRO_DEPTH 64
+
+// Expands .macro/.endm, .rept/.endr and .table on the token list, before parsing. Bodies are
+// kept as tokens and copied once per expansion, so the work is linear in the output.
+//   .macro name a, b    ...    .endm           invoked as: name 1, $20
+//   .rept 8, i          ...    .endr           i counts 0..7 inside the body
+//   .table i, 0, 255, 128 + 127 * sin(i * 2 * pi / 256)       emits .db of every value
+// Labels declared inside a body get a unique suffix per expansion.
+class MacroExpander {
+public:
+    MacroExpander(const std::vector<Token>& tokens, const Preprocessor& preprocessor)
+    :   _tokens(tokens), _preprocessor(preprocessor) {}
+
+    std::vector<Token> expand();
+
+private:
+    const std::vector<Token>& _tokens;
+    const Preprocessor& _preprocessor;
+
+    struct _Macro {
+        std::vector<std::string> params;
+        std::vector<Token> body;
+    };
+
+    std::unordered_map<std::string, _Macro> _macros;
+    std::unordered_map<std::string, double> _constants;    // name = value assignments seen so far
+    std::vector<Token> _output;
+    int _expansions = 0;
+    int _depth = 0;
+
+    std::string _location(const Token& token);
+    void _expand(const std::vector<Token>& tokens);
+    size_t _lineEnd(const std::vector<Token>& tokens, size_t start);
+    size_t _collectBody(const std::vector<Token>& tokens, size_t start, const char* open, const char* close, std::vector<Token>& body);
+    std::vector<std::pair<size_t, size_t>> _splitArguments(const std::vector<Token>& tokens, size_t start, size_t end);
+
+    size_t _defineMacro(const std::vector<Token>& tokens, size_t start);
+    size_t _invokeMacro(const std::vector<Token>& tokens, size_t start);
+    size_t _repeat(const std::vector<Token>& tokens, size_t start);
+    size_t _table(const std::vector<Token>& tokens, size_t start);
+    void _recordConstant(const std::string& name, const std::vector<Token>& tokens, size_t start, size_t end);
+
+    void _expandBody(const std::vector<Token>& body, const std::unordered_map<std::string, std::vector<Token>>& substitutions);
+    int _evaluateInteger(const std::vector<Token>& tokens, size_t start, size_t end, const char* directive);
+
+    bool _evaluate(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value);
+    bool _evaluateProduct(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value);
+    bool _evaluateUnary(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value);
+    bool _evaluatePrimary(const std::vector<Token>& tokens, size_t& pos, size_t end, double& value);
+};
+
+#endif
@@ -1,25 +1,144 @@
 #include "main.hpp"
 #include "assembler.hpp"
+#include "linker.hpp"
+#include "server.hpp"
 
-int main(int argc, char* argv[]) {
-    // Check if file is provided
-    if (argc != 2) {
-        std::cerr << "Usage: ./tasml <filename>" << std::endl;
-        exit(ERROR::FILE_ERROR);
-    }
+#include <thread>
+#include <atomic>
+#include <unistd.h>
+
+static void usage() {
+    std::cerr << "Usage: ./tasml [-O] [-t] [-g] [-v] [-P <profile>] [-f bin|seg|hex|srec] <filename>" << std::endl;
+    std::cerr << "       ./tasml -c [-O] <filename>..." << std::endl;
+    std::cerr << "       ./tasml -l <output.bin|seg|hex|srec> [-T <linkscript>] <object>..." << std::endl;
+    std::cerr << "       ./tasml -S [-j <workers>] [<socket>]" << std::endl;
+    exit(ERROR::FILE_ERROR);
+}
 
+static std::string replaceExtension(const std::string& sourcePath, const std::string& extension) {
     // Check if the file extension is .tasml
-    std::string sourcePath = argv[1];
     size_t lastDot = sourcePath.find_last_of(".");
     if (lastDot == std::string::npos || sourcePath.substr(lastDot) != ".tasml") {
         std::cerr << "Error: File must have a .tasml extension" << std::endl;
         exit(ERROR::EXT_ERROR);
     }
 
-    std::string outputPath = sourcePath.substr(0, lastDot) + ".bin";
+    return sourcePath.substr(0, lastDot) + extension;
+}
+
+static void assembleObjects(const std::vector<std::string>& sourcePaths, bool optimize) {
+    std::vector<std::string> outputPaths;
+    for (const auto& sourcePath : sourcePaths) outputPaths.push_back(replaceExtension(sourcePath, ".tobj"));
+
+    // Modules are independent, so hand them out to one worker per core. With a server running each
+    // worker keeps its own connection, so the server assembles as many modules at once
+    std::string socketPath = defaultSocketPath();
+    int server = connectTo(socketPath);
+    std::atomic<size_t> nextModule = 0;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t workerCount = std::min<size_t>(cores, sourcePaths.size());
+    unsigned lexerThreads = cores / workerCount;
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([&, i]() {
+            int connection = server < 0 || i == 0 ? server : connectTo(socketPath);
+            if (server >= 0 && connection < 0) return;              // The other workers take its share
+
+            for (size_t module = nextModule++; module < sourcePaths.size(); module = nextModule++) {
+                if (connection < 0) {
+                    Assembler assembler(sourcePaths[module], outputPaths[module], optimize);
+                    assembler.setLexerThreads(lexerThreads);
+                    assembler.assembleObject();
+                    continue;
+                }
+
+                int status = 0;
+                AssemblyRequest request = {sourcePaths[module], outputPaths[module], true, optimize};
+                if (!assembleRemote(connection, request, status)) {
+                    std::cerr << "Error: lost the connection to the server" << std::endl;
+                    exit(ERROR::FILE_ERROR);
+                }
+                if (status != 0) exit(status);
+            }
+
+            if (connection >= 0) close(connection);
+        });
+    }
+
+    for (auto& worker : workers) worker.join();
+}
+
+int main(int argc, char* argv[]) {
+    // Check if file is provided
+    if (argc < 2) usage();
+
+    std::string mode;
+    std::string extension = ".bin";                                         // Full image unless -f picks a sparse format
+    std::string outputPath;
+    std::string scriptPath;
+    std::vector<std::string> inputPaths;
+    bool optimize = false;
+    bool timing = false;                                                    // Cycle report and .lst listing
+    bool debug = false;                                                     // .sym symbol map for the emulator
+    bool verbose = false;                                                   // Token and AST dumps
+    std::string profilePath;                                                // emulator -m access counts for .var
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-O") optimize = true;
+        else if (arg == "-t") timing = true;
+        else if (arg == "-g") debug = true;
+        else if (arg == "-v") verbose = true;
+        else if (arg == "-c" || arg == "-S") mode = arg;
+        else if (arg == "-j" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else if (arg == "-l" && i + 1 < argc) { mode = arg; outputPath = argv[++i]; }
+        else if (arg == "-T" && i + 1 < argc) scriptPath = argv[++i];
+        else if (arg == "-P" && i + 1 < argc) profilePath = argv[++i];
+        else if (arg == "-f" && i + 1 < argc) {
+            extension = std::string(".") + argv[++i];
+            if (imageFormatFromPath(extension) == IMAGE_BIN && extension != ".bin") {
+                std::cerr << "Error: unknown output format '" << argv[i] << "'" << std::endl;
+                exit(ERROR::EXT_ERROR);
+            }
+        }
+        else if (arg[0] == '-') usage();
+        else inputPaths.push_back(arg);
+    }
+
+    if (mode == "-S") {                                                     // Serve requests until killed
+        if (inputPaths.size() > 1) usage();
+        AssemblyServer server(inputPaths.empty() ? defaultSocketPath(true) : inputPaths[0], threads);
+        server.serve();
+        return 0;
+    }
+
+    if (inputPaths.empty()) usage();
+
+    if (mode == "-c") {                                                     // Assemble modules into objects
+        assembleObjects(inputPaths, optimize);
+        return 0;
+    }
+
+    if (mode == "-l") {                                                     // Link objects into an image
+        Linker linker(inputPaths, outputPath, scriptPath);
+        linker.link();
+        return 0;
+    }
+
+    if (inputPaths.size() != 1) usage();
+
+    std::string sourcePath = inputPaths[0];
+    outputPath = replaceExtension(sourcePath, extension);
+
+    int status = 0;
+    AssemblyRequest request = {sourcePath, outputPath, false, optimize, timing, debug, verbose, profilePath};
+    if (assembleRemote(defaultSocketPath(), request, status)) return status;
 
-    Assembler assembler(sourcePath, outputPath);
+    Assembler assembler(sourcePath, outputPath, optimize, timing, debug, verbose, profilePath);
     assembler.assemble();
 
     return 0;
-}
\ No newline at end of file
+}
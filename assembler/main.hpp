@@ -8,6 +8,8 @@
 #include <fstream>
 #include <memory>
 #include <cmath>
+#include <algorithm>
+#include <cstdio>
 
 
 #define OFFSET          0x4000
@@ -17,13 +19,7 @@ enum ERROR {
     STARTADDR_ERROR, INCLUDE_ERROR, FILE_ERROR, ORG_ERROR, STRING_ERROR, ASSIGNMENT_ERROR,
     FLOAT_ERROR, PAREN_ERROR, UNEXP_TOKEN_ERROR, EXT_ERROR, CONVER_ERROR, ZERO_ERROR, OP_ERROR,
     LARGE_VALUE_ERROR, INSTR_ERROR, SYNTAX_ERROR, OPERAND_ERROR, VAR_ERROR, REG_ERROR, LABEL_ERROR,
-    MAIN_ERROR,
-};
-
-struct Instruction {
-    std::string name;
-    uint8_t opcode;
-    std::string addr_mode;
+    MAIN_ERROR, OBJECT_ERROR, LINK_ERROR, MACRO_ERROR,
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "object.hpp"
+
+// Object file layout (all integers little endian):
+//   "TOBJ" u16 version, string module
+//   u16 sections    { string name, u8 relocatable, u16 origin, u16 size, data[size] }
+//   u16 symbols     { string name, u16 section, u16 offset }
+//   u16 relocations { u16 section, u16 offset, string symbol }
+// Strings are stored as u16 length followed by the characters.
+
+static void writeU16(std::ofstream& file, int value) {
+    file.put(static_cast<char>(value & 0xff));
+    file.put(static_cast<char>((value >> 8) & 0xff));
+}
+
+static void writeString(std::ofstream& file, const std::string& str) {
+    writeU16(file, static_cast<int>(str.size()));
+    file.write(str.data(), str.size());
+}
+
+static int readU16(std::ifstream& file) {
+    uint8_t bytes[2] = {0, 0};
+    file.read(reinterpret_cast<char*>(bytes), 2);
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static std::string readString(std::ifstream& file) {
+    std::string str(readU16(file), '\0');
+    file.read(str.data(), str.size());
+    return str;
+}
+
+void ObjectFile::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: unable to write object file '" << path << "'" << std::endl;
+        exit(ERROR::OBJECT_ERROR);
+    }
+
+    file.write(OBJECT_MAGIC, 4);
+    writeU16(file, OBJECT_VERSION);
+    writeString(file, module);
+
+    writeU16(file, static_cast<int>(sections.size()));
+    for (const auto& section : sections) {
+        writeString(file, section.name);
+        file.put(section.relocatable ? 1 : 0);
+        writeU16(file, section.origin);
+        writeU16(file, static_cast<int>(section.data.size()));
+        file.write(reinterpret_cast<const char*>(section.data.data()), section.data.size());
+    }
+
+    writeU16(file, static_cast<int>(symbols.size()));
+    for (const auto& symbol : symbols) {
+        writeString(file, symbol.name);
+        writeU16(file, symbol.section);
+        writeU16(file, symbol.offset);
+    }
+
+    writeU16(file, static_cast<int>(relocations.size()));
+    for (const auto& relocation : relocations) {
+        writeU16(file, relocation.section);
+        writeU16(file, relocation.offset);
+        writeString(file, relocation.symbol);
+    }
+}
+
+void ObjectFile::read(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: unable to open object file '" << path << "'" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+
+    char magic[4] = {0};
+    file.read(magic, 4);
+    if (std::string(magic, 4) != OBJECT_MAGIC || readU16(file) != OBJECT_VERSION) {
+        std::cerr << "Error: '" << path << "' is not a tasml object file" << std::endl;
+        exit(ERROR::OBJECT_ERROR);
+    }
+    module = readString(file);
+
+    sections.resize(readU16(file));
+    for (auto& section : sections) {
+        section.name = readString(file);
+        section.relocatable = file.get() != 0;
+        section.origin = readU16(file);
+        section.data.resize(readU16(file));
+        file.read(reinterpret_cast<char*>(section.data.data()), section.data.size());
+    }
+
+    symbols.resize(readU16(file));
+    for (auto& symbol : symbols) {
+        symbol.name = readString(file);
+        symbol.section = readU16(file);
+        symbol.offset = readU16(file);
+    }
+
+    relocations.resize(readU16(file));
+    for (auto& relocation : relocations) {
+        relocation.section = readU16(file);
+        relocation.offset = readU16(file);
+        relocation.symbol = readString(file);
+    }
+
+    if (!file) {
+        std::cerr << "Error: object file '" << path << "' is truncated" << std::endl;
+        exit(ERROR::OBJECT_ERROR);
+    }
+}
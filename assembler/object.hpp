@@ -0,0 +1,38 @@
+#ifndef OBJECT_HPP
+#define OBJECT_HPP
+
+#include "main.hpp"
+
+#define OBJECT_MAGIC    "TOBJ"
+#define OBJECT_VERSION  1
+
+struct ObjectSection {
+    std::string name;
+    bool relocatable;                   // Placed by the linker, otherwise fixed by .org
+    int origin;                         // Address the section was assembled at
+    std::vector<uint8_t> data;
+};
+
+struct ObjectSymbol {
+    std::string name;
+    int section;
+    int offset;
+};
+
+struct ObjectRelocation {
+    int section;
+    int offset;                         // Location of the 16 bit little endian field
+    std::string symbol;
+};
+
+struct ObjectFile {
+    std::string module;
+    std::vector<ObjectSection> sections;
+    std::vector<ObjectSymbol> symbols;          // Exported (defined) labels
+    std::vector<ObjectRelocation> relocations;  // References, imported or local
+
+    void write(const std::string& path) const;
+    void read(const std::string& path);
+};
+
+#endif
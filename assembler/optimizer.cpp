@@ -0,0 +1,275 @@
+#include "optimizer.hpp"
+
+// Instructions that leave the N and Z flags untouched, transfers included: their microcode never writes the flags
+static const std::vector<std::string> FLAG_NEUTRAL = {
+    "sta", "stx", "sty", "nop", "out", "tax", "tay", "tsx", "tsa", "txs", "tya", "clc", "sec", "cli", "sei", "clv", "pha",
+};
+
+// Instructions that overwrite N and Z without reading them
+static const std::vector<std::string> NZ_WRITERS = {"lda", "ldx", "ldy", "cmp", "cpx", "cpy", "plp"};
+
+// Instructions that overwrite the carry flag without reading it. Compares subtract the carry as a
+// borrow and the shifts rotate it in, so neither is one
+static const std::vector<std::string> CARRY_WRITERS = {"clc", "sec", "plp"};
+
+static bool isInList(const std::vector<std::string>& list, const std::string& name) {
+    return std::find(list.begin(), list.end(), name) != list.end();
+}
+
+// Helper Functions
+
+int Optimizer::_evaluate(const std::shared_ptr<ASTNode>& node) {
+    const Token& token = *node->data;
+
+    switch (token.type) {
+        case TokenType::NUMBER: return std::stoi(token.substring, nullptr, 10);
+        case TokenType::HEX: return std::stoi(token.substring, nullptr, 16);
+        case TokenType::BINARY: return std::stoi(token.substring, nullptr, 2);
+        case TokenType::CHAR: return static_cast<int>(token.substring[0]);
+        case TokenType::IDENTIFIER:
+            for (const auto& element : _varTable) {
+                if (element.name == token.substring) return element.value;
+            }
+            return 0xffff;                                                  // Imported label
+        case TokenType::LABEL: return 0xffff;
+        default: break;
+    }
+
+    if (token.type == TokenType::LOW) return _evaluate(node->children[0]) & 0xff;
+    if (token.type == TokenType::HIGH) return (_evaluate(node->children[0]) >> 8) & 0xff;
+
+    if (node->children.size() != 2) return 0xffff;
+    int left = _evaluate(node->children[0]);
+    int right = _evaluate(node->children[1]);
+
+    switch (token.type) {
+        case TokenType::PLUS: return left + right;
+        case TokenType::MINUS: return left - right;
+        case TokenType::MUL: return left * right;
+        case TokenType::DIV: return right == 0 ? 0 : left / right;
+        default: return 0xffff;
+    }
+}
+
+AddressingMode Optimizer::_addressingMode(const ASTNode* node) {
+    // Mirrors the operand decoding in CodeGen::_instructionCode
+    const auto& operand = node->children;
+
+    if (operand.empty()) return AddressingMode::IMPLIED;
+    if (operand[0]->data->type == TokenType::IMMEDIATE) return AddressingMode::IMMEDIATE;
+    if (operand[0]->data->type == TokenType::BRACKET) {
+        return operand.size() == 1 ? AddressingMode::INDIRECT : AddressingMode::INDIRECT_POST_X;
+    }
+
+    AddressingMode mode = operand.size() == 1 ? AddressingMode::ZEROPAGE : AddressingMode::ZEROPAGE_X;
+    if (_evaluate(operand[0]) > 0xff || findOpcode(node->data->substring, mode) < 0) mode = absoluteMode(mode);
+    return mode;
+}
+
+int Optimizer::_estimateCycles(const std::string& name, AddressingMode mode) {
+    int opcode = findOpcode(name, mode);
+    return opcode < 0 ? 4 : OPCODE_TABLE[opcode].maxCycles;
+}
+
+ASTNode* Optimizer::_instructionAt(size_t item) {
+    if (item >= _stream.size() || _stream[item].kind != _StreamItem::INSTRUCTION) return nullptr;
+    return _stream[item].node;
+}
+
+bool Optimizer::_isMnemonic(size_t item, const char* name) {
+    ASTNode* node = _instructionAt(item);
+    return node && node->data->substring == name;
+}
+
+bool Optimizer::_sameOperand(const ASTNode* a, const ASTNode* b) {
+    if (a->data->type != b->data->type || a->data->substring != b->data->substring) return false;
+    if (a->children.size() != b->children.size()) return false;
+
+    for (size_t i = 0; i < a->children.size(); i++) {
+        if (!_sameOperand(a->children[i].get(), b->children[i].get())) return false;
+    }
+    return true;
+}
+
+bool Optimizer::_mayReachDevice(const ASTNode* node) {
+    // The mailbox registers act on every load and store. An indexed operand may reach them from
+    // below its base, and a pointer from anywhere
+    AddressingMode mode = _addressingMode(node);
+    if (mode >= AddressingMode::INDIRECT) return true;
+
+    int low = _evaluate(node->children[0]);
+    int high = low + (mode == AddressingMode::ZEROPAGE || mode == AddressingMode::ABSOLUTE ? 0 : 0xff);
+    return low < BUS_DEVICE_END && high >= BUS_DEVICE_START;
+}
+
+size_t Optimizer::_next(size_t item) {
+    for (item++; item < _stream.size() && _stream[item].removed; item++);
+    return item;
+}
+
+void Optimizer::_remove(size_t item) {
+    ASTNode* node = _stream[item].node;
+    AddressingMode mode = _addressingMode(node);
+
+    _currentRule->bytes += 1 + operandSize(mode);
+    _currentRule->cycles += _estimateCycles(node->data->substring, mode);
+    _stream[item].removed = true;
+}
+
+// Stream Functions
+
+void Optimizer::_flatten(const std::shared_ptr<ASTNode>& node, ASTNode* parent, size_t index) {
+    if (!node) return;
+
+    // Same traversal order as CodeGen::_generateNodeCode
+    switch (node->data->type) {
+        case TokenType::INSTRUCTION:
+            _stream.push_back({_StreamItem::INSTRUCTION, parent, index, node.get()});
+            return;
+        case TokenType::LABEL_DECLARE:
+            _stream.push_back({_StreamItem::LABEL, parent, index, node.get()});
+            break;
+        case TokenType::IDENTIFIER:
+            if (!node->children.empty()) {
+                int value = _evaluate(node->children[0]);
+                auto found = std::find_if(_varTable.begin(), _varTable.end(), [&](const _SymbolTable& var) { return var.name == node->data->substring; });
+                if (found != _varTable.end()) found->value = value;
+                else _varTable.push_back({node->data->substring, value});
+            }
+            _stream.push_back({_StreamItem::BARRIER, parent, index, node.get()});
+            break;
+        default:
+            if (parent) _stream.push_back({_StreamItem::BARRIER, parent, index, node.get()});
+            break;
+    }
+
+    for (size_t i = 0; i < node->children.size(); i++) {
+        _flatten(node->children[i], node.get(), i);
+    }
+}
+
+void Optimizer::_removeMarked() {
+    // Erase back to front so the recorded indices stay valid
+    for (auto item = _stream.rbegin(); item != _stream.rend(); item++) {
+        if (item->removed) item->parent->children.erase(item->parent->children.begin() + item->index);
+    }
+}
+
+// Rules
+
+bool Optimizer::_jumpToNext(size_t item) {
+    // jmp label, where label directly follows
+    ASTNode* node = _instructionAt(item);
+    if (!_isMnemonic(item, "jmp") || node->children.size() != 1 || node->children[0]->data->type != TokenType::LABEL) return false;
+
+    for (size_t next = _next(item); next < _stream.size() && _stream[next].kind == _StreamItem::LABEL; next = _next(next)) {
+        if (_stream[next].node->data->substring == node->children[0]->data->substring) {
+            _remove(item);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Optimizer::_loadAfterStore(size_t item) {
+    // sta x / lda x, A already holds x. Only dropped when N and Z are overwritten before being read.
+    size_t load = _next(item);
+    if (!_isMnemonic(item, "sta") || !_isMnemonic(load, "lda")) return false;
+
+    ASTNode* store = _instructionAt(item);
+    ASTNode* loadNode = _instructionAt(load);
+    if (store->children.size() != loadNode->children.size() || _mayReachDevice(store)) return false;
+    for (size_t i = 0; i < store->children.size(); i++) {
+        if (!_sameOperand(store->children[i].get(), loadNode->children[i].get())) return false;
+    }
+
+    for (size_t next = _next(load); _instructionAt(next); next = _next(next)) {
+        const std::string& name = _instructionAt(next)->data->substring;
+        if (isInList(NZ_WRITERS, name)) {
+            _remove(load);
+            return true;
+        }
+        if (!isInList(FLAG_NEUTRAL, name)) break;
+    }
+    return false;
+}
+
+bool Optimizer::_deadCarry(size_t item) {
+    // clc/sec directly followed by an instruction that overwrites carry
+    if (!_isMnemonic(item, "clc") && !_isMnemonic(item, "sec")) return false;
+
+    ASTNode* next = _instructionAt(_next(item));
+    if (!next || !isInList(CARRY_WRITERS, next->data->substring)) return false;
+
+    _remove(item);
+    return true;
+}
+
+bool Optimizer::_tailCall(size_t item) {
+    // jsr x / rts becomes jmp x
+    size_t ret = _next(item);
+    if (!_isMnemonic(item, "jsr") || !_isMnemonic(ret, "rts")) return false;
+
+    ASTNode* call = _instructionAt(item);
+    _remove(ret);
+    _currentRule->cycles += _estimateCycles("jsr", AddressingMode::ABSOLUTE) - _estimateCycles("jmp", AddressingMode::ABSOLUTE);
+    call->data->substring = "jmp";
+    return true;
+}
+
+// Main Functions
+
+void Optimizer::optimize() {
+    _rules = {
+        {"jmp to next instruction", &Optimizer::_jumpToNext},
+        {"lda after sta of same address", &Optimizer::_loadAfterStore},
+        {"clc/sec before carry overwrite", &Optimizer::_deadCarry},
+        {"jsr/rts tail call", &Optimizer::_tailCall},
+    };
+
+    // Removing one instruction can expose another pattern, so repeat until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        _stream.clear();
+        _varTable.clear();
+        _flatten(_ast, nullptr, 0);
+
+        for (size_t item = 0; item < _stream.size(); item++) {
+            if (_stream[item].removed || _stream[item].kind != _StreamItem::INSTRUCTION) continue;
+
+            for (auto& rule : _rules) {
+                _currentRule = &rule;
+                if ((this->*rule.apply)(item)) {
+                    rule.hits++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+
+        _removeMarked();
+    }
+}
+
+void Optimizer::printReport(const std::string& module) {
+    int hits = 0, bytes = 0, cycles = 0;
+    char line[96];
+
+    // Built whole and written once, -c optimizes modules on several threads at a time
+    std::string report = "\nPeephole optimizer" + (module.empty() ? "" : " (" + module + ")") + "\n";
+    std::snprintf(line, sizeof(line), "  %-32s %6s %6s %8s\n", "rule", "hits", "bytes", "cycles");
+    report += line;
+
+    for (const auto& rule : _rules) {
+        std::snprintf(line, sizeof(line), "  %-32s %6d %6d %8d\n", rule.name, rule.hits, rule.bytes, rule.cycles);
+        report += line;
+        hits += rule.hits;
+        bytes += rule.bytes;
+        cycles += rule.cycles;
+    }
+
+    std::snprintf(line, sizeof(line), "  %-32s %6d %6d %8d\n", "total", hits, bytes, cycles);
+    report += line;
+    std::cout << report << std::flush;
+}
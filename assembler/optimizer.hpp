@@ -0,0 +1,69 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "main.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "devices.hpp"
+
+// Peephole optimizer run on the AST between parsing and code generation. Labels are
+// only assigned addresses by CodeGen afterwards, so removing instructions here keeps
+// every label consistent with the code that is finally emitted.
+class Optimizer {
+public:
+    Optimizer(const Parser& parser) : _ast(parser.rootNode) {}
+
+    void optimize();
+    void printReport(const std::string& module = "");
+
+private:
+    const std::shared_ptr<ASTNode> _ast;
+
+    // One entry of the flattened instruction stream
+    struct _StreamItem {
+        enum Kind { INSTRUCTION, LABEL, BARRIER } kind;
+        ASTNode* parent;
+        size_t index;
+        ASTNode* node;
+        bool removed = false;
+    };
+
+    struct _Rule {
+        const char* name;
+        bool (Optimizer::*apply)(size_t item);
+        int hits = 0;
+        int bytes = 0;
+        int cycles = 0;
+    };
+
+    struct _SymbolTable {
+        std::string name;
+        int value;
+    };
+
+    std::vector<_StreamItem> _stream;
+    std::vector<_SymbolTable> _varTable;
+    std::vector<_Rule> _rules;
+    _Rule* _currentRule = nullptr;
+
+    void _flatten(const std::shared_ptr<ASTNode>& node, ASTNode* parent, size_t index);
+    void _removeMarked();
+    size_t _next(size_t item);
+
+    bool _jumpToNext(size_t item);
+    bool _loadAfterStore(size_t item);
+    bool _deadCarry(size_t item);
+    bool _tailCall(size_t item);
+
+    ASTNode* _instructionAt(size_t item);
+    bool _isMnemonic(size_t item, const char* name);
+    bool _sameOperand(const ASTNode* a, const ASTNode* b);
+    bool _mayReachDevice(const ASTNode* node);
+    void _remove(size_t item);
+
+    int _evaluate(const std::shared_ptr<ASTNode>& node);
+    AddressingMode _addressingMode(const ASTNode* node);
+    int _estimateCycles(const std::string& name, AddressingMode mode);
+};
+
+#endif
@@ -1,6 +1,6 @@
 #include "parser.hpp"
 
-Parser::Parser(const Lexer& lexer): _lexer(lexer) {
+Parser::Parser(const Lexer& lexer, bool relocatable): _lexer(lexer), _relocatable(relocatable) {
     // Setup Root Node
     rootNode = std::make_unique<ASTNode>(nullptr);
     rootNode->data = std::make_unique<Token>();
@@ -75,16 +75,13 @@ std::unique_ptr<ASTNode> Parser::_parseDirective() {
 
     if (_currToken->substring == "db") {                                // Handle .db directive
         while (_hasToken()) {
-            const Token& nextToken = _peekNextToken();
-
-            if (nextToken.type != TokenType::NUMBER && nextToken.type != TokenType::HEX && nextToken.type != TokenType::BINARY && nextToken.type != TokenType::CHAR) {
+            if (_peekNextToken().type == TokenType::COMMA) _advanceToken();
+            if (!_hasToken() || !_isOperandStart(_peekNextToken().type)) {
                 break; // Stop when a non-numeric token is encountered
             }
             
             _advanceToken();
-            std::unique_ptr<ASTNode> byteNode = std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
-            directiveNode->children.push_back(std::move(byteNode));
-            
+            directiveNode->children.push_back(_parseOperand());
         }
     } 
     else if (_currToken->substring == "tx") {                            // Handle .tx directive
@@ -98,6 +95,33 @@ std::unique_ptr<ASTNode> Parser::_parseDirective() {
 
         directiveNode->value = std::make_unique<Token>(*_currToken);
     }
+    else if (_currToken->substring == "bound") {                         // Handle .bound directive
+        _advanceToken(); // Advance to the iteration count
+
+        if (_currToken->type != TokenType::NUMBER && _currToken->type != TokenType::HEX && _currToken->type != TokenType::BINARY) {
+            std::cerr << "Error: bound directive needs an iteration count" << std::endl;
+            exit(ERROR::SYNTAX_ERROR);
+        }
+
+        directiveNode->value = std::make_unique<Token>(*_currToken);
+    }
+    else if (_currToken->substring == "var") {                           // Handle .var directive
+        _advanceToken(); // Advance to the storage name
+
+        if (_currToken->type != TokenType::IDENTIFIER) {
+            std::cerr << "Error: var directive needs a name" << std::endl;
+            exit(ERROR::SYNTAX_ERROR);
+        }
+
+        directiveNode->value = std::make_unique<Token>(*_currToken);
+
+        // Optional size in bytes, one by default
+        TokenType next = _hasToken() ? _peekNextToken().type : TokenType::NEWLINE;
+        if (next == TokenType::NUMBER || next == TokenType::HEX || next == TokenType::BINARY) {
+            _advanceToken();
+            directiveNode->children.push_back(std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken)));
+        }
+    }
 
     return directiveNode;
 }
@@ -187,6 +211,74 @@ std::unique_ptr<ASTNode> Parser::_parsePrimary() {
     }
 }
 
+bool Parser::_isOperandStart(TokenType type) {
+    return type == TokenType::NUMBER || type == TokenType::HEX || type == TokenType::BINARY || type == TokenType::CHAR ||
+           type == TokenType::IDENTIFIER || type == TokenType::LABEL || type == TokenType::MINUS ||
+           type == TokenType::LOW || type == TokenType::HIGH;
+}
+
+// Operand expressions stay as trees so labels can be resolved in the fixup pass.
+// <expr and >expr take the low and high byte of everything after them, e.g. #>table+3.
+// Leaves the current token on the last token of the expression.
+std::unique_ptr<ASTNode> Parser::_parseOperand() {
+    if (_currToken->type == TokenType::LOW || _currToken->type == TokenType::HIGH) {
+        std::unique_ptr<ASTNode> byteNode = std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
+
+        if (!_hasToken() || !_isOperandStart(_peekNextToken().type)) {
+            std::cerr << "Error: '" << _currToken->substring << "' needs a value" << std::endl;
+            exit(ERROR::SYNTAX_ERROR);
+        }
+        _advanceToken();
+        byteNode->children.push_back(_parseOperand());
+        return byteNode;
+    }
+
+    std::unique_ptr<ASTNode> left = _parseOperandTerm();
+
+    while (_hasToken() && (_peekNextToken().type == TokenType::PLUS || _peekNextToken().type == TokenType::MINUS)) {
+        _advanceToken();
+        std::unique_ptr<ASTNode> newParent = std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
+
+        _advanceToken();
+        newParent->children.push_back(std::move(left));
+        newParent->children.push_back(_parseOperandTerm());
+        left = std::move(newParent);
+    }
+
+    return left;
+}
+
+std::unique_ptr<ASTNode> Parser::_parseOperandTerm() {
+    std::unique_ptr<ASTNode> left = _parseOperandValue();
+
+    while (_hasToken() && (_peekNextToken().type == TokenType::MUL || _peekNextToken().type == TokenType::DIV)) {
+        _advanceToken();
+        std::unique_ptr<ASTNode> newParent = std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
+
+        _advanceToken();
+        newParent->children.push_back(std::move(left));
+        newParent->children.push_back(_parseOperandValue());
+        left = std::move(newParent);
+    }
+
+    return left;
+}
+
+std::unique_ptr<ASTNode> Parser::_parseOperandValue() {
+    if (_currToken->type == TokenType::MINUS) {                         // Negative number
+        _advanceToken();
+        _currToken->substring = "-" + _currToken->substring;
+    }
+
+    if (_currToken->type != TokenType::NUMBER && _currToken->type != TokenType::HEX && _currToken->type != TokenType::BINARY &&
+        _currToken->type != TokenType::CHAR && _currToken->type != TokenType::IDENTIFIER && _currToken->type != TokenType::LABEL) {
+        std::cerr << "Error: expected a value in operand, found '" << _currToken->substring << "'" << std::endl;
+        exit(ERROR::SYNTAX_ERROR);
+    }
+
+    return std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
+}
+
 std::unique_ptr<ASTNode> Parser::_parseInstructionPrimary() { 
 
     if (_currToken->type == TokenType::L_PAREN) {
@@ -214,11 +306,9 @@ std::unique_ptr<ASTNode> Parser::_parseInstructionPrimary() {
         
         return commaNode;
     } 
-    else if (_currToken->type == TokenType::MINUS) {
-        _advanceToken();
-        _currToken->substring = "-" + _currToken->substring;
-        return std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
-    }  
+    else if (_isOperandStart(_currToken->type)) {
+        return _parseOperand();
+    }
     else {
         return std::make_unique<ASTNode>(std::make_unique<Token>(*_currToken));
     }
@@ -299,14 +389,18 @@ void Parser::parseProgram() {
 
     std::shared_ptr<ASTNode> mainNode = _findAndRemoveMainLabelNode(rootNode);
 
-    if (mainNode) {
+    if (mainNode && _relocatable && (rootNode->children.empty() || rootNode->children.front()->data->type != TokenType::ORG)) {
+        // Keep main at the start of the relocatable section
+        rootNode->children.insert(rootNode->children.begin(), mainNode);
+    }
+    else if (mainNode) {
         for (auto& child : rootNode->children) {
             if (child->data->type == TokenType::ORG) {
                 child->children.insert(child->children.begin(), mainNode);
                 break;
             } 
         }
-    } else {
+    } else if (!_relocatable) {
         std::cerr << "Error: no main function" << std::endl;
         exit(ERROR::MAIN_ERROR);
     }
@@ -14,7 +14,7 @@ struct ASTNode {
 
 class Parser {
 public:
-    Parser(const Lexer& lexer);
+    Parser(const Lexer& lexer, bool relocatable = false);
 
     void parseProgram();
     void printAST() { _printAST(rootNode, 0); }
@@ -23,6 +23,7 @@ public:
     
 private:
     Lexer _lexer;
+    const bool _relocatable;
     void _printAST(std::shared_ptr<ASTNode> node, int depth);
 
     std::unique_ptr<ASTNode> _parseStatement();
@@ -39,6 +40,10 @@ private:
 
     std::unique_ptr<ASTNode> _parseInstruction();
     std::unique_ptr<ASTNode> _parseInstructionPrimary();
+    std::unique_ptr<ASTNode> _parseOperand();
+    std::unique_ptr<ASTNode> _parseOperandTerm();
+    std::unique_ptr<ASTNode> _parseOperandValue();
+    bool _isOperandStart(TokenType type);
     std::unique_ptr<ASTNode> _parseLabel();
 
     std::shared_ptr<Token> _currToken; 
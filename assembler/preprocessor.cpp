@@ -1,34 +1,224 @@
 #include "preprocessor.hpp"
 
-std::string Preprocessor::_extractIncludedFilePath(const std::string &line) {
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr size_t CACHE_MAX_FILES = 256;         // Sources a server keeps mapped
+static uint64_t cacheClock = 0;                         // Ticks once per cacheSource, under cacheMutex()
+
+std::unordered_map<std::string, Preprocessor::_CachedFile> Preprocessor::_cache;
+
+Preprocessor::~Preprocessor() {
+    for (const auto& mapped : _mapped) {
+        if (mapped.data && !mapped.cached) munmap(const_cast<char*>(mapped.data), mapped.size);
+    }
+}
+
+std::mutex& Preprocessor::cacheMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static bool sameFile(const struct stat& status, ino_t inode, const struct timespec& modified, size_t size) {
+    return status.st_ino == inode && static_cast<size_t>(status.st_size) == size &&
+           status.st_mtim.tv_sec == modified.tv_sec && status.st_mtim.tv_nsec == modified.tv_nsec;
+}
+
+void Preprocessor::cacheSource(const std::string& canonicalPath) {
+    int fd = open(canonicalPath.c_str(), O_RDONLY);
+    struct stat status;
+    if (fd < 0) return;
+    if (fstat(fd, &status) < 0 || status.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex());
+    auto found = _cache.find(canonicalPath);
+    if (found != _cache.end()) {
+        _CachedFile& entry = found->second;
+        if (sameFile(status, entry.inode, entry.modified, entry.mapped.size)) {
+            entry.used = ++cacheClock;
+            close(fd);
+            return;
+        }
+        munmap(const_cast<char*>(entry.mapped.data), entry.mapped.size);
+        _cache.erase(found);
+    }
+
+    // Full, so the file the longest without a request goes
+    if (_cache.size() >= CACHE_MAX_FILES) {
+        auto oldest = std::min_element(_cache.begin(), _cache.end(), [](const auto& a, const auto& b) { return a.second.used < b.second.used; });
+        munmap(const_cast<char*>(oldest->second.mapped.data), oldest->second.mapped.size);
+        _cache.erase(oldest);
+    }
+
+    void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return;
+
+    _cache[canonicalPath] = {{static_cast<const char*>(data), static_cast<size_t>(status.st_size), true}, status.st_ino, status.st_mtim, ++cacheClock};
+}
+
+// Helper Functions
+
+std::string Preprocessor::_extractIncludedFilePath(std::string_view line) {
     // Extract the file path from the include directive
     // Assuming the format is: .include <filepath>
-    size_t start = line.find('<') + 1;
+    size_t start = line.find('<');
     size_t end = line.find('>');
-    if (start == std::string::npos || end == std::string::npos || start >= end) {
+    if (start == std::string::npos || end == std::string::npos || start + 1 >= end) {
         std::cerr << "Error: invalid include directive format" << std::endl;
         exit(ERROR::INCLUDE_ERROR);
     }
-    return line.substr(start, end - start);
+    return std::string(line.substr(start + 1, end - start - 1));
+}
+
+std::string Preprocessor::_resolve(std::string& filePath) {
+    char resolved[PATH_MAX];
+
+    // Relative to the working directory first, then to the including file
+    if (realpath(filePath.c_str(), resolved)) return resolved;
+
+    if (!_includeStack.empty() && filePath[0] != '/') {
+        const std::string& includer = _includeStack.back();
+        std::string sibling = includer.substr(0, includer.find_last_of('/') + 1) + filePath;
+        if (realpath(sibling.c_str(), resolved)) {
+            const std::string& includerName = files[_includeFiles.back()];
+            filePath = includerName.substr(0, includerName.find_last_of('/') + 1) + filePath;
+            return resolved;
+        }
+    }
+
+    std::cerr << "Error: unable to open file '" << filePath << "'" << std::endl;
+    exit(ERROR::FILE_ERROR);
 }
 
-void Preprocessor::processFile(const std::string& filePath, std::string& output) {
-    std::ifstream inputFile(filePath);
+Preprocessor::_MappedFile Preprocessor::_map(const std::string& filePath) {
+    int fd = open(filePath.c_str(), O_RDONLY);
+    struct stat status;
 
-    if (!inputFile.is_open()) {
+    if (fd < 0 || fstat(fd, &status) < 0) {
         std::cerr << "Error: unable to open file '" << filePath << "'" << std::endl;
         exit(ERROR::FILE_ERROR);
     }
 
-    std::string line;
+    _MappedFile mapped = {nullptr, static_cast<size_t>(status.st_size)};
 
-    while (std::getline(inputFile, line)) {
-        if (line.find(".include") == 0) {
-            std::string includedFilePath = _extractIncludedFilePath(line);
-            processFile(includedFilePath, output);
-        } else output += line + '\n';
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex());
+        auto found = _cache.find(filePath);
+        if (found != _cache.end() && sameFile(status, found->second.inode, found->second.modified, mapped.size)) {
+            close(fd);
+            return found->second.mapped;
+        }
+    }
 
+    if (mapped.size > 0) {
+        void* data = mmap(nullptr, mapped.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            std::cerr << "Error: unable to map file '" << filePath << "'" << std::endl;
+            exit(ERROR::FILE_ERROR);
+        }
+        mapped.data = static_cast<const char*>(data);
     }
 
-    inputFile.close();
-}
\ No newline at end of file
+    close(fd);
+    return mapped;
+}
+
+void Preprocessor::_addChunk(std::string_view text, int file, int line) {
+    if (text.empty()) return;
+    chunks.push_back({text, _size, file, line});
+    _size += text.size();
+}
+
+// Main Functions
+
+void Preprocessor::processFile(const std::string& filePath) {
+    std::string name = filePath;
+    std::string path = _resolve(name);
+
+    if (std::find(_includeStack.begin(), _includeStack.end(), path) != _includeStack.end()) {
+        std::cerr << "Error: include cycle ";
+        for (const auto& open : _includeStack) std::cerr << open << " -> ";
+        std::cerr << path << std::endl;
+        exit(ERROR::INCLUDE_ERROR);
+    }
+
+    // Include guard
+    if (!_included.insert(path).second) return;
+
+    _mapped.push_back(_map(path));
+    _process(std::string_view(_mapped.back().data, _mapped.back().size), name, path);
+}
+
+void Preprocessor::processSource(std::string_view source, const std::string& name) {
+    // The caller keeps the text alive; includes still come from disk, next to the name
+    char resolved[PATH_MAX];
+    std::string path = realpath(name.c_str(), resolved) ? resolved : name;
+    _included.insert(path);
+    _process(source, name, path);
+}
+
+void Preprocessor::_process(std::string_view source, const std::string& name, const std::string& path) {
+    _includeOrder.push_back(path);
+
+    int file = files.size();
+    files.push_back(name);
+    _includeStack.push_back(path);
+    _includeFiles.push_back(file);
+
+    size_t chunkStart = 0;
+    int chunkLine = 1;
+    int lineNumber = 1;
+
+    for (size_t lineStart = 0; lineStart < source.size(); lineNumber++) {
+        size_t lineEnd = source.find('\n', lineStart);
+        size_t next = lineEnd == std::string_view::npos ? source.size() : lineEnd + 1;
+
+        if (source.compare(lineStart, 8, ".include") == 0) {
+            _addChunk(source.substr(chunkStart, lineStart - chunkStart), file, chunkLine);
+            processFile(_extractIncludedFilePath(source.substr(lineStart, next - lineStart)));
+            chunkStart = next;
+            chunkLine = lineNumber + 1;
+        }
+
+        lineStart = next;
+    }
+
+    // Chunks always end in a newline, only a last line without one is copied
+    std::string_view rest = source.substr(chunkStart);
+    if (!rest.empty() && rest.back() != '\n') {
+        size_t lastLine = rest.rfind('\n') + 1;
+        _addChunk(rest.substr(0, lastLine), file, chunkLine);
+
+        _tails.push_back(std::make_unique<std::string>(rest.substr(lastLine)));
+        _tails.back()->push_back('\n');
+        _addChunk(*_tails.back(), file, lineNumber - 1);
+    } else _addChunk(rest, file, chunkLine);
+
+    _includeStack.pop_back();
+    _includeFiles.pop_back();
+}
+
+Preprocessor::SourceLine Preprocessor::locate(size_t offset) const {
+    if (chunks.empty()) return {0, 0};
+
+    auto chunk = std::upper_bound(chunks.begin(), chunks.end(), offset,
+        [](size_t value, const SourceChunk& c) { return value < c.offset; });
+    if (chunk != chunks.begin()) chunk--;
+
+    size_t length = std::min(offset - chunk->offset, chunk->text.size());
+    int line = chunk->line + std::count(chunk->text.begin(), chunk->text.begin() + length, '\n');
+    return {chunk->file, line};
+}
+
+std::string Preprocessor::describe(const SourceLine& location) const {
+    if (location.file < 0 || location.file >= (int)files.size()) return "line " + std::to_string(location.line);
+    return files[location.file] + ":" + std::to_string(location.line);
+}
@@ -1,15 +1,83 @@
 #ifndef PREPROCESSOR_HPP
-#define PREPROCESOR_HPP
+#define PREPROCESSOR_HPP
 
 #include "main.hpp"
 
+#include <sys/stat.h>
+
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// Maps every source once and splices .include lines out as a list of views into the mappings,
+// so nothing is copied. A file is included at most once by canonical path; including a file
+// that is still open is a cycle and an error. Every chunk ends with a newline.
 class Preprocessor {
 public:
-    Preprocessor() {}; 
-    void processFile(const std::string& filePath, std::string& output);
+    Preprocessor() {};
+    Preprocessor(const Preprocessor&) = delete;
+    Preprocessor& operator=(const Preprocessor&) = delete;
+    ~Preprocessor();
+
+    void processFile(const std::string& filePath);
+    void processSource(std::string_view source, const std::string& name);
+
+    struct SourceLine {
+        int file;                       // Index into files
+        int line;
+    };
+
+    struct SourceChunk {
+        std::string_view text;
+        size_t offset;                  // Start of the chunk in the output
+        int file;
+        int line;                       // Line of the first character
+    };
+
+    // Output in order, and where it came from
+    std::vector<std::string> files;
+    std::vector<SourceChunk> chunks;
+
+    size_t size() const { return _size; }
+    SourceLine locate(size_t offset) const;
+    std::string describe(const SourceLine& location) const;
+    std::vector<std::string> sources() const { return _includeOrder; }
+
+    // Mappings kept warm by a long lived process (tasml -S), reused while a file is unchanged.
+    // The least recently requested file is dropped once the cache is full.
+    static void cacheSource(const std::string& canonicalPath);
+    static std::mutex& cacheMutex();
+
 private:
-    const std::string _filename;
-    std::string _extractIncludedFilePath(const std::string& line);
+    struct _MappedFile {
+        const char* data;
+        size_t size;
+        bool cached = false;            // Owned by the cache, not unmapped here
+    };
+
+    struct _CachedFile {
+        _MappedFile mapped;
+        ino_t inode;
+        struct timespec modified;
+        uint64_t used;                  // cacheSource tick of the last request that read it
+    };
+
+    static std::unordered_map<std::string, _CachedFile> _cache;
+
+    std::vector<_MappedFile> _mapped;
+    std::unordered_set<std::string> _included;              // Canonical paths
+    std::vector<std::string> _includeOrder;
+    std::vector<std::string> _includeStack;                 // Files still open, for cycles
+    std::vector<int> _includeFiles;
+    std::vector<std::unique_ptr<std::string>> _tails;       // Last lines without a newline
+    size_t _size = 0;
+
+    std::string _extractIncludedFilePath(std::string_view line);
+    std::string _resolve(std::string& filePath);
+    _MappedFile _map(const std::string& filePath);
+    void _process(std::string_view source, const std::string& name, const std::string& path);
+    void _addChunk(std::string_view text, int file, int line);
 };
 
-#endif
\ No newline at end of file
+#endif
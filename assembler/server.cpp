@@ -0,0 +1,402 @@
+#include "server.hpp"
+#include "assembler.hpp"
+
+#include <csignal>
+#include <cstring>
+#include <dirent.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#define FLAG_OBJECT     0x01
+#define FLAG_OPTIMIZE   0x02
+#define FLAG_TIMING     0x04
+#define FLAG_DEBUG      0x08
+#define FLAG_VERBOSE    0x10
+
+#define SOURCES_FILE    ".sources"                 // Written by the child next to its output
+
+// Helper Functions
+
+static void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+static void putString(std::string& out, const std::string& value) {
+    putU32(out, value.size());
+    out += value;
+}
+
+static bool getU32(const std::string& in, size_t& pos, uint32_t& value) {
+    if (pos + 4 > in.size()) return false;
+    value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<uint8_t>(in[pos++])) << (8 * i);
+    return true;
+}
+
+static bool getString(const std::string& in, size_t& pos, std::string& value) {
+    uint32_t size;
+    if (!getU32(in, pos, size) || pos + size > in.size()) return false;
+    value = in.substr(pos, size);
+    pos += size;
+    return true;
+}
+
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t count = read(fd, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool writeFrame(int fd, const std::string& payload) {
+    std::string header;
+    putU32(header, payload.size());
+    return writeAll(fd, header.data(), header.size()) && writeAll(fd, payload.data(), payload.size());
+}
+
+static bool readFrame(int fd, std::string& payload) {
+    char header[4];
+    if (!readAll(fd, header, sizeof(header))) return false;
+
+    std::string headerString(header, sizeof(header));
+    size_t pos = 0;
+    uint32_t size;
+    getU32(headerString, pos, size);
+    if (size > SERVER_MAX_FRAME) return false;
+
+    payload.resize(size);
+    return readAll(fd, payload.data(), size);
+}
+
+static std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::string baseName(const std::string& path) {
+    return path.substr(path.find_last_of('/') + 1);
+}
+
+static bool socketAddress(const std::string& socketPath, struct sockaddr_un& address) {
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: socket path '" << socketPath << "' is too long" << std::endl;
+        return false;
+    }
+
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socketPath.c_str());
+    return true;
+}
+
+// Both ends only talk to processes of the same user
+static bool sameUser(int fd) {
+    struct ucred peer;
+    socklen_t size = sizeof(peer);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &size) == 0 && peer.uid == getuid();
+}
+
+int connectTo(const std::string& socketPath) {
+    struct sockaddr_un address;
+    if (!socketAddress(socketPath, address)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (!sameUser(fd)) {
+        std::cerr << "Warning: ignoring '" << socketPath << "', its server runs as another user" << std::endl;
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+std::string defaultSocketPath(bool create) {
+    const char* path = std::getenv("TASML_SOCKET");
+    if (path && *path) return path;
+
+    // Private to the user by the XDG spec, otherwise a directory of our own that nobody else can enter
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) return std::string(runtime) + "/tasml.sock";
+
+    std::string directory = "/tmp/tasml-" + std::to_string(getuid());
+    if (create) mkdir(directory.c_str(), 0700);
+
+    struct stat status;
+    if (lstat(directory.c_str(), &status) < 0 || !S_ISDIR(status.st_mode) || status.st_uid != getuid() || (status.st_mode & 077)) return "";
+    return directory + "/server.sock";
+}
+
+// Server
+
+static char listeningPath[sizeof(((struct sockaddr_un*)nullptr)->sun_path)];
+
+static void stopServing(int) {
+    unlink(listeningPath);
+    _exit(0);
+}
+
+AssemblyServer::AssemblyServer(const std::string& socketPath, int workers)
+: _socketPath(socketPath), _workers(std::max(1, workers)) {}
+
+std::string AssemblyServer::_handle(const std::string& payload) {
+    size_t pos = 0;
+    std::string cwd, sourcePath, outputPath, profilePath;
+    uint8_t flags = payload.empty() ? 0 : payload[pos++];
+    std::string response;
+
+    if (payload.empty() || !getString(payload, pos, cwd) || !getString(payload, pos, sourcePath) || !getString(payload, pos, outputPath)) {
+        response.push_back(static_cast<char>(ERROR::FILE_ERROR));
+        putString(response, "Error: malformed request\n");
+        putU32(response, 0);
+        return response;
+    }
+
+    // Clients from before -P send no profile
+    if (pos < payload.size() && !getString(payload, pos, profilePath)) profilePath.clear();
+
+    char directory[] = "/tmp/tasml-XXXXXX";
+    int output[2];
+    if (!mkdtemp(directory) || pipe(output) < 0) {
+        response.push_back(static_cast<char>(ERROR::FILE_ERROR));
+        putString(response, "Error: server is unable to create a work directory\n");
+        putU32(response, 0);
+        return response;
+    }
+
+    // The child is a snapshot of the worker, including its include cache
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(_listener);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        dup2(output[1], STDOUT_FILENO);
+        dup2(output[1], STDERR_FILENO);
+        close(output[0]);
+        close(output[1]);
+
+        if (chdir(cwd.c_str()) < 0) {
+            std::cerr << "Error: unable to enter '" << cwd << "'" << std::endl;
+            exit(ERROR::FILE_ERROR);
+        }
+
+        std::string workPath = std::string(directory) + "/" + baseName(outputPath);
+        Assembler assembler(sourcePath, workPath, flags & FLAG_OPTIMIZE, flags & FLAG_TIMING, flags & FLAG_DEBUG, flags & FLAG_VERBOSE, profilePath);
+        if (flags & FLAG_OBJECT) {
+            // Modules arrive together from tasml -c, one on each worker
+            assembler.setLexerThreads(std::max(1u, std::thread::hardware_concurrency() / static_cast<unsigned>(_workers)));
+            assembler.assembleObject();
+        } else assembler.assemble();
+
+        std::ofstream sources(std::string(directory) + "/" SOURCES_FILE);
+        for (const auto& source : assembler.sources()) sources << source << '\n';
+        sources.close();
+        exit(0);
+    }
+
+    close(output[1]);
+    std::string diagnostics;
+    char buffer[4096];
+    for (ssize_t count; (count = read(output[0], buffer, sizeof(buffer))) != 0;) {
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+        diagnostics.append(buffer, count);
+    }
+    close(output[0]);
+
+    int status = ERROR::FILE_ERROR;
+    if (pid > 0 && waitpid(pid, &status, 0) == pid) status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    else diagnostics += "Error: server is unable to start a worker\n";
+
+    // Return what the run produced and keep the files it read warm for the next request
+    std::vector<std::pair<std::string, std::string>> files;
+    if (DIR* dir = opendir(directory)) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+
+            std::string path = std::string(directory) + "/" + name;
+            if (name == SOURCES_FILE) {
+                std::ifstream sources(path);
+                for (std::string source; std::getline(sources, source);) Preprocessor::cacheSource(source);
+            }
+            else if (status == 0) files.push_back({name, readFile(path)});
+            unlink(path.c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(directory);
+
+    response.push_back(static_cast<char>(status));
+    putString(response, diagnostics);
+    putU32(response, files.size());
+    for (const auto& file : files) {
+        putString(response, file.first);
+        putString(response, file.second);
+    }
+    return response;
+}
+
+void AssemblyServer::_startWorker(pid_t server) {
+    pid_t pid = fork();
+    if (pid != 0) return;
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != server) _exit(0);
+
+    _work();
+    _exit(ERROR::FILE_ERROR);
+}
+
+void AssemblyServer::_work() {
+    while (true) {
+        int client = accept(_listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return;
+        }
+        if (!sameUser(client)) {
+            close(client);
+            continue;
+        }
+
+        // A connection may send any number of requests
+        std::string payload;
+        while (readFrame(client, payload)) {
+            if (!writeFrame(client, _handle(payload))) break;
+        }
+        close(client);
+    }
+}
+
+void AssemblyServer::serve() {
+    if (_socketPath.empty()) {
+        std::cerr << "Error: /tmp/tasml-" << getuid() << " is not a private directory, set XDG_RUNTIME_DIR or TASML_SOCKET" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+
+    struct sockaddr_un address;
+    if (!socketAddress(_socketPath, address)) exit(ERROR::FILE_ERROR);
+
+    // A socket nobody answers on is left over from a server that died
+    int existing = connectTo(_socketPath);
+    if (existing >= 0) {
+        close(existing);
+        std::cerr << "Error: a server is already listening on '" << _socketPath << "'" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+    unlink(_socketPath.c_str());
+
+    _listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listener < 0 || bind(_listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0 || listen(_listener, 64) < 0) {
+        std::cerr << "Error: unable to listen on '" << _socketPath << "'" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+
+    std::strcpy(listeningPath, _socketPath.c_str());
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "Listening on " << _socketPath << " with " << _workers << " workers" << std::endl;
+
+    // Processes rather than threads: each forks a child per request, and fork is only safe from a
+    // process running one thread. Workers end with the server.
+    pid_t server = getpid();
+    for (int i = 0; i < _workers; i++) _startWorker(server);
+    signal(SIGINT, stopServing);
+    signal(SIGTERM, stopServing);
+
+    // A worker killed by a signal is replaced, one whose listener failed is not
+    for (int status; true;) {
+        if (wait(&status) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (WIFSIGNALED(status)) _startWorker(server);
+    }
+
+    close(_listener);
+    unlink(_socketPath.c_str());
+}
+
+// Client
+
+bool assembleRemote(const std::string& socketPath, const AssemblyRequest& request, int& status) {
+    int fd = connectTo(socketPath);
+    if (fd < 0) return false;
+
+    bool answered = assembleRemote(fd, request, status);
+    close(fd);
+    return answered;
+}
+
+bool assembleRemote(int fd, const AssemblyRequest& request, int& status) {
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof(cwd))) return false;
+
+    std::string payload;
+    payload.push_back(static_cast<char>((request.object ? FLAG_OBJECT : 0) | (request.optimize ? FLAG_OPTIMIZE : 0) |
+        (request.timing ? FLAG_TIMING : 0) | (request.debug ? FLAG_DEBUG : 0) | (request.verbose ? FLAG_VERBOSE : 0)));
+    putString(payload, cwd);
+    putString(payload, request.sourcePath);
+    putString(payload, request.outputPath);
+    putString(payload, request.profilePath);
+
+    std::string response;
+    if (!writeFrame(fd, payload) || !readFrame(fd, response)) return false;
+
+    size_t pos = 1;
+    std::string diagnostics;
+    uint32_t count;
+    if (response.empty() || !getString(response, pos, diagnostics) || !getU32(response, pos, count)) {
+        std::cerr << "Error: malformed response from server" << std::endl;
+        exit(ERROR::FILE_ERROR);
+    }
+    status = static_cast<uint8_t>(response[0]);
+    (status == 0 ? std::cout : std::cerr) << diagnostics << std::flush;
+
+    // Outputs go next to the requested output path, and only under its name with another extension
+    std::string directory = request.outputPath.substr(0, request.outputPath.find_last_of('/') + 1);
+    std::string outputName = baseName(request.outputPath);
+    std::string stem = outputName.substr(0, outputName.find_last_of('.') + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        std::string name, data;
+        if (!getString(response, pos, name) || !getString(response, pos, data) || baseName(name).compare(0, stem.size(), stem) != 0) {
+            std::cerr << "Error: malformed response from server" << std::endl;
+            exit(ERROR::FILE_ERROR);
+        }
+
+        std::ofstream file(directory + baseName(name), std::ios::binary);
+        if (!file.write(data.data(), data.size())) {
+            std::cerr << "Error: unable to write '" << directory + baseName(name) << "'" << std::endl;
+            exit(ERROR::FILE_ERROR);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include "main.hpp"
+
+#define SERVER_MAX_FRAME    (64 << 20)
+
+// A long lived tasml (-S) that assembles requests from clients over a Unix socket.
+// Single threaded worker processes each take a connection; every assembly runs in a child the
+// worker forks, so an error exit() only ends that request, while the child inherits the warm
+// instruction set and the include cache kept by its worker. Both ends of a connection must
+// belong to the same user.
+//
+// Every message is a u32 little endian length followed by the payload.
+//   request:  u8 flags, string cwd, string source, string output, string profile
+//   response: u8 exit status, string diagnostics, u32 count {string name, string data}
+// Strings are a u32 length and the bytes. Output files are returned, not written by the server.
+struct AssemblyRequest {
+    std::string sourcePath;
+    std::string outputPath;
+    bool object = false;
+    bool optimize = false;
+    bool timing = false;
+    bool debug = false;
+    bool verbose = false;
+    std::string profilePath;                // Access profile for .var placement, empty for none
+};
+
+class AssemblyServer {
+public:
+    AssemblyServer(const std::string& socketPath, int workers);
+
+    void serve();
+
+private:
+    const std::string _socketPath;
+    const int _workers;
+    int _listener = -1;
+
+    void _startWorker(pid_t server);
+    void _work();
+    std::string _handle(const std::string& payload);
+};
+
+// TASML_SOCKET, else in XDG_RUNTIME_DIR, else in a 0700 directory under /tmp that create makes.
+// Empty when that directory is missing or not private.
+std::string defaultSocketPath(bool create = false);
+
+// A connection to the server's socket, or -1 when no server of this user is listening
+int connectTo(const std::string& socketPath);
+
+// Returns false when no server is listening, so the caller can assemble in process
+bool assembleRemote(const std::string& socketPath, const AssemblyRequest& request, int& status);
+// Sends one request over an open connection, false when the server dropped it
+bool assembleRemote(int fd, const AssemblyRequest& request, int& status);
+
+#endif
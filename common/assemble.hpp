@@ -0,0 +1,60 @@
+#ifndef ASSEMBLE_HPP
+#define ASSEMBLE_HPP
+
+// tasml as a library call, for tools that run what they assemble without an image on disk in
+// between. Implemented by the assembler's objects; like tasml it exits on the first error.
+
+#include "image.hpp"
+#include "symbols.hpp"
+
+#include <iterator>
+#include <string_view>
+
+struct AssembledProgram {
+    std::vector<uint8_t> memory;            // All 64K, as the code generator laid it out
+    std::vector<ImageRange> ranges;         // The populated parts of it
+    SymbolMap symbols;
+    std::vector<std::string> sources;       // Canonical paths of the source and everything it included
+};
+
+inline bool readSource(const std::string& path, std::string& source) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: unable to open source '" << path << "'" << std::endl;
+        return false;
+    }
+    source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// An AssembledProgram as bytes, for handing one from the process that assembled it to another:
+//   memory   u16 ranges { u16 start, u32 end }   u16 sources { string path }   symbol map
+inline void writeAssembledProgram(std::ostream& out, const AssembledProgram& program) {
+    out.write(reinterpret_cast<const char*>(program.memory.data()), program.memory.size());
+    _writeSymbolsInt(out, program.ranges.size(), 2);
+    for (const auto& range : program.ranges) {
+        _writeSymbolsInt(out, range.start, 2);
+        _writeSymbolsInt(out, range.end, 4);
+    }
+    _writeSymbolsInt(out, program.sources.size(), 2);
+    for (const auto& source : program.sources) _writeSymbolsString(out, source);
+    program.symbols.write(out);
+}
+
+inline bool readAssembledProgram(std::istream& in, AssembledProgram& program) {
+    program.memory.assign(IMAGE_MEMORY_SIZE, 0);
+    in.read(reinterpret_cast<char*>(program.memory.data()), program.memory.size());
+    program.ranges.resize(_readSymbolsInt(in, 2));
+    for (auto& range : program.ranges) {
+        range.start = _readSymbolsInt(in, 2);
+        range.end = _readSymbolsInt(in, 4);
+    }
+    program.sources.resize(_readSymbolsInt(in, 2));
+    for (auto& source : program.sources) source = _readSymbolsString(in);
+    return in && program.symbols.read(in, "the assembler's symbol map");
+}
+
+// The name is what errors and the symbol map call the source, and where .include looks from
+AssembledProgram assembleProgram(std::string_view source, const std::string& name, bool optimize = false);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef DEVICES_HPP
+#define DEVICES_HPP
+
+// The multiprocessor bus's memory map, shared by the emulator that implements it and tasml, which
+// must neither place storage on the registers nor treat their loads and stores as plain memory.
+// Each core keeps the zero page, the stack and the mailbox registers to itself. The rest of RAM
+// is one memory every core sees, and the ROM is the same program in all of them
+#define BUS_SHARED_START    0x0200
+#define BUS_DEVICE_START    0x3f00
+#define BUS_DEVICE_END      0x3f06
+
+// Mailbox registers
+#define MAILBOX_CPU_ID      0x3f00          // Read: this core's number
+#define MAILBOX_CPU_COUNT   0x3f01          // Read: how many cores there are
+#define MAILBOX_PENDING     0x3f02          // Read: messages waiting for this core
+#define MAILBOX_DATA        0x3f03          // Read: the oldest of them; write: drops it
+#define MAILBOX_TARGET      0x3f04          // Write: the core sends go to
+#define MAILBOX_SEND        0x3f05          // Write: posts the byte to the target, raising its IRQ
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef DISASM_HPP
+#define DISASM_HPP
+
+// Disassembler driven by OPCODE_TABLE, the table tasml encodes from, so both always agree on the
+// ISA. Instructions print in tasml syntax: reassembling the text gives the same bytes, except an
+// absolute operand below $100 that has a zero page form, which tasml would shrink.
+
+#include "isa.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#define DISASM_MAX_TEXT     96              // Longest instruction text, labels are cut to fit
+
+struct Instruction {
+    const Opcode* op;                       // Illegal opcodes have an empty mnemonic
+    int address;
+    int size;
+    int operand;                            // Zero for implied
+};
+
+// Around the operand, per addressing mode
+struct _DisasmSyntax {
+    std::string_view prefix;
+    std::string_view suffix;
+};
+
+constexpr std::array<_DisasmSyntax, ADDRESSING_MODES> _DISASM_SYNTAX = {{
+    {"", ""}, {"#", ""}, {"", ""}, {"", ",rX"}, {"", ",rY"}, {"", ""}, {"", ",rX"}, {"", ",rY"},
+    {"(", ")"}, {"(", ",rX)"}, {"(", ",rY)"}, {"(", "),rX"}, {"(", "),rY"},
+}};
+
+inline Instruction decodeInstruction(const std::vector<uint8_t>& memory, int address) {
+    const Opcode& op = OPCODE_TABLE[memory[address & 0xffff]];
+    Instruction instr = {&op, address, op.legal() ? op.size() : 1, 0};
+    for (int i = instr.size - 1; i > 0; i--) instr.operand = instr.operand << 8 | memory[(address + i) & 0xffff];
+    return instr;
+}
+
+// A zero page sized value in an absolute operand reassembles to the zero page opcode
+inline bool reassemblesShorter(const Instruction& instr) {
+    AddressingMode mode = instr.op->mode;
+    if (mode != AddressingMode::ABSOLUTE && mode != AddressingMode::ABSOLUTE_X && mode != AddressingMode::ABSOLUTE_Y) return false;
+
+    AddressingMode zeropage = static_cast<AddressingMode>(static_cast<int>(mode) - 3);
+    return instr.operand <= 0xff && findOpcode(instr.op->mnemonic, zeropage) >= 0;
+}
+
+inline char* _disasmCopy(char* out, std::string_view text) {
+    for (char c : text) *out++ = c;
+    return out;
+}
+
+inline char* _disasmHex(char* out, int value, int digits) {
+    constexpr char hex[] = "0123456789abcdef";
+    *out++ = '$';
+    for (int shift = 4 * (digits - 1); shift >= 0; shift -= 4) *out++ = hex[(value >> shift) & 0xf];
+    return out;
+}
+
+// Writes the instruction without a terminator and returns the length, at most DISASM_MAX_TEXT.
+// The label, when given, replaces a 16 bit operand. No snprintf, traces print one per line
+inline int formatInstruction(char* text, const Instruction& instr, std::string_view label = {}) {
+    char* out = text;
+    if (!instr.op->legal()) {
+        out = _disasmCopy(out, ".db ");
+        return _disasmHex(out, static_cast<int>(instr.op->opcode), 2) - text;
+    }
+
+    out = _disasmCopy(out, instr.op->mnemonic);
+    if (instr.op->mode == AddressingMode::IMPLIED) return out - text;
+
+    const _DisasmSyntax& syntax = _DISASM_SYNTAX[static_cast<int>(instr.op->mode)];
+    *out++ = ' ';
+    out = _disasmCopy(out, syntax.prefix);
+    if (!label.empty() && instr.size == 3) out = _disasmCopy(out, label.substr(0, DISASM_MAX_TEXT - 9));
+    else out = _disasmHex(out, instr.operand, 2 * (instr.size - 1));
+    out = _disasmCopy(out, syntax.suffix);
+    return out - text;
+}
+
+inline std::string disassemble(const std::vector<uint8_t>& memory, int address) {
+    char text[DISASM_MAX_TEXT];
+    return std::string(text, formatInstruction(text, decodeInstruction(memory, address)));
+}
+
+// Control flow, for following code from an entry point
+inline bool isBranch(const Opcode& op) { return op.legal() && op.mnemonic[0] == 'b' && op.mnemonic != "bit" && op.mnemonic != "brk"; }
+inline bool continuesAfter(const Opcode& op) {
+    return op.legal() && op.mnemonic != "jmp" && op.mnemonic != "rts" && op.mnemonic != "rti" && op.mnemonic != "hlt" && op.mnemonic != "brk";
+}
+inline bool hasTarget(const Opcode& op) {
+    return isBranch(op) || op.mnemonic == "jsr" || (op.mnemonic == "jmp" && op.mode == AddressingMode::ABSOLUTE);
+}
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+// Program image formats shared by the assembler (writer) and the emulator (loader).
+//   .bin   full ROM image, 0x4000..0xffff
+//   .seg   segment list: "TSEG" u16 count { u16 address, u16 length, data[length] }
+//   .hex   Intel HEX, 16 byte data records
+//   .srec  Motorola S-record, S1 data records
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#define IMAGE_ROM_START     0x4000
+#define IMAGE_MEMORY_SIZE   0x10000
+#define IMAGE_RECORD_BYTES  16
+
+enum ImageFormat { IMAGE_BIN, IMAGE_SEGMENTS, IMAGE_IHEX, IMAGE_SREC };
+
+// Half open range of populated addresses
+struct ImageRange {
+    int start;
+    int end;
+};
+
+inline ImageFormat imageFormatFromPath(const std::string& path) {
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    if (extension == "seg") return IMAGE_SEGMENTS;
+    if (extension == "hex") return IMAGE_IHEX;
+    if (extension == "srec") return IMAGE_SREC;
+    return IMAGE_BIN;
+}
+
+inline void _writeHexRecord(std::ofstream& file, const char* prefix, const std::vector<uint8_t>& fields, bool srec) {
+    // Intel HEX checksums are the two's complement of the sum, S-records the one's complement
+    unsigned int sum = 0;
+    for (uint8_t field : fields) sum += field;
+    uint8_t checksum = srec ? static_cast<uint8_t>(~sum) : static_cast<uint8_t>(-sum);
+
+    char byte[3];
+    file << prefix;
+    for (uint8_t field : fields) {
+        std::snprintf(byte, sizeof(byte), "%02X", field);
+        file << byte;
+    }
+    std::snprintf(byte, sizeof(byte), "%02X", checksum);
+    file << byte << '\n';
+}
+
+// Writes only the populated ranges of memory, except for IMAGE_BIN which is always the full ROM
+inline bool writeImage(const std::string& path, const std::vector<uint8_t>& memory, const std::vector<ImageRange>& ranges) {
+    ImageFormat format = imageFormatFromPath(path);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error opening file for writing." << std::endl;
+        return false;
+    }
+
+    if (format == IMAGE_BIN) {
+        file.write(reinterpret_cast<const char*>(&memory[IMAGE_ROM_START]), IMAGE_MEMORY_SIZE - IMAGE_ROM_START);
+        return true;
+    }
+
+    if (format == IMAGE_SEGMENTS) {
+        const uint8_t header[6] = {'T', 'S', 'E', 'G', static_cast<uint8_t>(ranges.size()), static_cast<uint8_t>(ranges.size() >> 8)};
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+        for (const auto& range : ranges) {
+            int length = range.end - range.start;
+            const uint8_t segment[4] = {static_cast<uint8_t>(range.start), static_cast<uint8_t>(range.start >> 8),
+                                        static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8)};
+            file.write(reinterpret_cast<const char*>(segment), sizeof(segment));
+            file.write(reinterpret_cast<const char*>(&memory[range.start]), length);
+        }
+        return true;
+    }
+
+    bool srec = format == IMAGE_SREC;
+    if (srec) _writeHexRecord(file, "S0", {0x03, 0x00, 0x00}, true);
+
+    for (const auto& range : ranges) {
+        for (int address = range.start; address < range.end; address += IMAGE_RECORD_BYTES) {
+            int length = std::min(IMAGE_RECORD_BYTES, range.end - address);
+            std::vector<uint8_t> fields;
+
+            if (srec) fields = {static_cast<uint8_t>(length + 3), static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address)};
+            else fields = {static_cast<uint8_t>(length), static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address), 0x00};
+
+            fields.insert(fields.end(), memory.begin() + address, memory.begin() + address + length);
+            _writeHexRecord(file, srec ? "S1" : ":", fields, srec);
+        }
+    }
+
+    // Execution starts at the beginning of ROM
+    if (srec) _writeHexRecord(file, "S9", {0x03, IMAGE_ROM_START >> 8, IMAGE_ROM_START & 0xff}, true);
+    else file << ":00000001FF\n";
+    return true;
+}
+
+inline int _parseHexByte(const std::string& line, size_t position) {
+    if (position + 2 > line.size()) return -1;
+    char* end = nullptr;
+    std::string digits = line.substr(position, 2);
+    long value = std::strtol(digits.c_str(), &end, 16);
+    return *end == '\0' ? static_cast<int>(value) : -1;
+}
+
+// Parses one Intel HEX or S-record line into its bytes, verifying the checksum
+inline bool _readHexRecord(const std::string& line, size_t start, bool srec, std::vector<uint8_t>& fields) {
+    fields.clear();
+    unsigned int sum = 0;
+
+    for (size_t position = start; position + 1 < line.size() && line[position] != '\r'; position += 2) {
+        int value = _parseHexByte(line, position);
+        if (value < 0) return false;
+        fields.push_back(static_cast<uint8_t>(value));
+        sum += value;
+    }
+
+    // Count, address and checksum for S-records, plus the type for HEX; the count must name the rest
+    if (fields.size() < (srec ? 4u : 5u)) return false;
+    if (fields[0] != (srec ? fields.size() - 1 : fields.size() - 5)) return false;
+    return srec ? (sum & 0xff) == 0xff : (sum & 0xff) == 0;
+}
+
+// Loads any image format into memory at the addresses it names
+inline bool readImage(const std::string& path, std::vector<uint8_t>& memory) {
+    ImageFormat format = imageFormatFromPath(path);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return false;
+    }
+
+    if (format == IMAGE_BIN) {
+        file.seekg(0, std::ios::end);
+        size_t fileSize = file.tellg();
+        if (fileSize > memory.size() - IMAGE_ROM_START) {
+            std::cerr << "Error: File size exceeds available memory." << std::endl;
+            return false;
+        }
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(&memory[IMAGE_ROM_START]), fileSize);
+        return true;
+    }
+
+    if (format == IMAGE_SEGMENTS) {
+        uint8_t header[6] = {0};
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file || std::string(reinterpret_cast<char*>(header), 4) != "TSEG") {
+            std::cerr << "Error: '" << path << "' is not a segment list" << std::endl;
+            return false;
+        }
+
+        for (int count = header[4] | (header[5] << 8); count > 0; count--) {
+            uint8_t segment[4] = {0};
+            file.read(reinterpret_cast<char*>(segment), sizeof(segment));
+            size_t address = segment[0] | (segment[1] << 8);
+            size_t length = segment[2] | (segment[3] << 8);
+
+            if (!file || address + length > memory.size()) {
+                std::cerr << "Error: segment list '" << path << "' is corrupt" << std::endl;
+                return false;
+            }
+            file.read(reinterpret_cast<char*>(&memory[address]), length);
+        }
+        return true;
+    }
+
+    bool srec = format == IMAGE_SREC;
+    std::string line;
+    std::vector<uint8_t> fields;
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line == "\r") continue;
+
+        size_t start = srec ? 2 : 1;
+        bool valid = srec ? line[0] == 'S' : line[0] == ':';
+        if (!valid || !_readHexRecord(line, start, srec, fields)) {
+            std::cerr << "Error: bad record in '" << path << "': " << line << std::endl;
+            return false;
+        }
+
+        size_t address, length;
+        const uint8_t* data;
+        if (srec) {
+            if (line[1] == '9') break;
+            if (line[1] != '1') continue;                                   // Header and count records
+            address = (fields[1] << 8) | fields[2];
+            length = fields[0] - 3;
+            data = &fields[3];
+        } else {
+            if (fields[3] == 0x01) break;
+            if (fields[3] != 0x00) continue;                                // Ignore extended records
+            address = (fields[1] << 8) | fields[2];
+            length = fields[0];
+            data = &fields[4];
+        }
+
+        if (data + length > fields.data() + fields.size() - 1 || address + length > memory.size()) {
+            std::cerr << "Error: bad record in '" << path << "': " << line << std::endl;
+            return false;
+        }
+        std::copy(data, data + length, memory.begin() + address);
+    }
+    return true;
+}
+
+#endif
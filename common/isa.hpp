@@ -0,0 +1,412 @@
+#ifndef ISA_HPP
+#define ISA_HPP
+
+// Instruction set of the computer, shared by tasml and the emulator. OPCODES is the only
+// description of the encodings; every other table here is derived from it at compile time.
+// The cycle counts are microcode steps, and assembler/instruction_setup.py checks them against
+// microcode.bin on every build.
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+
+enum class AddressingMode : uint8_t {
+    IMPLIED, IMMEDIATE, ZEROPAGE, ZEROPAGE_X, ZEROPAGE_Y, ABSOLUTE, ABSOLUTE_X, ABSOLUTE_Y,
+    INDIRECT, INDIRECT_X, INDIRECT_Y, INDIRECT_POST_X, INDIRECT_POST_Y,
+};
+
+#define ADDRESSING_MODES    13
+#define OPCODE_COUNT        189
+
+// Spelled the way the assembler syntax documents them
+constexpr std::array<std::string_view, ADDRESSING_MODES> ADDRESSING_MODE_NAMES = {
+    "implied", "immediate", "zeropage", "zeropage,X", "zeropage,Y", "absolute", "absolute,X", "absolute,Y",
+    "(indirect)", "(indirect,X)", "(indirect,Y)", "(indirect),X", "(indirect),Y",
+};
+
+constexpr std::string_view modeName(AddressingMode mode) { return ADDRESSING_MODE_NAMES[static_cast<int>(mode)]; }
+
+// Operand bytes after the opcode. Every indirect form takes a full 16 bit pointer address.
+constexpr int operandSize(AddressingMode mode) {
+    switch (mode) {
+        case AddressingMode::IMPLIED: return 0;
+        case AddressingMode::IMMEDIATE: case AddressingMode::ZEROPAGE:
+        case AddressingMode::ZEROPAGE_X: case AddressingMode::ZEROPAGE_Y: return 1;
+        default: return 2;
+    }
+}
+
+constexpr bool isZeropage(AddressingMode mode) {
+    return mode == AddressingMode::ZEROPAGE || mode == AddressingMode::ZEROPAGE_X || mode == AddressingMode::ZEROPAGE_Y;
+}
+
+// zeropage, zeropage,X and zeropage,Y to the absolute form with the same index
+constexpr AddressingMode absoluteMode(AddressingMode zeropage) {
+    return static_cast<AddressingMode>(static_cast<int>(zeropage) + 3);
+}
+
+struct Opcode {
+    uint8_t opcode;
+    std::string_view mnemonic;              // Empty for opcodes that are not part of the ISA
+    AddressingMode mode;
+    uint8_t minCycles;                      // Branches take the max when taken
+    uint8_t maxCycles;
+
+    constexpr bool legal() const { return !mnemonic.empty(); }
+    constexpr int size() const { return 1 + operandSize(mode); }
+};
+
+// Listed in opcode order. Accumulator forms of asl, lsr, rol and ror are implied.
+constexpr std::array<Opcode, OPCODE_COUNT> opcodeList() {
+    using enum AddressingMode;
+    return {{
+        {  0, "nop", IMPLIED,         3, 3},
+
+        {  1, "adc", IMMEDIATE,       3, 3},
+        {  2, "adc", ZEROPAGE,        3, 3},
+        {  3, "adc", ZEROPAGE_X,      4, 4},
+        {  4, "adc", ZEROPAGE_Y,      4, 4},
+        {  5, "adc", ABSOLUTE,        4, 4},
+        {  6, "adc", ABSOLUTE_X,      4, 4},
+        {  7, "adc", ABSOLUTE_Y,      4, 4},
+        {  8, "adc", INDIRECT_X,      6, 6},
+        {  9, "adc", INDIRECT_Y,      6, 6},
+        { 10, "adc", INDIRECT_POST_X, 5, 5},
+        { 11, "adc", INDIRECT_POST_Y, 5, 5},
+
+        { 12, "and", IMMEDIATE,       3, 3},
+        { 13, "and", ZEROPAGE,        3, 3},
+        { 14, "and", ZEROPAGE_X,      4, 4},
+        { 15, "and", ZEROPAGE_Y,      4, 4},
+        { 16, "and", ABSOLUTE,        4, 4},
+        { 17, "and", ABSOLUTE_X,      4, 4},
+        { 18, "and", ABSOLUTE_Y,      4, 4},
+        { 19, "and", INDIRECT_X,      6, 6},
+        { 20, "and", INDIRECT_Y,      6, 6},
+        { 21, "and", INDIRECT_POST_X, 5, 5},
+        { 22, "and", INDIRECT_POST_Y, 5, 5},
+
+        { 23, "asl", IMPLIED,         3, 3},
+        { 24, "asl", ZEROPAGE,        5, 5},
+        { 25, "asl", ZEROPAGE_X,      6, 6},
+        { 26, "asl", ZEROPAGE_Y,      6, 6},
+        { 27, "asl", ABSOLUTE,        6, 6},
+        { 28, "asl", ABSOLUTE_X,      6, 6},
+        { 29, "asl", ABSOLUTE_Y,      6, 6},
+
+        { 30, "bcc", ABSOLUTE,        3, 5},
+
+        { 31, "bcs", ABSOLUTE,        3, 5},
+
+        { 32, "beq", ABSOLUTE,        3, 5},
+
+        { 33, "bit", ZEROPAGE,        3, 3},
+        { 34, "bit", ABSOLUTE,        4, 4},
+
+        { 35, "bmi", ABSOLUTE,        3, 5},
+
+        { 36, "bne", ABSOLUTE,        3, 5},
+
+        { 37, "bpl", ABSOLUTE,        3, 5},
+
+        { 38, "brk", IMPLIED,         7, 7},
+
+        { 39, "bvc", ABSOLUTE,        3, 5},
+
+        { 40, "bvs", ABSOLUTE,        3, 5},
+
+        { 41, "clc", IMPLIED,         3, 3},
+
+        { 42, "cli", IMPLIED,         3, 3},
+
+        { 43, "clv", IMPLIED,         3, 3},
+
+        { 44, "cmp", IMMEDIATE,       3, 3},
+        { 45, "cmp", ZEROPAGE,        3, 3},
+        { 46, "cmp", ZEROPAGE_X,      4, 4},
+        { 47, "cmp", ZEROPAGE_Y,      4, 4},
+        { 48, "cmp", ABSOLUTE,        4, 4},
+        { 49, "cmp", ABSOLUTE_X,      4, 4},
+        { 50, "cmp", ABSOLUTE_Y,      4, 4},
+        { 51, "cmp", INDIRECT_X,      6, 6},
+        { 52, "cmp", INDIRECT_Y,      6, 6},
+        { 53, "cmp", INDIRECT_POST_X, 5, 5},
+        { 54, "cmp", INDIRECT_POST_Y, 5, 5},
+
+        { 55, "cpx", IMMEDIATE,       3, 3},
+        { 56, "cpx", ZEROPAGE,        3, 3},
+        { 57, "cpx", ABSOLUTE,        4, 4},
+
+        { 58, "cpy", IMMEDIATE,       3, 3},
+        { 59, "cpy", ZEROPAGE,        3, 3},
+        { 60, "cpy", ABSOLUTE,        4, 4},
+
+        { 61, "dec", ZEROPAGE,        4, 4},
+        { 62, "dec", ZEROPAGE_X,      5, 5},
+        { 63, "dec", ZEROPAGE_Y,      5, 5},
+        { 64, "dec", ABSOLUTE,        5, 5},
+        { 65, "dec", ABSOLUTE_X,      5, 5},
+        { 66, "dec", ABSOLUTE_Y,      5, 5},
+
+        { 67, "dex", IMPLIED,         3, 3},
+
+        { 68, "dey", IMPLIED,         3, 3},
+
+        { 69, "eor", IMMEDIATE,       3, 3},
+        { 70, "eor", ZEROPAGE,        3, 3},
+        { 71, "eor", ZEROPAGE_X,      4, 4},
+        { 72, "eor", ZEROPAGE_Y,      4, 4},
+        { 73, "eor", ABSOLUTE,        4, 4},
+        { 74, "eor", ABSOLUTE_X,      4, 4},
+        { 75, "eor", ABSOLUTE_Y,      4, 4},
+        { 76, "eor", INDIRECT_X,      6, 6},
+        { 77, "eor", INDIRECT_Y,      6, 6},
+        { 78, "eor", INDIRECT_POST_X, 5, 5},
+        { 79, "eor", INDIRECT_POST_Y, 5, 5},
+
+        { 80, "inc", ZEROPAGE,        5, 5},
+        { 81, "inc", ZEROPAGE_X,      5, 5},
+        { 82, "inc", ZEROPAGE_Y,      5, 5},
+        { 83, "inc", ABSOLUTE,        5, 5},
+        { 84, "inc", ABSOLUTE_X,      5, 5},
+        { 85, "inc", ABSOLUTE_Y,      5, 5},
+
+        { 86, "inx", IMPLIED,         3, 3},
+
+        { 87, "iny", IMPLIED,         3, 3},
+
+        { 88, "jmp", ABSOLUTE,        5, 5},
+        { 89, "jmp", INDIRECT,        8, 8},
+
+        { 90, "jsr", ABSOLUTE,        7, 7},
+
+        { 91, "lda", IMMEDIATE,       3, 3},
+        { 92, "lda", ZEROPAGE,        4, 4},
+        { 93, "lda", ZEROPAGE_X,      5, 5},
+        { 94, "lda", ZEROPAGE_Y,      5, 5},
+        { 95, "lda", ABSOLUTE,        5, 5},
+        { 96, "lda", ABSOLUTE_X,      5, 5},
+        { 97, "lda", ABSOLUTE_Y,      5, 5},
+        { 98, "lda", INDIRECT_X,      7, 7},
+        { 99, "lda", INDIRECT_Y,      7, 7},
+        {100, "lda", INDIRECT_POST_X, 6, 6},
+        {101, "lda", INDIRECT_POST_Y, 6, 6},
+
+        {102, "ldx", IMMEDIATE,       3, 3},
+        {103, "ldx", ZEROPAGE,        4, 4},
+        {104, "ldx", ZEROPAGE_Y,      5, 5},
+        {105, "ldx", ABSOLUTE,        5, 5},
+        {106, "ldx", ABSOLUTE_Y,      5, 5},
+
+        {107, "ldy", IMMEDIATE,       3, 3},
+        {108, "ldy", ZEROPAGE,        4, 4},
+        {109, "ldy", ZEROPAGE_X,      5, 5},
+        {110, "ldy", ABSOLUTE,        5, 5},
+        {111, "ldy", ABSOLUTE_X,      5, 5},
+
+        {112, "lsr", IMPLIED,         3, 3},
+        {113, "lsr", ZEROPAGE,        5, 5},
+        {114, "lsr", ZEROPAGE_X,      6, 6},
+        {115, "lsr", ZEROPAGE_Y,      6, 6},
+        {116, "lsr", ABSOLUTE,        6, 6},
+        {117, "lsr", ABSOLUTE_X,      6, 6},
+        {118, "lsr", ABSOLUTE_Y,      6, 6},
+
+        {119, "ora", IMMEDIATE,       3, 3},
+        {120, "ora", ZEROPAGE,        3, 3},
+        {121, "ora", ZEROPAGE_X,      4, 4},
+        {122, "ora", ZEROPAGE_Y,      4, 4},
+        {123, "ora", ABSOLUTE,        4, 4},
+        {124, "ora", ABSOLUTE_X,      4, 4},
+        {125, "ora", ABSOLUTE_Y,      4, 4},
+        {126, "ora", INDIRECT_X,      6, 6},
+        {127, "ora", INDIRECT_Y,      6, 6},
+        {128, "ora", INDIRECT_POST_X, 5, 5},
+        {129, "ora", INDIRECT_POST_Y, 5, 5},
+
+        {130, "pha", IMPLIED,         3, 3},
+
+        {131, "php", IMPLIED,         3, 3},
+
+        {132, "pla", IMPLIED,         4, 4},
+
+        {133, "plp", IMPLIED,         4, 4},
+
+        {134, "rol", IMPLIED,         3, 3},
+        {135, "rol", ZEROPAGE,        5, 5},
+        {136, "rol", ZEROPAGE_X,      6, 6},
+        {137, "rol", ZEROPAGE_Y,      6, 6},
+        {138, "rol", ABSOLUTE,        6, 6},
+        {139, "rol", ABSOLUTE_X,      6, 6},
+        {140, "rol", ABSOLUTE_Y,      6, 6},
+
+        {141, "ror", IMPLIED,         3, 3},
+        {142, "ror", ZEROPAGE,        5, 5},
+        {143, "ror", ZEROPAGE_X,      6, 6},
+        {144, "ror", ZEROPAGE_Y,      6, 6},
+        {145, "ror", ABSOLUTE,        6, 6},
+        {146, "ror", ABSOLUTE_X,      6, 6},
+        {147, "ror", ABSOLUTE_Y,      6, 6},
+
+        {148, "rti", IMPLIED,         6, 6},
+
+        {149, "rts", IMPLIED,         6, 6},
+
+        {150, "sub", IMMEDIATE,       3, 3},
+        {151, "sub", ZEROPAGE,        3, 3},
+        {152, "sub", ZEROPAGE_X,      4, 4},
+        {153, "sub", ZEROPAGE_Y,      4, 4},
+        {154, "sub", ABSOLUTE,        4, 4},
+        {155, "sub", ABSOLUTE_X,      4, 4},
+        {156, "sub", ABSOLUTE_Y,      4, 4},
+        {157, "sub", INDIRECT_X,      6, 6},
+        {158, "sub", INDIRECT_Y,      6, 6},
+        {159, "sub", INDIRECT_POST_X, 5, 5},
+        {160, "sub", INDIRECT_POST_Y, 5, 5},
+
+        {161, "sec", IMPLIED,         3, 3},
+
+        {162, "sei", IMPLIED,         3, 3},
+
+        {163, "sta", ZEROPAGE,        3, 3},
+        {164, "sta", ZEROPAGE_X,      4, 4},
+        {165, "sta", ZEROPAGE_Y,      4, 4},
+        {166, "sta", ABSOLUTE,        4, 4},
+        {167, "sta", ABSOLUTE_X,      4, 4},
+        {168, "sta", ABSOLUTE_Y,      4, 4},
+        {169, "sta", INDIRECT_X,      6, 6},
+        {170, "sta", INDIRECT_Y,      6, 6},
+        {171, "sta", INDIRECT_POST_X, 5, 5},
+        {172, "sta", INDIRECT_POST_Y, 5, 5},
+
+        {173, "stx", ZEROPAGE,        3, 3},
+        {174, "stx", ZEROPAGE_Y,      4, 4},
+        {175, "stx", ABSOLUTE,        4, 4},
+        {176, "stx", ABSOLUTE_Y,      4, 4},
+
+        {177, "sty", ZEROPAGE,        3, 3},
+        {178, "sty", ZEROPAGE_X,      4, 4},
+        {179, "sty", ABSOLUTE,        4, 4},
+        {180, "sty", ABSOLUTE_X,      4, 4},
+
+        {181, "tax", IMPLIED,         3, 3},
+
+        {182, "tay", IMPLIED,         3, 3},
+
+        {183, "tsx", IMPLIED,         3, 3},
+
+        {184, "tsa", IMPLIED,         3, 3},
+
+        {185, "txs", IMPLIED,         3, 3},
+
+        {186, "tya", IMPLIED,         3, 3},
+
+        {187, "hlt", IMPLIED,         1, 1},
+
+        {188, "out", IMPLIED,         3, 3},
+    }};
+}
+
+constexpr std::array<Opcode, OPCODE_COUNT> OPCODES = opcodeList();
+
+// Derived Tables
+
+// Decode table indexed by opcode
+constexpr std::array<Opcode, 256> OPCODE_TABLE = [] {
+    std::array<Opcode, 256> table = {};
+    for (int i = 0; i < 256; i++) table[i] = {static_cast<uint8_t>(i), "", AddressingMode::IMPLIED, 0, 0};
+    for (const Opcode& op : OPCODES) table[op.opcode] = op;
+    return table;
+}();
+
+constexpr int countMnemonics() {
+    int count = 0;
+    for (int i = 0; i < OPCODE_COUNT; i++) count += i == 0 || OPCODES[i].mnemonic != OPCODES[i - 1].mnemonic;
+    return count;
+}
+
+constexpr int MNEMONIC_COUNT = countMnemonics();
+
+// Sorted, for the binary search in mnemonicIndex
+constexpr std::array<std::string_view, MNEMONIC_COUNT> MNEMONICS = [] {
+    std::array<std::string_view, MNEMONIC_COUNT> names = {};
+    int count = 0;
+    for (int i = 0; i < OPCODE_COUNT; i++) {
+        if (i > 0 && OPCODES[i].mnemonic == OPCODES[i - 1].mnemonic) continue;
+
+        int j = count++;
+        for (; j > 0 && names[j - 1] > OPCODES[i].mnemonic; j--) names[j] = names[j - 1];
+        names[j] = OPCODES[i].mnemonic;
+    }
+    return names;
+}();
+
+constexpr int mnemonicIndex(std::string_view name) {
+    int low = 0, high = MNEMONIC_COUNT;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (MNEMONICS[middle] < name) low = middle + 1;
+        else high = middle;
+    }
+    return low < MNEMONIC_COUNT && MNEMONICS[low] == name ? low : -1;
+}
+
+constexpr bool isMnemonic(std::string_view name) { return mnemonicIndex(name) >= 0; }
+
+// Mnemonic and addressing mode to opcode, -1 where the mode is not encoded
+constexpr std::array<std::array<int16_t, ADDRESSING_MODES>, MNEMONIC_COUNT> ENCODINGS = [] {
+    std::array<std::array<int16_t, ADDRESSING_MODES>, MNEMONIC_COUNT> table = {};
+    for (auto& modes : table) modes.fill(-1);
+    for (const Opcode& op : OPCODES) table[mnemonicIndex(op.mnemonic)][static_cast<int>(op.mode)] = op.opcode;
+    return table;
+}();
+
+constexpr int findOpcode(std::string_view name, AddressingMode mode) {
+    int index = mnemonicIndex(name);
+    return index < 0 ? -1 : ENCODINGS[index][static_cast<int>(mode)];
+}
+
+// Consistency Checks
+
+constexpr bool opcodesAscending() {
+    for (int i = 1; i < OPCODE_COUNT; i++) {
+        if (OPCODES[i].opcode <= OPCODES[i - 1].opcode) return false;
+    }
+    return true;
+}
+
+constexpr bool mnemonicsGrouped() {
+    // A mnemonic split over two runs of the list would be counted twice
+    for (int i = 1; i < MNEMONIC_COUNT; i++) {
+        if (MNEMONICS[i] == MNEMONICS[i - 1]) return false;
+    }
+    return true;
+}
+
+constexpr bool encodingsUnique() {
+    for (int i = 0; i < OPCODE_COUNT; i++) {
+        for (int j = i + 1; j < OPCODE_COUNT; j++) {
+            if (OPCODES[i].mnemonic == OPCODES[j].mnemonic && OPCODES[i].mode == OPCODES[j].mode) return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool opcodesWellFormed() {
+    for (const Opcode& op : OPCODES) {
+        if (op.mnemonic.size() != 3 || op.minCycles < 1 || op.minCycles > op.maxCycles) return false;
+        for (char c : op.mnemonic) {
+            if (c < 'a' || c > 'z') return false;
+        }
+    }
+    return true;
+}
+
+static_assert(opcodesAscending(), "OPCODES must be in opcode order with no opcode encoded twice");
+static_assert(mnemonicsGrouped(), "each mnemonic's opcodes must be listed together");
+static_assert(encodingsUnique(), "a mnemonic and addressing mode may only have one opcode");
+static_assert(opcodesWellFormed(), "mnemonics are three lower case letters and cycle counts need min <= max");
+static_assert(static_cast<int>(AddressingMode::INDIRECT_POST_Y) + 1 == ADDRESSING_MODES);
+static_assert(absoluteMode(AddressingMode::ZEROPAGE_Y) == AddressingMode::ABSOLUTE_Y);
+
+#endif
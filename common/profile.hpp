@@ -0,0 +1,83 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+// Data access profile written by emulator -m and read by tasml -P to place .var storage.
+// Plain text, one line per RAM address the program read or wrote:
+//   $<address> <reads> <writes> [<symbol>]
+// The symbol is the label covering the address in the symbol map the emulator loaded, which
+// is how tasml maps counts from the old placement back to each .var.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstdlib>
+
+struct AccessCount {
+    int address;
+    uint64_t reads;
+    uint64_t writes;
+    std::string symbol;                 // Empty when no label covers the address
+};
+
+struct AccessProfile {
+    std::vector<AccessCount> counts;
+
+    bool write(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "Error: unable to write access profile '" << path << "'" << std::endl;
+            return false;
+        }
+
+        file << "; address reads writes symbol" << std::endl;
+        for (const auto& count : counts) {
+            char address[8];
+            std::snprintf(address, sizeof(address), "$%04x", count.address);
+            file << address << " " << count.reads << " " << count.writes;
+            if (!count.symbol.empty()) file << " " << count.symbol;
+            file << "\n";
+        }
+        return true;
+    }
+
+    bool read(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Error: unable to open access profile '" << path << "'" << std::endl;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == ';') continue;
+
+            std::istringstream fields(line);
+            std::string address;
+            AccessCount count = {0, 0, 0, ""};
+            if (!(fields >> address >> count.reads >> count.writes) || address[0] != '$') {
+                std::cerr << "Error: access profile '" << path << "' is corrupt" << std::endl;
+                return false;
+            }
+
+            count.address = std::strtol(address.c_str() + 1, nullptr, 16);
+            fields >> count.symbol;
+            counts.push_back(count);
+        }
+        return true;
+    }
+
+    // Reads plus writes for each symbol
+    std::map<std::string, uint64_t> bySymbol() const {
+        std::map<std::string, uint64_t> totals;
+        for (const auto& count : counts) {
+            if (!count.symbol.empty()) totals[count.symbol] += count.reads + count.writes;
+        }
+        return totals;
+    }
+};
+
+#endif
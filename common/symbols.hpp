@@ -0,0 +1,216 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+// Debug symbol map written by tasml -g and read by the emulator. Every table is kept sorted
+// by address (or value) so lookups are binary searches. All integers little endian:
+//   "TSYM" u16 version
+//   u16 files      { string path }
+//   u16 labels     { string name, u16 start, u16 size }
+//   u16 variables  { string name, u16 value }
+//   u32 lines      { u16 address, u8 size, u16 file, u32 line }    one per emitted instruction
+// Strings are stored as u16 length followed by the characters.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+
+#define SYMBOLS_MAGIC   "TSYM"
+#define SYMBOLS_VERSION 1
+
+struct SymbolLabel {
+    std::string name;
+    int start;
+    int end;                            // Exclusive
+};
+
+struct SymbolVariable {
+    std::string name;
+    int value;
+};
+
+struct SymbolLine {
+    int address;
+    int size;
+    int file;
+    int line;
+};
+
+inline void _writeSymbolsInt(std::ostream& file, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) file.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+inline uint32_t _readSymbolsInt(std::istream& file, int bytes) {
+    uint8_t data[4] = {0, 0, 0, 0};
+    file.read(reinterpret_cast<char*>(data), bytes);
+
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    return value;
+}
+
+inline void _writeSymbolsString(std::ostream& file, const std::string& str) {
+    _writeSymbolsInt(file, str.size(), 2);
+    file.write(str.data(), str.size());
+}
+
+inline std::string _readSymbolsString(std::istream& file) {
+    std::string str(_readSymbolsInt(file, 2), '\0');
+    file.read(str.data(), str.size());
+    return str;
+}
+
+struct SymbolMap {
+    std::vector<std::string> files;
+    std::vector<SymbolLabel> labels;
+    std::vector<SymbolVariable> variables;
+    std::vector<SymbolLine> lines;
+
+    // Puts the tables in lookup order, call before write
+    void sort() {
+        std::stable_sort(labels.begin(), labels.end(), [](const SymbolLabel& a, const SymbolLabel& b) { return a.start < b.start; });
+        std::stable_sort(variables.begin(), variables.end(), [](const SymbolVariable& a, const SymbolVariable& b) { return a.value < b.value; });
+        std::stable_sort(lines.begin(), lines.end(), [](const SymbolLine& a, const SymbolLine& b) { return a.address < b.address; });
+    }
+
+    bool write(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: unable to write symbol file '" << path << "'" << std::endl;
+            return false;
+        }
+        write(file);
+        return true;
+    }
+
+    void write(std::ostream& file) const {
+        file.write(SYMBOLS_MAGIC, 4);
+        _writeSymbolsInt(file, SYMBOLS_VERSION, 2);
+
+        _writeSymbolsInt(file, files.size(), 2);
+        for (const auto& path : files) _writeSymbolsString(file, path);
+
+        _writeSymbolsInt(file, labels.size(), 2);
+        for (const auto& label : labels) {
+            _writeSymbolsString(file, label.name);
+            _writeSymbolsInt(file, label.start, 2);
+            _writeSymbolsInt(file, label.end - label.start, 2);
+        }
+
+        _writeSymbolsInt(file, variables.size(), 2);
+        for (const auto& variable : variables) {
+            _writeSymbolsString(file, variable.name);
+            _writeSymbolsInt(file, variable.value, 2);
+        }
+
+        _writeSymbolsInt(file, lines.size(), 4);
+        for (const auto& line : lines) {
+            _writeSymbolsInt(file, line.address, 2);
+            _writeSymbolsInt(file, line.size, 1);
+            _writeSymbolsInt(file, line.file, 2);
+            _writeSymbolsInt(file, line.line, 4);
+        }
+    }
+
+    bool read(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: unable to open symbol file '" << path << "'" << std::endl;
+            return false;
+        }
+        return read(file, "symbol file '" + path + "'");
+    }
+
+    // The name is what errors call the stream
+    bool read(std::istream& file, const std::string& name) {
+        char magic[4] = {0};
+        file.read(magic, 4);
+        if (std::string(magic, 4) != SYMBOLS_MAGIC || _readSymbolsInt(file, 2) != SYMBOLS_VERSION) {
+            std::cerr << "Error: " << name << " is not a tasml symbol map" << std::endl;
+            return false;
+        }
+
+        files.resize(_readSymbolsInt(file, 2));
+        for (auto& path : files) path = _readSymbolsString(file);
+
+        labels.resize(_readSymbolsInt(file, 2));
+        for (auto& label : labels) {
+            label.name = _readSymbolsString(file);
+            label.start = _readSymbolsInt(file, 2);
+            label.end = label.start + _readSymbolsInt(file, 2);
+        }
+
+        variables.resize(_readSymbolsInt(file, 2));
+        for (auto& variable : variables) {
+            variable.name = _readSymbolsString(file);
+            variable.value = _readSymbolsInt(file, 2);
+        }
+
+        lines.resize(_readSymbolsInt(file, 4));
+        for (auto& line : lines) {
+            line.address = _readSymbolsInt(file, 2);
+            line.size = _readSymbolsInt(file, 1);
+            line.file = _readSymbolsInt(file, 2);
+            line.line = _readSymbolsInt(file, 4);
+        }
+
+        if (!file) {
+            std::cerr << "Error: " << name << " is corrupt" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Innermost label whose range holds address, nullptr if none
+    const SymbolLabel* labelAt(int address) const {
+        auto next = std::upper_bound(labels.begin(), labels.end(), address, [](int value, const SymbolLabel& label) { return value < label.start; });
+        if (next == labels.begin()) return nullptr;
+
+        const SymbolLabel& label = *(next - 1);
+        return address < label.end || address == label.start ? &label : nullptr;
+    }
+
+    // Source line of the instruction that covers address, nullptr if none
+    const SymbolLine* lineAt(int address) const {
+        auto next = std::upper_bound(lines.begin(), lines.end(), address, [](int value, const SymbolLine& line) { return value < line.address; });
+        if (next == lines.begin()) return nullptr;
+
+        const SymbolLine& line = *(next - 1);
+        return address < line.address + line.size ? &line : nullptr;
+    }
+
+    const SymbolVariable* variableAt(int value) const {
+        auto found = std::lower_bound(variables.begin(), variables.end(), value, [](const SymbolVariable& variable, int value) { return variable.value < value; });
+        return found != variables.end() && found->value == value ? &*found : nullptr;
+    }
+
+    // Resolves a label name or file:line to an address, -1 if unknown. Only used while setting up.
+    int addressOf(const std::string& location) const {
+        for (const auto& label : labels) {
+            if (label.name == location) return label.start;
+        }
+
+        size_t colon = location.find_last_of(':');
+        if (colon == std::string::npos) return -1;
+        std::string path = location.substr(0, colon);
+        int number = std::atoi(location.c_str() + colon + 1);
+
+        // Lines without code resolve to the next line that has some
+        int best = -1, bestLine = 0;
+        for (const auto& line : lines) {
+            const std::string& file = files[line.file];
+            bool sameFile = file == path || (file.size() > path.size() && file.compare(file.size() - path.size() - 1, std::string::npos, "/" + path) == 0);
+            if (!sameFile || line.line < number) continue;
+            if (best < 0 || line.line < bestLine || (line.line == bestLine && line.address < best)) {
+                best = line.address;
+                bestLine = line.line;
+            }
+        }
+        return best;
+    }
+};
+
+#endif
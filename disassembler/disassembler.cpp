@@ -0,0 +1,168 @@
+#include "disassembler.hpp"
+
+#include <cstring>
+
+Disassembler::Disassembler(const std::string& imagePath) : _imagePath(imagePath) {
+    if (!readImage(imagePath, _memory)) exit(ERROR);
+}
+
+void Disassembler::loadSymbols(const std::string& symbolPath) {
+    if (!_symbols.read(symbolPath)) exit(ERROR);
+}
+
+// Helper Functions
+
+void Disassembler::_follow(int entry) {
+    std::vector<int> pending = {entry};
+
+    while (!pending.empty()) {
+        int address = pending.back();
+        pending.pop_back();
+
+        // RAM is zero until the program runs, code jumped to there is written by the program
+        while (address >= IMAGE_ROM_START && address <= MAX_MEMORY && _bytes[address] == DATA) {
+            Instruction instr = decodeInstruction(_memory, address);
+            if (!instr.op->legal() || address + instr.size > MAX_MEMORY + 1) break;
+
+            // A path into the middle of code decoded another way is taken to be wrong
+            bool overlaps = false;
+            for (int i = 1; i < instr.size; i++) overlaps |= _bytes[address + i] != DATA;
+            if (overlaps) break;
+
+            _bytes[address] = CODE;
+            for (int i = 1; i < instr.size; i++) _bytes[address + i] = OPERAND;
+            _instructions++;
+
+            if (hasTarget(*instr.op)) pending.push_back(instr.operand);
+            if (!continuesAfter(*instr.op)) break;
+            address += instr.size;
+        }
+    }
+}
+
+void Disassembler::_addLabel(int address, const std::string& fallback) {
+    if (_labels.count(address)) return;
+
+    // Macro expansions name their labels with a '.' that tasml would not accept back
+    const SymbolLabel* label = _symbols.labelAt(address);
+    bool usable = label && label->start == address && !label->name.empty() && !isdigit(static_cast<unsigned char>(label->name[0])) &&
+                  std::all_of(label->name.begin(), label->name.end(), [](char c) { return isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+    _labels[address] = usable ? label->name : fallback;
+}
+
+std::string Disassembler::_targetLabel(const Instruction& instr) {
+    if (!hasTarget(*instr.op)) return "";
+    auto label = _labels.find(instr.operand);
+    return label == _labels.end() ? "" : label->second;
+}
+
+int Disassembler::_dataEnd(int address) {
+    // Zeros nothing reaches or names, long enough to be worth an .org
+    int end = address;
+    while (end <= MAX_MEMORY && _bytes[end] == DATA && _memory[end] == 0 && !_labels.count(end)) end++;
+    return end - address >= MIN_ZERO_GAP || end > MAX_MEMORY ? end : address;
+}
+
+// Main Functions
+
+void Disassembler::trace() {
+    _follow(ENTRY_POINT);
+    _follow(IRQ_VECTOR);
+
+    // Only paths that were decoded get labels, a target inside an instruction stays a number
+    _labels[ENTRY_POINT] = "main";
+    if (_bytes[IRQ_VECTOR] == CODE) _addLabel(IRQ_VECTOR, "irq");
+
+    for (int address = 0; address <= MAX_MEMORY; address++) {
+        if (_bytes[address] != CODE) continue;
+        Instruction instr = decodeInstruction(_memory, address);
+        if (!hasTarget(*instr.op) || _bytes[instr.operand] != CODE) continue;
+
+        char name[8];
+        std::snprintf(name, sizeof(name), "L%04x", instr.operand);
+        _addLabel(instr.operand, name);
+    }
+}
+
+void Disassembler::write(std::ostream& out) {
+    out << "; Disassembled by disasm from " << _imagePath << std::endl;
+
+    char text[DISASM_MAX_TEXT + 1];
+    char line[2 * DISASM_MAX_TEXT];
+    int next = -1;
+
+    for (int address = IMAGE_ROM_START; address <= MAX_MEMORY;) {
+        int skipped = _dataEnd(address);
+        if (skipped != address) {
+            address = skipped;
+            continue;
+        }
+
+        if (address != next) {
+            std::snprintf(line, sizeof(line), "\n.org $%04x", address);
+            out << line << std::endl;
+        }
+
+        auto label = _labels.find(address);
+        if (label != _labels.end()) out << label->second << ":" << std::endl;
+
+        if (_bytes[address] == CODE) {
+            Instruction instr = decodeInstruction(_memory, address);
+            text[formatInstruction(text, instr, _targetLabel(instr))] = '\0';
+
+            // Kept as bytes, tasml would pick the zero page opcode for it
+            if (reassemblesShorter(instr)) {
+                std::snprintf(line, sizeof(line), "    .db $%02x, $%02x, $%02x", _memory[address], _memory[address + 1], _memory[address + 2]);
+                std::snprintf(line + strlen(line), sizeof(line) - strlen(line), "%*s; %s", static_cast<int>(32 - strlen(line)), "", text);
+            } else std::snprintf(line, sizeof(line), "    %s", text);
+
+            out << line << std::endl;
+            address += instr.size;
+        } else {
+            out << "    .db ";
+            int start = address;
+            do {
+                std::snprintf(line, sizeof(line), "%s$%02x", address == start ? "" : ", ", _memory[address]);
+                out << line;
+                address++;
+            } while (address <= MAX_MEMORY && address - start < DB_PER_LINE && _bytes[address] == DATA && !_labels.count(address) &&
+                     _dataEnd(address) == address);
+            out << std::endl;
+        }
+        next = address;
+    }
+}
+
+void Disassembler::annotate(FILE* in, FILE* out) {
+    // Every address formatted once up front, a line then costs a scan and two copies
+    std::vector<std::string> texts(MAX_MEMORY + 1);
+    char text[DISASM_MAX_TEXT];
+    for (int address = 0; address <= MAX_MEMORY; address++) {
+        texts[address] = std::string(text, formatInstruction(text, decodeInstruction(_memory, address)));
+    }
+
+    static char inBuffer[1 << 20], outBuffer[1 << 20];
+    setvbuf(in, inBuffer, _IOFBF, sizeof(inBuffer));
+    setvbuf(out, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    char line[4096];
+    while (fgets(line, sizeof(line), in)) {
+        size_t length = strlen(line);
+        if (length > 0 && line[length - 1] == '\n') length--;
+
+        int address = -1;
+        for (size_t i = length; i-- > 0 && address < 0;) {
+            if (line[i] != '$' || i + 5 > length || (i + 5 < length && isxdigit(static_cast<unsigned char>(line[i + 5])))) continue;
+            if (!std::all_of(line + i + 1, line + i + 5, [](char c) { return isxdigit(static_cast<unsigned char>(c)); })) continue;
+            address = std::strtol(std::string(line + i + 1, 4).c_str(), nullptr, 16);
+        }
+
+        fwrite(line, 1, length, out);
+        if (address >= 0) {
+            fputs("  ", out);
+            fwrite(texts[address].data(), 1, texts[address].size(), out);
+        }
+        fputc('\n', out);
+    }
+    fflush(out);
+}
@@ -0,0 +1,41 @@
+#ifndef DISASSEMBLER_HPP
+#define DISASSEMBLER_HPP
+
+#include "main.hpp"
+#include "image.hpp"
+#include "symbols.hpp"
+#include "disasm.hpp"
+
+// Turns a whole 64K image back into tasml source. Code is told apart from data by following
+// every path from the entry point and the IRQ vector; the rest is written as .db, so assembling
+// the output gives the image back byte for byte.
+class Disassembler {
+public:
+    Disassembler(const std::string& imagePath);
+
+    void loadSymbols(const std::string& symbolPath);
+    void trace();
+    void write(std::ostream& out);
+
+    // Trace filter: appends the instruction at the last $addr of every line
+    void annotate(FILE* in, FILE* out);
+
+    int instructions() const { return _instructions; }
+
+private:
+    enum _Byte : uint8_t { DATA, CODE, OPERAND };
+
+    std::string _imagePath;
+    std::vector<uint8_t> _memory = std::vector<uint8_t>(MAX_MEMORY + 1, 0);
+    std::vector<_Byte> _bytes = std::vector<_Byte>(MAX_MEMORY + 1, DATA);
+    std::map<int, std::string> _labels;
+    SymbolMap _symbols;
+    int _instructions = 0;
+
+    void _follow(int entry);
+    void _addLabel(int address, const std::string& fallback);
+    std::string _targetLabel(const Instruction& instr);
+    int _dataEnd(int address);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "main.hpp"
+#include "disassembler.hpp"
+
+static void usage() {
+    std::cerr << "Usage: ./disasm [-s <symbols.sym>] [-o <output.tasml>] <image>" << std::endl;
+    std::cerr << "       ./disasm -a <image> < trace" << std::endl;
+    exit(ERROR);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) usage();
+
+    std::string imagePath;
+    std::string symbolPath;
+    std::string outputPath;
+    bool annotate = false;                          // Pretty-prints a trace, gatesim -t or any other
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-s" && i + 1 < argc) symbolPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputPath = argv[++i];
+        else if (arg == "-a") annotate = true;
+        else if (arg[0] == '-' || !imagePath.empty()) usage();
+        else imagePath = arg;
+    }
+
+    if (imagePath.empty()) usage();
+
+    Disassembler disassembler(imagePath);
+    if (annotate) {
+        disassembler.annotate(stdin, stdout);
+        return 0;
+    }
+
+    // tasml -g writes the symbol map next to the image
+    if (symbolPath.empty()) {
+        std::string candidate = imagePath.substr(0, imagePath.find_last_of('.')) + ".sym";
+        if (std::ifstream(candidate)) symbolPath = candidate;
+    }
+    if (!symbolPath.empty()) disassembler.loadSymbols(symbolPath);
+
+    disassembler.trace();
+    if (outputPath.empty()) {
+        disassembler.write(std::cout);
+        return 0;
+    }
+
+    std::ofstream output(outputPath);
+    if (!output) {
+        std::cerr << "Error: unable to write '" << outputPath << "'" << std::endl;
+        exit(ERROR);
+    }
+    disassembler.write(output);
+    std::cerr << disassembler.instructions() << " instructions" << std::endl;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#define ERROR           1
+#define MAX_MEMORY      0xffff
+
+#define ENTRY_POINT     0x4000              // Where the program counter starts
+#define IRQ_VECTOR      0xfffd              // Where brk and interrupts jump, an instruction not a pointer
+
+#define DB_PER_LINE     16
+#define MIN_ZERO_GAP    16                  // Unreached zeros skipped with an .org, tasml fills them back in
+
+
+#endif
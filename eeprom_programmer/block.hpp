@@ -0,0 +1,41 @@
+#ifndef BLOCK_HPP
+#define BLOCK_HPP
+
+#include "main.hpp"
+
+#include <array>
+
+// Answering DUMP_COMMAND, the programmer sends the EEPROM as blocks of up to BLOCK_SIZE bytes:
+//   BLOCK_SYNC, address low, address high, length low, length high, data[length], CRC low, CRC high
+// The CRC-16/CCITT covers everything after the sync byte. The host answers each block with
+// BLOCK_ACK, or BLOCK_NAK to have it sent again. A block with length 0 ends the dump.
+
+static constexpr std::array<uint16_t, 256> crcTable() {
+    std::array<uint16_t, 256> table = {};
+    for (int i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for (int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        table[i] = crc;
+    }
+    return table;
+}
+
+static constexpr std::array<uint16_t, 256> CRC_TABLE = crcTable();
+
+inline uint16_t crc16(const uint8_t* data, size_t size, uint16_t crc = 0xffff) {
+    for (size_t i = 0; i < size; i++) crc = (crc << 8) ^ CRC_TABLE[(crc >> 8) ^ data[i]];
+    return crc;
+}
+
+inline std::vector<uint8_t> encodeBlock(int address, const uint8_t* data, int length) {
+    std::vector<uint8_t> block = {BLOCK_SYNC, static_cast<uint8_t>(address), static_cast<uint8_t>(address >> 8),
+                                  static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8)};
+    block.insert(block.end(), data, data + length);
+
+    uint16_t crc = crc16(block.data() + 1, block.size() - 1);
+    block.push_back(crc);
+    block.push_back(crc >> 8);
+    return block;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include "main.hpp"
+#include "serial.hpp"
+#include "block.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Stand-in for the programmer on a pseudo-terminal, serving an image the way the firmware
+// serves the EEPROM: P for the raw dump hexdump_reader.py expects, DUMP_COMMAND for blocks.
+// Every -c'th block is corrupted the first time it is sent, to exercise the retries.
+
+static void usage() {
+    std::cerr << "Usage: ./edevice [-c <corrupt every>] <image.bin>" << std::endl;
+    exit(ERROR);
+}
+
+static void serveRaw(SerialPort& port, const std::vector<uint8_t>& image) {
+    port.write(image.data(), image.size());
+    port.write(reinterpret_cast<const uint8_t*>("EOFEOF"), 6);
+}
+
+static void serveBlocks(SerialPort& port, const std::vector<uint8_t>& image, int corruptEvery) {
+    int blocks = 0;
+    for (size_t address = 0; address <= image.size(); address += BLOCK_SIZE) {
+        int length = std::min<size_t>(BLOCK_SIZE, image.size() - address);
+        std::vector<uint8_t> block = encodeBlock(address, image.data() + address, length);
+
+        bool corrupt = corruptEvery > 0 && ++blocks % corruptEvery == 0;
+        while (true) {
+            std::vector<uint8_t> sent = block;
+            if (corrupt) sent[sent.size() / 2] ^= 0x10;
+            corrupt = false;
+            if (!port.write(sent.data(), sent.size())) return;
+
+            uint8_t reply = 0;
+            while (reply != BLOCK_ACK && reply != BLOCK_NAK) {
+                if (!port.read(&reply, 1, -1)) return;
+            }
+            if (reply == BLOCK_ACK) break;
+        }
+        if (length == 0) break;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string imagePath;
+    int corruptEvery = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-c" && i + 1 < argc) corruptEvery = std::atoi(argv[++i]);
+        else if (arg[0] == '-' || !imagePath.empty()) usage();
+        else imagePath = arg;
+    }
+
+    if (imagePath.empty()) usage();
+
+    std::ifstream file(imagePath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: unable to open '" << imagePath << "'" << std::endl;
+        exit(ERROR);
+    }
+    std::vector<uint8_t> image(std::istreambuf_iterator<char>(file), {});
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0 || !SerialPort::makeRaw(master, BAUD_RATE)) {
+        std::cerr << "Error: unable to create a pseudo-terminal" << std::endl;
+        exit(ERROR);
+    }
+
+    // Keep the slave open so the line stays up between the host opening and closing it
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    std::cout << ptsname(master) << std::endl;
+
+    SerialPort port(master);
+    uint8_t command = 0;
+    while (command != 'P' && command != DUMP_COMMAND) {
+        if (!port.read(&command, 1, -1)) exit(ERROR);
+    }
+
+    if (command == 'P') serveRaw(port, image);
+    else serveBlocks(port, image, corruptEvery);
+
+    // Let the host drain the line before the pseudo-terminal goes away
+    uint8_t rest;
+    while (port.read(&rest, 1, 500)) {}
+    close(slave);
+    return 0;
+}
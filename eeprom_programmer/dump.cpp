@@ -0,0 +1,71 @@
+#include "main.hpp"
+#include "serial.hpp"
+#include "dumper.hpp"
+
+#include <chrono>
+#include <thread>
+
+static void usage() {
+    std::cerr << "Usage: ./edump [-b <baud>] [-r <reset ms>] [-e <expected.bin>] [-o <eeprom_dump.bin>] <serial port>" << std::endl;
+    exit(ERROR);
+}
+
+int main(int argc, char* argv[]) {
+    std::string portPath;
+    std::string dumpPath = "eeprom_dump.bin";
+    std::string expectedPath;
+    int baudRate = BAUD_RATE;
+    int resetDelay = 2000;                          // Opening the port resets the Arduino
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-b" && i + 1 < argc) baudRate = std::atoi(argv[++i]);
+        else if (arg == "-r" && i + 1 < argc) resetDelay = std::atoi(argv[++i]);
+        else if (arg == "-e" && i + 1 < argc) expectedPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) dumpPath = argv[++i];
+        else if (arg[0] == '-' || !portPath.empty()) usage();
+        else portPath = arg;
+    }
+
+    if (portPath.empty() || resetDelay < 0) usage();
+
+    std::vector<uint8_t> expected;
+    if (!expectedPath.empty()) {
+        std::ifstream file(expectedPath, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: unable to open '" << expectedPath << "'" << std::endl;
+            exit(ERROR);
+        }
+        expected.assign(std::istreambuf_iterator<char>(file), {});
+    }
+
+    SerialPort port(SerialPort::open(portPath, baudRate));
+    std::this_thread::sleep_for(std::chrono::milliseconds(resetDelay));
+
+    auto start = std::chrono::steady_clock::now();
+    EepromDumper dumper(port, expected);
+    if (!dumper.dump()) exit(ERROR);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream file(dumpPath, std::ios::binary);
+    if (!file || !file.write(reinterpret_cast<const char*>(dumper.contents().data()), dumper.contents().size())) {
+        std::cerr << "Error: unable to write '" << dumpPath << "'" << std::endl;
+        exit(ERROR);
+    }
+
+    char elapsed[16];
+    std::snprintf(elapsed, sizeof(elapsed), "%.2f", seconds);
+    std::cout << "Read " << dumper.contents().size() << " bytes in " << dumper.blocks() << " blocks ("
+              << dumper.resent() << " resent) in " << elapsed << " s" << std::endl;
+
+    if (!expected.empty()) {
+        if (dumper.mismatches() > 0) {
+            std::cerr << "Error: " << dumper.mismatches() << " bytes differ from '" << expectedPath << "'" << std::endl;
+            exit(ERROR);
+        }
+        std::cout << "Verified: EEPROM matches '" << expectedPath << "'" << std::endl;
+    }
+
+    return 0;
+}
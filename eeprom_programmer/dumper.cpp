@@ -0,0 +1,99 @@
+#include "dumper.hpp"
+
+#define BLOCK_TIMEOUT_MS    3000
+#define BYTE_TIMEOUT_MS     200             // Within a block, which the programmer sends from RAM
+#define QUIET_MS            50
+#define MISMATCHES_SHOWN    8
+
+// Helper Functions
+
+EepromDumper::_Status EepromDumper::_receive(int& address, std::vector<uint8_t>& data) {
+    uint8_t header[BLOCK_HEADER];
+    if (!_port.read(header, 1, BLOCK_TIMEOUT_MS)) return BLOCK_TIMEOUT;
+    if (header[0] != BLOCK_SYNC) return BLOCK_CORRUPT;
+    if (!_port.read(header + 1, BLOCK_HEADER - 1, BYTE_TIMEOUT_MS)) return BLOCK_CORRUPT;
+
+    address = header[1] | header[2] << 8;
+    int length = header[3] | header[4] << 8;
+    if (length > BLOCK_SIZE) return BLOCK_CORRUPT;
+
+    // A corrupt length leaves the read waiting for bytes that never come
+    uint8_t crc[2];
+    data.resize(length);
+    if (!_port.read(data.data(), length, BYTE_TIMEOUT_MS) || !_port.read(crc, 2, BYTE_TIMEOUT_MS)) return BLOCK_CORRUPT;
+
+    uint16_t expected = crc16(data.data(), length, crc16(header + 1, BLOCK_HEADER - 1));
+    return (crc[0] | crc[1] << 8) == expected ? BLOCK_OK : BLOCK_CORRUPT;
+}
+
+void EepromDumper::_verify(int address, const std::vector<uint8_t>& data) {
+    for (size_t i = 0; i < data.size(); i++) {
+        size_t location = address + i;
+        if (location < _expected.size() && _expected[location] == data[i]) continue;
+
+        if (_mismatches++ < MISMATCHES_SHOWN) {
+            char line[64];
+            if (location < _expected.size()) std::snprintf(line, sizeof(line), "Mismatch at $%04zx: read $%02x, expected $%02x", location, data[i], _expected[location]);
+            else std::snprintf(line, sizeof(line), "Mismatch at $%04zx: read $%02x past the end of the image", location, data[i]);
+            std::cerr << line << std::endl;
+        }
+    }
+}
+
+bool EepromDumper::_answer(uint8_t reply) {
+    return _port.write(&reply, 1);
+}
+
+// Main Functions
+
+bool EepromDumper::dump() {
+    uint8_t command = DUMP_COMMAND;
+    if (!_port.write(&command, 1)) {
+        std::cerr << "Error: unable to send the dump command" << std::endl;
+        return false;
+    }
+
+    int attempts = 0;
+    std::vector<uint8_t> data;
+    data.reserve(BLOCK_SIZE);
+
+    while (true) {
+        int address = 0;
+        _Status status = _receive(address, data);
+
+        if (status == BLOCK_TIMEOUT) {
+            std::cerr << "Error: programmer stopped answering after " << _contents.size() << " bytes" << std::endl;
+            return false;
+        }
+
+        // A block resent because its acknowledgement was lost is already in the dump
+        int next = _contents.size() & 0xffff;
+        if (status == BLOCK_OK && address != next && ((next - address) & 0xffff) <= BLOCK_SIZE) {
+            if (!_answer(BLOCK_ACK)) return false;
+            continue;
+        }
+
+        if (status == BLOCK_CORRUPT || address != next) {
+            if (++attempts > BLOCK_RETRIES) {
+                std::cerr << "Error: block at " << _contents.size() << " failed " << BLOCK_RETRIES << " retries" << std::endl;
+                return false;
+            }
+            _resent++;
+            _port.discard(QUIET_MS);
+            if (!_answer(BLOCK_NAK)) return false;
+            continue;
+        }
+
+        attempts = 0;
+        if (!_answer(BLOCK_ACK)) return false;
+        if (data.empty()) break;
+
+        if (!_expected.empty()) _verify(_contents.size(), data);
+        _contents.insert(_contents.end(), data.begin(), data.end());
+        _blocks++;
+    }
+
+    // Bytes of the image the dump never reached
+    if (!_expected.empty() && _expected.size() > _contents.size()) _mismatches += _expected.size() - _contents.size();
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef DUMPER_HPP
+#define DUMPER_HPP
+
+#include "main.hpp"
+#include "serial.hpp"
+#include "block.hpp"
+
+// Host side of the block dump. Blocks are checked against the expected image as they arrive,
+// so a verify needs no second pass over the dump.
+class EepromDumper {
+public:
+    EepromDumper(SerialPort& port, const std::vector<uint8_t>& expected)
+    : _port(port), _expected(expected) {}
+
+    bool dump();
+
+    const std::vector<uint8_t>& contents() const { return _contents; }
+    int blocks() const { return _blocks; }
+    int resent() const { return _resent; }
+    int mismatches() const { return _mismatches; }
+
+private:
+    SerialPort& _port;
+    const std::vector<uint8_t>& _expected;          // Empty when not verifying
+
+    std::vector<uint8_t> _contents;
+    int _blocks = 0;
+    int _resent = 0;
+    int _mismatches = 0;
+
+    enum _Status {BLOCK_OK, BLOCK_CORRUPT, BLOCK_TIMEOUT};
+
+    _Status _receive(int& address, std::vector<uint8_t>& data);
+    void _verify(int address, const std::vector<uint8_t>& data);
+    bool _answer(uint8_t reply);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "eeprom.hpp"
+
+// Helper Functions
+
+void EepromModel::_settle(double time) {
+    // The page is programmed once loading has paused for longer than the byte load limit
+    if (_pageBuffer.empty() || time - _lastLoad <= BYTE_LOAD_LIMIT) return;
+
+    for (const auto& [offset, value] : _pageBuffer) {
+        _memory[_latchedPage * _pageSize + offset] = value;
+    }
+    _pageBuffer.clear();
+    _busyUntil = _lastLoad + BYTE_LOAD_LIMIT + WRITE_CYCLE;
+    _writeCycles++;
+}
+
+void EepromModel::_fault(const std::string& message, double time) {
+    char stamp[32];
+    std::snprintf(stamp, sizeof(stamp), "%.3f ms: ", time / 1000);
+    _faults.push_back(stamp + message);
+}
+
+// Main Functions
+
+void EepromModel::load(int address, uint8_t value, double time) {
+    _settle(time);
+
+    if (address >= static_cast<int>(_memory.size())) {
+        _fault("load past the end of the device", time);
+        return;
+    }
+    if (time < _busyUntil) {
+        _fault("load during a write cycle is lost", time);
+        return;
+    }
+
+    int page = address / _pageSize;
+    if (!_pageBuffer.empty() && page != _latchedPage) {
+        _fault("load crosses into another page, the buffer is programmed into the last one", time);
+    }
+
+    _latchedPage = page;
+    _lastLoad = time;
+    _pollValue = value;
+    _pageBuffer.push_back({address % _pageSize, value});
+}
+
+uint8_t EepromModel::read(int address, double time) {
+    _settle(time);
+    if (time < _busyUntil) return ~_pollValue & 0x80;
+    return _memory[address];
+}
+
+void SimulatedProgrammer::_waitReady() {
+    // Data polling: bit 7 reads back true once the last byte loaded has been programmed
+    if (_pollAddress < 0) return;
+
+    double timeout = _time + BYTE_LOAD_LIMIT + WRITE_CYCLE;
+    while (((_eeprom.read(_pollAddress, _time) ^ _pollValue) & 0x80) && _time < timeout) _time += POLL_INTERVAL;
+}
+
+bool SimulatedProgrammer::run(const std::vector<uint8_t>& stream) {
+    size_t pos = 0;
+
+    while (pos < stream.size()) {
+        size_t start = pos;
+        if (stream[pos++] != FRAME_SYNC || pos + 3 > stream.size()) {
+            std::cerr << "Error: patch stream is corrupt at byte " << start << std::endl;
+            return false;
+        }
+
+        int page = stream[pos] | stream[pos + 1] << 8;
+        int runs = stream[pos + 2];
+        pos += 3;
+
+        std::vector<std::pair<int, uint8_t>> loads;
+        bool valid = true;
+        for (int i = 0; i < runs && valid; i++) {
+            valid = pos + 2 <= stream.size() && stream[pos] + stream[pos + 1] <= _pageSize && pos + 2 + stream[pos + 1] <= stream.size();
+            if (!valid) break;
+
+            int offset = stream[pos];
+            int length = stream[pos + 1];
+            pos += 2;
+            for (int j = 0; j < length; j++) loads.push_back({page * _pageSize + offset + j, stream[pos++]});
+        }
+
+        uint8_t sum = 0;
+        for (size_t i = start + 1; i <= pos && i < stream.size(); i++) sum += stream[i];
+        if (!valid || pos >= stream.size() || sum != 0) {
+            std::cerr << "Error: patch stream frame at byte " << start << " is corrupt" << std::endl;
+            return false;
+        }
+        pos++;
+
+        // The host sends each frame once the previous one is acknowledged with one byte
+        _time += (pos - start + 1) * _byteTime;
+        if (runs == 0) break;
+
+        _waitReady();
+        for (const auto& [address, value] : loads) {
+            _eeprom.load(address, value, _time);
+            _time += BYTE_LOAD;
+            if (address < static_cast<int>(_eeprom.memory().size())) {
+                _pollAddress = address;
+                _pollValue = value;
+            }
+        }
+        _frames++;
+    }
+
+    // The last page still has to finish programming
+    _time += BYTE_LOAD_LIMIT;
+    _waitReady();
+    return true;
+}
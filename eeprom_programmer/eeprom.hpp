@@ -0,0 +1,65 @@
+#ifndef EEPROM_HPP
+#define EEPROM_HPP
+
+#include "main.hpp"
+
+// Software stand-in for the AT28C256. Loaded bytes sit in the page buffer until no byte has been
+// loaded for BYTE_LOAD_LIMIT, then the whole buffer is programmed into the page latched by the
+// last load and the device is busy for WRITE_CYCLE. While busy, reads return the complement of
+// bit 7 of the last byte loaded (data polling) and loads are lost.
+class EepromModel {
+public:
+    EepromModel(const std::vector<uint8_t>& contents, int pageSize)
+    : _memory(contents), _pageSize(pageSize) {}
+
+    void load(int address, uint8_t value, double time);
+    uint8_t read(int address, double time);
+
+    const std::vector<uint8_t>& memory() const { return _memory; }
+    int writeCycles() const { return _writeCycles; }
+    const std::vector<std::string>& faults() const { return _faults; }
+
+private:
+    std::vector<uint8_t> _memory;
+    const int _pageSize;
+
+    std::vector<std::pair<int, uint8_t>> _pageBuffer;
+    int _latchedPage = -1;
+    double _lastLoad = 0;
+    double _busyUntil = 0;
+    uint8_t _pollValue = 0;
+
+    int _writeCycles = 0;
+    std::vector<std::string> _faults;               // Loads the device would lose or misplace
+
+    void _settle(double time);
+    void _fault(const std::string& message, double time);
+};
+
+// The receiving end of the patch stream, as the firmware would run it: buffer a frame, check
+// it, wait for the previous write cycle by data polling, load the page and acknowledge so the
+// host sends the next frame while this one programs.
+class SimulatedProgrammer {
+public:
+    SimulatedProgrammer(EepromModel& eeprom, int pageSize, int baudRate)
+    : _eeprom(eeprom), _pageSize(pageSize), _byteTime(1e6 * BITS_PER_BYTE / baudRate) {}
+
+    bool run(const std::vector<uint8_t>& stream);
+
+    double elapsed() const { return _time; }
+    int frames() const { return _frames; }
+
+private:
+    EepromModel& _eeprom;
+    const int _pageSize;
+    const double _byteTime;
+
+    double _time = 0;
+    int _frames = 0;
+    int _pollAddress = -1;                          // Last byte loaded, read back by data polling
+    uint8_t _pollValue = 0;
+
+    void _waitReady();
+};
+
+#endif
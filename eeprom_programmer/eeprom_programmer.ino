@@ -12,6 +12,9 @@
 #define D07           11
 #define D08           12
 
+#define BLOCK_SYNC    0x5A
+#define BLOCK_SIZE    256
+
 void setup() {
   // Initialize the shift register pins
   pinMode(OE, OUTPUT);
@@ -41,6 +44,9 @@ void setup() {
   if (c == 'P') { 
     printContents();
   } 
+  else if (c == 'B') {
+    sendBlocks();
+  } 
   else if (c == 'W') {
     writeEEPROM(0xFFF1, 0x4);
   }
@@ -123,5 +129,51 @@ void printContents() {
   }
 
   Serial.write("EOFEOF");  // Send an End-Of-Transmission signal
+  Serial.end();
+}
+
+unsigned int crc16(unsigned int crc, byte data) {
+  crc ^= (unsigned int)data << 8;
+  for (int bit = 0; bit < 8; bit++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+// Blocks of sync, address, length, data and CRC, each sent again until the host acknowledges it
+void sendBlocks() {
+  static byte data[BLOCK_SIZE];
+  unsigned long address = 0;
+
+  while (true) {
+    unsigned int length = address <= 0xFFFF ? BLOCK_SIZE : 0;
+    for (unsigned int offset = 0; offset < length; offset++) {
+      data[offset] = readEEPROM(address + offset);
+    }
+
+    byte header[4] = {(byte)address, (byte)(address >> 8), (byte)length, (byte)(length >> 8)};
+    unsigned int crc = 0xFFFF;
+    for (int i = 0; i < 4; i++) crc = crc16(crc, header[i]);
+    for (unsigned int i = 0; i < length; i++) crc = crc16(crc, data[i]);
+
+    char reply = 0;
+    while (reply != 'A') {
+      Serial.write((byte)BLOCK_SYNC);
+      Serial.write(header, 4);
+      Serial.write(data, length);
+      Serial.write((byte)crc);
+      Serial.write((byte)(crc >> 8));
+
+      reply = 0;
+      while (reply != 'A' && reply != 'N') {
+        while (!Serial.available()) {}
+        reply = Serial.read();
+      }
+    }
+
+    if (length == 0) break;
+    address += length;
+  }
+
   Serial.end();
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "main.hpp"
+#include "planner.hpp"
+#include "eeprom.hpp"
+
+static void usage() {
+    std::cerr << "Usage: ./eplan [-d <eeprom_dump.bin>] [-f] [-w <word bytes> -l <lane>] [-b <baud>] [-o <patch.bin>] [-v] <image.bin>" << std::endl;
+    exit(ERROR);
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: unable to open '" << path << "'" << std::endl;
+        exit(ERROR);
+    }
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+
+static std::string duration(double microseconds) {
+    char text[32];
+    double seconds = microseconds / 1e6;
+    if (seconds < 120) std::snprintf(text, sizeof(text), "%.2f s", seconds);
+    else if (seconds < 7200) std::snprintf(text, sizeof(text), "%.1f min", seconds / 60);
+    else std::snprintf(text, sizeof(text), "%.1f h", seconds / 3600);
+    return text;
+}
+
+// Flashes the plan into a model of the device holding the dump, returning the time it took
+static double simulate(const FlashPlanner& planner, int baudRate, EepromModel& eeprom) {
+    SimulatedProgrammer programmer(eeprom, PAGE_SIZE, baudRate);
+    if (!programmer.run(planner.encode())) exit(ERROR);
+    return programmer.elapsed();
+}
+
+int main(int argc, char* argv[]) {
+    std::string imagePath;
+    std::string dumpPath = "eeprom_dump.bin";
+    std::string patchPath;
+    bool full = false;                              // Ignore the dump and write every byte
+    bool verbose = false;
+    int wordBytes = 1;                              // One EEPROM per byte lane, as for microcode.bin
+    int lane = 0;
+    int baudRate = BAUD_RATE;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-d" && i + 1 < argc) dumpPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) patchPath = argv[++i];
+        else if (arg == "-w" && i + 1 < argc) wordBytes = std::atoi(argv[++i]);
+        else if (arg == "-l" && i + 1 < argc) lane = std::atoi(argv[++i]);
+        else if (arg == "-b" && i + 1 < argc) baudRate = std::atoi(argv[++i]);
+        else if (arg == "-f") full = true;
+        else if (arg == "-v") verbose = true;
+        else if (arg[0] == '-' || !imagePath.empty()) usage();
+        else imagePath = arg;
+    }
+
+    if (imagePath.empty() || wordBytes < 1 || lane < 0 || lane >= wordBytes || baudRate <= 0) usage();
+
+    std::vector<uint8_t> image;
+    std::vector<uint8_t> words = readFile(imagePath);
+    for (size_t i = lane; i < words.size(); i += wordBytes) image.push_back(words[i]);
+
+    if (image.size() > (1 << 16) * PAGE_SIZE) {
+        std::cerr << "Error: '" << imagePath << "' is larger than a frame can address" << std::endl;
+        exit(ERROR);
+    }
+
+    // Bytes the dump does not cover are unknown and start out erased in the model
+    std::vector<uint8_t> dump;
+    if (!full) dump = readFile(dumpPath);
+    std::vector<uint8_t> device = dump;
+    device.resize(std::max(dump.size(), image.size()), 0xff);
+
+    FlashPlanner planner(image, dump, PAGE_SIZE);
+    planner.plan();
+    std::vector<uint8_t> stream = planner.encode();
+
+    if (verbose) planner.printPlan();
+
+    EepromModel eeprom(device, PAGE_SIZE);
+    double elapsed = simulate(planner, baudRate, eeprom);
+
+    std::vector<uint8_t> nothing;
+    FlashPlanner rewrite(image, nothing, PAGE_SIZE);
+    rewrite.plan();
+    EepromModel blank(device, PAGE_SIZE);
+    double rewriteElapsed = simulate(rewrite, baudRate, blank);
+
+    std::cout << "Plan: " << planner.changedBytes() << " bytes changed, " << planner.loadedBytes() << " loaded in "
+              << planner.pageWrites().size() << " page writes, " << stream.size() << " byte patch stream" << std::endl;
+    std::cout << "Estimated time: " << duration(elapsed) << " (full rewrite " << duration(rewriteElapsed)
+              << ", byte at a time " << duration(static_cast<double>(planner.changedBytes()) * BYTE_WRITE) << ")" << std::endl;
+
+    // The model has to end up holding the image, with one write cycle per planned page
+    for (const auto& fault : eeprom.faults()) std::cerr << "Error: " << fault << std::endl;
+
+    auto mismatch = std::mismatch(image.begin(), image.end(), eeprom.memory().begin());
+    if (mismatch.first != image.end()) {
+        char address[16];
+        std::snprintf(address, sizeof(address), "$%05x", static_cast<int>(mismatch.first - image.begin()));
+        std::cerr << "Error: simulated EEPROM differs from '" << imagePath << "' at " << address << std::endl;
+        exit(ERROR);
+    }
+    if (!eeprom.faults().empty() || eeprom.writeCycles() != static_cast<int>(planner.pageWrites().size())) {
+        std::cerr << "Error: simulated EEPROM took " << eeprom.writeCycles() << " write cycles for "
+                  << planner.pageWrites().size() << " planned page writes" << std::endl;
+        exit(ERROR);
+    }
+    std::cout << "Verified: simulated EEPROM matches '" << imagePath << "' after " << eeprom.writeCycles() << " write cycles" << std::endl;
+
+    if (!patchPath.empty()) {
+        std::ofstream patch(patchPath, std::ios::binary);
+        if (!patch) {
+            std::cerr << "Error: unable to write '" << patchPath << "'" << std::endl;
+            exit(ERROR);
+        }
+        patch.write(reinterpret_cast<const char*>(stream.data()), stream.size());
+    }
+
+    return 0;
+}
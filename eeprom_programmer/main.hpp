@@ -0,0 +1,38 @@
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#define ERROR           1
+
+// AT28C256 page mode: bytes loaded within BYTE_LOAD_LIMIT of each other are programmed together
+// once loading stops, taking up to WRITE_CYCLE. All times are in microseconds.
+#define PAGE_SIZE           64
+#define WRITE_CYCLE         10000
+#define BYTE_LOAD_LIMIT     150
+#define BYTE_LOAD           20              // Address, data and CE pulse with direct port writes
+#define POLL_INTERVAL       10
+#define BYTE_WRITE          2009100         // writeEEPROM() in eeprom_programmer.ino, delays included
+
+#define BAUD_RATE           115200
+#define BITS_PER_BYTE       10              // 8N1
+
+#define FRAME_SYNC          0xa5
+
+// Block dump protocol, see block.hpp
+#define BLOCK_SYNC          0x5a
+#define BLOCK_SIZE          256
+#define BLOCK_HEADER        5               // Sync, address and length
+#define BLOCK_RETRIES       5
+#define DUMP_COMMAND        'B'
+#define BLOCK_ACK           'A'
+#define BLOCK_NAK           'N'
+
+#endif
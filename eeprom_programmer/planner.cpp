@@ -0,0 +1,80 @@
+#include "planner.hpp"
+
+#define RUN_HEADER      2                   // Offset and length
+
+// Helper Functions
+
+bool FlashPlanner::_changed(int address) const {
+    return address >= static_cast<int>(_dump.size()) || _dump[address] != _image[address];
+}
+
+// Main Functions
+
+void FlashPlanner::plan() {
+    _pageWrites.clear();
+    _changedBytes = _loadedBytes = 0;
+
+    int size = _image.size();
+    for (int base = 0; base < size; base += _pageSize) {
+        int end = std::min(base + _pageSize, size);
+        PageWrite write = {base / _pageSize, {}};
+
+        int runEnd = -1;                    // One past the last byte of the current run
+        for (int address = base; address < end; address++) {
+            if (!_changed(address)) continue;
+            _changedBytes++;
+
+            // Unchanged bytes in a short gap are known, so loading them again is harmless
+            if (runEnd < 0 || address - runEnd > RUN_HEADER) {
+                write.runs.push_back({address - base, {}});
+                runEnd = address;
+            }
+            for (; runEnd <= address; runEnd++) write.runs.back().data.push_back(_image[runEnd]);
+        }
+
+        if (write.runs.empty()) continue;
+        for (const auto& run : write.runs) _loadedBytes += run.data.size();
+        _pageWrites.push_back(write);
+    }
+}
+
+std::vector<uint8_t> FlashPlanner::encode() const {
+    std::vector<uint8_t> stream;
+
+    auto frame = [&stream](const std::vector<uint8_t>& body) {
+        uint8_t sum = 0;
+        stream.push_back(FRAME_SYNC);
+        for (uint8_t byte : body) {
+            stream.push_back(byte);
+            sum += byte;
+        }
+        stream.push_back(-sum);
+    };
+
+    for (const auto& write : _pageWrites) {
+        std::vector<uint8_t> body = {static_cast<uint8_t>(write.page), static_cast<uint8_t>(write.page >> 8), static_cast<uint8_t>(write.runs.size())};
+        for (const auto& run : write.runs) {
+            body.push_back(run.offset);
+            body.push_back(run.data.size());
+            body.insert(body.end(), run.data.begin(), run.data.end());
+        }
+        frame(body);
+    }
+
+    frame({0, 0, 0});
+    return stream;
+}
+
+void FlashPlanner::printPlan() const {
+    for (const auto& write : _pageWrites) {
+        char line[32];
+        std::snprintf(line, sizeof(line), "$%05x", write.page * _pageSize);
+        std::cout << line << ":";
+
+        for (const auto& run : write.runs) {
+            std::snprintf(line, sizeof(line), " +%d[%d]", run.offset, static_cast<int>(run.data.size()));
+            std::cout << line;
+        }
+        std::cout << std::endl;
+    }
+}
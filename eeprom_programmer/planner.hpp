@@ -0,0 +1,47 @@
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+#include "main.hpp"
+
+// Diffs a new image against the last dump of the EEPROM and plans one page write per page that
+// changed. The plan is sent as a stream of frames, one frame per page write:
+//   FRAME_SYNC, page low, page high, run count, { offset, length, data[length] } * runs, checksum
+// The checksum makes the sum of every byte after FRAME_SYNC zero. A frame with no runs ends
+// the stream. Short gaps between changed bytes are rewritten with their old value when that is
+// cheaper than starting another run.
+class FlashPlanner {
+public:
+    FlashPlanner(const std::vector<uint8_t>& image, const std::vector<uint8_t>& dump, int pageSize)
+    : _image(image), _dump(dump), _pageSize(pageSize) {}
+
+    struct Run {
+        int offset;
+        std::vector<uint8_t> data;
+    };
+
+    struct PageWrite {
+        int page;
+        std::vector<Run> runs;
+    };
+
+    void plan();
+    std::vector<uint8_t> encode() const;
+    void printPlan() const;
+
+    const std::vector<PageWrite>& pageWrites() const { return _pageWrites; }
+    int changedBytes() const { return _changedBytes; }
+    int loadedBytes() const { return _loadedBytes; }
+
+private:
+    const std::vector<uint8_t>& _image;
+    const std::vector<uint8_t>& _dump;              // Bytes past its end are unknown
+    const int _pageSize;
+
+    std::vector<PageWrite> _pageWrites;
+    int _changedBytes = 0;
+    int _loadedBytes = 0;
+
+    bool _changed(int address) const;
+};
+
+#endif
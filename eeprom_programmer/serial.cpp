@@ -0,0 +1,97 @@
+#include "serial.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Helper Functions
+
+static speed_t baudConstant(int baudRate) {
+    switch (baudRate) {
+        case 9600:      return B9600;
+        case 19200:     return B19200;
+        case 38400:     return B38400;
+        case 57600:     return B57600;
+        case 115200:    return B115200;
+        case 230400:    return B230400;
+        case 460800:    return B460800;
+        case 500000:    return B500000;
+        case 1000000:   return B1000000;
+        case 2000000:   return B2000000;
+        default:        return B0;
+    }
+}
+
+bool SerialPort::_fill(int timeout) {
+    if (_start == _end) _start = _end = 0;
+
+    pollfd ready = {_fd, POLLIN, 0};
+    if (poll(&ready, 1, timeout) <= 0) return false;
+
+    ssize_t count = ::read(_fd, _buffer.data() + _end, _buffer.size() - _end);
+    if (count <= 0) return false;
+    _end += count;
+    return true;
+}
+
+// Main Functions
+
+SerialPort::~SerialPort() {
+    ::close(_fd);
+}
+
+bool SerialPort::makeRaw(int fd, int baudRate) {
+    termios settings;
+    if (tcgetattr(fd, &settings) != 0) return false;
+
+    cfmakeraw(&settings);
+    settings.c_cflag |= CLOCAL | CREAD;
+    settings.c_cc[VMIN] = 0;
+    settings.c_cc[VTIME] = 0;
+    cfsetispeed(&settings, baudConstant(baudRate));
+    cfsetospeed(&settings, baudConstant(baudRate));
+    return tcsetattr(fd, TCSANOW, &settings) == 0;
+}
+
+int SerialPort::open(const std::string& path, int baudRate) {
+    if (baudConstant(baudRate) == B0) {
+        std::cerr << "Error: unsupported baud rate " << baudRate << std::endl;
+        exit(ERROR);
+    }
+
+    int fd = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+    if (fd < 0 || !makeRaw(fd, baudRate)) {
+        std::cerr << "Error: unable to open serial port '" << path << "'" << std::endl;
+        exit(ERROR);
+    }
+    return fd;
+}
+
+bool SerialPort::read(uint8_t* data, size_t size, int timeout) {
+    while (size > 0) {
+        if (_start == _end && !_fill(timeout)) return false;
+
+        size_t count = std::min(size, _end - _start);
+        std::copy(_buffer.begin() + _start, _buffer.begin() + _start + count, data);
+        _start += count;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool SerialPort::write(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t count = ::write(_fd, data, size);
+        if (count <= 0) return false;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+void SerialPort::discard(int quiet) {
+    _start = _end = 0;
+    while (_fill(quiet)) _start = _end = 0;
+}
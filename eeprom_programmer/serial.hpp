@@ -0,0 +1,30 @@
+#ifndef SERIAL_HPP
+#define SERIAL_HPP
+
+#include "main.hpp"
+
+// Raw 8N1 serial port. Reads are buffered so a dump arrives in a few large read() calls
+// instead of one per byte.
+class SerialPort {
+public:
+    explicit SerialPort(int fd) : _fd(fd) {}
+    ~SerialPort();
+
+    static int open(const std::string& path, int baudRate);
+    static bool makeRaw(int fd, int baudRate);
+
+    bool read(uint8_t* data, size_t size, int timeout);      // Milliseconds
+    bool write(const uint8_t* data, size_t size);
+    void discard(int quiet);                                   // Drop input until the line is quiet
+
+private:
+    const int _fd;
+
+    std::vector<uint8_t> _buffer = std::vector<uint8_t>(4096);
+    size_t _start = 0;
+    size_t _end = 0;
+
+    bool _fill(int timeout);
+};
+
+#endif
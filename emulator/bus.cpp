@@ -0,0 +1,130 @@
+#include "bus.hpp"
+#include "emulator.hpp"
+
+#include <barrier>
+#include <thread>
+
+Bus::Bus(const std::string& programFile, int cores, uint64_t quantum, bool lockstep)
+: _state(cores), _quantum(lockstep ? 1 : quantum), _lockstep(lockstep) {
+    for (int i = 0; i < cores; i++) {
+        _cores.push_back(std::make_unique<Emulator>(programFile));
+        _cores[i]->attach(this, i, &_state[i].console);
+        _refreshMailbox(i);
+    }
+}
+
+Bus::~Bus() = default;
+
+// Helper Functions
+
+void Bus::_refreshMailbox(int core) {
+    // The registers read back what the device holds, not what the program stored in them
+    Emulator& emulator = *_cores[core];
+    const std::deque<uint8_t>& mailbox = _state[core].mailbox;
+
+    emulator.busWrite(MAILBOX_CPU_ID, core);
+    emulator.busWrite(MAILBOX_CPU_COUNT, _cores.size());
+    emulator.busWrite(MAILBOX_PENDING, std::min<size_t>(mailbox.size(), 0xff));
+    emulator.busWrite(MAILBOX_DATA, mailbox.empty() ? 0 : mailbox.front());
+    emulator.busWrite(MAILBOX_TARGET, _state[core].target);
+    emulator.busWrite(MAILBOX_SEND, 0);
+}
+
+void Bus::_runCore(int core) {
+    Emulator& emulator = *_cores[core];
+    if (!emulator.running()) return;
+
+    uint64_t end = emulator.instructions() + _quantum;
+    if (_limit) end = std::min(end, _limit);
+    if (emulator.instructions() >= end) return;
+
+    emulator.setInstructionLimit(end);
+    emulator.emulate();
+}
+
+void Bus::_exchange() {
+    // Runs alone, between quanta. Each core already sees its own stores; every core, the storing
+    // one included, then takes all of them in one order so the last writer wins everywhere
+    auto byInstruction = [](const _Store& a, const _Store& b) { return a.instruction < b.instruction; };
+
+    std::vector<_Store> stores;
+    std::vector<_Store> sends;
+    for (_Core& state : _state) {
+        stores.insert(stores.end(), state.stores.begin(), state.stores.end());
+        sends.insert(sends.end(), state.sends.begin(), state.sends.end());
+        state.stores.clear();
+        state.sends.clear();
+    }
+    std::stable_sort(stores.begin(), stores.end(), byInstruction);
+    std::stable_sort(sends.begin(), sends.end(), byInstruction);
+
+    for (const _Store& store : stores) {
+        for (auto& emulator : _cores) emulator->busWrite(store.address, store.value);
+    }
+    for (const _Store& send : sends) {
+        if (send.target < _state.size()) _state[send.target].mailbox.push_back(send.value);
+    }
+
+    bool done = true;
+    for (size_t i = 0; i < _cores.size(); i++) {
+        Emulator& emulator = *_cores[i];
+        _refreshMailbox(i);
+        if (!_state[i].mailbox.empty() && emulator.running()) emulator.interrupt();
+
+        std::cout << _state[i].console.str();
+        _state[i].console.str("");
+        done &= !emulator.running() || (_limit && emulator.instructions() >= _limit);
+    }
+    std::cout.flush();
+    _done = done;
+}
+
+// Main Functions
+
+void Bus::store(int core, uint64_t instruction, uint16_t address, uint8_t value) {
+    _Core& state = _state[core];
+    if (address < BUS_DEVICE_START || address >= BUS_DEVICE_END) {
+        state.stores.push_back({instruction, core, 0, address, value});
+        return;
+    }
+
+    // Sends wait for the end of the quantum like stores; the own mailbox is only touched here
+    if (address == MAILBOX_DATA && !state.mailbox.empty()) state.mailbox.pop_front();
+    else if (address == MAILBOX_TARGET) state.target = value;
+    else if (address == MAILBOX_SEND) state.sends.push_back({instruction, core, state.target, address, value});
+    _refreshMailbox(core);
+}
+
+void Bus::run(uint64_t limit) {
+    _limit = limit;
+
+    if (_lockstep) {
+        while (!_done) {
+            for (size_t i = 0; i < _cores.size(); i++) _runCore(i);
+            _exchange();
+        }
+        return;
+    }
+
+    std::barrier sync(_cores.size(), [this]() noexcept { _exchange(); });
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < _cores.size(); i++) {
+        threads.emplace_back([this, &sync, i] {
+            while (!_done) {
+                _runCore(i);
+                sync.arrive_and_wait();
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+}
+
+void Bus::printBenchmark(double seconds) {
+    uint64_t total = 0;
+    for (auto& emulator : _cores) total += emulator->instructions();
+
+    char row[96];
+    std::snprintf(row, sizeof(row), "%llu instructions on %zu cores in %.3f s, %.1f MIPS", static_cast<unsigned long long>(total), _cores.size(), seconds,
+                  seconds > 0 ? total / seconds / 1e6 : 0.0);
+    std::cout << "\nBenchmark: " << row << std::endl;
+}
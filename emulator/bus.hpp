@@ -0,0 +1,59 @@
+#ifndef BUS_HPP
+#define BUS_HPP
+
+#include "main.hpp"
+#include "devices.hpp"
+
+#include <deque>
+#include <memory>
+#include <sstream>
+
+class Emulator;
+
+#define DEFAULT_QUANTUM     10000
+
+// Several CPUs on one memory bus, each core on its own thread. Cores run a quantum of instructions
+// against their own copy of the shared memory, then stop at a barrier where every shared write
+// and mailbox send of the quantum is applied to all of them. Conflicting writes land in the order
+// of the instruction that made them, then of the core number, so every run ends the same way.
+// Lockstep runs the cores one instruction at a time on one thread, as on a real shared bus.
+class Bus {
+public:
+    Bus(const std::string& programFile, int cores, uint64_t quantum, bool lockstep);
+    ~Bus();
+
+    Emulator& core(int core) { return *_cores[core]; }
+    void run(uint64_t limit);
+    void printBenchmark(double seconds);
+    void store(int core, uint64_t instruction, uint16_t address, uint8_t value);
+
+private:
+    struct _Store {
+        uint64_t instruction;               // Of the storing core, orders the writes of a quantum
+        int core;
+        size_t target;                      // Core a mailbox send goes to
+        uint16_t address;
+        uint8_t value;
+    };
+
+    struct _Core {
+        std::vector<_Store> stores;         // Only touched by the core's thread during a quantum
+        std::vector<_Store> sends;
+        std::deque<uint8_t> mailbox;
+        uint8_t target = 0;
+        std::ostringstream console;
+    };
+
+    std::vector<std::unique_ptr<Emulator>> _cores;
+    std::vector<_Core> _state;
+    uint64_t _quantum;
+    bool _lockstep;
+    uint64_t _limit = 0;
+    bool _done = false;
+
+    void _runCore(int core);
+    void _exchange();
+    void _refreshMailbox(int core);
+};
+
+#endif
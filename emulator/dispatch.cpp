@@ -0,0 +1,98 @@
+#include "emulator.hpp"
+
+// Binds every opcode in isa.hpp to the handler for its mnemonic, so decoding an instruction is one
+// table load and new opcodes only need a row in OPCODES
+constexpr std::array<Emulator::_Decoded, 256> Emulator::_buildDecode() {
+    struct Handler {
+        std::string_view mnemonic;
+        _Execute execute;
+    };
+
+    const Handler handlers[] = {
+        {"nop", &Emulator::_nop}, {"adc", &Emulator::_adc}, {"and", &Emulator::_and}, {"asl", &Emulator::_asl},
+        {"bcc", &Emulator::_bcc}, {"bcs", &Emulator::_bcs}, {"beq", &Emulator::_beq}, {"bit", &Emulator::_bit},
+        {"bmi", &Emulator::_bmi}, {"bne", &Emulator::_bne}, {"bpl", &Emulator::_bpl}, {"brk", &Emulator::_brk},
+        {"bvc", &Emulator::_bvc}, {"bvs", &Emulator::_bvs}, {"clc", &Emulator::_clc}, {"cli", &Emulator::_cli},
+        {"clv", &Emulator::_clv}, {"cmp", &Emulator::_cmp}, {"cpx", &Emulator::_cpx}, {"cpy", &Emulator::_cpy},
+        {"dec", &Emulator::_dec}, {"dex", &Emulator::_dex}, {"dey", &Emulator::_dey}, {"eor", &Emulator::_eor},
+        {"inc", &Emulator::_inc}, {"inx", &Emulator::_inx}, {"iny", &Emulator::_iny}, {"jmp", &Emulator::_jmp},
+        {"jsr", &Emulator::_jsr}, {"lda", &Emulator::_lda}, {"ldx", &Emulator::_ldx}, {"ldy", &Emulator::_ldy},
+        {"lsr", &Emulator::_lsr}, {"ora", &Emulator::_ora}, {"pha", &Emulator::_pha}, {"php", &Emulator::_php},
+        {"pla", &Emulator::_pla}, {"plp", &Emulator::_plp}, {"rol", &Emulator::_rol}, {"ror", &Emulator::_ror},
+        {"rti", &Emulator::_rti}, {"rts", &Emulator::_rts}, {"sub", &Emulator::_sub}, {"sec", &Emulator::_sec},
+        {"sei", &Emulator::_sei}, {"sta", &Emulator::_sta}, {"stx", &Emulator::_stx}, {"sty", &Emulator::_sty},
+        {"tax", &Emulator::_tax}, {"tay", &Emulator::_tay}, {"tsx", &Emulator::_tsx}, {"tsa", &Emulator::_tsa},
+        {"txs", &Emulator::_txs}, {"tya", &Emulator::_tya}, {"hlt", &Emulator::_hlt}, {"out", &Emulator::_out},
+    };
+
+    std::array<_Decoded, 256> decode = {};
+    for (const Opcode& op : OPCODE_TABLE) {
+        decode[op.opcode] = {nullptr, op.mode};
+        for (const Handler& handler : handlers) {
+            if (handler.mnemonic == op.mnemonic) decode[op.opcode].execute = handler.execute;
+        }
+    }
+    return decode;
+}
+
+constinit const std::array<Emulator::_Decoded, 256> Emulator::_decode = _buildDecode();
+
+void Emulator::_performInstr(uint8_t instr) {
+    static_assert([] {
+        for (const Opcode& op : OPCODE_TABLE) {
+            if (op.legal() != (_buildDecode()[op.opcode].execute != nullptr)) return false;
+        }
+        return true;
+    }(), "every mnemonic in isa.hpp needs an instruction handler");
+
+    const _Decoded& decoded = _decode[instr];
+    if (decoded.execute) (this->*decoded.execute)(decoded.mode);
+    else _illegal(instr);
+}
+
+// Fusion
+
+template <uint8_t Opcode>
+void Emulator::_step() {
+    constexpr _Decoded decoded = _buildDecode()[Opcode];
+    (this->*decoded.execute)(decoded.mode);
+}
+
+// Runs a whole rule from fusion.hpp with the opcode handlers inlined. The first opcode was
+// fetched by the run loop; the rest are checked again in case an earlier one stored over them.
+// Counts each instruction as it retires, so stores see the same count as unfused
+template <size_t Rule>
+void Emulator::_fusedRun() {
+    constexpr FusionRule rule = FUSION_RULES[Rule];
+    _step<rule.opcodes[0]>();
+    _instructionCount++;
+
+    if (_memory[_programCounter] != rule.opcodes[1]) return;
+    _instrReg = _fetch();
+    _step<rule.opcodes[1]>();
+    _instructionCount++;
+
+    if constexpr (rule.length > 2) {
+        if (_memory[_programCounter] != rule.opcodes[2]) return;
+        _instrReg = _fetch();
+        _step<rule.opcodes[2]>();
+        _instructionCount++;
+    }
+}
+
+template <size_t... Rules>
+constexpr std::array<Emulator::_Fused, sizeof...(Rules)> Emulator::_buildFused(std::index_sequence<Rules...>) {
+    static_assert([] {
+        for (const FusionRule& rule : FUSION_RULES) {
+            if (rule.length < 2 || rule.length > FUSION_MAX_LENGTH) return false;
+            for (int i = 0; i < rule.length; i++) {
+                if (!OPCODE_TABLE[rule.opcodes[i]].legal() || (i < rule.length - 1 && _endsRun(rule.opcodes[i]))) return false;
+            }
+        }
+        return true;
+    }(), "fusion.hpp rules need legal opcodes, and only the last may jump, branch or halt");
+
+    return {&Emulator::_fusedRun<Rules>...};
+}
+
+constinit const std::array<Emulator::_Fused, FUSION_RULES.size()> Emulator::_fusedHandlers = _buildFused(std::make_index_sequence<FUSION_RULES.size()>());
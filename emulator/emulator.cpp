@@ -1,30 +1,599 @@
 #include "emulator.hpp"
 
 Emulator::Emulator(const std::string& programFile) {
-    const size_t startAddress = 0x4000;
-    std::ifstream file(programFile, std::ios::binary);
-    
-    if (!file) {
-        std::cerr << "Unable to open file: " << programFile << std::endl;
+    // Full .bin images load at 0x4000, segment/HEX/S-record files at the addresses they name
+    if (!readImage(programFile, _memory)) exit(ERROR);
+}
+
+Emulator::Emulator(const AssembledProgram& program) : _symbols(program.symbols) {
+    // Loaded like the sparse image formats, only what the source populated
+    for (const ImageRange& range : program.ranges) std::copy(program.memory.begin() + range.start, program.memory.begin() + range.end, _memory.begin() + range.start);
+}
+
+// Debugging Functions
+
+void Emulator::loadSymbols(const std::string& symbolFile) {
+    if (!_symbols.read(symbolFile)) exit(ERROR);
+}
+
+void Emulator::addBreakpoint(const std::string& location) {
+    int address = location[0] == '$' ? std::stoi(location.substr(1), nullptr, 16) : _symbols.addressOf(location);
+    if (address < 0 || address > MAX_MEMORY) {
+        std::cerr << "Error: unknown breakpoint location '" << location << "'" << std::endl;
         exit(ERROR);
     }
 
-     // Ensure that the file contents do not exceed the memory size
-    file.seekg(0, std::ios::end);
-    size_t fileSize = file.tellg();
-    if (fileSize > _memory.size() - startAddress) {
-        std::cerr << "Error: File size exceeds available memory." << std::endl;
-        exit(ERROR);
+    if (_breakpoints.empty()) _breakpoints.assign(MAX_MEMORY + 1, 0);
+    _breakpoints[address] = 1;
+}
+
+std::string Emulator::_describe(int address) {
+    char text[16];
+    std::snprintf(text, sizeof(text), "$%04x", address);
+    std::string description = text;
+
+    const SymbolLabel* label = _symbols.labelAt(address);
+    if (label) {
+        description += "  " + label->name;
+        if (address != label->start) description += "+" + std::to_string(address - label->start);
+    }
+
+    const SymbolLine* line = _symbols.lineAt(address);
+    if (line) description += "  " + _symbols.files[line->file] + ":" + std::to_string(line->line);
+    return description;
+}
+
+void Emulator::_printState() {
+    char state[64];
+    std::snprintf(state, sizeof(state), "A=%02x X=%02x Y=%02x SR=%02x SP=%02x", _regA, _regX, _regY, _flagsReg, _stackPointer);
+    std::cerr << state << "  PC=" << _describe(_programCounter) << std::endl;
+}
+
+void Emulator::_printTrace(uint16_t address) {
+    char line[DISASM_MAX_TEXT + 1];
+    line[formatInstruction(line, decodeInstruction(_memory, address))] = '\0';
+
+    char state[48];
+    std::snprintf(state, sizeof(state), "A=%02x X=%02x Y=%02x SR=%02x SP=%02x", _regA, _regX, _regY, _flagsReg, _stackPointer);
+    std::fprintf(stderr, "%-12s %s  %s\n", line, state, _describe(address).c_str());
+}
+
+void Emulator::printProfile() {
+    if (_profile.empty()) return;
+
+    // Attribution only happens here so the run loop just counts per address
+    std::map<std::string, uint64_t> labelCounts;
+    std::map<std::string, uint64_t> lineCounts;
+    uint64_t total = 0;
+
+    for (int address = 0; address <= MAX_MEMORY; address++) {
+        uint64_t count = _profile[address];
+        if (count == 0) continue;
+        total += count;
+
+        const SymbolLabel* label = _symbols.labelAt(address);
+        char unknown[8];
+        std::snprintf(unknown, sizeof(unknown), "$%04x", address);
+        labelCounts[label ? label->name : unknown] += count;
+
+        const SymbolLine* line = _symbols.lineAt(address);
+        if (line) lineCounts[_symbols.files[line->file] + ":" + std::to_string(line->line)] += count;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> labels(labelCounts.begin(), labelCounts.end());
+    std::vector<std::pair<std::string, uint64_t>> lines(lineCounts.begin(), lineCounts.end());
+    auto byCount = [](const auto& a, const auto& b) { return a.second > b.second; };
+    std::stable_sort(labels.begin(), labels.end(), byCount);
+    std::stable_sort(lines.begin(), lines.end(), byCount);
+
+    char row[96];
+    std::cout << "\nProfile: " << total << " instructions, " << _cycleCount << " clock cycles" << std::endl;
+    for (const auto& [name, count] : labels) {
+        std::snprintf(row, sizeof(row), "  %-32s %12llu %6.1f%%", name.c_str(), static_cast<unsigned long long>(count), 100.0 * count / total);
+        std::cout << row << std::endl;
+    }
+
+    if (lines.empty()) return;
+    std::cout << "\nHottest source lines" << std::endl;
+    for (size_t i = 0; i < lines.size() && i < 10; i++) {
+        std::snprintf(row, sizeof(row), "  %-32s %12llu %6.1f%%", lines[i].first.c_str(), static_cast<unsigned long long>(lines[i].second), 100.0 * lines[i].second / total);
+        std::cout << row << std::endl;
+    }
+}
+
+static std::string describeRule(const FusionRule& rule) {
+    std::string text;
+    for (int i = 0; i < rule.length; i++) {
+        const Opcode& op = OPCODE_TABLE[rule.opcodes[i]];
+        text += (i ? "; " : "") + std::string(op.mnemonic) + (op.mode == IMPLIED ? "" : " " + std::string(modeName(op.mode)));
+    }
+    return text;
+}
+
+void Emulator::printBenchmark(double seconds) {
+    char row[96];
+    std::snprintf(row, sizeof(row), "%llu instructions in %.3f s, %.1f MIPS", static_cast<unsigned long long>(_instructionCount), seconds,
+                  seconds > 0 ? _instructionCount / seconds / 1e6 : 0.0);
+    std::cout << "\nBenchmark: " << row << std::endl;
+
+    // Each dispatch is one fetch and indirect call through the run loop
+    uint64_t removed = _instructionCount - _dispatches;
+    std::snprintf(row, sizeof(row), "%llu dispatches, %llu removed by fusion (%.1f%%)", static_cast<unsigned long long>(_dispatches),
+                  static_cast<unsigned long long>(removed), _instructionCount ? 100.0 * removed / _instructionCount : 0.0);
+    std::cout << "Dispatch: " << row << std::endl;
+
+    for (size_t r = 0; r < _fusionHits.size(); r++) {
+        if (_fusionHits[r] == 0) continue;
+        std::snprintf(row, sizeof(row), "  %-52s %12llu", describeRule(FUSION_RULES[r]).c_str(), static_cast<unsigned long long>(_fusionHits[r]));
+        std::cout << row << std::endl;
+    }
+}
+
+void Emulator::writeAccessProfile(const std::string& profilePath) {
+    if (_reads.empty()) return;
+
+    // Only RAM, the ROM holds code and constants that can't be moved
+    AccessProfile profile;
+    for (int address = 0; address < IMAGE_ROM_START; address++) {
+        if (_reads[address] == 0 && _writes[address] == 0) continue;
+
+        const SymbolLabel* label = _symbols.labelAt(address);
+        profile.counts.push_back({address, _reads[address], _writes[address], label ? label->name : ""});
+    }
+
+    if (!profile.write(profilePath)) exit(ERROR);
+}
+
+// Multiprocessor Functions
+
+void Emulator::busWrite(uint16_t address, uint8_t value) {
+    // Another core's store, or a mailbox register the bus updated
+    _memory[address] = value;
+    if (!_fusedBytes.empty() && _fusedBytes[address]) _unfuse(address);
+}
+
+void Emulator::interrupt() {
+    // Like brk, without the break flag, and held off while interrupts are disabled
+    if (_flagsReg & _IF) return;
+    _push(_programCounter >> 8);
+    _push(_programCounter & 0xff);
+    _push(_flagsReg & ~_BF);
+    _setFlag(_IF, true);
+    _programCounter = irqVec;
+}
+
+void Emulator::patch(uint16_t address, uint8_t value) {
+    // Reassembled code, which unlike a store may change the ROM. Runs decoded from the old bytes
+    // go, and the new bytes get whatever rules match them now
+    _memory[address] = value;
+    if (_fusion.empty()) return;
+
+    for (int back = 0; back < FUSION_MAX_LENGTH * 3; back++) _fuseAt(address - back);
+}
+
+// Fusion Functions
+
+int Emulator::_matchRule(uint16_t address) {
+    // Longer rules first, so a triple wins over the pair it starts with
+    int best = -1;
+    for (size_t r = 0; r < FUSION_RULES.size(); r++) {
+        const FusionRule& rule = FUSION_RULES[r];
+        if (best >= 0 && rule.length <= FUSION_RULES[best].length) continue;
+
+        uint16_t at = address;
+        int i = 0;
+        for (; i < rule.length && _memory[at] == rule.opcodes[i]; i++) at += OPCODE_TABLE[rule.opcodes[i]].size();
+        if (i == rule.length) best = r;
+    }
+    return best;
+}
+
+void Emulator::_buildFusion() {
+    // Every address, not just instruction starts: a run only fuses where execution reaches it
+    _fusion.assign(MAX_MEMORY + 1, 0);
+    _fusedBytes.assign(MAX_MEMORY + 1, 0);
+    _fusionHits.assign(FUSION_RULES.size(), 0);
+
+    for (int address = 0; address <= MAX_MEMORY; address++) _fuseAt(address);
+}
+
+void Emulator::_fuseAt(uint16_t address) {
+    if (_fusion[address]) _markRun(address, -1);
+    _fusion[address] = _matchRule(address) + 1;
+    if (_fusion[address]) _markRun(address, 1);
+}
+
+void Emulator::_markRun(uint16_t address, int delta) {
+    // Counted, so a byte no run covers any more reads zero again and its stores stay cheap
+    const FusionRule& rule = FUSION_RULES[_fusion[address] - 1];
+    uint16_t at = address;
+    for (int i = 0; i < rule.length; i++) {
+        for (int b = 0; b < OPCODE_TABLE[rule.opcodes[i]].size(); b++) _fusedBytes[at++] += delta;
+    }
+}
+
+void Emulator::_unfuse(uint16_t address) {
+    // Code was written over, every run decoded from that byte goes back to one instruction at a time
+    for (int back = 0; back < FUSION_MAX_LENGTH * 3; back++) {
+        uint16_t start = address - back;
+        if (!_fusion[start]) continue;
+
+        const FusionRule& rule = FUSION_RULES[_fusion[start] - 1];
+        int span = 0;
+        for (int i = 0; i < rule.length; i++) span += OPCODE_TABLE[rule.opcodes[i]].size();
+        if (back < span) {
+            _markRun(start, -1);
+            _fusion[start] = 0;
+        }
+    }
+}
+
+void Emulator::_countSequence(uint16_t address) {
+    // Counts the runs ending here that fell through from the instructions before it
+    uint8_t instr = _memory[address];
+    if (address != _sequenceNext) _sequenceLength = 0;
+
+    // Keyed by length, then the opcodes in order from the top byte down
+    for (int start = 0; start < _sequenceLength; start++) {
+        int length = _sequenceLength - start + 1;
+        uint32_t key = length << 24 | instr << (24 - 8 * length);
+        for (int i = 0; i < length - 1; i++) key |= _sequence[start + i] << (16 - 8 * i);
+        _sequences[key]++;
+    }
+
+    if (_endsRun(instr)) _sequenceLength = 0;
+    else {
+        if (_sequenceLength == FUSION_MAX_LENGTH - 1) std::copy(_sequence.begin() + 1, _sequence.end(), _sequence.begin());
+        else _sequenceLength++;
+        _sequence[_sequenceLength - 1] = instr;
+    }
+    _sequenceNext = address + OPCODE_TABLE[instr].size();
+}
+
+// Helper Functions
+
+uint8_t Emulator::_fetch() {
+    return _memory[_programCounter++];
+}
+
+uint16_t Emulator::_fetchWord() {
+    uint8_t low = _fetch();
+    return low | (_fetch() << 8);
+}
+
+uint16_t Emulator::_readWord(uint16_t address) {
+    return _memory[address] | (_memory[static_cast<uint16_t>(address + 1)] << 8);
+}
+
+uint16_t Emulator::_readPointer(uint16_t address) {
+    if (!_reads.empty()) {
+        _reads[address]++;
+        _reads[static_cast<uint16_t>(address + 1)]++;
+    }
+    return _readWord(address);
+}
+
+void Emulator::_write(uint16_t address, uint8_t value) {
+    if (!_writes.empty()) _writes[address]++;
+    if (address >= IMAGE_ROM_START) return;                                // ROM ignores writes
+
+    _memory[address] = value;
+    if (!_fusedBytes.empty() && _fusedBytes[address]) _unfuse(address);
+    if (_bus && address >= BUS_SHARED_START) _bus->store(_core, _instructionCount, address, value);
+}
+
+uint16_t Emulator::_address(AddressingMode mode) {
+    switch (mode) {
+        case ZEROPAGE: return _fetch();
+        case ZEROPAGE_X: return static_cast<uint8_t>(_fetch() + _regX);
+        case ZEROPAGE_Y: return static_cast<uint8_t>(_fetch() + _regY);
+        case ABSOLUTE: return _fetchWord();
+        case ABSOLUTE_X: return _fetchWord() + _regX;
+        case ABSOLUTE_Y: return _fetchWord() + _regY;
+        case INDIRECT: return _readPointer(_fetchWord());
+        case INDIRECT_X: return _readPointer(_fetchWord() + _regX);
+        case INDIRECT_Y: return _readPointer(_fetchWord() + _regY);
+        case INDIRECT_POST_X: return _readPointer(_fetchWord()) + _regX;
+        case INDIRECT_POST_Y: return _readPointer(_fetchWord()) + _regY;
+        default: return _programCounter++;                                 // Immediate operand
+    }
+}
+
+uint8_t Emulator::_operand(AddressingMode mode) {
+    uint16_t address = _address(mode);
+    if (!_reads.empty() && mode != IMMEDIATE) _reads[address]++;
+    return _memory[address];
+}
+
+void Emulator::_push(uint8_t value) {
+    // The stack grows upwards: write, then increment
+    _write(stackPage | _stackPointer++, value);
+}
+
+uint8_t Emulator::_pull() {
+    return _memory[stackPage | --_stackPointer];
+}
+
+void Emulator::_setFlag(uint8_t flag, bool set) {
+    _flagsReg = set ? (_flagsReg | flag) : (_flagsReg & ~flag);
+}
+
+void Emulator::_setNZ(uint8_t value) {
+    _setFlag(_ZF, value == 0);
+    _setFlag(_NF, value & 0x80);
+}
+
+void Emulator::_branch(bool condition) {
+    uint16_t target = _fetchWord();
+    if (condition) _programCounter = target;
+}
+
+void Emulator::_compare(uint8_t reg, AddressingMode mode) {
+    // The ALU's subtractor, the carry flag is its borrow in and takes the borrow out
+    uint8_t value = _operand(mode);
+    int difference = reg - value - (_flagsReg & _CF);
+    _setFlag(_CF, difference < 0);
+    _setNZ(static_cast<uint8_t>(difference));
+}
+
+void Emulator::_modify(AddressingMode mode, uint8_t (Emulator::*operation)(uint8_t)) {
+    // Implied shifts and rotates work on the accumulator
+    if (mode == IMPLIED) {
+        _regA = (this->*operation)(_regA);
+        return;
     }
-    file.seekg(0, std::ios::beg);
 
-    file.read(reinterpret_cast<char*>(&_memory[startAddress]), fileSize);
+    uint16_t address = _address(mode);
+    if (!_reads.empty()) _reads[address]++;
+    _write(address, (this->*operation)(_memory[address]));
+}
+
+void Emulator::_addWithCarry(uint8_t value) {
+    int sum = _regA + value + (_flagsReg & _CF);
+    _setFlag(_CF, sum > 0xff);
+    _setFlag(_VF, ~(_regA ^ value) & (_regA ^ sum) & 0x80);
+    _regA = static_cast<uint8_t>(sum);
+    _setNZ(_regA);
+}
+
+void Emulator::_subtractWithBorrow(uint8_t value) {
+    // Unlike a 6502 the carry is the borrow itself, set when the subtraction went below zero
+    int difference = _regA - value - (_flagsReg & _CF);
+    _setFlag(_CF, difference < 0);
+    _setFlag(_VF, (_regA ^ value) & (_regA ^ difference) & 0x80);
+    _regA = static_cast<uint8_t>(difference);
+    _setNZ(_regA);
+}
+
+uint8_t Emulator::_shiftLeft(uint8_t value) {
+    _setFlag(_CF, value & 0x80);
+    _setNZ(value << 1);
+    return value << 1;
+}
+
+uint8_t Emulator::_shiftRight(uint8_t value) {
+    _setFlag(_CF, value & 0x01);
+    _setNZ(value >> 1);
+    return value >> 1;
 }
 
+uint8_t Emulator::_rotateLeft(uint8_t value) {
+    uint8_t result = (value << 1) | (_flagsReg & _CF);
+    _setFlag(_CF, value & 0x80);
+    _setNZ(result);
+    return result;
+}
+
+uint8_t Emulator::_rotateRight(uint8_t value) {
+    uint8_t result = (value >> 1) | ((_flagsReg & _CF) << 7);
+    _setFlag(_CF, value & 0x01);
+    _setNZ(result);
+    return result;
+}
+
+uint8_t Emulator::_increment(uint8_t value) {
+    _setNZ(value + 1);
+    return value + 1;
+}
+
+uint8_t Emulator::_decrement(uint8_t value) {
+    _setNZ(value - 1);
+    return value - 1;
+}
+
+// Instructions
+
+void Emulator::_nop(AddressingMode mode) {}
+void Emulator::_adc(AddressingMode mode) { _addWithCarry(_operand(mode)); }
+void Emulator::_sub(AddressingMode mode) { _subtractWithBorrow(_operand(mode)); }
+void Emulator::_and(AddressingMode mode) { _regA &= _operand(mode); _setNZ(_regA); }
+void Emulator::_eor(AddressingMode mode) { _regA ^= _operand(mode); _setNZ(_regA); }
+void Emulator::_ora(AddressingMode mode) { _regA |= _operand(mode); _setNZ(_regA); }
+
+void Emulator::_asl(AddressingMode mode) { _modify(mode, &Emulator::_shiftLeft); }
+void Emulator::_lsr(AddressingMode mode) { _modify(mode, &Emulator::_shiftRight); }
+void Emulator::_rol(AddressingMode mode) { _modify(mode, &Emulator::_rotateLeft); }
+void Emulator::_ror(AddressingMode mode) { _modify(mode, &Emulator::_rotateRight); }
+void Emulator::_inc(AddressingMode mode) { _modify(mode, &Emulator::_increment); }
+void Emulator::_dec(AddressingMode mode) { _modify(mode, &Emulator::_decrement); }
+
+void Emulator::_bcc(AddressingMode mode) { _branch(!(_flagsReg & _CF)); }
+void Emulator::_bcs(AddressingMode mode) { _branch(_flagsReg & _CF); }
+void Emulator::_beq(AddressingMode mode) { _branch(_flagsReg & _ZF); }
+void Emulator::_bmi(AddressingMode mode) { _branch(_flagsReg & _NF); }
+void Emulator::_bne(AddressingMode mode) { _branch(!(_flagsReg & _ZF)); }
+void Emulator::_bpl(AddressingMode mode) { _branch(!(_flagsReg & _NF)); }
+void Emulator::_bvc(AddressingMode mode) { _branch(!(_flagsReg & _VF)); }
+void Emulator::_bvs(AddressingMode mode) { _branch(_flagsReg & _VF); }
+
+void Emulator::_bit(AddressingMode mode) {
+    uint8_t value = _operand(mode);
+    _setFlag(_ZF, (_regA & value) == 0);
+    _setFlag(_NF, value & 0x80);
+    _setFlag(_VF, value & 0x40);
+}
+
+void Emulator::_brk(AddressingMode mode) {
+    _push(_programCounter >> 8);
+    _push(_programCounter & 0xff);
+    _push(_flagsReg | _BF);
+    _setFlag(_IF, true);
+    _programCounter = irqVec;
+}
+
+void Emulator::_rti(AddressingMode mode) {
+    _flagsReg = _pull() & ~_BF;
+    uint8_t low = _pull();
+    _programCounter = low | (_pull() << 8);
+}
+
+void Emulator::_jsr(AddressingMode mode) {
+    uint16_t target = _fetchWord();
+    _push(_programCounter >> 8);
+    _push(_programCounter & 0xff);
+    _programCounter = target;
+}
+
+void Emulator::_rts(AddressingMode mode) {
+    uint8_t low = _pull();
+    _programCounter = low | (_pull() << 8);
+}
+
+void Emulator::_jmp(AddressingMode mode) { _programCounter = _address(mode); }
+
+void Emulator::_clc(AddressingMode mode) { _setFlag(_CF, false); }
+void Emulator::_cli(AddressingMode mode) { _setFlag(_IF, false); }
+void Emulator::_clv(AddressingMode mode) { _setFlag(_VF, false); }
+void Emulator::_sec(AddressingMode mode) { _setFlag(_CF, true); }
+void Emulator::_sei(AddressingMode mode) { _setFlag(_IF, true); }
+
+void Emulator::_cmp(AddressingMode mode) { _compare(_regA, mode); }
+void Emulator::_cpx(AddressingMode mode) { _compare(_regX, mode); }
+void Emulator::_cpy(AddressingMode mode) { _compare(_regY, mode); }
+
+void Emulator::_dex(AddressingMode mode) { _setNZ(--_regX); }
+void Emulator::_dey(AddressingMode mode) { _setNZ(--_regY); }
+void Emulator::_inx(AddressingMode mode) { _setNZ(++_regX); }
+void Emulator::_iny(AddressingMode mode) { _setNZ(++_regY); }
+
+void Emulator::_lda(AddressingMode mode) { _regA = _operand(mode); _setNZ(_regA); }
+void Emulator::_ldx(AddressingMode mode) { _regX = _operand(mode); _setNZ(_regX); }
+void Emulator::_ldy(AddressingMode mode) { _regY = _operand(mode); _setNZ(_regY); }
+void Emulator::_sta(AddressingMode mode) { _write(_address(mode), _regA); }
+void Emulator::_stx(AddressingMode mode) { _write(_address(mode), _regX); }
+void Emulator::_sty(AddressingMode mode) { _write(_address(mode), _regY); }
+
+void Emulator::_pha(AddressingMode mode) { _push(_regA); }
+void Emulator::_php(AddressingMode mode) { _push(_flagsReg | _BF); }
+void Emulator::_pla(AddressingMode mode) { _regA = _pull(); _setNZ(_regA); }
+void Emulator::_plp(AddressingMode mode) { _flagsReg = _pull() & ~_BF; }
+
+// Transfers are a register out and a register in on the bus, the flags are not written.
+// tsa's microcode moves X to A, whatever its name says
+void Emulator::_tax(AddressingMode mode) { _regX = _regA; }
+void Emulator::_tay(AddressingMode mode) { _regY = _regA; }
+void Emulator::_tsx(AddressingMode mode) { _regX = _stackPointer; }
+void Emulator::_tsa(AddressingMode mode) { _regA = _regX; }
+void Emulator::_txs(AddressingMode mode) { _stackPointer = _regX; }
+void Emulator::_tya(AddressingMode mode) { _regA = _regY; }
+
+void Emulator::_hlt(AddressingMode mode) { _RUN = false; }
+void Emulator::_out(AddressingMode mode) { _console->put(static_cast<char>(_regA)); }
+
+void Emulator::_illegal(uint8_t instr) {
+    std::cerr << "Error: unknown opcode " << static_cast<int>(instr) << " at " << _describe(_programCounter - 1) << std::endl;
+    _RUN = false;
+}
+
+// Main Functions
+
 void Emulator::emulate() {
+    // Fused runs would step over breakpoints and trace lines, and the profile counts each address
+    if (_fuse && !_trace && _breakpoints.empty() && _profile.empty() && !_mining && _fusion.empty()) _buildFusion();
+
     while (_RUN) {
-        _instrReg = _memory[_memoryAddressReg];
-        _performInstr(_instrReg);
+        uint16_t address = _programCounter;
+
+        if (!_breakpoints.empty() && _breakpoints[address]) {
+            std::cerr << "Breakpoint at " << _describe(address) << std::endl;
+            _printState();
+            break;
+        }
+        if (_trace) _printTrace(address);
+        if (!_profile.empty()) {
+            _profile[address]++;
+            _cycleCount += microcodeCycles(_memory[address], _flagsReg);
+        }
+        if (_mining) _countSequence(address);
+
+        _instrReg = _fetch();
+        _dispatches++;
+
+        int rule = _fusion.empty() ? 0 : _fusion[address];
+        if (rule && (!_instructionLimit || _instructionCount + FUSION_RULES[rule - 1].length <= _instructionLimit)) {
+            (this->*_fusedHandlers[rule - 1])();
+            _fusionHits[rule - 1]++;
+        } else {
+            _performInstr(_instrReg);
+            _instructionCount++;
+        }
+
+        if (_instructionCount == _instructionLimit) break;
     }
+
+    _console->flush();
 }
 
+
+void Emulator::writeFusionRules(const std::string& headerPath) {
+    // Adds this run's counts to the rules already in the header, so several programs can be mined
+    std::map<uint32_t, uint64_t> saved;
+    for (const auto& [key, count] : _sequences) saved[key] += count * ((key >> 24) - 1);
+
+    std::ifstream existing(headerPath);
+    for (std::string line; std::getline(existing, line);) {
+        unsigned length, first, second, third;
+        unsigned long long count;
+        if (std::sscanf(line.c_str(), " {%u, {%i, %i, %i}, %llu}", &length, &first, &second, &third, &count) != 5) continue;
+        saved[length << 24 | first << 16 | second << 8 | third] += count;
+    }
+
+    // A pair that only ever ran inside one of the triples would never fire on its own
+    auto runs = [&](uint32_t key) { return saved[key] / ((key >> 24) - 1); };
+    std::vector<std::pair<uint32_t, uint64_t>> rules;
+    for (const auto& [key, count] : saved) {
+        bool covered = false;
+        for (const auto& [triple, tripleSaved] : saved) {
+            if ((triple >> 24) != 3 || (key >> 24) != 2 || runs(triple) < runs(key)) continue;
+            uint16_t pair = key >> 8 & 0xffff;
+            covered |= (triple >> 8 & 0xffff) == pair || (triple & 0xffff) == pair;
+        }
+        if (!covered) rules.push_back({key, count});
+    }
+    std::stable_sort(rules.begin(), rules.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    if (rules.size() > FUSION_MAX_RULES) rules.resize(FUSION_MAX_RULES);
+
+    std::ofstream header(headerPath);
+    if (!header) {
+        std::cerr << "Error: unable to write fusion rules to '" << headerPath << "'" << std::endl;
+        exit(ERROR);
+    }
+
+    header << "#ifndef FUSION_HPP\n#define FUSION_HPP\n\n"
+           << "// Generated by emulator -F from the instruction runs profiled programs executed most, do not edit\n\n"
+           << "#include <array>\n#include <cstdint>\n\n"
+           << "#define FUSION_MAX_LENGTH   " << FUSION_MAX_LENGTH << "\n\n"
+           << "struct FusionRule {\n    uint8_t length;\n    std::array<uint8_t, FUSION_MAX_LENGTH> opcodes;\n"
+           << "    uint64_t saved;                         // Dispatches the rule saved in the mined runs\n};\n\n"
+           << "constexpr std::array<FusionRule, " << rules.size() << "> FUSION_RULES = {{\n";
+
+    for (const auto& [key, count] : rules) {
+        FusionRule rule = {static_cast<uint8_t>(key >> 24), {static_cast<uint8_t>(key >> 16), static_cast<uint8_t>(key >> 8), static_cast<uint8_t>(key)}, count};
+        char entry[64], row[128];
+        std::snprintf(entry, sizeof(entry), "{%d, {0x%02x, 0x%02x, 0x%02x}, %llu},", rule.length, rule.opcodes[0], rule.opcodes[1], rule.opcodes[2],
+                      static_cast<unsigned long long>(count));
+        std::snprintf(row, sizeof(row), "    %-52s// %s", entry, describeRule(rule).c_str());
+        header << row << "\n";
+    }
+    header << "}};\n\n#endif\n";
+}
@@ -2,12 +2,53 @@
 #define EMULATOR_HPP
 
 #include "main.hpp"
+#include "image.hpp"
+#include "symbols.hpp"
+#include "profile.hpp"
+#include "isa.hpp"
+#include "microcode.hpp"
+#include "fusion.hpp"
+#include "bus.hpp"
+#include "assemble.hpp"
+#include "disasm.hpp"
+
+#include <array>
+#include <utility>
+
+using enum AddressingMode;
 
 class Emulator {
 public:
     Emulator(const std::string& programFile);
+    Emulator(const AssembledProgram& program);
+
+    void loadSymbols(const std::string& symbolFile);
+    void addBreakpoint(const std::string& location);
+    void enableTrace() { _trace = true; }
+    void enableProfile() { _profile.assign(MAX_MEMORY + 1, 0); }
+    void enableAccessProfile() { _reads.assign(MAX_MEMORY + 1, 0); _writes.assign(MAX_MEMORY + 1, 0); }
+    void setInstructionLimit(uint64_t limit) { _instructionLimit = limit; }
+    void disableFusion() { _fuse = false; }
+    void enableFusionMining() { _mining = true; }
+
+    // Multiprocessor, see bus.hpp
+    void attach(Bus* bus, int core, std::ostream* console) { _bus = bus; _core = core; _console = console; }
+    void setConsole(std::ostream* console) { _console = console; }
+
+    // Watch mode, see watch.hpp
+    void patch(uint16_t address, uint8_t value);
+    void setSymbols(const SymbolMap& symbols) { _symbols = symbols; }
+    void restart() { _RUN = true; _programCounter = IMAGE_ROM_START; }
+    void busWrite(uint16_t address, uint8_t value);
+    void interrupt();
+    bool running() const { return _RUN; }
+    uint64_t instructions() const { return _instructionCount; }
 
     void emulate();
+    void printProfile();
+    void printBenchmark(double seconds);
+    void writeAccessProfile(const std::string& profilePath);
+    void writeFusionRules(const std::string& headerPath);
 
 private:
     // Memory
@@ -22,24 +63,172 @@ private:
     uint8_t _instrReg = 0;
     uint8_t _flagsReg = 0;
     uint8_t _stackPointer = 0;
-    uint16_t _memoryAddressReg = 0x4000;
-    uint16_t _programCounter = 0x4001;
+    uint16_t _programCounter = IMAGE_ROM_START;
 
     // Vectors
     const uint16_t irqVec = 0xfffd;
+    const uint16_t stackPage = 0x0100;
 
     // Flags
     const uint8_t _CF  = 0b00000001;        // Carry Flag
     const uint8_t _VF  = 0b00000010;        // Overflow Flag
     const uint8_t _NF  = 0b00000100;        // Negative Flag
     const uint8_t _ZF  = 0b00001000;        // Zero Flag
+    const uint8_t _BF  = 0b00010000;        // Break Flag
     const uint8_t _IF  = 0b00100000;        // Interupt Flag
 
     // Running
     bool _RUN = true;
+    uint64_t _instructionCount = 0;
+    uint64_t _instructionLimit = 0;         // 0 runs until hlt
+    uint64_t _cycleCount = 0;               // Clock cycles from microcode.hpp, counted while profiling
+    uint64_t _dispatches = 0;               // Trips through the run loop, fused runs count once
+
+    // Multiprocessor, null and core 0 when the emulator runs alone
+    Bus* _bus = nullptr;
+    int _core = 0;
+    std::ostream* _console = &std::cout;
+
+    // Debugging, the run loop only indexes flat per-address tables
+    SymbolMap _symbols;
+    bool _trace = false;
+    std::vector<uint8_t> _breakpoints;
+    std::vector<uint64_t> _profile;         // Instructions executed per address, empty when off
+    std::vector<uint64_t> _reads;           // Data reads and writes per address, empty when off
+    std::vector<uint64_t> _writes;
+
+    // Decode table, built from OPCODE_TABLE at compile time in dispatch.cpp
+    typedef void (Emulator::*_Execute)(AddressingMode mode);
+
+    struct _Decoded {
+        _Execute execute;                   // Null for opcodes outside the ISA
+        AddressingMode mode;
+    };
+
+    static const std::array<_Decoded, 256> _decode;
+    static constexpr std::array<_Decoded, 256> _buildDecode();
+
+    // Fusion, runs of instructions from fusion.hpp executed by one handler each. _fusion holds
+    // the rule starting at every address plus one, and is empty when off
+    typedef void (Emulator::*_Fused)();
+
+    bool _fuse = true;
+    std::vector<uint8_t> _fusion;
+    std::vector<uint8_t> _fusedBytes;       // Fused runs decoded from each byte
+    std::vector<uint64_t> _fusionHits;
+
+    static const std::array<_Fused, FUSION_RULES.size()> _fusedHandlers;
+    template <size_t... Rules> static constexpr std::array<_Fused, sizeof...(Rules)> _buildFused(std::index_sequence<Rules...>);
+    template <size_t Rule> void _fusedRun();
+    template <uint8_t Opcode> void _step();
+
+    // Only the last instruction of a run may move the program counter
+    static constexpr bool _endsRun(uint8_t opcode) {
+        std::string_view name = OPCODE_TABLE[opcode].mnemonic;
+        return name.empty() || (name[0] == 'b' && name != "bit") || name == "jmp" || name == "jsr" || name == "rts" || name == "rti" || name == "hlt";
+    }
+
+    // Mining, how often each run of straight line instructions executed
+    bool _mining = false;
+    std::map<uint32_t, uint64_t> _sequences;
+    std::array<uint8_t, FUSION_MAX_LENGTH - 1> _sequence = {};
+    int _sequenceLength = 0;
+    uint16_t _sequenceNext = 0;
 
     // Functions
     void _performInstr(uint8_t instr);
+    void _buildFusion();
+    void _fuseAt(uint16_t address);
+    void _markRun(uint16_t address, int delta);
+    int _matchRule(uint16_t address);
+    void _unfuse(uint16_t address);
+    void _countSequence(uint16_t address);
+    std::string _describe(int address);
+    void _printTrace(uint16_t address);
+    void _printState();
+
+    uint8_t _fetch();
+    uint16_t _fetchWord();
+    uint16_t _readWord(uint16_t address);
+    uint16_t _readPointer(uint16_t address);
+    void _write(uint16_t address, uint8_t value);
+    uint16_t _address(AddressingMode mode);
+    uint8_t _operand(AddressingMode mode);
+    void _push(uint8_t value);
+    uint8_t _pull();
+    void _setNZ(uint8_t value);
+    void _setFlag(uint8_t flag, bool set);
+    void _branch(bool condition);
+    void _compare(uint8_t reg, AddressingMode mode);
+    void _modify(AddressingMode mode, uint8_t (Emulator::*operation)(uint8_t));
+    void _addWithCarry(uint8_t value);
+    void _subtractWithBorrow(uint8_t value);
+
+    uint8_t _shiftLeft(uint8_t value);
+    uint8_t _shiftRight(uint8_t value);
+    uint8_t _rotateLeft(uint8_t value);
+    uint8_t _rotateRight(uint8_t value);
+    uint8_t _increment(uint8_t value);
+    uint8_t _decrement(uint8_t value);
+
+    // Instructions
+    void _nop(AddressingMode mode);
+    void _adc(AddressingMode mode);
+    void _and(AddressingMode mode);
+    void _asl(AddressingMode mode);
+    void _bcc(AddressingMode mode);
+    void _bcs(AddressingMode mode);
+    void _beq(AddressingMode mode);
+    void _bit(AddressingMode mode);
+    void _bmi(AddressingMode mode);
+    void _bne(AddressingMode mode);
+    void _bpl(AddressingMode mode);
+    void _brk(AddressingMode mode);
+    void _bvc(AddressingMode mode);
+    void _bvs(AddressingMode mode);
+    void _clc(AddressingMode mode);
+    void _cli(AddressingMode mode);
+    void _clv(AddressingMode mode);
+    void _cmp(AddressingMode mode);
+    void _cpx(AddressingMode mode);
+    void _cpy(AddressingMode mode);
+    void _dec(AddressingMode mode);
+    void _dex(AddressingMode mode);
+    void _dey(AddressingMode mode);
+    void _eor(AddressingMode mode);
+    void _inc(AddressingMode mode);
+    void _inx(AddressingMode mode);
+    void _iny(AddressingMode mode);
+    void _jmp(AddressingMode mode);
+    void _jsr(AddressingMode mode);
+    void _lda(AddressingMode mode);
+    void _ldx(AddressingMode mode);
+    void _ldy(AddressingMode mode);
+    void _lsr(AddressingMode mode);
+    void _ora(AddressingMode mode);
+    void _pha(AddressingMode mode);
+    void _php(AddressingMode mode);
+    void _pla(AddressingMode mode);
+    void _plp(AddressingMode mode);
+    void _rol(AddressingMode mode);
+    void _ror(AddressingMode mode);
+    void _rti(AddressingMode mode);
+    void _rts(AddressingMode mode);
+    void _sub(AddressingMode mode);
+    void _sec(AddressingMode mode);
+    void _sei(AddressingMode mode);
+    void _sta(AddressingMode mode);
+    void _stx(AddressingMode mode);
+    void _sty(AddressingMode mode);
+    void _tax(AddressingMode mode);
+    void _tay(AddressingMode mode);
+    void _tsx(AddressingMode mode);
+    void _tsa(AddressingMode mode);
+    void _txs(AddressingMode mode);
+    void _tya(AddressingMode mode);
+    void _hlt(AddressingMode mode);
+    void _out(AddressingMode mode);
+    void _illegal(uint8_t instr);
 };
 
-#endif
\ No newline at end of file
+#endif
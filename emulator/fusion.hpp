@@ -0,0 +1,36 @@
+#ifndef FUSION_HPP
+#define FUSION_HPP
+
+// Generated by emulator -F from the instruction runs profiled programs executed most, do not edit
+
+#include <array>
+#include <cstdint>
+
+#define FUSION_MAX_LENGTH   3
+
+struct FusionRule {
+    uint8_t length;
+    std::array<uint8_t, FUSION_MAX_LENGTH> opcodes;
+    uint64_t saved;                         // Dispatches the rule saved in the mined runs
+};
+
+constexpr std::array<FusionRule, 16> FUSION_RULES = {{
+    {3, {0x60, 0xa7, 0x56}, 1099776},                   // lda absolute,X; sta absolute,X; inx
+    {3, {0xa7, 0x56, 0x24}, 1099776},                   // sta absolute,X; inx; bne absolute
+    {2, {0x43, 0x24, 0x00}, 409700},                    // dex; bne absolute
+    {3, {0x60, 0x2c, 0x20}, 102450},                    // lda absolute,X; cmp immediate; beq absolute
+    {3, {0x56, 0x37, 0x24}, 100000},                    // inx; cpx immediate; bne absolute
+    {2, {0x56, 0x58, 0x00}, 49176},                     // inx; jmp absolute
+    {3, {0x66, 0x60, 0xa7}, 4296},                      // ldx immediate; lda absolute,X; sta absolute,X
+    {2, {0x66, 0x60, 0x00}, 4197},                      // ldx immediate; lda absolute,X
+    {3, {0x66, 0x43, 0x24}, 4096},                      // ldx immediate; dex; bne absolute
+    {3, {0x66, 0x60, 0x2c}, 4096},                      // ldx immediate; lda absolute,X; cmp immediate
+    {2, {0x44, 0x24, 0x00}, 2148},                      // dey; bne absolute
+    {3, {0x01, 0xa3, 0x57}, 400},                       // adc immediate; sta zeropage; iny
+    {3, {0x29, 0x01, 0xa3}, 400},                       // clc; adc immediate; sta zeropage
+    {3, {0x57, 0x3a, 0x24}, 400},                       // iny; cpy immediate; bne absolute
+    {3, {0x5c, 0x29, 0x01}, 400},                       // lda zeropage; clc; adc immediate
+    {3, {0x66, 0x56, 0x37}, 400},                       // ldx immediate; inx; cpx immediate
+}};
+
+#endif
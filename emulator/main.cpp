@@ -1,13 +1,179 @@
 #include "main.hpp"
+#include "emulator.hpp"
+#include "watch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+static void usage() {
+    std::cerr << "Usage: ./emulator [-s <symbols.sym>] [-b <label|file:line|$addr>]... [-t] [-p] [-m <profile>] [-n <count>] [-B] [-x] [-F <fusion.hpp>] [-c <cores> [-q <quantum>] [-l]] <filename>" << std::endl;
+    std::cerr << "       ./emulator --asm [-n <count>] [-B] [-x] <source.tasml>..." << std::endl;
+    std::cerr << "       ./emulator --watch [-t] [-x] <source.tasml>" << std::endl;
+    exit(ERROR);
+}
+
+static std::string readProgramSource(const std::string& path) {
+    std::string source;
+    if (!readSource(path, source)) exit(ERROR);
+    return source;
+}
+
+// Many small programs, the way CI runs them: each is assembled and run in memory on one worker
+// per host core, and what it printed is shown in the order they were given
+static void runPrograms(const std::vector<std::string>& sourcePaths, uint64_t limit, bool fuse, bool benchmark) {
+    std::vector<std::ostringstream> outputs(sourcePaths.size());
+    std::atomic<uint64_t> instructions = 0;
+    std::atomic<size_t> nextProgram = 0;
+    size_t workerCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), sourcePaths.size());
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([&]() {
+            for (size_t program = nextProgram++; program < sourcePaths.size(); program = nextProgram++) {
+                Emulator emulator(assembleProgram(readProgramSource(sourcePaths[program]), sourcePaths[program]));
+                emulator.setConsole(&outputs[program]);
+                emulator.setInstructionLimit(limit);
+                if (!fuse) emulator.disableFusion();
+                emulator.emulate();
+                instructions += emulator.instructions();
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (size_t program = 0; program < sourcePaths.size(); program++) {
+        std::cout << "==> " << sourcePaths[program] << " <==" << std::endl;
+        std::cout << outputs[program].str() << std::endl;
+    }
+
+    if (!benchmark) return;
+    char row[96];
+    std::snprintf(row, sizeof(row), "%zu programs, %llu instructions in %.3f s", sourcePaths.size(), static_cast<unsigned long long>(instructions.load()),
+                  elapsed.count());
+    std::cout << "\nBenchmark: " << row << std::endl;
+}
 
 int main(int argc, char* argv[]) {
     // Check if file is provided
-    if (argc != 2) {
-        std::cerr << "Usage: ./emulator <filename>" << std::endl;
+    if (argc < 2) usage();
+
+    std::vector<std::string> programFiles;
+    std::string symbolFile;
+    std::vector<std::string> breakpoints;
+    bool trace = false;
+    bool profile = false;
+    std::string accessProfile;                      // Data reads and writes per address, for tasml -P
+    uint64_t limit = 0;
+    bool benchmark = false;
+    bool fuse = true;
+    std::string fusionRules;                        // Mines the runs this program executes into fusion.hpp
+    int cores = 1;                                  // More than one runs them on a shared bus, see bus.hpp
+    uint64_t quantum = DEFAULT_QUANTUM;
+    bool lockstep = false;
+    bool assemble = false;                          // Programs are .tasml sources, assembled in memory
+    bool watch = false;                             // Patches edits to the source into the running program
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-s" && i + 1 < argc) symbolFile = argv[++i];
+        else if (arg == "-b" && i + 1 < argc) breakpoints.push_back(argv[++i]);
+        else if (arg == "-t") trace = true;
+        else if (arg == "-p") profile = true;
+        else if (arg == "-m" && i + 1 < argc) accessProfile = argv[++i];
+        else if (arg == "-n" && i + 1 < argc) limit = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-B") benchmark = true;
+        else if (arg == "-x") fuse = false;
+        else if (arg == "-F" && i + 1 < argc) fusionRules = argv[++i];
+        else if (arg == "-c" && i + 1 < argc) cores = std::atoi(argv[++i]);
+        else if (arg == "-q" && i + 1 < argc) quantum = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-l") lockstep = true;
+        else if (arg == "--asm") assemble = true;
+        else if (arg == "--watch") assemble = watch = true;
+        else if (arg[0] == '-') usage();
+        else programFiles.push_back(arg);
+    }
+
+    if (programFiles.empty() || (programFiles.size() > 1 && !assemble)) usage();
+    if (assemble && (cores > 1 || !symbolFile.empty())) {
+        std::cerr << "Error: --asm runs one core, with the symbols the assembler made" << std::endl;
         exit(ERROR);
     }
 
-    std::string programFile = argv[1];
+    if (programFiles.size() > 1) {
+        if (trace || profile || !breakpoints.empty() || !accessProfile.empty() || !fusionRules.empty()) {
+            std::cerr << "Error: -t, -b, -p, -m and -F debug a single program, give --asm only one" << std::endl;
+            exit(ERROR);
+        }
+        runPrograms(programFiles, limit, fuse, benchmark);
+        return 0;
+    }
+
+    std::string programFile = programFiles[0];
+    if (watch) {
+        if (profile || limit || !breakpoints.empty() || !accessProfile.empty() || !fusionRules.empty()) {
+            std::cerr << "Error: --watch runs until interrupted, -b, -p, -m, -n and -F need a run that ends" << std::endl;
+            exit(ERROR);
+        }
+
+        AssembledProgram program = assembleProgram(readProgramSource(programFile), programFile);
+        Emulator emulator(program);
+        if (trace) emulator.enableTrace();
+        if (!fuse) emulator.disableFusion();
+
+        Watcher watcher(programFile, emulator, program);
+        watcher.run();
+        return 0;
+    }
+
+    // tasml -g writes the symbol map next to the image
+    if (symbolFile.empty() && !assemble) {
+        std::string candidate = programFile.substr(0, programFile.find_last_of('.')) + ".sym";
+        if (std::ifstream(candidate)) symbolFile = candidate;
+    }
+
+    if (cores < 1 || cores > 0xff || quantum == 0) usage();
+    if (cores > 1) {
+        if (trace || profile || !breakpoints.empty() || !accessProfile.empty() || !fusionRules.empty()) {
+            std::cerr << "Error: -t, -b, -p, -m and -F debug a single core, they can't be used with -c" << std::endl;
+            exit(ERROR);
+        }
+
+        Bus bus(programFile, cores, quantum, lockstep);
+        for (int i = 0; i < cores; i++) {
+            if (!fuse) bus.core(i).disableFusion();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bus.run(limit);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (benchmark) bus.printBenchmark(elapsed.count());
+        return 0;
+    }
+
+    Emulator emulator = assemble ? Emulator(assembleProgram(readProgramSource(programFile), programFile)) : Emulator(programFile);
+    if (!symbolFile.empty()) emulator.loadSymbols(symbolFile);
+    for (const auto& location : breakpoints) emulator.addBreakpoint(location);
+    if (trace) emulator.enableTrace();
+    if (profile) emulator.enableProfile();
+    if (!accessProfile.empty()) emulator.enableAccessProfile();
+    emulator.setInstructionLimit(limit);
+    if (!fuse) emulator.disableFusion();
+    if (!fusionRules.empty()) emulator.enableFusionMining();
+
+    auto start = std::chrono::steady_clock::now();
+    emulator.emulate();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    emulator.printProfile();
+    if (benchmark) emulator.printBenchmark(elapsed.count());
+    if (!accessProfile.empty()) emulator.writeAccessProfile(accessProfile);
+    if (!fusionRules.empty()) emulator.writeFusionRules(fusionRules);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -6,9 +6,15 @@
 #include <vector>
 #include <cstdint>
 #include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
 
 #define ERROR       1
 #define MAX_MEMORY  0xffff
 
+#define FUSION_MAX_RULES    16          // Rules emulator -F keeps in fusion.hpp
+
 
 #endif
\ No newline at end of file
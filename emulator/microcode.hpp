@@ -0,0 +1,373 @@
+#ifndef MICROCODE_HPP
+#define MICROCODE_HPP
+
+// Generated by microcode/mcc from microcode_editor.py, do not edit
+
+#include <array>
+#include <cstdint>
+
+#define MICROCODE_END       0x0000080000         // EP, last step of an instruction
+#define MICROCODE_FLAGS     0x0f                 // Status flags the branches depend on
+
+// Control words of every opcode with all flags clear
+constexpr uint64_t MICROCODE[256][8] = {
+    {0x0000020000, 0x3000000000, 0x00010c0000},                                                                 // 0
+    {0x34e1120800, 0x3500008000, 0x00010c0000},                                                                 // 1
+    {0x30e1031040, 0x24e0103800, 0x35010c8000},                                                                 // 2
+    {0x34ff024c00, 0x0000019040, 0x24e0103800, 0x35010c8000},                                                   // 3
+    {0x34ff024900, 0x0000019040, 0x24e0103800, 0x35010c8000},                                                   // 4
+    {0x30e1000040, 0x3be1021000, 0x24e0103800, 0x35010c8000},                                                   // 5
+    {0x34ff004c04, 0x3be1029044, 0x24e0103800, 0x35010c8000},                                                   // 6
+    {0x34ff004904, 0x3be1029044, 0x24e0103800, 0x35010c8000},                                                   // 7
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e0103800, 0x35010c8000},                       // 8
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e0103800, 0x35010c8000},                       // 9
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x24e0103800, 0x35010c8000},                                     // 10
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x24e0103800, 0x35010c8000},                                     // 11
+    {0x34e3020800, 0x3500008000, 0x00010c0000},                                                                 // 12
+    {0x30e1031040, 0x24e2003800, 0x35010c8000},                                                                 // 13
+    {0x34ff024c00, 0x0000019040, 0x24e2003800, 0x35010c8000},                                                   // 14
+    {0x34ff024900, 0x0000019040, 0x24e2003800, 0x35010c8000},                                                   // 15
+    {0x30e1000040, 0x3be1021000, 0x24e2003800, 0x35010c8000},                                                   // 16
+    {0x34ff004c04, 0x3be1029044, 0x24e2003800, 0x35010c8000},                                                   // 17
+    {0x34ff004904, 0x3be1029044, 0x24e2003800, 0x35010c8000},                                                   // 18
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e2003800, 0x35010c8000},                       // 19
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e2003800, 0x35010c8000},                       // 20
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x24e2003800, 0x35010c8000},                                     // 21
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x24e2003800, 0x35010c8000},                                     // 22
+    {0x340d020000, 0x3500008000, 0x00010c0000},                                                                 // 23
+    {0x30e1030040, 0x2000002000, 0x05e0000000, 0x040c000000, 0x35010c8000},                                     // 24
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x05e0000000, 0x040c000000, 0x35010c8000},                       // 25
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x05e0000000, 0x040c000000, 0x35010c8000},                       // 26
+    {0x30e1000040, 0x3be1020000, 0x2000002000, 0x05e0000000, 0x040c000000, 0x35010c8000},                       // 27
+    {0x34ff004c04, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x040c000000, 0x35010c8000},                       // 28
+    {0x34ff004904, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x040c000000, 0x35010c8000},                       // 29
+    {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000},                                     // 30
+    {0x0001000000, 0x3001020000, 0x30010c0000},                                                                 // 31
+    {0x0001000000, 0x3001020000, 0x30010c0000},                                                                 // 32
+    {0x30e1031040, 0x2ee0003800, 0x30010c0000},                                                                 // 33
+    {0x30e1000040, 0x3be1021000, 0x2ee0003800, 0x30010c0000},                                                   // 34
+    {0x0001000000, 0x3001020000, 0x30010c0000},                                                                 // 35
+    {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000},                                     // 36
+    {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000},                                     // 37
+    {0x235840001e, 0x232040001e, 0x23c040001c, 0x0000a00000, 0x3001020000, 0x3000000000, 0x00010c0000},         // 38
+    {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000},                                     // 39
+    {0x0001000000, 0x3001020000, 0x30010c0000},                                                                 // 40
+    {0x000002000c, 0x3000000000, 0x00010c0000},                                                                 // 41
+    {0x0a00020000, 0x3000000000, 0x00010c0000},                                                                 // 42
+    {0x0000020014, 0x3000000000, 0x00010c0000},                                                                 // 43
+    {0x30f3020800, 0x3000000000, 0x00010c0000},                                                                 // 44
+    {0x30e1031040, 0x20f2003800, 0x30010c0000},                                                                 // 45
+    {0x34ff024c00, 0x0000019040, 0x20f2003800, 0x30010c0000},                                                   // 46
+    {0x34ff024900, 0x0000019040, 0x20f2003800, 0x30010c0000},                                                   // 47
+    {0x30e1000040, 0x3be1021000, 0x20f2003800, 0x30010c0000},                                                   // 48
+    {0x34ff004c04, 0x3be1029044, 0x20f2003800, 0x30010c0000},                                                   // 49
+    {0x34ff004904, 0x3be1029044, 0x20f2003800, 0x30010c0000},                                                   // 50
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x20f2003800, 0x30010c0000},                       // 51
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x20f2003800, 0x30010c0000},                       // 52
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x20f2003800, 0x30010c0000},                                     // 53
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x20f2003800, 0x30010c0000},                                     // 54
+    {0x30f3024c00, 0x3000000000, 0x00010c0000},                                                                 // 55
+    {0x30e1031040, 0x20f2007c00, 0x30010c0000},                                                                 // 56
+    {0x30e1000040, 0x3be1021000, 0x20f2007c00, 0x30010c0000},                                                   // 57
+    {0x30f3024900, 0x3000000000, 0x00010c0000},                                                                 // 58
+    {0x30e1031040, 0x20f2007900, 0x30010c0000},                                                                 // 59
+    {0x30e1000040, 0x3be1021000, 0x20f2007900, 0x30010c0000},                                                   // 60
+    {0x30e1031040, 0x24fc003800, 0x3300008000, 0x00010c0000},                                                   // 61
+    {0x34ff024c00, 0x0000019040, 0x24fc003800, 0x3300008000, 0x00010c0000},                                     // 62
+    {0x34ff024900, 0x0000019040, 0x24fc003800, 0x3300008000, 0x00010c0000},                                     // 63
+    {0x30e1000040, 0x3be1021000, 0x24fc003800, 0x3300008000, 0x00010c0000},                                     // 64
+    {0x34ff004c04, 0x3be1029044, 0x24fc003800, 0x3300008000, 0x00010c0000},                                     // 65
+    {0x34ff004904, 0x3be1029044, 0x24fc003800, 0x3300008000, 0x00010c0000},                                     // 66
+    {0x041c020600, 0x3600008000, 0x00010c0000},                                                                 // 67
+    {0x041c020180, 0x3600008000, 0x00010c0000},                                                                 // 68
+    {0x34e7020800, 0x3500008000, 0x00010c0000},                                                                 // 69
+    {0x30e1031040, 0x24e6003800, 0x35010c8000},                                                                 // 70
+    {0x34ff024c00, 0x0000019040, 0x24e6003800, 0x35010c8000},                                                   // 71
+    {0x34ff024900, 0x0000019040, 0x24e6003800, 0x35010c8000},                                                   // 72
+    {0x30e1000040, 0x3be1021000, 0x24e6003800, 0x35010c8000},                                                   // 73
+    {0x34ff004c04, 0x3be1029044, 0x24e6003800, 0x35010c8000},                                                   // 74
+    {0x34ff004904, 0x3be1029044, 0x24e6003800, 0x35010c8000},                                                   // 75
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e6003800, 0x35010c8000},                       // 76
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e6003800, 0x35010c8000},                       // 77
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x24e6003800, 0x35010c8000},                                     // 78
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x24e6003800, 0x35010c8000},                                     // 79
+    {0x30e1031040, 0x24fa003800, 0x0300008000, 0x3000000000, 0x00010c0000},                                     // 80
+    {0x34ff024c00, 0x0000019040, 0x24fa003800, 0x3300008000, 0x00010c0000},                                     // 81
+    {0x34ff024900, 0x0000019040, 0x24fa003800, 0x3300008000, 0x00010c0000},                                     // 82
+    {0x30e1000040, 0x3be1021000, 0x24fa003800, 0x3300008000, 0x00010c0000},                                     // 83
+    {0x34ff004c04, 0x3be1029044, 0x24fa003800, 0x3301008000, 0x00000c0000},                                     // 84
+    {0x34ff004904, 0x3be1029044, 0x24fa003800, 0x3301008000, 0x00000c0000},                                     // 85
+    {0x041a020600, 0x3600008000, 0x00010c0000},                                                                 // 86
+    {0x041a020180, 0x3700008000, 0x00010c0000},                                                                 // 87
+    {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000},                                     // 88
+    {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x01e1000001, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}, // 89
+    {0x01e0000000, 0x32e1000000, 0x234040001e, 0x232040001e, 0x3d00800000, 0x3d01020000, 0x00010c0000},         // 90
+    {0x35e1020000, 0x3000000018, 0x00010c0000},                                                                 // 91
+    {0x30e1030040, 0x2000002000, 0x35e1000000, 0x00000c0018},                                                   // 92
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x35e1000000, 0x00000c0018},                                     // 93
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x35e1000000, 0x00000c0018},                                     // 94
+    {0x30e1000040, 0x3be1020000, 0x2000002000, 0x35e1000000, 0x00000c0018},                                     // 95
+    {0x34ff004c04, 0x3be1029044, 0x2000003000, 0x35e1000000, 0x00000c0018},                                     // 96
+    {0x34ff004904, 0x3be1029044, 0x2000003000, 0x35e1000000, 0x00000c0018},                                     // 97
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x2000003000, 0x35e1000000, 0x00000c0018},         // 98
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x2000003000, 0x35e1000000, 0x00000c0018},         // 99
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x2000003000, 0x35e1000000, 0x00000c0018},                       // 100
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x2000003000, 0x35e1000000, 0x00000c0018},                       // 101
+    {0x36e1020000, 0x3000004418, 0x00010c0000},                                                                 // 102
+    {0x30e1030040, 0x2000003000, 0x36e1000000, 0x00000c4418},                                                   // 103
+    {0x34ff024900, 0x0000019040, 0x2000003000, 0x36e1000000, 0x00000c4418},                                     // 104
+    {0x30e1000040, 0x3be1020000, 0x2000003000, 0x36e1000000, 0x00000c4418},                                     // 105
+    {0x34ff004904, 0x3be1029044, 0x2000003000, 0x36e1000000, 0x00000c4418},                                     // 106
+    {0x37e1020000, 0x3000004118, 0x00010c0000},                                                                 // 107
+    {0x30e1030040, 0x2000003000, 0x37e1000000, 0x00000c4118},                                                   // 108
+    {0x34ff024c00, 0x0000019040, 0x2000003000, 0x37e1000000, 0x00000c4118},                                     // 109
+    {0x30e1000040, 0x3be1020000, 0x2000003000, 0x37e1000000, 0x00000c4118},                                     // 110
+    {0x34ff004c04, 0x3be1029044, 0x2000003000, 0x37e1000000, 0x00000c4118},                                     // 111
+    {0x340b020000, 0x3500008000, 0x00010c0000},                                                                 // 112
+    {0x30e1030040, 0x2000002000, 0x05e0000000, 0x040a000000, 0x35010c8000},                                     // 113
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x05e0000000, 0x040a000000, 0x35010c8000},                       // 114
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x05e0000000, 0x040a000000, 0x35010c8000},                       // 115
+    {0x30e1000040, 0x3be1020000, 0x2000002000, 0x05e0000000, 0x040a000000, 0x35010c8000},                       // 116
+    {0x34ff004c04, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x040a000000, 0x35010c8000},                       // 117
+    {0x34ff004904, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x040a000000, 0x35010c8000},                       // 118
+    {0x34e5020800, 0x3500008000, 0x00010c0000},                                                                 // 119
+    {0x30e1031040, 0x24e4003800, 0x35010c8000},                                                                 // 120
+    {0x34ff024c00, 0x0000019040, 0x24e4003800, 0x35010c8000},                                                   // 121
+    {0x34ff024900, 0x0000019040, 0x24e4003800, 0x35010c8000},                                                   // 122
+    {0x30e1000040, 0x3be1021000, 0x24e4003800, 0x35010c8000},                                                   // 123
+    {0x34ff004c04, 0x3be1029044, 0x24e4003800, 0x35010c8000},                                                   // 124
+    {0x34ff004904, 0x3be1029044, 0x24e4003800, 0x35010c8000},                                                   // 125
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e4003800, 0x35010c8000},                       // 126
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e4003800, 0x35010c8000},                       // 127
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x24e4003800, 0x35010c8000},                                     // 128
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x24e4003800, 0x35010c8000},                                     // 129
+    {0x0000020000, 0x236040001c, 0x30010c0000},                                                                 // 130
+    {0x0000020000, 0x23c040001c, 0x30010c0000},                                                                 // 131
+    {0x0014420000, 0x200000001c, 0x05e0000000, 0x30010c0000},                                                   // 132
+    {0x0014420000, 0x200000001c, 0x08e0000000, 0x30010c0000},                                                   // 133
+    {0x3411020000, 0x3500008000, 0x00010c0000},                                                                 // 134
+    {0x30e1030040, 0x2000002000, 0x05e0000000, 0x0410000000, 0x35010c8000},                                     // 135
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x05e0000000, 0x0410000000, 0x35010c8000},                       // 136
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x05e0000000, 0x0410000000, 0x35010c8000},                       // 137
+    {0x30e1000040, 0x3be1020000, 0x2000002000, 0x05e0000000, 0x0410000000, 0x35010c8000},                       // 138
+    {0x34ff004c04, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x0410000000, 0x35010c8000},                       // 139
+    {0x34ff004904, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x0410000000, 0x35010c8000},                       // 140
+    {0x340f020000, 0x3500008000, 0x00010c0000},                                                                 // 141
+    {0x30e1030040, 0x2000002000, 0x05e0000000, 0x040e000000, 0x35010c8000},                                     // 142
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x05e0000000, 0x040e000000, 0x35010c8000},                       // 143
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x05e0000000, 0x040e000000, 0x35010c8000},                       // 144
+    {0x30e1000040, 0x3be1020000, 0x2000002000, 0x05e0000000, 0x040e000000, 0x35010c8000},                       // 145
+    {0x34ff004c04, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x040e000000, 0x35010c8000},                       // 146
+    {0x34ff004904, 0x3be1029044, 0x2000002000, 0x05e0000000, 0x040e000000, 0x35010c8000},                       // 147
+    {0x0014401000, 0x28f450101c, 0x21f440001c, 0x22e000001c, 0x0000800000, 0x3a01080008},                       // 148
+    {0x0014401000, 0x28f450101c, 0x21f440001c, 0x22e000001c, 0x0000800000, 0x3a01080000},                       // 149
+    {0x34e9120800, 0x3500008000, 0x00010c0000},                                                                 // 150
+    {0x30e1031040, 0x24e8103800, 0x35010c8000},                                                                 // 151
+    {0x34ff024c00, 0x0000019040, 0x24e8103800, 0x35010c8000},                                                   // 152
+    {0x34ff024900, 0x0000019040, 0x24e8103800, 0x35010c8000},                                                   // 153
+    {0x30e1000040, 0x3be1021000, 0x24e8103800, 0x35010c8000},                                                   // 154
+    {0x34ff004c04, 0x3be1029044, 0x24e8103800, 0x35010c8000},                                                   // 155
+    {0x34ff004904, 0x3be1029044, 0x24e8103800, 0x35010c8000},                                                   // 156
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e8103800, 0x35010c8000},                       // 157
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0001040, 0x24e8103800, 0x35010c8000},                       // 158
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x24e8103800, 0x35010c8000},                                     // 159
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x24e8103800, 0x35010c8000},                                     // 160
+    {0x0f00020000, 0x3000000000, 0x00010c0000},                                                                 // 161
+    {0x0018020000, 0x3000000000, 0x00010c0000},                                                                 // 162
+    {0x30e1030040, 0x2360002000, 0x30010c0000},                                                                 // 163
+    {0x34ff024c00, 0x0000018040, 0x2360002000, 0x30010c0000},                                                   // 164
+    {0x34ff024900, 0x0000018040, 0x2360002000, 0x30010c0000},                                                   // 165
+    {0x30e1000040, 0x3be1020000, 0x2360002000, 0x30010c0000},                                                   // 166
+    {0x34ff004c04, 0x3be1029044, 0x2360003000, 0x30010c0000},                                                   // 167
+    {0x34ff004904, 0x3be1029044, 0x2360003000, 0x30010c0000},                                                   // 168
+    {0x34ff024c00, 0x0000018040, 0x2000002000, 0x00e0000040, 0x2360002000, 0x30010c0000},                       // 169
+    {0x34ff024900, 0x0000018040, 0x2000002000, 0x00e0000040, 0x2360002000, 0x30010c0000},                       // 170
+    {0x30e1031040, 0x24fe007c04, 0x0b00009044, 0x2360002000, 0x30010c0000},                                     // 171
+    {0x30e1031040, 0x24fe007904, 0x0b00009044, 0x2360002000, 0x30010c0000},                                     // 172
+    {0x30e1030040, 0x2300002200, 0x30010c0000},                                                                 // 173
+    {0x34ff024900, 0x0000018040, 0x2300002200, 0x30010c0000},                                                   // 174
+    {0x30e1000040, 0x3be1020000, 0x2300002200, 0x30010c0000},                                                   // 175
+    {0x34ff004904, 0x3be1029044, 0x2300003200, 0x30010c0000},                                                   // 176
+    {0x30e1030040, 0x2300002080, 0x30010c0000},                                                                 // 177
+    {0x34ff024c00, 0x0000018040, 0x2300002080, 0x30010c0000},                                                   // 178
+    {0x30e1000040, 0x3be1020000, 0x2300002080, 0x30010c0000},                                                   // 179
+    {0x34ff004c04, 0x3be1029044, 0x2300003080, 0x30010c0000},                                                   // 180
+    {0x0660020000, 0x3000000000, 0x00010c0000},                                                                 // 181
+    {0x0760020000, 0x3000000000, 0x00010c0000},                                                                 // 182
+    {0x06a0020000, 0x3000000000, 0x00010c0000},                                                                 // 183
+    {0x0500020200, 0x3000000000, 0x00010c0000},                                                                 // 184
+    {0x0900020200, 0x3000000000, 0x00010c0000},                                                                 // 185
+    {0x0500020080, 0x3000000000, 0x00010c0000},                                                                 // 186
+    {0x0000000010},                                                                                             // 187
+    {0x0c60020000, 0x3000000000, 0x00010c0000},                                                                 // 188
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+    {},
+};
+
+struct MicrocodeVariant {
+    uint8_t opcode;
+    uint8_t flags;                          // Status flags & MICROCODE_FLAGS
+    uint64_t steps[8];
+};
+
+// Opcodes whose steps change with the flags, one entry per flag combination that differs
+constexpr MicrocodeVariant MICROCODE_VARIANTS[] = {
+    {30, 0x01, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x01, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {39, 0x02, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x02, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {30, 0x03, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x03, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {39, 0x03, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x03, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x04, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {37, 0x04, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {30, 0x05, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x05, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x05, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {37, 0x05, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {35, 0x06, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {37, 0x06, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {39, 0x06, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x06, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {30, 0x07, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x07, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x07, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {37, 0x07, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {39, 0x07, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x07, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {32, 0x08, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x08, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {30, 0x09, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x09, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {32, 0x09, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x09, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {32, 0x0a, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x0a, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {39, 0x0a, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x0a, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {30, 0x0b, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x0b, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {32, 0x0b, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x0b, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {39, 0x0b, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x0b, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {32, 0x0c, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x0c, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x0c, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {37, 0x0c, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {30, 0x0d, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x0d, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {32, 0x0d, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x0d, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x0d, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {37, 0x0d, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {32, 0x0e, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x0e, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x0e, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {37, 0x0e, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {39, 0x0e, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x0e, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {30, 0x0f, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {31, 0x0f, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {32, 0x0f, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {35, 0x0f, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+    {36, 0x0f, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {37, 0x0f, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {39, 0x0f, {0x0001000000, 0x3001020000, 0x30010c0000}},
+    {40, 0x0f, {0x01e0000000, 0x32e0000001, 0x3d00800001, 0x3000020001, 0x30010c0000}},
+};
+
+constexpr const uint64_t* microcodeSteps(uint8_t opcode, uint8_t flags) {
+    for (const auto& variant : MICROCODE_VARIANTS) {
+        if (variant.opcode == opcode && variant.flags == (flags & MICROCODE_FLAGS)) return variant.steps;
+    }
+    return MICROCODE[opcode];
+}
+
+// Clock cycles per flag combination and opcode: the steps up to the one that ends the
+// instruction, or every step of one that stops the clock instead (hlt)
+constexpr std::array<std::array<uint8_t, 256>, MICROCODE_FLAGS + 1> MICROCODE_CYCLES = [] {
+    std::array<std::array<uint8_t, 256>, MICROCODE_FLAGS + 1> cycles = {};
+    for (int flags = 0; flags <= MICROCODE_FLAGS; flags++) {
+        for (int opcode = 0; opcode < 256; opcode++) {
+            const uint64_t* steps = microcodeSteps(opcode, flags);
+            int used = 0;
+            for (int substep = 0; substep < 8 && !cycles[flags][opcode]; substep++) {
+                if (steps[substep] & MICROCODE_END) cycles[flags][opcode] = substep + 1;
+                else if (steps[substep]) used++;
+            }
+            if (!cycles[flags][opcode]) cycles[flags][opcode] = used;
+        }
+    }
+    return cycles;
+}();
+
+constexpr int microcodeCycles(uint8_t opcode, uint8_t flags) { return MICROCODE_CYCLES[flags & MICROCODE_FLAGS][opcode]; }
+
+#endif
@@ -0,0 +1,152 @@
+#include "watch.hpp"
+#include "emulator.hpp"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <set>
+#include <sstream>
+
+Watcher::Watcher(const std::string& sourcePath, Emulator& emulator, const AssembledProgram& program)
+: _sourcePath(sourcePath), _emulator(emulator), _program(program) {
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify < 0) {
+        std::cerr << "Error: unable to start inotify" << std::endl;
+        exit(ERROR);
+    }
+    _watchSources();
+}
+
+Watcher::~Watcher() {
+    close(_inotify);
+}
+
+// Helper Functions
+
+void Watcher::_watchSources() {
+    // Directories rather than files, editors often save by renaming a new file over the old one
+    for (int watch : _watches) inotify_rm_watch(_inotify, watch);
+    _watches.clear();
+
+    std::set<std::string> directories;
+    for (const auto& source : _program.sources) directories.insert(source.substr(0, source.find_last_of('/')));
+    for (const auto& directory : directories) {
+        int watch = inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (watch < 0) std::cerr << "Warning: unable to watch '" << directory << "'" << std::endl;
+        else _watches.push_back(watch);
+    }
+}
+
+bool Watcher::_edited(bool wait) {
+    struct pollfd ready = {_inotify, POLLIN, 0};
+    if (poll(&ready, 1, wait ? -1 : 0) <= 0) return false;
+
+    std::set<std::string> names;
+    for (const auto& source : _program.sources) names.insert(source.substr(source.find_last_of('/') + 1));
+
+    // Events for other files in the same directories are read and dropped
+    bool edited = false;
+    alignas(struct inotify_event) char buffer[4096];
+    for (ssize_t length; (length = read(_inotify, buffer, sizeof(buffer))) > 0;) {
+        for (ssize_t offset = 0; offset < length;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            if (event->len > 0 && names.count(event->name)) edited = true;
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (edited) _editTime = std::chrono::steady_clock::now();
+    return edited;
+}
+
+bool Watcher::_assemble(AssembledProgram& program) {
+    // The assembler exits on the first error, so a child takes that exit and the run goes on.
+    // Watch mode runs no other threads to be caught mid-lock by the fork.
+    int channel[2];
+    if (pipe(channel) < 0) return false;
+
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(channel[0]);
+        close(channel[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(channel[0]);
+        std::string source;
+        if (!readSource(_sourcePath, source)) _exit(ERROR);
+
+        std::ostringstream out;
+        writeAssembledProgram(out, assembleProgram(source, _sourcePath));
+        const std::string& bytes = out.str();
+        for (size_t sent = 0; sent < bytes.size();) {
+            ssize_t written = write(channel[1], bytes.data() + sent, bytes.size() - sent);
+            if (written <= 0) _exit(ERROR);
+            sent += written;
+        }
+        _exit(0);
+    }
+
+    // Read before waiting, the result is bigger than the pipe holds
+    close(channel[1]);
+    std::string bytes;
+    char buffer[65536];
+    for (ssize_t length; (length = read(channel[0], buffer, sizeof(buffer))) > 0;) bytes.append(buffer, length);
+    close(channel[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+
+    std::istringstream in(bytes);
+    return readAssembledProgram(in, program);
+}
+
+void Watcher::_reload() {
+    AssembledProgram program;
+    if (!_assemble(program)) {
+        std::cerr << "Watch: " << _sourcePath << " did not assemble, still running the old code" << std::endl;
+        return;
+    }
+
+    // Only the ROM; RAM holds the program's data, whatever the source initialises it to
+    int bytes = 0;
+    int ranges = 0;
+    bool previousChanged = false;
+    for (int address = IMAGE_ROM_START; address <= MAX_MEMORY; address++) {
+        bool changed = program.memory[address] != _program.memory[address];
+        if (changed) {
+            _emulator.patch(address, program.memory[address]);
+            bytes++;
+            ranges += !previousChanged;
+        }
+        previousChanged = changed;
+    }
+
+    _emulator.setSymbols(program.symbols);
+    bool includesChanged = program.sources != _program.sources;
+    _program = std::move(program);
+    if (includesChanged) _watchSources();
+    if (bytes > 0 && !_emulator.running()) _emulator.restart();
+
+    std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - _editTime;
+    char report[96];
+    std::snprintf(report, sizeof(report), "patched %d bytes in %d ranges, %.1f ms from edit to running", bytes, ranges, latency.count());
+    std::cerr << "Watch: " << report << std::endl;
+}
+
+// Main Functions
+
+void Watcher::run() {
+    // Until interrupted; a halted program waits for the next edit
+    while (true) {
+        if (_emulator.running()) {
+            _emulator.setInstructionLimit(_emulator.instructions() + WATCH_SLICE);
+            _emulator.emulate();
+        }
+        if (_edited(!_emulator.running())) _reload();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef WATCH_HPP
+#define WATCH_HPP
+
+#include "main.hpp"
+#include "assemble.hpp"
+
+#include <chrono>
+
+class Emulator;
+
+#define WATCH_SLICE     100000              // Instructions run between looks for edits
+
+// Runs a program assembled from source and keeps it running across edits. inotify watches the
+// directories of the source and its includes; on a change the source is assembled again and every
+// ROM byte that came out different is patched into the running emulator. Registers, RAM and the
+// program counter are kept, a halted program starts over at the reset address.
+class Watcher {
+public:
+    Watcher(const std::string& sourcePath, Emulator& emulator, const AssembledProgram& program);
+    ~Watcher();
+
+    void run();
+
+private:
+    std::string _sourcePath;
+    Emulator& _emulator;
+    AssembledProgram _program;
+    int _inotify;
+    std::vector<int> _watches;
+    std::chrono::steady_clock::time_point _editTime;
+
+    void _watchSources();
+    bool _edited(bool wait);
+    bool _assemble(AssembledProgram& program);
+    void _reload();
+};
+
+#endif
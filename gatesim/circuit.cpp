@@ -0,0 +1,175 @@
+#include "circuit.hpp"
+
+#include <cctype>
+
+// Helper Functions
+
+static std::string decodeEntities(const std::string& text) {
+    std::string result;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] != '&') {
+            result += text[i];
+            continue;
+        }
+
+        size_t end = text.find(';', i);
+        if (end == std::string::npos) {
+            result += text[i];
+            continue;
+        }
+
+        std::string entity = text.substr(i + 1, end - i - 1);
+        if (entity == "amp") result += '&';
+        else if (entity == "lt") result += '<';
+        else if (entity == "gt") result += '>';
+        else if (entity == "quot") result += '"';
+        else if (entity == "apos") result += '\'';
+        else if (entity.size() > 1 && entity[0] == '#') result += static_cast<char>(entity[1] == 'x' ? std::stoi(entity.substr(2), nullptr, 16) : std::stoi(entity.substr(1)));
+        else result += "&" + entity + ";";
+        i = end;
+    }
+    return result;
+}
+
+Point parsePoint(const std::string& text) {
+    // (1550,1250)
+    Point point;
+    if (std::sscanf(text.c_str(), " (%d , %d)", &point.x, &point.y) != 2) {
+        std::cerr << "Error: bad location '" << text << "'" << std::endl;
+        exit(ERROR);
+    }
+    return point;
+}
+
+std::string Component::attr(const std::string& key, const std::string& fallback) const {
+    auto it = attrs.find(key);
+    return it == attrs.end() ? fallback : it->second;
+}
+
+int Component::number(const std::string& key, int fallback) const {
+    auto it = attrs.find(key);
+    return it == attrs.end() ? fallback : static_cast<int>(std::strtol(it->second.c_str(), nullptr, 0));
+}
+
+std::string Component::describe() const {
+    return name + "(" + std::to_string(loc.x) + "," + std::to_string(loc.y) + ")";
+}
+
+bool Project::_nextTag(const std::string& text, size_t& pos, _Tag& tag, std::string& before) {
+    while (true) {
+        size_t start = text.find('<', pos);
+        if (start == std::string::npos) return false;
+        before = text.substr(pos, start - pos);
+
+        // Declarations and comments carry nothing we need
+        if (text.compare(start, 2, "<?") == 0 || text.compare(start, 2, "<!") == 0) {
+            size_t end = text.find('>', start);
+            if (end == std::string::npos) return false;
+            pos = end + 1;
+            continue;
+        }
+
+        tag = _Tag();
+        size_t i = start + 1;
+        if (text[i] == '/') {
+            tag.closing = true;
+            i++;
+        }
+        while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) && text[i] != '>' && text[i] != '/') tag.name += text[i++];
+
+        while (i < text.size() && text[i] != '>') {
+            if (text[i] == '/') {
+                tag.empty = true;
+                i++;
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(text[i]))) {
+                i++;
+                continue;
+            }
+
+            size_t equals = text.find('=', i);
+            size_t open = text.find('"', equals);
+            size_t close = text.find('"', open + 1);
+            if (equals == std::string::npos || open == std::string::npos || close == std::string::npos) return false;
+            std::string key = text.substr(i, equals - i);
+            key.erase(std::remove_if(key.begin(), key.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }), key.end());
+            tag.attrs[key] = decodeEntities(text.substr(open + 1, close - open - 1));
+            i = close + 1;
+        }
+
+        pos = i + 1;
+        return i < text.size();
+    }
+}
+
+// Main Functions
+
+void Project::load(const std::string& path) {
+    _path = path;
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Error: unable to open '" << path << "'" << std::endl;
+        exit(ERROR);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    Circuit* circuit = nullptr;
+    Component* component = nullptr;
+    std::string pendingAttr;                // <a name="contents"> holds its value as text
+    size_t pos = 0;
+    _Tag tag;
+    std::string before;
+
+    while (_nextTag(text, pos, tag, before)) {
+        if (tag.closing) {
+            if (tag.name == "a" && component && !pendingAttr.empty()) component->attrs[pendingAttr] = decodeEntities(before);
+            else if (tag.name == "comp") component = nullptr;
+            else if (tag.name == "circuit") circuit = nullptr;
+            pendingAttr.clear();
+            continue;
+        }
+
+        if (tag.name == "main") _main = tag.attrs["name"];
+        else if (tag.name == "circuit") {
+            _circuits.push_back({tag.attrs["name"], {}, {}});
+            circuit = &_circuits.back();
+        }
+        else if (tag.name == "comp" && circuit) {
+            Component comp;
+            comp.name = tag.attrs["name"];
+            comp.library = tag.attrs.count("lib") > 0;
+            comp.loc = parsePoint(tag.attrs["loc"]);
+            circuit->components.push_back(comp);
+            component = tag.empty ? nullptr : &circuit->components.back();
+        }
+        else if (tag.name == "a" && component) {
+            if (tag.attrs.count("val")) component->attrs[tag.attrs["name"]] = tag.attrs["val"];
+            else if (!tag.empty) pendingAttr = tag.attrs["name"];
+        }
+        else if (tag.name == "wire" && circuit) circuit->wires.push_back({parsePoint(tag.attrs["from"]), parsePoint(tag.attrs["to"])});
+    }
+
+    if (_circuits.empty()) {
+        std::cerr << "Error: no circuits in '" << path << "'" << std::endl;
+        exit(ERROR);
+    }
+    if (_main.empty()) _main = _circuits.front().name;
+    if (!find(_main)) {
+        std::cerr << "Error: main circuit '" << _main << "' is missing from '" << path << "'" << std::endl;
+        exit(ERROR);
+    }
+}
+
+const Circuit* Project::find(const std::string& name) const {
+    for (const auto& circuit : _circuits) {
+        if (circuit.name == name) return &circuit;
+    }
+    return nullptr;
+}
+
+const Circuit& Project::top() const {
+    return *find(_main);
+}
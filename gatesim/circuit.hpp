@@ -0,0 +1,64 @@
+#ifndef CIRCUIT_HPP
+#define CIRCUIT_HPP
+
+#include "main.hpp"
+
+// Just enough of the Logisim-evolution .circ format to rebuild the netlist: circuits,
+// their components with attributes, and their wires. Everything is kept in grid units.
+
+struct Point {
+    int x = 0;
+    int y = 0;
+
+    bool operator<(const Point& other) const { return x != other.x ? x < other.x : y < other.y; }
+    bool operator==(const Point& other) const { return x == other.x && y == other.y; }
+};
+
+struct Component {
+    std::string name;                       // "AND Gate", "Register", or the name of a circuit
+    bool library = false;                   // False for instances of circuits in the same file
+    Point loc;
+    std::map<std::string, std::string> attrs;
+
+    std::string attr(const std::string& key, const std::string& fallback) const;
+    int number(const std::string& key, int fallback) const;
+    std::string describe() const;           // "Register(1550,1250)"
+};
+
+struct Wire {
+    Point from;
+    Point to;
+};
+
+struct Circuit {
+    std::string name;
+    std::vector<Component> components;
+    std::vector<Wire> wires;
+};
+
+class Project {
+public:
+    void load(const std::string& path);
+
+    const Circuit* find(const std::string& name) const;
+    const Circuit& top() const;
+    const std::string& path() const { return _path; }
+
+private:
+    std::string _path;
+    std::string _main;
+    std::vector<Circuit> _circuits;
+
+    struct _Tag {
+        std::string name;
+        std::map<std::string, std::string> attrs;
+        bool closing = false;
+        bool empty = false;                 // <a .../>
+    };
+
+    bool _nextTag(const std::string& text, size_t& pos, _Tag& tag, std::string& before);
+};
+
+Point parsePoint(const std::string& text);
+
+#endif
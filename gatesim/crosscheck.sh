@@ -0,0 +1,42 @@
+#!/bin/sh
+# Runs each program on the emulator and on the gate model and compares them instruction by
+# instruction, then checks that both printed "ok". The gate model samples the registers after
+# an instruction's first micro-step, so the flags an instruction sets on its own show up a row
+# early there; they are only compared once the program has halted.
+
+cd "$(dirname "$0")"
+trace=$(mktemp -d) || exit 1
+trap 'rm -rf "$trace"' EXIT
+
+# A X Y SP and the address of every instruction, one per line
+registers='s/.*\(A=.. X=.. Y=..\) SR=.. \(SP=..  \$[0-9a-f]*\)$/\1 \2/p'
+flags='s/.* SR=.\(.\) SP=..  \$[0-9a-f]*$/\1/p'
+
+failed=0
+for source in "$@"; do
+    image=${source%.tasml}.bin
+    ../assembler/tasml "$source" > /dev/null || exit 1
+    ../emulator/emulator -t -x "$image" > "$trace/emulator.out" 2> "$trace/emulator.trace"
+    ./gatesim -n 1000000 -t "$image" > "$trace/gatesim.out" 2> "$trace/gatesim.trace"
+    rm -f "$image"
+
+    sed -n "$registers" "$trace/emulator.trace" > "$trace/emulator.steps"
+    sed -n "$registers" "$trace/gatesim.trace" > "$trace/gatesim.steps"
+
+    if ! grep -q ": halted after" "$trace/gatesim.trace"; then
+        echo "$source: the gate model did not halt"
+    elif ! cmp -s "$trace/emulator.steps" "$trace/gatesim.steps"; then
+        echo "$source: the emulator and the gate model diverge (emulator <, gate model >)"
+        diff "$trace/emulator.steps" "$trace/gatesim.steps" | sed -n '1,5p'
+    elif [ "$(sed -n "$flags" "$trace/emulator.trace" | tail -n 1)" != "$(sed -n "$flags" "$trace/gatesim.trace" | tail -n 1)" ]; then
+        echo "$source: the emulator and the gate model halt with different flags"
+    elif [ "$(cat "$trace/emulator.out")" != "ok" ] || [ "$(cat "$trace/gatesim.out")" != "ok" ]; then
+        echo "$source: failed case $(cat "$trace/emulator.out") on the emulator, $(cat "$trace/gatesim.out") on the gate model"
+    else
+        echo "$source: ok"
+        continue
+    fi
+    failed=1
+done
+
+exit $failed
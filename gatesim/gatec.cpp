@@ -0,0 +1,44 @@
+#include "main.hpp"
+#include "circuit.hpp"
+#include "netlist.hpp"
+#include "writer.hpp"
+
+static void usage() {
+    std::cerr << "Usage: ./gatec [-v] [-o <model.cpp>] <computer.circ>" << std::endl;
+    exit(ERROR);
+}
+
+int main(int argc, char* argv[]) {
+    std::string circuitPath;
+    std::string modelPath = "model.cpp";
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-o" && i + 1 < argc) modelPath = argv[++i];
+        else if (arg == "-v") verbose = true;
+        else if (arg[0] == '-' || !circuitPath.empty()) usage();
+        else circuitPath = arg;
+    }
+
+    if (circuitPath.empty()) usage();
+
+    Project project;
+    project.load(circuitPath);
+
+    Netlist netlist;
+    netlist.build(project);
+    int warnings = netlist.report(verbose);
+
+    ModelWriter writer(netlist);
+    writer.levelize();
+    writer.write(modelPath, circuitPath.substr(circuitPath.find_last_of('/') + 1));
+
+    std::cout << "Netlist: " << netlist.nets << " nets, " << netlist.cells.size() << " cells, " << netlist.flipFlops.size() << " flip-flops, "
+              << netlist.memories.size() << " memories" << std::endl;
+    std::cout << "Levelized: " << writer.levels() << " levels, " << writer.loops() << " combinational loops" << std::endl;
+    if (warnings > 0) std::cout << warnings << " warnings" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "main.hpp"
+#include "machine.hpp"
+#include "image.hpp"
+
+#include <unistd.h>
+
+#define MICROCODE_WORD_BYTES    5
+#define DEFAULT_CYCLE_LIMIT     10000000
+#define PREFETCH_BYTES          2
+
+static void usage() {
+    std::cerr << "Usage: ./gatesim [-u <microcode.bin>] [-n <cycles>] [-t] <program>..." << std::endl;
+    exit(ERROR);
+}
+
+// Helper Functions
+
+// microcode.bin sits at the top of the tree, one up from wherever gatesim was built
+static std::string defaultMicrocodePath() {
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length <= 0 || length == sizeof(path)) return "../microcode.bin";
+
+    std::string executable(path, length);
+    return executable.substr(0, executable.find_last_of('/')) + "/../microcode.bin";
+}
+
+static const SignalSpec& probe(const Machine& machine, const std::string& name) {
+    const SignalSpec* signal = machine.findProbe(name);
+    if (!signal) {
+        std::cerr << "Error: the model has no '" << name << "' probe, was computer.circ changed?" << std::endl;
+        exit(ERROR);
+    }
+    return *signal;
+}
+
+static std::vector<uint64_t> readMicrocode(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: unable to open microcode '" << path << "'" << std::endl;
+        exit(ERROR);
+    }
+
+    std::vector<uint64_t> words;
+    uint8_t bytes[MICROCODE_WORD_BYTES];
+    while (file.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+        uint64_t word = 0;
+        for (int i = MICROCODE_WORD_BYTES - 1; i >= 0; i--) word = (word << 8) | bytes[i];
+        words.push_back(word);
+    }
+    return words;
+}
+
+// The architectural registers, located by where they sit in computer.circ. The status
+// register's four flip-flops hold C, V, N and Z, in the emulator's SR bit order.
+struct Registers {
+    const SignalSpec &a, &x, &y, &sp, &pc, &halt, &start;
+    std::vector<const SignalSpec*> flags;
+
+    Registers(const Machine& m)
+    : a(probe(m, "main/Register(1550,1250)")), x(probe(m, "main/Register(1630,1900)")), y(probe(m, "main/Register(1600,2110)")),
+      sp(probe(m, "main/Register(1750,650)")), pc(probe(m, "main/program_counter(2040,230)/Counter(310,200)")), halt(probe(m, "HLT")),
+      start(probe(m, "START_INSTR")) {
+        for (int y : {340, 520, 710, 850}) flags.push_back(&probe(m, "main/status_register(1170,1760)/D Flip-Flop(320," + std::to_string(y) + ")"));
+    }
+
+    // The program counter runs ahead of the instruction by what the fetch register holds
+    int instruction(const Machine& m, int lane) const { return (m.value(pc, lane) - PREFETCH_BYTES) & 0xffff; }
+
+    std::string describe(const Machine& m, int lane) const {
+        int status = 0;
+        for (size_t i = 0; i < flags.size(); i++) status |= m.value(*flags[i], lane) << i;
+        char state[48];
+        std::snprintf(state, sizeof(state), "A=%02x X=%02x Y=%02x SR=%02x SP=%02x", static_cast<int>(m.value(a, lane)), static_cast<int>(m.value(x, lane)),
+                      static_cast<int>(m.value(y, lane)), status, static_cast<int>(m.value(sp, lane)));
+        return state;
+    }
+};
+
+// Main Functions
+
+int main(int argc, char* argv[]) {
+    std::string microcodePath = defaultMicrocodePath();
+    std::vector<std::string> programs;
+    uint64_t limit = DEFAULT_CYCLE_LIMIT;
+    bool trace = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-u" && i + 1 < argc) microcodePath = argv[++i];
+        else if (arg == "-n" && i + 1 < argc) limit = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-t") trace = true;
+        else if (arg[0] == '-') usage();
+        else programs.push_back(arg);
+    }
+
+    if (programs.empty() || programs.size() > LANES) usage();
+
+    int lanes = programs.size();
+    Machine machine(lanes);
+    Registers registers(machine);
+
+    // Every lane runs the same microcode; each gets its own program in ROM and RAM
+    machine.load(machine.findMemory(18, 38), -1, readMicrocode(microcodePath));
+    int rom = machine.findMemory(16, 8);
+    int ram = machine.findMemory(14, 8);
+    for (int lane = 0; lane < lanes; lane++) {
+        std::vector<uint8_t> memory(IMAGE_MEMORY_SIZE, 0);
+        if (!readImage(programs[lane], memory)) exit(ERROR);
+        machine.load(rom, lane, std::vector<uint64_t>(memory.begin(), memory.end()));
+        machine.load(ram, lane, std::vector<uint64_t>(memory.begin(), memory.begin() + IMAGE_ROM_START));
+    }
+
+    machine.reset();
+
+    std::vector<uint64_t> haltedAt(lanes, 0);
+    int running = lanes;
+    while (running > 0 && machine.cycles() < limit) {
+        machine.cycle();
+
+        for (int lane = 0; lane < lanes; lane++) {
+            if (haltedAt[lane]) continue;
+            if (trace && machine.value(registers.start, lane)) {
+                std::fprintf(stderr, "%2d %8llu  %s  $%04x\n", lane, static_cast<unsigned long long>(machine.cycles()), registers.describe(machine, lane).c_str(),
+                             registers.instruction(machine, lane));
+            }
+            if (machine.value(registers.halt, lane)) {
+                haltedAt[lane] = machine.cycles();
+                running--;
+            }
+        }
+    }
+
+    for (int lane = 0; lane < lanes; lane++) {
+        if (lanes > 1) std::cout << "==> " << programs[lane] << " <==" << std::endl;
+        std::cout << machine.output(lane);
+        if (lanes > 1) std::cout << std::endl;
+
+        std::string status = haltedAt[lane] ? "halted after " + std::to_string(haltedAt[lane]) + " cycles" : "still running after " + std::to_string(machine.cycles()) + " cycles";
+        char pc[8];
+        std::snprintf(pc, sizeof(pc), "$%04x", static_cast<int>(machine.value(registers.pc, lane)));
+        std::cerr << programs[lane] << ": " << status << "  " << registers.describe(machine, lane) << "  PC=" << pc << std::endl;
+    }
+    std::cout.flush();
+
+    if (machine.oscillations() > 0) std::cerr << "Warning: " << machine.oscillations() << " settles did not converge" << std::endl;
+    return 0;
+}
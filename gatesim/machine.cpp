@@ -0,0 +1,203 @@
+#include "machine.hpp"
+
+Machine::Machine(int lanes)
+: _lanes(lanes), _laneMask(lanes >= LANES ? ALL_LANES : (1ull << lanes) - 1), _output(lanes) {
+    _nets.assign(NET_COUNT, 0);
+    _nets[NET_ONE] = ALL_LANES;
+    _next.assign(FLIP_FLOP_COUNT, 0);
+
+    // Memories start with what the circuit saved in them, shared until a lane loads its own
+    _memories.resize(MEMORY_COUNT);
+    for (int m = 0; m < MEMORY_COUNT; m++) {
+        const MemorySpec& spec = MEMORIES[m];
+        std::vector<uint64_t>& words = _memories[m].words;
+        words.assign(1ull << spec.addressWidth, 0);
+
+        size_t address = 0;
+        for (int run = 0; run < spec.runs; run++) {
+            for (uint32_t i = 0; i < spec.contents[run].count && address < words.size(); i++) words[address++] = spec.contents[run].value;
+        }
+    }
+}
+
+// Helper Functions
+
+uint32_t Machine::_gather(const int* nets, int width, int lane) const {
+    uint32_t value = 0;
+    for (int bit = 0; bit < width; bit++) value |= static_cast<uint32_t>((_nets[nets[bit]] >> lane) & 1) << bit;
+    return value;
+}
+
+uint64_t Machine::_read(int memory) {
+    const MemorySpec& spec = MEMORIES[memory];
+    const _Storage& storage = _memories[memory];
+    size_t size = 1ull << spec.addressWidth;
+
+    uint64_t words[LANES];
+    for (int lane = 0; lane < _lanes; lane++) {
+        uint32_t address = _gather(spec.address, spec.addressWidth, lane);
+        words[lane] = storage.words[(storage.perLane ? lane * size : 0) + address];
+    }
+
+    uint64_t changed = 0;
+    for (int bit = 0; bit < spec.dataWidth; bit++) {
+        uint64_t value = 0;
+        for (int lane = 0; lane < _lanes; lane++) value |= ((words[lane] >> bit) & 1) << lane;
+        changed |= value ^ _nets[spec.data[bit]];
+        _nets[spec.data[bit]] = value;
+    }
+    return changed;
+}
+
+uint64_t Machine::_edges() {
+    uint64_t* n = _nets.data();
+    uint64_t changed = 0;
+
+    // Sample every flip-flop before updating any, one's D may be another's Q
+    for (int i = 0; i < FLIP_FLOP_COUNT; i++) {
+        const FlipFlopSpec& ff = FLIP_FLOPS[i];
+        uint64_t clock = n[ff.clock];
+        uint64_t edge = ff.falling ? _flipFlopClocks[i] & ~clock : ~_flipFlopClocks[i] & clock;
+        _flipFlopClocks[i] = clock;
+
+        uint64_t load = edge & n[ff.enable];
+        uint64_t q = (n[ff.q] & ~load) | (n[ff.d] & load);
+        _next[i] = (q & ~n[ff.clear]) | n[ff.preset];
+    }
+
+    for (int m = 0; m < MEMORY_COUNT; m++) {
+        const MemorySpec& spec = MEMORIES[m];
+        if (!spec.input) continue;
+
+        uint64_t clock = n[spec.clock];
+        uint64_t edge = spec.falling ? _memoryClocks[m] & ~clock : ~_memoryClocks[m] & clock;
+        _memoryClocks[m] = clock;
+
+        uint64_t stores = edge & n[spec.store] & _laneMask;
+        if (stores == 0) continue;
+
+        _Storage& storage = _memories[m];
+        if (!storage.perLane) _split(m);
+        for (int lane = 0; lane < _lanes; lane++) {
+            if (!((stores >> lane) & 1)) continue;
+            uint32_t address = _gather(spec.address, spec.addressWidth, lane);
+            storage.words[(static_cast<size_t>(lane) << spec.addressWidth) + address] = _gather(spec.input, spec.dataWidth, lane);
+        }
+        changed |= stores;
+    }
+
+    for (int t = 0; t < TTY_COUNT; t++) {
+        const TtySpec& tty = TTYS[t];
+        uint64_t clock = n[tty.clock];
+        uint64_t writes = ~_ttyClocks[t] & clock & n[tty.enable] & _laneMask;
+        _ttyClocks[t] = clock;
+
+        for (int lane = 0; lane < _lanes; lane++) {
+            if ((writes >> lane) & 1) _output[lane] += static_cast<char>(_gather(tty.data, 7, lane));
+        }
+    }
+
+    for (int i = 0; i < FLIP_FLOP_COUNT; i++) {
+        changed |= _next[i] ^ n[FLIP_FLOPS[i].q];
+        n[FLIP_FLOPS[i].q] = _next[i];
+    }
+    return changed & _laneMask;
+}
+
+void Machine::_split(int memory) {
+    _Storage& storage = _memories[memory];
+    std::vector<uint64_t> shared = storage.words;
+    storage.words.clear();
+    for (int i = 0; i < _lanes; i++) storage.words.insert(storage.words.end(), shared.begin(), shared.end());
+    storage.perLane = true;
+}
+
+void Machine::_settle() {
+    // A clock edge changes state, which can make another edge, until nothing moves
+    for (int pass = 0; pass < MAX_SETTLE; pass++) {
+        _evaluate();
+        if (!_edges()) return;
+    }
+    _oscillations++;
+}
+
+void Machine::_setClocks(uint64_t level) {
+    for (int i = 0; i < CLOCK_COUNT; i++) _nets[CLOCKS[i]] = level;
+}
+
+// Main Functions
+
+int Machine::findMemory(int addressWidth, int dataWidth) const {
+    int found = -1;
+    for (int m = 0; m < MEMORY_COUNT; m++) {
+        if (MEMORIES[m].addressWidth != addressWidth || MEMORIES[m].dataWidth != dataWidth) continue;
+        if (found >= 0) {
+            std::cerr << "Error: more than one " << addressWidth << "x" << dataWidth << " memory in the model" << std::endl;
+            exit(ERROR);
+        }
+        found = m;
+    }
+    if (found < 0) {
+        std::cerr << "Error: no " << addressWidth << "x" << dataWidth << " memory in the model" << std::endl;
+        exit(ERROR);
+    }
+    return found;
+}
+
+const SignalSpec* Machine::findProbe(const std::string& name) const {
+    for (int i = 0; i < PROBE_COUNT; i++) {
+        if (name == PROBES[i].name) return &PROBES[i];
+    }
+    return nullptr;
+}
+
+void Machine::load(int memory, int lane, const std::vector<uint64_t>& words) {
+    // Lane -1 loads every lane. A lane of its own first copies the shared contents to all
+    _Storage& storage = _memories[memory];
+    size_t size = 1ull << MEMORIES[memory].addressWidth;
+
+    if (lane >= 0 && !storage.perLane) _split(memory);
+
+    for (int i = 0; i < _lanes; i++) {
+        if (lane >= 0 && i != lane) continue;
+        size_t base = storage.perLane ? i * size : 0;
+        for (size_t address = 0; address < words.size() && address < size; address++) storage.words[base + address] = words[address];
+        if (!storage.perLane) break;
+    }
+}
+
+void Machine::reset() {
+    // Hold the power-on reset through a settle, so every asynchronous clear takes effect, and a
+    // few clock periods
+    _flipFlopClocks.assign(FLIP_FLOP_COUNT, 0);
+    _memoryClocks.assign(MEMORY_COUNT, 0);
+    _ttyClocks.assign(TTY_COUNT, 0);
+
+    for (int i = 0; i < RESET_COUNT; i++) _nets[RESETS[i]] = ALL_LANES;
+    _evaluate();
+    for (int i = 0; i < FLIP_FLOP_COUNT; i++) _flipFlopClocks[i] = _nets[FLIP_FLOPS[i].clock];
+    for (int m = 0; m < MEMORY_COUNT; m++) _memoryClocks[m] = _nets[MEMORIES[m].clock];
+    for (int t = 0; t < TTY_COUNT; t++) _ttyClocks[t] = _nets[TTYS[t].clock];
+    _settle();
+
+    // Registers that load a reset value, like the address register, need clock edges for it
+    for (int i = 0; i < RESET_CYCLES; i++) cycle();
+
+    for (int i = 0; i < RESET_COUNT; i++) _nets[RESETS[i]] = 0;
+    _settle();
+    _cycles = 0;
+}
+
+void Machine::cycle() {
+    _setClocks(ALL_LANES);
+    _settle();
+    _setClocks(0);
+    _settle();
+    _cycles++;
+}
+
+uint64_t Machine::value(const SignalSpec& signal, int lane) const {
+    uint64_t value = 0;
+    for (int bit = 0; bit < signal.width; bit++) value |= ((_nets[signal.nets[bit]] >> lane) & 1) << bit;
+    return value;
+}
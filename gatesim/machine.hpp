@@ -0,0 +1,52 @@
+#ifndef MACHINE_HPP
+#define MACHINE_HPP
+
+#include "main.hpp"
+#include "model.hpp"
+
+// Runs the model gatec generated: up to 64 copies of the computer side by side, one per bit of
+// every net. All lanes share the clocks; each has its own RAM and may have its own program.
+class Machine {
+public:
+    Machine(int lanes);
+
+    int findMemory(int addressWidth, int dataWidth) const;
+    const SignalSpec* findProbe(const std::string& name) const;
+    void load(int memory, int lane, const std::vector<uint64_t>& words);
+
+    void reset();
+    void cycle();                           // One full clock period, high then low
+    uint64_t value(const SignalSpec& signal, int lane) const;
+
+    uint64_t cycles() const { return _cycles; }
+    uint64_t oscillations() const { return _oscillations; }
+    const std::string& output(int lane) const { return _output[lane]; }
+
+private:
+    int _lanes;
+    uint64_t _laneMask;
+    std::vector<uint64_t> _nets;
+    std::vector<uint64_t> _next;            // Flip-flop states sampled before any of them change
+    std::vector<uint64_t> _flipFlopClocks;  // Clock level each edge detector saw last
+    std::vector<uint64_t> _memoryClocks;
+    std::vector<uint64_t> _ttyClocks;
+    uint64_t _cycles = 0;
+    uint64_t _oscillations = 0;
+    std::vector<std::string> _output;       // What each lane wrote to the TTY
+
+    struct _Storage {
+        std::vector<uint64_t> words;
+        bool perLane = false;
+    };
+    std::vector<_Storage> _memories;
+
+    void _evaluate();                       // Generated into model.cpp
+    uint64_t _read(int memory);
+    uint64_t _edges();
+    void _split(int memory);                // Gives every lane its own copy of a shared memory
+    void _settle();
+    void _setClocks(uint64_t level);
+    uint32_t _gather(const int* nets, int width, int lane) const;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#define ERROR           1
+
+// Nets hold one bit for each of 64 machines simulated side by side
+#define LANES           64
+#define ALL_LANES       (~0ull)
+
+// Nets 0 and 1 are the constants every undriven input falls back to
+#define NET_ZERO        0
+#define NET_ONE         1
+
+#define MAX_SETTLE      64                  // Passes before a combinational loop counts as oscillating
+#define RESET_CYCLES    4                   // Clock periods the power-on reset is held for
+
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MODEL_HPP
+#define MODEL_HPP
+
+#include <cstdint>
+
+// Tables gatec writes into model.cpp next to the levelized evaluation code. Everything refers
+// to nets by index; each net is a 64 bit word holding that bit for every lane.
+
+struct FlipFlopSpec {
+    int d, clock, enable, clear, preset, q;
+    bool falling;
+};
+
+struct MemoryRun {
+    uint32_t count;
+    uint64_t value;
+};
+
+struct MemorySpec {
+    const char* name;
+    int addressWidth, dataWidth;
+    const int* address;
+    const int* data;                        // Nets the read port writes
+    const int* input;                       // Null for ROMs
+    int store, clock;
+    bool falling;
+    const MemoryRun* contents;              // Saved in the circuit, run-length encoded
+    int runs;
+};
+
+struct TtySpec {
+    const int* data;                        // 7 bits of ASCII
+    int clock, enable, clear;
+};
+
+struct SignalSpec {
+    const char* name;
+    int width;
+    const int* nets;
+};
+
+extern const int NET_COUNT;
+extern const FlipFlopSpec FLIP_FLOPS[];
+extern const int FLIP_FLOP_COUNT;
+extern const MemorySpec MEMORIES[];
+extern const int MEMORY_COUNT;
+extern const TtySpec TTYS[];
+extern const int TTY_COUNT;
+extern const SignalSpec INPUTS[];
+extern const int INPUT_COUNT;
+extern const SignalSpec PROBES[];
+extern const int PROBE_COUNT;
+extern const int CLOCKS[];
+extern const int CLOCK_COUNT;
+extern const int RESETS[];
+extern const int RESET_COUNT;
+
+#endif
@@ -0,0 +1,802 @@
+#include "netlist.hpp"
+
+#include <set>
+
+#define MAX_DEPTH           16              // Subcircuit nesting, deeper means a circuit contains itself
+#define DIAGNOSTICS_SHOWN   20
+#define BOX_WIDTH           220             // Fixed size evolution box, inputs sit this far left of the outputs
+#define PIN_SPACING         20
+
+// Helper Functions
+
+static Point rotate(const std::string& facing, int dx, int dy) {
+    // Offsets are given for a component facing east
+    if (facing == "west") return {-dx, -dy};
+    if (facing == "north") return {dy, -dx};
+    if (facing == "south") return {-dy, dx};
+    return {dx, dy};
+}
+
+static std::vector<int> gateInputOffsets(int inputs, int size) {
+    // Logisim spreads the inputs of wide gates apart and leaves a gap in the middle of even counts
+    int start, step, skip;
+    if (inputs <= 3) {
+        if (size < 40) start = -5, step = 10, skip = 10;
+        else if (size < 60 || inputs <= 2) start = -10, step = 20, skip = 20;
+        else start = -15, step = 30, skip = 30;
+    }
+    else if (inputs == 4 && size >= 60) start = -5, step = 20, skip = 0;
+    else start = -5, step = 10, skip = 10;
+
+    std::vector<int> offsets;
+    for (int i = 0; i < inputs; i++) {
+        if (inputs & 1) offsets.push_back(start * (inputs - 1) + step * i);
+        else offsets.push_back(start * inputs + step * i + (i >= inputs / 2 ? skip : 0));
+    }
+    return offsets;
+}
+
+static int bitsFor(int values) {
+    int bits = 1;
+    while ((1 << bits) < values) bits++;
+    return bits;
+}
+
+static std::vector<int> splitterEnds(const Component& component) {
+    // End each combined bit leaves on, -1 when it leaves on none
+    int fanout = component.number("fanout", 2);
+    int incoming = component.number("incoming", fanout);
+    std::vector<int> ends(incoming);
+
+    int base = incoming / fanout;
+    int extra = incoming % fanout;
+    for (int bit = 0, end = 0, used = 0; bit < incoming; bit++) {
+        ends[bit] = end;
+        if (++used == base + (end < extra ? 1 : 0)) end++, used = 0;
+    }
+
+    for (int bit = 0; bit < incoming; bit++) {
+        std::string mapping = component.attr("bit" + std::to_string(bit), "");
+        if (mapping == "none") ends[bit] = -1;
+        else if (!mapping.empty()) ends[bit] = std::atoi(mapping.c_str());
+    }
+    return ends;
+}
+
+static std::vector<std::pair<uint32_t, uint64_t>> parseContents(const std::string& text, int addressWidth, int dataWidth, const std::string& name) {
+    // addr/data: 18 38
+    // 20000 3000000000 10c0000 5*0 ...
+    std::vector<std::pair<uint32_t, uint64_t>> runs;
+    if (text.empty()) return runs;
+
+    std::istringstream stream(text);
+    std::string header;
+    int addressBits = 0, dataBits = 0;
+    stream >> header >> addressBits >> dataBits;
+    if (header != "addr/data:" || addressBits != addressWidth || dataBits != dataWidth) {
+        std::cerr << "Error: " << name << ": contents do not match its " << addressWidth << "x" << dataWidth << " size" << std::endl;
+        exit(ERROR);
+    }
+
+    std::string token;
+    while (stream >> token) {
+        size_t star = token.find('*');
+        uint32_t count = star == std::string::npos ? 1 : std::strtoul(token.c_str(), nullptr, 10);
+        uint64_t value = std::strtoull(token.c_str() + (star == std::string::npos ? 0 : star + 1), nullptr, 16);
+
+        if (!runs.empty() && runs.back().second == value) runs.back().first += count;
+        else runs.push_back({count, value});
+    }
+    return runs;
+}
+
+int Netlist::_node() {
+    _parent.push_back(_parent.size());
+    return _parent.size() - 1;
+}
+
+int Netlist::_find(int node) {
+    while (_parent[node] != node) {
+        _parent[node] = _parent[_parent[node]];
+        node = _parent[node];
+    }
+    return node;
+}
+
+void Netlist::_join(int a, int b) {
+    _parent[_find(a)] = _find(b);
+}
+
+std::vector<int> Netlist::_pinOrder(const Circuit& circuit) {
+    // Inputs down the left of the box then outputs down the right, each top to bottom
+    std::vector<int> inputs, outputs;
+    for (size_t i = 0; i < circuit.components.size(); i++) {
+        const Component& component = circuit.components[i];
+        if (component.name != "Pin" || !component.library) continue;
+        (component.attr("output", "false") == "true" ? outputs : inputs).push_back(i);
+    }
+
+    auto byPosition = [&](int a, int b) {
+        const Point& pa = circuit.components[a].loc;
+        const Point& pb = circuit.components[b].loc;
+        return pa.y != pb.y ? pa.y < pb.y : pa.x < pb.x;
+    };
+    std::stable_sort(inputs.begin(), inputs.end(), byPosition);
+    std::stable_sort(outputs.begin(), outputs.end(), byPosition);
+
+    inputs.insert(inputs.end(), outputs.begin(), outputs.end());
+    return inputs;
+}
+
+std::vector<Netlist::_Port> Netlist::_ports(const Component& component) {
+    const std::string& name = component.name;
+    std::string facing = component.attr("facing", "east");
+    int width = component.number("width", 1);
+    std::vector<_Port> ports;
+
+    auto add = [&](int dx, int dy, int bits, _Direction direction) { ports.push_back({rotate(facing, dx, dy), bits, direction}); };
+    auto unsupported = [&](const std::string& what) {
+        std::cerr << "Error: " << component.describe() << ": unsupported " << what << std::endl;
+        exit(ERROR);
+    };
+
+    if (!component.library) {
+        const Circuit* circuit = _project->find(name);
+        if (!circuit) unsupported("component '" + name + "'");
+
+        std::vector<int> order = _pinOrder(*circuit);
+        int inputs = 0, outputs = 0;
+        for (int index : order) {
+            const Component& pin = circuit->components[index];
+            if (pin.attr("output", "false") == "true") add(0, PIN_SPACING * outputs++, pin.number("width", 1), PORT_JOIN);
+            else add(-BOX_WIDTH, PIN_SPACING * inputs++, pin.number("width", 1), PORT_JOIN);
+        }
+        if (outputs == 0 && inputs > 0) unsupported("subcircuit without outputs");
+    }
+    else if (name == "Tunnel" || name == "Pin") add(0, 0, width, PORT_JOIN);
+    else if (name == "Constant" || name == "Clock" || name == "POR") add(0, 0, width, PORT_OUT);
+    else if (name == "Pull Resistor") add(0, 0, 0, PORT_IN);
+    else if (name == "Splitter") {
+        int fanout = component.number("fanout", 2);
+        std::string appear = component.attr("appear", "left");
+        int justify = appear == "center" || appear == "legacy" ? 0 : appear == "right" ? 1 : -1;
+        std::vector<int> ends = splitterEnds(component);
+
+        ports.push_back({{0, 0}, static_cast<int>(ends.size()), PORT_JOIN});
+        for (int end = 0; end < fanout; end++) {
+            int bits = std::count(ends.begin(), ends.end(), end);
+            Point at;
+            if (facing == "north" || facing == "south") {
+                int m = facing == "north" ? 1 : -1;
+                int dx = justify == 0 ? 10 * ((fanout + 1) / 2 - 1) : m * justify < 0 ? -10 : 10 * fanout;
+                at = {dx - 10 * end, -m * 20};
+            }
+            else {
+                int m = facing == "west" ? -1 : 1;
+                int dy = justify == 0 ? -10 * (fanout / 2) : m * justify > 0 ? -10 * fanout : 10;
+                at = {m * 20, dy + 10 * end};
+            }
+            ports.push_back({at, bits, PORT_JOIN});
+        }
+    }
+    else if (name == "AND Gate" || name == "OR Gate" || name == "NAND Gate" || name == "NOR Gate" || name == "XOR Gate" || name == "XNOR Gate") {
+        int size = component.number("size", 50);
+        int depth = size + (name[0] == 'X' ? 10 : 0) + (name[0] == 'N' || name == "XNOR Gate" ? 10 : 0);
+
+        add(0, 0, width, PORT_OUT);
+        for (int dy : gateInputOffsets(component.number("inputs", 2), size)) add(-depth, dy, width, PORT_IN);
+    }
+    else if (name == "NOT Gate") {
+        add(0, 0, width, PORT_OUT);
+        add(-component.number("size", 30), 0, width, PORT_IN);
+    }
+    else if (name == "Controlled Buffer") {
+        add(0, 0, width, PORT_OUT);
+        add(-20, 0, width, PORT_IN);
+        add(-10, component.attr("control", "right") == "left" ? -10 : 10, 1, PORT_IN);
+    }
+    else if (name == "Multiplexer" || name == "Demultiplexer") {
+        if (component.number("select", 1) != 1) unsupported("select width");
+        int side = component.attr("selloc", "bl") == "bl" ? 1 : -1;
+        int flow = name == "Multiplexer" ? -1 : 1;          // Inputs behind a mux, outputs ahead of a demux
+
+        // The select sits on the same side of the body whichever way it faces
+        _Direction ends = name == "Multiplexer" ? PORT_IN : PORT_OUT;
+        ports.push_back({{0, 0}, width, name == "Multiplexer" ? PORT_OUT : PORT_IN});
+        if (facing == "north" || facing == "south") {
+            int m = (facing == "south" ? 1 : -1) * flow;
+            ports.push_back({{-10, 30 * m}, width, ends});
+            ports.push_back({{10, 30 * m}, width, ends});
+            ports.push_back({{-20 * side, 20 * m}, 1, PORT_IN});
+        }
+        else {
+            int m = (facing == "west" ? -1 : 1) * flow;
+            ports.push_back({{30 * m, -10}, width, ends});
+            ports.push_back({{30 * m, 10}, width, ends});
+            ports.push_back({{20 * m, 20 * side}, 1, PORT_IN});
+        }
+    }
+    else if (name == "Decoder") {
+        int select = component.number("select", 1);
+        if (facing != "north" && facing != "south") unsupported("facing");
+
+        ports.push_back({{0, 0}, select, PORT_IN});
+        for (int output = 0; output < (1 << select); output++) ports.push_back({{10 * output, facing == "south" ? 20 : -20}, 1, PORT_OUT});
+    }
+    else if (name == "BitSelector") {
+        int dataWidth = component.number("width", 8);
+        int group = component.number("group", 1);
+        int groups = (dataWidth + group - 1) / group;
+
+        add(0, 0, group, PORT_OUT);
+        add(-30, 0, dataWidth, PORT_IN);
+        add(-10, component.attr("selloc", "bl") == "tr" ? -10 : 10, groups > 1 ? bitsFor(groups) : 1, PORT_IN);
+    }
+    else if (name == "Adder" || name == "Subtractor") {
+        width = component.number("width", 8);
+        add(0, 0, width, PORT_OUT);
+        add(-40, -10, width, PORT_IN);
+        add(-40, 10, width, PORT_IN);
+        add(-20, -20, 1, PORT_IN);
+        add(-20, 20, 1, PORT_OUT);
+    }
+    else if (name == "Bit Extender") {
+        add(0, 0, component.number("out_width", 16), PORT_OUT);
+        add(-40, 0, component.number("in_width", 8), PORT_IN);
+        if (component.attr("type", "zero") == "input") add(-20, -20, 1, PORT_IN);
+    }
+    else if (name == "Register") {
+        if (component.attr("appearance", "") != "logisim_evolution") unsupported("appearance");
+        width = component.number("width", 8);
+        ports.push_back({{0, 30}, width, PORT_IN});         // D
+        ports.push_back({{0, 50}, 1, PORT_IN});             // Enable
+        ports.push_back({{0, 70}, 1, PORT_IN});             // Clock
+        ports.push_back({{60, 30}, width, PORT_OUT});       // Q
+        ports.push_back({{30, 90}, 1, PORT_IN});            // Clear
+    }
+    else if (name == "D Flip-Flop") {
+        if (component.attr("appearance", "") != "logisim_evolution") unsupported("appearance");
+        ports.push_back({{-10, 10}, 1, PORT_IN});           // D
+        ports.push_back({{-10, 50}, 1, PORT_IN});           // Clock
+        ports.push_back({{50, 10}, 1, PORT_OUT});           // Q
+        ports.push_back({{50, 50}, 1, PORT_OUT});           // Q'
+        ports.push_back({{20, 60}, 1, PORT_IN});            // Reset
+        ports.push_back({{20, 0}, 1, PORT_IN});             // Set
+    }
+    else if (name == "Counter") {
+        width = component.number("width", 8);
+        if (component.attr("appearance", "") == "classic") {
+            ports.push_back({{0, 0}, width, PORT_OUT});
+            ports.push_back({{-30, 0}, width, PORT_IN});    // Load value
+            ports.push_back({{-20, 20}, 1, PORT_IN});       // Clock
+            ports.push_back({{-10, 20}, 1, PORT_IN});       // Clear
+            ports.push_back({{-30, -10}, 1, PORT_IN});      // Load
+            ports.push_back({{-20, -20}, 1, PORT_IN});      // Up/down
+            ports.push_back({{-30, 10}, 1, PORT_IN});       // Count enable
+            ports.push_back({{0, 10}, 1, PORT_OUT});        // Carry
+        }
+        else {
+            // The evolution box widens every five bits. Its load value, count enable and carry
+            // are left unconnected in every counter computer.circ uses, so only these are known
+            ports.push_back({{180 + 10 * ((width - 1) / 5), 110}, width, PORT_OUT});
+            ports.push_back({{0, 80}, 1, PORT_IN});
+            ports.push_back({{0, 20}, 1, PORT_IN});
+            ports.push_back({{0, 30}, 1, PORT_IN});
+            ports.push_back({{0, 50}, 1, PORT_IN});
+        }
+    }
+    else if (name == "ROM" || name == "RAM") {
+        if (component.attr("appearance", "") != "logisim_evolution") unsupported("appearance");
+        int addressWidth = component.number("addrWidth", 8);
+        int dataWidth = component.number("dataWidth", 8);
+
+        ports.push_back({{0, 10}, addressWidth, PORT_IN});
+        if (name == "ROM") ports.push_back({{240, 60}, dataWidth, PORT_OUT});
+        else {
+            if (component.attr("databus", "") != "bidir") unsupported("data bus");
+            ports.push_back({{0, 50}, 1, PORT_IN});         // Store
+            ports.push_back({{0, 60}, 1, PORT_IN});         // Output enable
+            ports.push_back({{0, 70}, 1, PORT_IN});         // Clock
+            ports.push_back({{250, 90}, dataWidth, PORT_INOUT});
+        }
+    }
+    else if (name == "TTY") {
+        ports.push_back({{0, -10}, 7, PORT_IN});
+        ports.push_back({{0, 0}, 1, PORT_IN});              // Clock
+        ports.push_back({{10, 10}, 1, PORT_IN});            // Write enable
+        ports.push_back({{20, 10}, 1, PORT_IN});            // Clear
+    }
+    else if (name != "Text" && name != "LedBar" && name != "RGB Video" && name != "Probe") unsupported("component");
+
+    return ports;
+}
+
+void Netlist::_checkWires(const Circuit& circuit, const std::vector<std::pair<const Component*, std::vector<_Port>>>& placed) {
+    // A port in the middle of a wire is not joined to it, which is easy to misplace by 10
+    std::set<Point> ends;
+    for (const auto& wire : circuit.wires) {
+        ends.insert(wire.from);
+        ends.insert(wire.to);
+    }
+
+    for (const auto& [component, ports] : placed) {
+        for (size_t i = 0; i < ports.size(); i++) {
+            Point at = ports[i].at;
+            if (ends.count(at)) continue;
+
+            for (const auto& wire : circuit.wires) {
+                bool vertical = wire.from.x == wire.to.x && wire.from.x == at.x && std::min(wire.from.y, wire.to.y) < at.y && at.y < std::max(wire.from.y, wire.to.y);
+                bool horizontal = wire.from.y == wire.to.y && wire.from.y == at.y && std::min(wire.from.x, wire.to.x) < at.x && at.x < std::max(wire.from.x, wire.to.x);
+                if (!vertical && !horizontal) continue;
+
+                _diagnostics.push_back(circuit.name + ": " + component->describe() + " port " + std::to_string(i) + " lies on a wire without joining it");
+                break;
+            }
+        }
+    }
+}
+
+std::vector<std::vector<int>> Netlist::_instantiate(const Circuit& circuit, const std::string& path, int depth) {
+    if (depth > MAX_DEPTH) {
+        std::cerr << "Error: " << path << ": subcircuits nest too deep" << std::endl;
+        exit(ERROR);
+    }
+    bool diagnose = std::find(_checked.begin(), _checked.end(), circuit.name) == _checked.end();
+    if (diagnose) _checked.push_back(circuit.name);
+
+    // Points joined by wires and by tunnel labels form the circuit's nets
+    std::map<Point, int> points;
+    std::map<std::string, int> labels;
+    std::vector<int> parent;
+    std::vector<int> uses;
+
+    auto id = [&](const Point& point) {
+        auto [it, added] = points.insert({point, static_cast<int>(parent.size())});
+        if (added) {
+            parent.push_back(parent.size());
+            uses.push_back(0);
+        }
+        return it->second;
+    };
+    auto find = [&](int node) {
+        while (parent[node] != node) node = parent[node] = parent[parent[node]];
+        return node;
+    };
+
+    for (const auto& wire : circuit.wires) {
+        int from = id(wire.from), to = id(wire.to);
+        uses[from]++;
+        uses[to]++;
+        parent[find(from)] = find(to);
+    }
+
+    std::vector<std::pair<const Component*, std::vector<_Port>>> placed;
+    for (const auto& component : circuit.components) {
+        std::vector<_Port> ports = _ports(component);
+        for (auto& port : ports) {
+            port.at = {component.loc.x + port.at.x, component.loc.y + port.at.y};
+            uses[id(port.at)]++;
+        }
+
+        if (component.name == "Tunnel" && component.library) {
+            std::string label = component.attr("label", "");
+            auto [it, added] = labels.insert({label, static_cast<int>(parent.size())});
+            if (added) {
+                parent.push_back(parent.size());
+                uses.push_back(0);
+            }
+            uses[it->second]++;
+            parent[find(id(ports[0].at))] = find(it->second);
+        }
+        placed.push_back({&component, ports});
+    }
+    if (diagnose) _checkWires(circuit, placed);
+
+    // Widths come from the ports on each net, they must all agree
+    std::map<int, int> widths;
+    std::map<int, int> members;
+    for (size_t i = 0; i < parent.size(); i++) members[find(i)] += uses[i];
+
+    for (const auto& [component, ports] : placed) {
+        for (const auto& port : ports) {
+            if (port.width == 0) continue;
+            int& width = widths[find(id(port.at))];
+            if (width == 0) width = port.width;
+            else if (width != port.width && diagnose) {
+                _diagnostics.push_back(circuit.name + ": " + component->describe() + " is " + std::to_string(port.width) + " bits wide at (" +
+                                       std::to_string(port.at.x) + "," + std::to_string(port.at.y) + ") on a " + std::to_string(width) + " bit net");
+            }
+        }
+    }
+
+    std::map<int, std::vector<int>> bits;
+    for (const auto& [net, width] : widths) {
+        for (int bit = 0; bit < width; bit++) bits[net].push_back(_node());
+    }
+
+    auto portBits = [&](const _Port& port) {
+        std::vector<int> result = bits[find(id(port.at))];
+        if (port.width > 0) {
+            while (static_cast<int>(result.size()) < port.width) result.push_back(_node());
+            result.resize(port.width);
+        }
+        return result;
+    };
+
+    std::vector<std::vector<int>> pins(circuit.components.size());
+    for (const auto& [component, ports] : placed) {
+        std::vector<std::vector<int>> nodes;
+        for (const auto& port : ports) nodes.push_back(portBits(port));
+
+        if (!component->library) {
+            const Circuit* child = _project->find(component->name);
+            std::vector<std::vector<int>> inside = _instantiate(*child, path + "/" + component->describe(), depth + 1);
+            for (size_t i = 0; i < ports.size(); i++) {
+                if (diagnose && members[find(id(ports[i].at))] < 2) _diagnostics.push_back(circuit.name + ": " + component->describe() + " port " + std::to_string(i) + " is not connected");
+                for (size_t bit = 0; bit < nodes[i].size(); bit++) _join(nodes[i][bit], inside[i][bit]);
+            }
+        }
+        else if (component->name == "Splitter") {
+            std::vector<int> ends = splitterEnds(*component);
+            std::vector<int> used(ports.size(), 0);
+            for (size_t bit = 0; bit < ends.size(); bit++) {
+                if (ends[bit] >= 0) _join(nodes[0][bit], nodes[1 + ends[bit]][used[1 + ends[bit]]++]);
+            }
+        }
+        else if (component->name == "Pin") {
+            pins[component - circuit.components.data()] = nodes[0];
+            if (depth == 0) _instances.push_back({component, path, true, nodes});
+        }
+        else if (component->name == "Tunnel") {
+            // Main's tunnels are probed by their label, those inside a subcircuit by its path too
+            std::string label = component->attr("label", "");
+            _tunnels.push_back({depth == 0 ? label : path + "/" + label, nodes[0]});
+        }
+        else if (!ports.empty()) _instances.push_back({component, path, depth == 0, nodes});
+    }
+
+    std::vector<std::vector<int>> ordered;
+    for (int index : _pinOrder(circuit)) ordered.push_back(pins[index]);
+    return ordered;
+}
+
+int Netlist::_in(int net, int fallback) {
+    return net >= static_cast<int>(_driven.size()) || _driven[net] ? net : fallback;
+}
+
+int Netlist::_gate(CellType type, bool invert, const std::vector<int>& inputs) {
+    int output = _fresh();
+    cells.push_back({type, invert, inputs, {output}});
+    return output;
+}
+
+void Netlist::_drive(int net, CellType type, bool invert, const std::vector<int>& inputs) {
+    // The net is only settled once every driver is known, see _resolveDrivers
+    cells.push_back({type, invert, inputs, {-1}});
+    _drivers[net].push_back({static_cast<int>(cells.size()) - 1, 0});
+}
+
+int Netlist::_state(int net) {
+    // Flip-flops write their own net, copied onto the circuit's so it can have other drivers
+    int state = _fresh();
+    _copy(net, state);
+    return state;
+}
+
+std::vector<int> Netlist::_decode(const std::vector<int>& select, int outputs) {
+    std::vector<int> inverted;
+    for (int bit : select) inverted.push_back(_not(bit));
+
+    std::vector<int> lines;
+    for (int value = 0; value < outputs; value++) {
+        std::vector<int> terms;
+        for (size_t bit = 0; bit < select.size(); bit++) terms.push_back((value >> bit) & 1 ? select[bit] : inverted[bit]);
+        lines.push_back(_gate(CELL_AND, false, terms));
+    }
+    return lines;
+}
+
+void Netlist::_lowerArithmetic(const _Instance& instance, const std::vector<std::vector<int>>& p, bool subtract) {
+    // Ripple carry, or ripple borrow for a - b - borrow in
+    int carry = _in(p[3][0], NET_ZERO);
+    for (size_t bit = 0; bit < p[0].size(); bit++) {
+        int a = _in(p[1][bit], NET_ZERO);
+        int b = _in(p[2][bit], NET_ZERO);
+        int half = _gate(CELL_XOR, false, {a, b});
+        _drive(p[0][bit], CELL_XOR, false, {half, carry});
+
+        if (subtract) carry = _gate(CELL_OR, false, {_gate(CELL_AND, false, {_not(a), b}), _gate(CELL_AND, false, {_not(half), carry})});
+        else carry = _gate(CELL_OR, false, {_gate(CELL_AND, false, {a, b}), _gate(CELL_AND, false, {half, carry})});
+    }
+    _copy(p[4][0], carry);
+}
+
+void Netlist::_lowerCounter(const _Instance& instance, const std::vector<std::vector<int>>& p, bool classic) {
+    const Component& component = *instance.component;
+    int width = p[0].size();
+    if (component.number("max", (1 << width) - 1) != (1 << width) - 1) {
+        std::cerr << "Error: " << component.describe() << ": only counters that wrap at 2^width are supported" << std::endl;
+        exit(ERROR);
+    }
+
+    int clock = _in(p[classic ? 2 : 1][0], NET_ZERO);
+    int clear = _in(p[classic ? 3 : 2][0], NET_ZERO);
+    int load = _in(p[classic ? 4 : 3][0], NET_ZERO);
+    int up = _in(p[classic ? 5 : 4][0], NET_ONE);
+    int enable = classic ? _in(p[6][0], NET_ONE) : NET_ONE;
+    bool falling = component.attr("trigger", "rising") == "falling";
+
+    // Load wins over counting, the stack pointer loads without its count enable
+    std::vector<int> states;
+    int carry = NET_ONE, borrow = NET_ONE;
+    for (int bit = 0; bit < width; bit++) {
+        int q = _state(p[0][bit]);
+        states.push_back(q);
+    }
+    for (int bit = 0; bit < width; bit++) {
+        int q = states[bit];
+        int increment = _gate(CELL_XOR, false, {q, carry});
+        int decrement = _gate(CELL_XOR, false, {q, borrow});
+        carry = _gate(CELL_AND, false, {q, carry});
+        borrow = _gate(CELL_AND, false, {_not(q), borrow});
+
+        int counted = _gate(CELL_MUX, false, {enable, q, _gate(CELL_MUX, false, {up, decrement, increment})});
+        int next = _gate(CELL_MUX, false, {load, counted, classic ? _in(p[1][bit], NET_ZERO) : NET_ZERO});
+        flipFlops.push_back({next, clock, NET_ONE, clear, NET_ZERO, q, falling});
+    }
+
+    if (classic) _drive(p[7][0], CELL_MUX, false, {up, _gate(CELL_OR, true, states), _gate(CELL_AND, false, states)});
+    probes.push_back({instance.path + "/" + component.describe(), states});
+}
+
+void Netlist::_lowerMemory(const _Instance& instance, const std::vector<std::vector<int>>& p, bool writable) {
+    const Component& component = *instance.component;
+    Memory memory;
+    memory.name = instance.path + "/" + component.describe();
+    memory.addressWidth = component.number("addrWidth", 8);
+    memory.dataWidth = component.number("dataWidth", 8);
+    memory.contents = parseContents(component.attr("contents", ""), memory.addressWidth, memory.dataWidth, memory.name);
+    for (int net : p[0]) memory.address.push_back(_in(net, NET_ZERO));
+
+    Cell read = {CELL_READ, false, memory.address, {}};
+    read.memory = memories.size();
+    cells.push_back(read);
+    int cell = cells.size() - 1;
+
+    if (!writable) {
+        // The read port drives the data pins directly
+        for (int bit = 0; bit < memory.dataWidth; bit++) {
+            cells[cell].outputs.push_back(-1);
+            _drivers[p[1][bit]].push_back({cell, bit});
+        }
+    }
+    else {
+        // A bidirectional bus: the RAM drives it while output is enabled and stores what is on it
+        int enable = _in(p[2][0], NET_ONE);
+        for (int bit = 0; bit < memory.dataWidth; bit++) {
+            int value = _fresh();
+            cells[cell].outputs.push_back(value);
+            _tristates[p[4][bit]].push_back({value, enable});
+            memory.input.push_back(p[4][bit]);
+        }
+        memory.store = _in(p[1][0], NET_ZERO);
+        memory.clock = _in(p[3][0], NET_ZERO);
+        memory.falling = component.attr("trigger", "rising") == "falling";
+    }
+    memory.data = cells[cell].outputs;
+    memories.push_back(memory);
+}
+
+void Netlist::_lower(const _Instance& instance) {
+    const Component& component = *instance.component;
+    const std::string& name = component.name;
+    std::vector<std::vector<int>> p;
+    for (const auto& port : instance.ports) {
+        p.push_back({});
+        for (int node : port) p.back().push_back(_net(node));
+    }
+
+    if (name == "AND Gate" || name == "OR Gate" || name == "NAND Gate" || name == "NOR Gate" || name == "XOR Gate" || name == "XNOR Gate") {
+        CellType type = name[0] == 'X' ? CELL_XOR : name.find("AND") != std::string::npos ? CELL_AND : CELL_OR;
+        bool invert = name[0] == 'N' || name == "XNOR Gate";
+
+        // With gateUndefined set to ignore, floating inputs drop out of the gate
+        for (size_t bit = 0; bit < p[0].size(); bit++) {
+            std::vector<int> inputs;
+            for (size_t i = 1; i < p.size(); i++) {
+                if (_in(p[i][bit], -1) >= 0) inputs.push_back(p[i][bit]);
+            }
+            if (!inputs.empty()) _drive(p[0][bit], type, invert, inputs);
+        }
+    }
+    else if (name == "NOT Gate") {
+        for (size_t bit = 0; bit < p[0].size(); bit++) _drive(p[0][bit], CELL_AND, true, {_in(p[1][bit], NET_ZERO)});
+    }
+    else if (name == "Controlled Buffer") {
+        // A floating control never drives the bus, the ALU leaves its NOT_MODE pin that way
+        int enable = _in(p[2][0], NET_ZERO);
+        for (size_t bit = 0; bit < p[0].size(); bit++) _tristates[p[0][bit]].push_back({_in(p[1][bit], NET_ZERO), enable});
+    }
+    else if (name == "Multiplexer") {
+        int select = _in(p[3][0], NET_ZERO);
+        for (size_t bit = 0; bit < p[0].size(); bit++) _drive(p[0][bit], CELL_MUX, false, {select, _in(p[1][bit], NET_ZERO), _in(p[2][bit], NET_ZERO)});
+    }
+    else if (name == "Demultiplexer") {
+        int select = _in(p[3][0], NET_ZERO);
+        int unselected = _not(select);
+        for (size_t bit = 0; bit < p[0].size(); bit++) {
+            _drive(p[1][bit], CELL_AND, false, {_in(p[0][bit], NET_ZERO), unselected});
+            _drive(p[2][bit], CELL_AND, false, {_in(p[0][bit], NET_ZERO), select});
+        }
+    }
+    else if (name == "Decoder") {
+        std::vector<int> select;
+        for (int net : p[0]) select.push_back(_in(net, NET_ZERO));
+        std::vector<int> lines = _decode(select, p.size() - 1);
+        for (size_t line = 0; line < lines.size(); line++) _copy(p[1 + line][0], lines[line]);
+    }
+    else if (name == "BitSelector") {
+        int group = p[0].size();
+        int dataWidth = p[1].size();
+        int groups = (dataWidth + group - 1) / group;
+
+        std::vector<int> select;
+        for (int net : p[2]) select.push_back(_in(net, NET_ZERO));
+        std::vector<int> lines = groups > 1 ? _decode(select, groups) : std::vector<int>{NET_ONE};
+
+        for (int bit = 0; bit < group; bit++) {
+            std::vector<int> terms;
+            for (int g = 0; g < groups; g++) {
+                if (g * group + bit < dataWidth) terms.push_back(_gate(CELL_AND, false, {lines[g], _in(p[1][g * group + bit], NET_ZERO)}));
+            }
+            _drive(p[0][bit], CELL_OR, false, terms);
+        }
+    }
+    else if (name == "Adder" || name == "Subtractor") _lowerArithmetic(instance, p, name == "Subtractor");
+    else if (name == "Bit Extender") {
+        std::string type = component.attr("type", "zero");
+        int inWidth = p[1].size();
+        int extension = type == "one" ? NET_ONE : type == "sign" ? _in(p[1][inWidth - 1], NET_ZERO) : type == "input" ? _in(p[2][0], NET_ZERO) : NET_ZERO;
+        for (size_t bit = 0; bit < p[0].size(); bit++) _copy(p[0][bit], static_cast<int>(bit) < inWidth ? _in(p[1][bit], NET_ZERO) : extension);
+    }
+    else if (name == "Constant") {
+        uint64_t value = std::strtoull(component.attr("value", "0x1").c_str(), nullptr, 0);
+        for (size_t bit = 0; bit < p[0].size(); bit++) _copy(p[0][bit], (value >> bit) & 1 ? NET_ONE : NET_ZERO);
+    }
+    else if (name == "Clock" || name == "POR") {
+        int source = _fresh();
+        (name == "Clock" ? clocks : resets).push_back(source);
+        _copy(p[0][0], source);
+    }
+    else if (name == "Pin") {
+        // Only inputs on the main circuit reach here, subcircuit pins were joined away
+        if (component.attr("output", "false") == "true") return;
+        Signal input = {component.attr("label", component.describe()), {}};
+        for (int net : p[0]) {
+            input.nets.push_back(_fresh());
+            _copy(net, input.nets.back());
+        }
+        inputs.push_back(input);
+    }
+    else if (name == "Register") {
+        int enable = _in(p[1][0], NET_ONE);
+        int clock = _in(p[2][0], NET_ZERO);
+        int clear = _in(p[4][0], NET_ZERO);
+        bool falling = component.attr("trigger", "rising") == "falling";
+
+        std::vector<int> states;
+        for (size_t bit = 0; bit < p[0].size(); bit++) {
+            states.push_back(_state(p[3][bit]));
+            flipFlops.push_back({_in(p[0][bit], NET_ZERO), clock, enable, clear, NET_ZERO, states.back(), falling});
+        }
+        probes.push_back({instance.path + "/" + component.describe(), states});
+    }
+    else if (name == "D Flip-Flop") {
+        int state = _state(p[2][0]);
+        _drive(p[3][0], CELL_AND, true, {state});
+        flipFlops.push_back({_in(p[0][0], NET_ZERO), _in(p[1][0], NET_ZERO), NET_ONE, _in(p[4][0], NET_ZERO), _in(p[5][0], NET_ZERO), state,
+                             component.attr("trigger", "rising") == "falling"});
+        probes.push_back({instance.path + "/" + component.describe(), {state}});
+    }
+    else if (name == "Counter") _lowerCounter(instance, p, component.attr("appearance", "") == "classic");
+    else if (name == "ROM" || name == "RAM") _lowerMemory(instance, p, name == "RAM");
+    else if (name == "TTY") {
+        Tty tty;
+        for (int net : p[0]) tty.data.push_back(_in(net, NET_ZERO));
+        tty.clock = _in(p[1][0], NET_ZERO);
+        tty.enable = _in(p[2][0], NET_ONE);
+        tty.clear = _in(p[3][0], NET_ZERO);
+        ttys.push_back(tty);
+    }
+}
+
+void Netlist::_resolveDrivers() {
+    // One plain driver writes its net directly. Anything else meets on a bus, where plain
+    // drivers are always enabled and tri-state ones only while their control is high.
+    for (size_t net = 2; net < _drivers.size(); net++) {
+        std::vector<_Driver>& drivers = _drivers[net];
+        std::vector<std::pair<int, int>>& tristates = _tristates[net];
+        if (tristates.empty() && drivers.size() == 1) {
+            cells[drivers[0].cell].outputs[drivers[0].slot] = net;
+            continue;
+        }
+        if (tristates.empty() && drivers.empty()) continue;
+        if (tristates.empty()) _diagnostics.push_back("net " + std::to_string(net) + " has " + std::to_string(drivers.size()) + " outputs driving it");
+
+        Cell bus = {CELL_BUS, false, {}, {static_cast<int>(net)}};
+        bus.pullUp = _pulled[net] == 1;
+        for (const auto& driver : drivers) {
+            int value = _fresh();
+            cells[driver.cell].outputs[driver.slot] = value;
+            bus.inputs.push_back(value);
+            bus.inputs.push_back(NET_ONE);
+        }
+        for (const auto& [value, enable] : tristates) {
+            bus.inputs.push_back(value);
+            bus.inputs.push_back(enable);
+        }
+        cells.push_back(bus);
+    }
+}
+
+// Main Functions
+
+void Netlist::build(const Project& project) {
+    _project = &project;
+    const Circuit& top = project.top();
+    _instantiate(top, top.name, 0);
+
+    // Collapse the bit nodes into nets
+    _netOf.assign(_parent.size(), -1);
+    for (size_t node = 0; node < _parent.size(); node++) {
+        int root = _find(node);
+        if (_netOf[root] < 0) _netOf[root] = nets++;
+    }
+
+    // Which nets something drives decides the fallbacks of the inputs reading them
+    _driven.assign(nets, 0);
+    _pulled.assign(nets, -1);
+    _driven[NET_ZERO] = _driven[NET_ONE] = 1;
+    for (const auto& instance : _instances) {
+        const Component& component = *instance.component;
+        std::vector<_Port> ports = _ports(component);
+        for (size_t i = 0; i < ports.size(); i++) {
+            bool drives = ports[i].direction == PORT_OUT || ports[i].direction == PORT_INOUT || (component.name == "Pin" && component.attr("output", "false") != "true");
+            for (int node : instance.ports[i]) {
+                int net = _net(node);
+                if (drives) _driven[net] = 1;
+                if (component.name == "Pull Resistor") _pulled[net] = component.attr("pull", "0") == "1" ? 1 : 0;
+            }
+        }
+    }
+
+    _drivers.assign(nets, {});
+    _tristates.assign(nets, {});
+    for (int net = 2; net < static_cast<int>(_pulled.size()); net++) {
+        if (_pulled[net] >= 0 && !_driven[net]) {
+            _driven[net] = 1;
+            _copy(net, _pulled[net] ? NET_ONE : NET_ZERO);
+        }
+    }
+
+    for (const auto& instance : _instances) _lower(instance);
+    _resolveDrivers();
+
+    // ROM read ports only learn which nets they write once their drivers are resolved
+    for (const auto& cell : cells) {
+        if (cell.type == CELL_READ) memories[cell.memory].data = cell.outputs;
+    }
+
+    for (const auto& [label, nodes] : _tunnels) {
+        if (std::any_of(probes.begin(), probes.end(), [&](const Signal& probe) { return probe.name == label; })) continue;
+        Signal probe = {label, {}};
+        for (int node : nodes) probe.nets.push_back(_net(node));
+        probes.push_back(probe);
+    }
+}
+
+int Netlist::report(bool verbose) {
+    for (size_t i = 0; i < _diagnostics.size() && (verbose || i < DIAGNOSTICS_SHOWN); i++) std::cerr << "Warning: " << _diagnostics[i] << std::endl;
+    if (!verbose && _diagnostics.size() > DIAGNOSTICS_SHOWN) std::cerr << "Warning: " << _diagnostics.size() - DIAGNOSTICS_SHOWN << " more, -v shows them all" << std::endl;
+    return _diagnostics.size();
+}
@@ -0,0 +1,128 @@
+#ifndef NETLIST_HPP
+#define NETLIST_HPP
+
+#include "main.hpp"
+#include "circuit.hpp"
+
+// Flattens a project into one bit-level netlist. Subcircuits, tunnels and splitters only join
+// nets, so they disappear into a union-find; everything else becomes two-valued cells, clocked
+// flip-flops and memories. Floating nets read as 0 unless pulled, and undriven control inputs
+// take the value Logisim gives an unconnected pin.
+
+enum CellType {CELL_AND, CELL_OR, CELL_XOR, CELL_MUX, CELL_BUS, CELL_READ};
+
+struct Cell {
+    CellType type;
+    bool invert = false;
+    std::vector<int> inputs;                // MUX: select, when 0, when 1. BUS: value, enable pairs
+    std::vector<int> outputs;               // One net except for memory reads
+    bool pullUp = false;                    // BUS: value while no driver is enabled
+    int memory = -1;                        // READ
+};
+
+struct FlipFlop {
+    int d, clock, enable, clear, preset, q;
+    bool falling;
+};
+
+struct Memory {
+    std::string name;
+    int addressWidth, dataWidth;
+    std::vector<int> address;
+    std::vector<int> data;                  // Read port
+    std::vector<int> input;                 // Write port, empty for ROMs
+    int store = NET_ZERO;
+    int clock = NET_ZERO;
+    bool falling = false;
+    std::vector<std::pair<uint32_t, uint64_t>> contents;    // Runs of words saved in the circuit
+};
+
+struct Tty {
+    std::vector<int> data;
+    int clock, enable, clear;
+};
+
+struct Signal {
+    std::string name;
+    std::vector<int> nets;
+};
+
+class Netlist {
+public:
+    void build(const Project& project);
+    int report(bool verbose);               // Prints the diagnostics, returns how many there were
+
+    int nets = 2;
+    std::vector<Cell> cells;
+    std::vector<FlipFlop> flipFlops;
+    std::vector<Memory> memories;
+    std::vector<Tty> ttys;
+    std::vector<Signal> inputs;             // Pins on the main circuit, driven from outside
+    std::vector<Signal> probes;             // Every tunnel and every register's output
+    std::vector<int> clocks;
+    std::vector<int> resets;                // Power-on reset outputs
+
+private:
+    const Project* _project = nullptr;
+
+    enum _Direction {PORT_IN, PORT_OUT, PORT_INOUT, PORT_JOIN};
+
+    struct _Port {
+        Point at;
+        int width;                          // 0 takes the width of whatever it is attached to
+        _Direction direction;
+    };
+
+    struct _Instance {
+        const Component* component;
+        std::string path;
+        bool top;
+        std::vector<std::vector<int>> ports;    // Bit nodes of each port
+    };
+
+    struct _Driver {
+        int cell;
+        int slot;
+    };
+
+    // Flattening
+    std::vector<int> _parent;
+    std::vector<_Instance> _instances;
+    std::vector<std::string> _diagnostics;
+
+    // Cells
+    std::vector<int> _netOf;                // Bit node to net, after flattening
+    std::vector<char> _driven;
+    std::vector<char> _pulled;
+    std::vector<std::vector<_Driver>> _drivers;
+    std::vector<std::vector<std::pair<int, int>>> _tristates;
+    std::vector<std::string> _checked;      // Circuits already diagnosed, they may be placed more than once
+    std::vector<std::pair<std::string, std::vector<int>>> _tunnels;
+
+    int _node();
+    int _find(int node);
+    void _join(int a, int b);
+
+    std::vector<_Port> _ports(const Component& component);
+    std::vector<int> _pinOrder(const Circuit& circuit);
+    std::vector<std::vector<int>> _instantiate(const Circuit& circuit, const std::string& path, int depth);
+    void _checkWires(const Circuit& circuit, const std::vector<std::pair<const Component*, std::vector<_Port>>>& placed);
+
+    int _net(int node) { return _netOf[_find(node)]; }
+    int _in(int net, int fallback);
+    int _fresh() { return nets++; }
+    int _gate(CellType type, bool invert, const std::vector<int>& inputs);
+    void _drive(int net, CellType type, bool invert, const std::vector<int>& inputs);
+    void _copy(int net, int from) { _drive(net, CELL_AND, false, {from}); }
+    int _not(int net) { return _gate(CELL_AND, true, {net}); }
+
+    std::vector<int> _decode(const std::vector<int>& select, int outputs);
+    int _state(int net);
+    void _lower(const _Instance& instance);
+    void _lowerArithmetic(const _Instance& instance, const std::vector<std::vector<int>>& p, bool subtract);
+    void _lowerCounter(const _Instance& instance, const std::vector<std::vector<int>>& p, bool classic);
+    void _lowerMemory(const _Instance& instance, const std::vector<std::vector<int>>& p, bool writable);
+    void _resolveDrivers();
+};
+
+#endif
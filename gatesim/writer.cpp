@@ -0,0 +1,236 @@
+#include "writer.hpp"
+
+// Helper Functions
+
+std::string ModelWriter::_operand(int net) {
+    if (net == NET_ZERO) return "0ull";
+    if (net == NET_ONE) return "ALL_LANES";
+    return "n[" + std::to_string(net) + "]";
+}
+
+std::string ModelWriter::_expression(const Cell& cell) {
+    std::string text;
+    if (cell.type == CELL_MUX) {
+        std::string select = _operand(cell.inputs[0]);
+        text = "(" + _operand(cell.inputs[1]) + " & ~" + select + ") | (" + _operand(cell.inputs[2]) + " & " + select + ")";
+    }
+    else if (cell.type == CELL_BUS) {
+        std::string enables;
+        for (size_t i = 0; i < cell.inputs.size(); i += 2) {
+            if (i > 0) text += " | ";
+            if (i > 0) enables += " | ";
+            text += cell.inputs[i + 1] == NET_ONE ? _operand(cell.inputs[i]) : "(" + _operand(cell.inputs[i]) + " & " + _operand(cell.inputs[i + 1]) + ")";
+            enables += _operand(cell.inputs[i + 1]);
+        }
+        if (cell.pullUp) text += " | ~(" + enables + ")";
+    }
+    else {
+        const char* op = cell.type == CELL_AND ? " & " : cell.type == CELL_OR ? " | " : " ^ ";
+        for (size_t i = 0; i < cell.inputs.size(); i++) text += (i > 0 ? op : "") + _operand(cell.inputs[i]);
+    }
+
+    if (cell.invert) return cell.inputs.size() == 1 ? "~" + text : "~(" + text + ")";
+    return text;
+}
+
+void ModelWriter::_writeCell(std::ostream& out, const Cell& cell, bool loop) {
+    if (cell.type == CELL_READ) {
+        out << (loop ? "        changed |= " : "    ") << "_read(" << cell.memory << ");\n";
+        return;
+    }
+
+    int net = cell.outputs[0];
+    if (!loop) out << "    n[" << net << "] = " << _expression(cell) << ";\n";
+    else out << "        value = " << _expression(cell) << "; changed |= value ^ n[" << net << "]; n[" << net << "] = value;\n";
+}
+
+void ModelWriter::_writeArray(std::ostream& out, const std::string& name, const std::vector<int>& values) {
+    // Zero length arrays aren't C++, empty tables still get one unused entry
+    out << "static const int " << name << "[] = {";
+    for (size_t i = 0; i < values.size(); i++) out << (i > 0 ? ", " : "") << values[i];
+    if (values.empty()) out << "0";
+    out << "};\n";
+}
+
+void ModelWriter::_writeSignals(std::ostream& out, const std::string& name, const std::vector<Signal>& signals) {
+    for (size_t i = 0; i < signals.size(); i++) _writeArray(out, "_" + name + std::to_string(i), signals[i].nets);
+
+    // "probes" names the PROBES table and its PROBE_COUNT
+    std::string table = name;
+    std::transform(table.begin(), table.end(), table.begin(), ::toupper);
+    out << "const SignalSpec " << table << "[] = {\n";
+    for (size_t i = 0; i < signals.size(); i++) out << "    {\"" << signals[i].name << "\", " << signals[i].nets.size() << ", _" << name << i << "},\n";
+    if (signals.empty()) out << "    {\"\", 0, nullptr},\n";
+    out << "};\nconst int " << table.substr(0, table.size() - 1) << "_COUNT = " << signals.size() << ";\n\n";
+}
+
+// Main Functions
+
+void ModelWriter::levelize() {
+    const std::vector<Cell>& cells = _netlist.cells;
+    std::vector<int> producer(_netlist.nets, -1);
+    for (size_t cell = 0; cell < cells.size(); cell++) {
+        for (int net : cells[cell].outputs) producer[net] = cell;
+    }
+
+    // Tarjan's strongly connected components, iteratively since the graph is deep. Edges point
+    // from a cell to the cells it reads, so components come out dependencies first.
+    int count = cells.size();
+    std::vector<int> index(count, -1), low(count, 0);
+    std::vector<char> onStack(count, 0);
+    std::vector<int> stack;
+    std::vector<std::pair<int, size_t>> calls;
+    int next = 0;
+
+    for (int root = 0; root < count; root++) {
+        if (index[root] >= 0) continue;
+        index[root] = low[root] = next++;
+        stack.push_back(root);
+        onStack[root] = 1;
+        calls.push_back({root, 0});
+
+        while (!calls.empty()) {
+            int cell = calls.back().first;
+            size_t input = calls.back().second;
+
+            if (input < cells[cell].inputs.size()) {
+                calls.back().second++;
+                int dependency = producer[cells[cell].inputs[input]];
+                if (dependency < 0) continue;
+
+                if (index[dependency] < 0) {
+                    index[dependency] = low[dependency] = next++;
+                    stack.push_back(dependency);
+                    onStack[dependency] = 1;
+                    calls.push_back({dependency, 0});
+                }
+                else if (onStack[dependency]) low[cell] = std::min(low[cell], index[dependency]);
+                continue;
+            }
+
+            if (low[cell] == index[cell]) {
+                std::vector<int> group;
+                int member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = 0;
+                    group.push_back(member);
+                } while (member != cell);
+                std::reverse(group.begin(), group.end());
+                _order.push_back(group);
+            }
+
+            calls.pop_back();
+            if (!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first], low[cell]);
+        }
+    }
+
+    // Depth of the longest path, a loop counting as one level
+    std::vector<int> level(count, 0);
+    for (const auto& group : _order) {
+        int deepest = 0;
+        for (int cell : group) {
+            for (int net : cells[cell].inputs) {
+                if (producer[net] >= 0 && level[producer[net]] > deepest && std::find(group.begin(), group.end(), producer[net]) == group.end()) deepest = level[producer[net]];
+            }
+        }
+        for (int cell : group) level[cell] = deepest + 1;
+        _levels = std::max(_levels, deepest + 1);
+    }
+}
+
+void ModelWriter::write(const std::string& modelPath, const std::string& source) {
+    std::ofstream out(modelPath);
+    if (!out) {
+        std::cerr << "Error: unable to write '" << modelPath << "'" << std::endl;
+        exit(ERROR);
+    }
+
+    const std::vector<Cell>& cells = _netlist.cells;
+    out << "// Generated by gatec from " << source << ", do not edit\n\n";
+    out << "#include \"machine.hpp\"\n\n";
+    out << "const int NET_COUNT = " << _netlist.nets << ";\n\n";
+
+    out << "const FlipFlopSpec FLIP_FLOPS[] = {\n";
+    for (const auto& ff : _netlist.flipFlops) {
+        out << "    {" << ff.d << ", " << ff.clock << ", " << ff.enable << ", " << ff.clear << ", " << ff.preset << ", " << ff.q << ", " << (ff.falling ? "true" : "false") << "},\n";
+    }
+    if (_netlist.flipFlops.empty()) out << "    {0, 0, 0, 0, 0, 0, false},\n";
+    out << "};\nconst int FLIP_FLOP_COUNT = " << _netlist.flipFlops.size() << ";\n\n";
+
+    for (size_t i = 0; i < _netlist.memories.size(); i++) {
+        const Memory& memory = _netlist.memories[i];
+        _writeArray(out, "_address" + std::to_string(i), memory.address);
+        _writeArray(out, "_data" + std::to_string(i), memory.data);
+        if (!memory.input.empty()) _writeArray(out, "_input" + std::to_string(i), memory.input);
+
+        out << "static const MemoryRun _contents" << i << "[] = {";
+        for (size_t run = 0; run < memory.contents.size(); run++) {
+            char text[40];
+            std::snprintf(text, sizeof(text), "{%u, 0x%llx}", memory.contents[run].first, static_cast<unsigned long long>(memory.contents[run].second));
+            out << (run % 8 == 0 ? "\n    " : " ") << text << ",";
+        }
+        out << (memory.contents.empty() ? "{0, 0}" : "\n") << "};\n";
+    }
+    out << "const MemorySpec MEMORIES[] = {\n";
+    for (size_t i = 0; i < _netlist.memories.size(); i++) {
+        const Memory& memory = _netlist.memories[i];
+        out << "    {\"" << memory.name << "\", " << memory.addressWidth << ", " << memory.dataWidth << ", _address" << i << ", _data" << i << ", "
+            << (memory.input.empty() ? "nullptr" : "_input" + std::to_string(i)) << ", " << memory.store << ", " << memory.clock << ", "
+            << (memory.falling ? "true" : "false") << ", _contents" << i << ", " << memory.contents.size() << "},\n";
+    }
+    if (_netlist.memories.empty()) out << "    {\"\", 0, 0, nullptr, nullptr, nullptr, 0, 0, false, nullptr, 0},\n";
+    out << "};\nconst int MEMORY_COUNT = " << _netlist.memories.size() << ";\n\n";
+
+    for (size_t i = 0; i < _netlist.ttys.size(); i++) _writeArray(out, "_tty" + std::to_string(i), _netlist.ttys[i].data);
+    out << "const TtySpec TTYS[] = {\n";
+    for (size_t i = 0; i < _netlist.ttys.size(); i++) {
+        const Tty& tty = _netlist.ttys[i];
+        out << "    {_tty" << i << ", " << tty.clock << ", " << tty.enable << ", " << tty.clear << "},\n";
+    }
+    if (_netlist.ttys.empty()) out << "    {nullptr, 0, 0, 0},\n";
+    out << "};\nconst int TTY_COUNT = " << _netlist.ttys.size() << ";\n\n";
+
+    _writeSignals(out, "inputs", _netlist.inputs);
+    _writeSignals(out, "probes", _netlist.probes);
+
+    out << "const int CLOCKS[] = {";
+    for (size_t i = 0; i < _netlist.clocks.size(); i++) out << (i > 0 ? ", " : "") << _netlist.clocks[i];
+    out << (_netlist.clocks.empty() ? "0" : "") << "};\nconst int CLOCK_COUNT = " << _netlist.clocks.size() << ";\n";
+    out << "const int RESETS[] = {";
+    for (size_t i = 0; i < _netlist.resets.size(); i++) out << (i > 0 ? ", " : "") << _netlist.resets[i];
+    out << (_netlist.resets.empty() ? "0" : "") << "};\nconst int RESET_COUNT = " << _netlist.resets.size() << ";\n\n";
+
+    // The levelized logic, one statement per cell
+    out << "void Machine::_evaluate() {\n";
+    out << "    uint64_t* n = _nets.data();\n";
+    for (const auto& group : _order) {
+        const Cell& first = cells[group[0]];
+        bool selfLoop = group.size() == 1 && std::any_of(first.inputs.begin(), first.inputs.end(), [&](int net) {
+            return std::find(first.outputs.begin(), first.outputs.end(), net) != first.outputs.end();
+        });
+
+        if (group.size() == 1 && !selfLoop) {
+            _writeCell(out, first, false);
+            continue;
+        }
+
+        _loops++;
+        out << "    for (int pass = 0; ; pass++) {\n";
+        out << "        uint64_t changed = 0, value;\n";
+        for (int cell : group) _writeCell(out, cells[cell], true);
+        out << "        if (!changed) break;\n";
+        out << "        if (pass == MAX_SETTLE) {\n";
+        out << "            _oscillations++;\n";
+        out << "            break;\n";
+        out << "        }\n";
+        out << "    }\n";
+    }
+    out << "}\n";
+
+    if (!out) {
+        std::cerr << "Error: unable to write '" << modelPath << "'" << std::endl;
+        exit(ERROR);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+#include "main.hpp"
+#include "netlist.hpp"
+
+// Orders the cells so every net is written before it is read and writes model.cpp. Cells on a
+// combinational loop can't be ordered; each loop becomes one block repeated until it settles.
+class ModelWriter {
+public:
+    ModelWriter(const Netlist& netlist) : _netlist(netlist) {}
+
+    void levelize();
+    void write(const std::string& modelPath, const std::string& source);
+
+    int levels() const { return _levels; }
+    int loops() const { return _loops; }
+
+private:
+    const Netlist& _netlist;
+    std::vector<std::vector<int>> _order;   // Strongly connected groups of cells, inputs first
+    int _levels = 0;
+    int _loops = 0;
+
+    std::string _operand(int net);
+    std::string _expression(const Cell& cell);
+    void _writeCell(std::ostream& out, const Cell& cell, bool loop);
+    void _writeArray(std::ostream& out, const std::string& name, const std::vector<int>& values);
+    void _writeSignals(std::ostream& out, const std::string& name, const std::vector<Signal>& signals);
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "compiler.hpp"
+
+// Helper Functions
+
+static std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+static std::string stripComment(const std::string& text) {
+    return text.substr(0, text.find('#'));
+}
+
+static bool startsWith(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+static bool isInteger(const std::string& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+uint64_t MicrocodeCompiler::_parseExpression(const std::string& expression, int line) {
+    uint64_t word = 0;
+    std::stringstream terms(expression);
+    std::string term;
+
+    while (std::getline(terms, term, '|')) {
+        term = trim(term);
+        auto signal = _signals.find(term);
+        if (signal == _signals.end()) {
+            std::cerr << "Error: " << _scriptPath << ":" << line << ": unknown control signal '" << term << "'" << std::endl;
+            exit(ERROR);
+        }
+        word |= signal->second;
+    }
+    return word;
+}
+
+void MicrocodeCompiler::_parseSignal(const std::string& text, int line) {
+    // MI    = 0b10_0000_000_...
+    size_t equal = text.find('=');
+    std::string name = trim(text.substr(0, equal));
+    std::string bits = trim(text.substr(equal + 1)).substr(2);
+    bits.erase(std::remove(bits.begin(), bits.end(), '_'), bits.end());
+
+    if (bits.empty() || bits.size() > WORD_BYTES * 8 || bits.find_first_not_of("01") != std::string::npos) {
+        std::cerr << "Error: " << _scriptPath << ":" << line << ": '" << name << "' is not a 40 bit binary literal" << std::endl;
+        exit(ERROR);
+    }
+    _signals[name] = std::stoull(bits, nullptr, 2);
+}
+
+void MicrocodeCompiler::_parseFlag(const std::string& text, int line) {
+    // CF  = bool((flag>>0)&1)
+    size_t shift = text.find(">>");
+    std::string bit = trim(text.substr(shift + 2, text.find(')', shift) - shift - 2));
+    if (!isInteger(bit) || std::stoi(bit) >= 7) {
+        std::cerr << "Error: " << _scriptPath << ":" << line << ": unsupported flag definition" << std::endl;
+        exit(ERROR);
+    }
+    _flags[trim(text.substr(0, text.find('=')))] = std::stoi(bit);
+}
+
+void MicrocodeCompiler::_parseRow(const std::string& text, int line) {
+    // [MI|COA|CE, RO|AI, CE|II|EP],
+    size_t open = text.find('[');
+    size_t close = text.rfind(']');
+    if (open != 0 || close == std::string::npos) {
+        std::cerr << "Error: " << _scriptPath << ":" << line << ": expected one instruction per line" << std::endl;
+        exit(ERROR);
+    }
+
+    std::vector<uint64_t> steps;
+    std::stringstream expressions(text.substr(open + 1, close - open - 1));
+    std::string expression;
+    while (std::getline(expressions, expression, ',')) {
+        if (!trim(expression).empty()) steps.push_back(_parseExpression(expression, line));
+    }
+    _steps.push_back(steps);
+}
+
+void MicrocodeCompiler::_parseBranchRule(const std::string& text, int line) {
+    // elif (not ZF) and (instr == 36): substeps_CJ(substep, rom_data, address)
+    std::string condition = text.substr(text.find(' ') + 1);
+    condition = condition.substr(0, condition.find(':'));
+
+    _BranchRule rule = {-1, 0, 0};
+    bool valid = true;
+    size_t start = 0;
+    while (valid && start <= condition.size()) {
+        size_t conjunction = condition.find(" and ", start);
+        std::string term = condition.substr(start, conjunction == std::string::npos ? std::string::npos : conjunction - start);
+        start = conjunction == std::string::npos ? condition.size() + 1 : conjunction + 5;
+
+        term.erase(std::remove_if(term.begin(), term.end(), [](char c) { return c == '(' || c == ')'; }), term.end());
+        term = trim(term);
+
+        // One opcode test, any number of flag tests
+        size_t equals = term.find("==");
+        if (equals != std::string::npos) {
+            std::string opcode = trim(term.substr(equals + 2));
+            valid = rule.opcode < 0 && trim(term.substr(0, equals)) == "instr" && isInteger(opcode) && std::stoi(opcode) < OPCODE_SPACE;
+            if (valid) rule.opcode = std::stoi(opcode);
+            continue;
+        }
+
+        bool set = !startsWith(term, "not ");
+        if (!set) term = trim(term.substr(4));
+        valid = _flags.count(term) > 0;
+        if (!valid) continue;
+
+        // A flag tested both ways could never branch
+        uint8_t bit = 1 << _flags[term];
+        valid = !(rule.mask & bit) || ((rule.value & bit) != 0) == set;
+        rule.mask |= bit;
+        if (set) rule.value |= bit;
+    }
+
+    if (!valid || rule.opcode < 0 || rule.mask == 0) {
+        std::cerr << "Error: " << _scriptPath << ":" << line << ": unsupported branch condition" << std::endl;
+        exit(ERROR);
+    }
+    _branchRules.push_back(rule);
+}
+
+void MicrocodeCompiler::_parseBranchStep(const std::string& text, int line) {
+    // case 0: rom_data[address] = RO|CIDL
+    std::string substep = trim(text.substr(5, text.find(':') - 5));
+    if (!isInteger(substep) || std::stoul(substep) != _branchSteps.size()) {
+        std::cerr << "Error: " << _scriptPath << ":" << line << ": branch steps must be listed in order" << std::endl;
+        exit(ERROR);
+    }
+    _branchSteps.push_back(_parseExpression(text.substr(text.find('=') + 1), line));
+}
+
+std::vector<uint64_t> MicrocodeCompiler::_buildPage(uint8_t flags) {
+    // Same order of writes as createMicroCode, including its ninth substep: the address of
+    // substep 8 lands on the first step of the next even opcode or on the opcode's own
+    std::vector<uint64_t> page(PAGE_SIZE, 0);
+
+    for (int opcode = 0; opcode < OPCODE_SPACE; opcode++) {
+        bool branch = false;
+        for (const auto& rule : _branchRules) {
+            if (rule.opcode == opcode && (flags & rule.mask) == rule.value) branch = true;
+        }
+
+        for (size_t substep = 0; substep <= SUBSTEPS; substep++) {
+            int address = (opcode << 3) | static_cast<int>(substep);
+            if (static_cast<size_t>(opcode) < _steps.size() && substep < _steps[opcode].size()) page[address] = _steps[opcode][substep];
+            if (branch && substep < _branchSteps.size()) page[address] = _branchSteps[substep];
+        }
+    }
+    return page;
+}
+
+// Main Functions
+
+void MicrocodeCompiler::parse(const std::string& scriptPath) {
+    _scriptPath = scriptPath;
+    std::ifstream file(scriptPath);
+    if (!file) {
+        std::cerr << "Error: unable to open '" << scriptPath << "'" << std::endl;
+        exit(ERROR);
+    }
+
+    enum { TOP_LEVEL, BRANCH_STEPS, BRANCH_RULES, INSTRUCTIONS } section = TOP_LEVEL;
+    std::string raw;
+    int line = 0;
+
+    while (std::getline(file, raw)) {
+        line++;
+        std::string text = trim(stripComment(raw));
+        if (text.empty()) continue;
+
+        if (section == INSTRUCTIONS) {
+            if (text == "]") section = TOP_LEVEL;
+            else _parseRow(text, line);
+            continue;
+        }
+
+        if (startsWith(text, "def ")) {
+            if (startsWith(text, "def substeps_CJ")) section = BRANCH_STEPS;
+            else if (startsWith(text, "def conditionalJumps_Expections")) section = BRANCH_RULES;
+            else section = TOP_LEVEL;
+        }
+        else if (startsWith(text, "instructions_data = [")) section = INSTRUCTIONS;
+        else if (raw[0] != ' ' && text.find("= 0b") != std::string::npos) _parseSignal(text, line);
+        else if (section == BRANCH_RULES && text.find("bool((flag>>") != std::string::npos) _parseFlag(text, line);
+        else if (section == BRANCH_RULES && (startsWith(text, "if ") || startsWith(text, "elif "))) _parseBranchRule(text, line);
+        else if (section == BRANCH_STEPS && startsWith(text, "case ")) _parseBranchStep(text, line);
+    }
+
+    if (_steps.empty() || _steps.size() > OPCODE_SPACE || !_signals.count("EP")) {
+        std::cerr << "Error: no instruction step list in '" << scriptPath << "'" << std::endl;
+        exit(ERROR);
+    }
+}
+
+void MicrocodeCompiler::compile() {
+    _flagMask = 0;
+    for (const auto& rule : _branchRules) _flagMask |= rule.mask;
+
+    // One page per combination of the flags the branches test
+    _pages.clear();
+    for (int flags = 0; flags < FLAG_STATES; flags++) {
+        if ((flags & _flagMask) == flags) _pages[flags] = _buildPage(flags);
+    }
+}
+
+void MicrocodeCompiler::writeRom(const std::string& romPath) {
+    std::vector<uint8_t> rom(ROM_SIZE * WORD_BYTES);
+    for (int flags = 0; flags < FLAG_STATES; flags++) {
+        const std::vector<uint64_t>& page = _pages[flags & _flagMask];
+        uint8_t* out = rom.data() + static_cast<size_t>(flags) * PAGE_SIZE * WORD_BYTES;
+
+        for (int address = 0; address < PAGE_SIZE; address++) {
+            for (int byte = 0; byte < WORD_BYTES; byte++) *out++ = static_cast<uint8_t>(page[address] >> (8 * byte));
+        }
+    }
+
+    std::ofstream file(romPath, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(rom.data()), rom.size())) {
+        std::cerr << "Error: unable to write '" << romPath << "'" << std::endl;
+        exit(ERROR);
+    }
+}
+
+void MicrocodeCompiler::writeHeader(const std::string& headerPath) {
+    const std::vector<uint64_t>& base = _pages[0];
+    char text[64];
+
+    std::ofstream file(headerPath);
+    if (!file) {
+        std::cerr << "Error: unable to write '" << headerPath << "'" << std::endl;
+        exit(ERROR);
+    }
+
+    file << "#ifndef MICROCODE_HPP\n#define MICROCODE_HPP\n\n";
+    file << "// Generated by microcode/mcc from microcode_editor.py, do not edit\n\n";
+    file << "#include <array>\n#include <cstdint>\n\n";
+    std::snprintf(text, sizeof(text), "#define MICROCODE_END       0x%010llx", static_cast<unsigned long long>(_signals["EP"]));
+    file << text << "         // EP, last step of an instruction\n";
+    std::snprintf(text, sizeof(text), "#define MICROCODE_FLAGS     0x%02x", _flagMask);
+    file << text << "                 // Status flags the branches depend on\n\n";
+
+    // Trailing empty steps are left to zero initialization
+    file << "// Control words of every opcode with all flags clear\n";
+    file << "constexpr uint64_t MICROCODE[256][8] = {\n";
+    for (int opcode = 0; opcode < OPCODE_SPACE; opcode++) {
+        const uint64_t* steps = &base[opcode * SUBSTEPS];
+        int used = SUBSTEPS;
+        while (used > 0 && steps[used - 1] == 0) used--;
+
+        std::string row = "    {";
+        for (int substep = 0; substep < used; substep++) {
+            std::snprintf(text, sizeof(text), "%s0x%010llx", substep ? ", " : "", static_cast<unsigned long long>(steps[substep]));
+            row += text;
+        }
+        row += "},";
+        if (used) file << row << std::string(row.size() < 112 ? 112 - row.size() : 1, ' ') << "// " << opcode << "\n";
+        else file << row << "\n";
+    }
+    file << "};\n\n";
+
+    file << "struct MicrocodeVariant {\n    uint8_t opcode;\n    uint8_t flags;                          // Status flags & MICROCODE_FLAGS\n";
+    file << "    uint64_t steps[8];\n};\n\n";
+    file << "// Opcodes whose steps change with the flags, one entry per flag combination that differs\n";
+    file << "constexpr MicrocodeVariant MICROCODE_VARIANTS[] = {\n";
+    for (const auto& [flags, page] : _pages) {
+        for (int opcode = 0; opcode < OPCODE_SPACE; opcode++) {
+            if (std::equal(page.begin() + opcode * SUBSTEPS, page.begin() + (opcode + 1) * SUBSTEPS, base.begin() + opcode * SUBSTEPS)) continue;
+
+            const uint64_t* steps = &page[opcode * SUBSTEPS];
+            int used = SUBSTEPS;
+            while (used > 0 && steps[used - 1] == 0) used--;
+
+            std::snprintf(text, sizeof(text), "    {%d, 0x%02x, {", opcode, flags);
+            file << text;
+            for (int substep = 0; substep < used; substep++) {
+                std::snprintf(text, sizeof(text), "%s0x%010llx", substep ? ", " : "", static_cast<unsigned long long>(steps[substep]));
+                file << text;
+            }
+            file << "}},\n";
+        }
+    }
+    file << "};\n\n";
+
+    file << "constexpr const uint64_t* microcodeSteps(uint8_t opcode, uint8_t flags) {\n";
+    file << "    for (const auto& variant : MICROCODE_VARIANTS) {\n";
+    file << "        if (variant.opcode == opcode && variant.flags == (flags & MICROCODE_FLAGS)) return variant.steps;\n";
+    file << "    }\n";
+    file << "    return MICROCODE[opcode];\n}\n\n";
+
+    file << "// Clock cycles per flag combination and opcode: the steps up to the one that ends the\n";
+    file << "// instruction, or every step of one that stops the clock instead (hlt)\n";
+    file << "constexpr std::array<std::array<uint8_t, 256>, MICROCODE_FLAGS + 1> MICROCODE_CYCLES = [] {\n";
+    file << "    std::array<std::array<uint8_t, 256>, MICROCODE_FLAGS + 1> cycles = {};\n";
+    file << "    for (int flags = 0; flags <= MICROCODE_FLAGS; flags++) {\n";
+    file << "        for (int opcode = 0; opcode < 256; opcode++) {\n";
+    file << "            const uint64_t* steps = microcodeSteps(opcode, flags);\n";
+    file << "            int used = 0;\n";
+    file << "            for (int substep = 0; substep < 8 && !cycles[flags][opcode]; substep++) {\n";
+    file << "                if (steps[substep] & MICROCODE_END) cycles[flags][opcode] = substep + 1;\n";
+    file << "                else if (steps[substep]) used++;\n";
+    file << "            }\n";
+    file << "            if (!cycles[flags][opcode]) cycles[flags][opcode] = used;\n";
+    file << "        }\n";
+    file << "    }\n";
+    file << "    return cycles;\n";
+    file << "}();\n\n";
+
+    file << "constexpr int microcodeCycles(uint8_t opcode, uint8_t flags) { return MICROCODE_CYCLES[flags & MICROCODE_FLAGS][opcode]; }\n\n";
+    file << "#endif\n";
+}
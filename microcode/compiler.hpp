@@ -0,0 +1,46 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include "main.hpp"
+
+// Builds the control ROM from the signal definitions and step lists in microcode_editor.py.
+// Only the status flags the branch rules test change the ROM, so one page is computed for each
+// combination of those flags and repeated over the other flag bits.
+class MicrocodeCompiler {
+public:
+    void parse(const std::string& scriptPath);
+    void compile();
+
+    void writeRom(const std::string& romPath);
+    void writeHeader(const std::string& headerPath);
+
+    const std::map<std::string, uint64_t>& signals() const { return _signals; }
+
+private:
+    // Conditional branch: the alternate steps run when every flag the rule tests reads as expected
+    struct _BranchRule {
+        int opcode;
+        uint8_t mask;                                   // Flags the rule tests
+        uint8_t value;                                  // What they must read, within mask
+    };
+
+    std::string _scriptPath;
+    std::map<std::string, uint64_t> _signals;
+    std::map<std::string, int> _flags;                  // Flag name to bit in the flags field
+    std::vector<std::vector<uint64_t>> _steps;          // Per opcode, in list order
+    std::vector<_BranchRule> _branchRules;
+    std::vector<uint64_t> _branchSteps;
+
+    uint8_t _flagMask = 0;                              // Flags any rule depends on
+    std::map<uint8_t, std::vector<uint64_t>> _pages;    // Flags & _flagMask to a page of PAGE_SIZE words
+
+    uint64_t _parseExpression(const std::string& expression, int line);
+    void _parseSignal(const std::string& text, int line);
+    void _parseFlag(const std::string& text, int line);
+    void _parseRow(const std::string& text, int line);
+    void _parseBranchRule(const std::string& text, int line);
+    void _parseBranchStep(const std::string& text, int line);
+    std::vector<uint64_t> _buildPage(uint8_t flags);
+};
+
+#endif
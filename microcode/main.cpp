@@ -0,0 +1,32 @@
+#include "main.hpp"
+#include "compiler.hpp"
+
+static void usage() {
+    std::cerr << "Usage: ./mcc [-o <microcode.bin>] [-H <microcode.hpp>] <microcode_editor.py>" << std::endl;
+    exit(ERROR);
+}
+
+int main(int argc, char* argv[]) {
+    std::string scriptPath;
+    std::string romPath = "microcode.bin";
+    std::string headerPath;                         // Decode table for the emulator
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-o" && i + 1 < argc) romPath = argv[++i];
+        else if (arg == "-H" && i + 1 < argc) headerPath = argv[++i];
+        else if (arg[0] == '-' || !scriptPath.empty()) usage();
+        else scriptPath = arg;
+    }
+
+    if (scriptPath.empty()) usage();
+
+    MicrocodeCompiler compiler;
+    compiler.parse(scriptPath);
+    compiler.compile();
+    compiler.writeRom(romPath);
+    if (!headerPath.empty()) compiler.writeHeader(headerPath);
+
+    return 0;
+}
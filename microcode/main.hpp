@@ -0,0 +1,26 @@
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#define ERROR           1
+
+// Control ROM address: flags << 11 | opcode << 3 | substep
+#define FLAG_STATES     128
+#define OPCODE_SPACE    256
+#define SUBSTEPS        8
+#define PAGE_SIZE       (OPCODE_SPACE * SUBSTEPS)
+#define ROM_SIZE        (FLAG_STATES * PAGE_SIZE)
+#define WORD_BYTES      5                   // 40 bit control words
+
+
+#endif
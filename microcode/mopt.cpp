@@ -0,0 +1,39 @@
+#include "main.hpp"
+#include "compiler.hpp"
+#include "optimizer.hpp"
+
+static void usage() {
+    std::cerr << "Usage: ./mopt [-s <microcode_editor.py>] [-o <proposed.bin>] <microcode.bin>" << std::endl;
+    exit(ERROR);
+}
+
+int main(int argc, char* argv[]) {
+    std::string scriptPath = "../microcode_editor.py";         // Signal definitions
+    std::string romPath;
+    std::string proposedPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-s" && i + 1 < argc) scriptPath = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) proposedPath = argv[++i];
+        else if (arg[0] == '-' || !romPath.empty()) usage();
+        else romPath = arg;
+    }
+
+    if (romPath.empty()) usage();
+
+    MicrocodeCompiler compiler;
+    compiler.parse(scriptPath);
+
+    MicrocodeOptimizer optimizer(compiler.signals());
+    optimizer.load(romPath);
+    optimizer.optimize();
+    optimizer.printReport();
+
+    // Every rewritten program has to leave the same state behind as the one it replaces
+    if (!optimizer.verify()) exit(ERROR);
+    if (!proposedPath.empty()) optimizer.writeRom(proposedPath);
+
+    return 0;
+}
@@ -0,0 +1,438 @@
+#include "optimizer.hpp"
+#include "isa.hpp"
+
+// Reads, writes and barrier flag of every signal in microcode_editor.py. ALU function and data
+// selects claim the ALU so they never end up paired with another step's operand latch, and the
+// clock inverts (BR, ECLK) claim the registers whose latching edge they move.
+struct SignalEffect {
+    const char* name;
+    uint32_t reads;
+    uint32_t writes;
+    bool barrier;
+};
+
+static const SignalEffect SIGNAL_EFFECTS[] = {
+    {"MI",    ADDRESS_BUS,                                  MAR,            false},
+    {"COA",   PC,                                           ADDRESS_BUS,    false},
+
+    {"CIDL",  DATA_BUS,                                     PC,             false},
+    {"CIDH",  DATA_BUS,                                     PC,             false},
+    {"RI",    DATA_BUS | MAR,                               RAM,            false},
+    {"EI",    DATA_BUS | AUX_BUS_1 | AUX_BUS_2 | REG_A | STATUS | ALU, ALU, false},
+    {"AI",    DATA_BUS,                                     REG_A,          false},
+    {"XI",    DATA_BUS,                                     REG_X,          false},
+    {"YI",    DATA_BUS,                                     REG_Y,          false},
+    {"SRDI",  DATA_BUS,                                     STATUS,         false},
+    {"SPI",   DATA_BUS,                                     STACK,          false},
+    {"CI",    0,                                            STATUS,         false},
+    {"TRHI",  DATA_BUS | TRANSFER,                          TRANSFER,       false},
+    {"OI",    DATA_BUS,                                     OUTPUT,         false},
+    {"BR",    MAR,                                          MAR,            false},
+    {"BIT",   DATA_BUS | REG_A,                             STATUS,         false},
+    {"SC",    0,                                            STATUS,         false},
+
+    {"CODL",  PC,                                           DATA_BUS,       false},
+    {"CODH",  PC,                                           DATA_BUS,       false},
+    {"AO",    REG_A,                                        DATA_BUS,       false},
+    {"DRF",   ALL_RESOURCES,                                INSTRUCTION,    true},
+    {"SPDO",  STACK,                                        DATA_BUS,       false},
+    {"SRO",   STATUS,                                       DATA_BUS,       false},
+    {"RO",    RAM | MAR,                                    DATA_BUS,       false},
+
+    {"AND",   ALU,                                          ALU,            false},
+    {"OR",    ALU,                                          ALU,            false},
+    {"XOR",   ALU,                                          ALU,            false},
+    {"SU",    ALU,                                          ALU,            false},
+    {"LSHFR", ALU,                                          ALU,            false},
+    {"ASHFL", ALU,                                          ALU,            false},
+    {"ROR",   ALU,                                          ALU,            false},
+    {"ROL",   ALU,                                          ALU,            false},
+    {"CMP",   DATA_BUS | AUX_BUS_1 | AUX_BUS_2 | REG_A | ALU, ALU | STATUS, false},
+    {"DSP",   STACK,                                        STACK,          false},
+    {"NOP",   ALL_RESOURCES,                                INSTRUCTION,    true},
+    {"SI",    0,                                            STATUS,         false},
+    {"INC",   ALU,                                          ALU,            false},
+    {"DEC",   ALU,                                          ALU,            false},
+    {"ADD",   ALU,                                          ALU,            false},
+
+    {"CE",    PC,                                           PC,             false},
+    {"J",     ALL_RESOURCES,                                PC,             true},
+    {"SPE",   STACK,                                        STACK,          false},
+    {"IJ",    ALL_RESOURCES,                                PC,             true},
+
+    {"FI",    ALU | STATUS,                                 STATUS,         false},
+    {"EP",    0,                                            SEQUENCER,      false},
+    {"II",    PIPELINE,                                     INSTRUCTION,    false},
+    {"FEC",   RAM | MAR,                                    PIPELINE,       false},
+
+    {"RTR",   TRANSFER,                                     TRANSFER,       false},
+    {"EO",    ALU,                                          DATA_BUS,       false},
+    {"ES1",   ALU,                                          ALU,            false},
+    {"TRO",   TRANSFER,                                     ADDRESS_BUS,    false},
+
+    {"ECLK",  ALU | STATUS,                                 ALU | STATUS,   false},
+    {"ES2",   ALU,                                          ALU,            false},
+
+    {"XO",    REG_X,                                        DATA_BUS,       false},
+    {"XOX1",  REG_X,                                        AUX_BUS_1,      false},
+    {"XOX2",  REG_X,                                        AUX_BUS_2,      false},
+    {"YO",    REG_Y,                                        DATA_BUS,       false},
+    {"YOX1",  REG_Y,                                        AUX_BUS_1,      false},
+    {"YOX2",  REG_Y,                                        AUX_BUS_2,      false},
+
+    {"TRLI",  DATA_BUS | TRANSFER,                          TRANSFER,       false},
+
+    {"CTR",   ALU | STATUS | TRANSFER,                      TRANSFER,       false},
+    {"IE",    ALL_RESOURCES,                                STATUS,         true},
+    {"CLC",   0,                                            STATUS,         false},
+    {"HLT",   ALL_RESOURCES,                                SEQUENCER,      true},
+    {"CLV",   0,                                            STATUS,         false},
+    {"LD",    ALL_RESOURCES,                                ALL_RESOURCES & ~BUSES, true},
+    {"SPAO",  STACK,                                        ADDRESS_BUS,    false},
+    {"PEC",   ALL_RESOURCES,                                SEQUENCER,      true},
+    {"CJ",    ALL_RESOURCES,                                SEQUENCER,      true},
+
+    {"CSB",   ALL_RESOURCES,                                SEQUENCER,      true},
+    {"RCC",   ALL_RESOURCES,                                SEQUENCER,      true},
+};
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    // splitmix64 finalizer over the running hash
+    hash += value + 0x9e3779b97f4a7c15ull;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    return hash ^ (hash >> 31);
+}
+
+static uint64_t hashName(const std::string& name) {
+    uint64_t hash = 0;
+    for (char c : name) hash = mix(hash, static_cast<uint8_t>(c));
+    return hash;
+}
+
+MicrocodeOptimizer::MicrocodeOptimizer(const std::map<std::string, uint64_t>& signals) {
+    for (const auto& effect : SIGNAL_EFFECTS) {
+        auto signal = signals.find(effect.name);
+        if (signal == signals.end()) continue;
+        _signals.push_back({effect.name, signal->second, 0, effect.reads, effect.writes, effect.barrier});
+    }
+
+    // A signal nobody described is kept but never moved
+    for (const auto& [name, value] : signals) {
+        bool described = std::any_of(_signals.begin(), _signals.end(), [&](const _Signal& signal) { return signal.name == name; });
+        if (!described) _signals.push_back({name, value, 0, ALL_RESOURCES, ALL_RESOURCES & ~BUSES, true});
+    }
+
+    // Signals whose bits overlap are values of one decoder field
+    for (const auto& signal : _signals) {
+        uint64_t field = signal.value;
+        for (bool grown = true; grown;) {
+            grown = false;
+            for (const auto& other : _signals) {
+                if ((other.value & field) && (other.value | field) != field) {
+                    field |= other.value;
+                    grown = true;
+                }
+            }
+        }
+        if (std::find(_fields.begin(), _fields.end(), field) == _fields.end()) _fields.push_back(field);
+    }
+    for (auto& signal : _signals) {
+        for (uint64_t field : _fields) {
+            if (signal.value & field) signal.field = field;
+        }
+    }
+}
+
+// Helper Functions
+
+MicrocodeOptimizer::_Step MicrocodeOptimizer::_decode(uint64_t word) {
+    _Step step;
+    uint64_t covered = 0;
+
+    for (uint64_t field : _fields) {
+        uint64_t value = word & field;
+        covered |= field;
+        if (!value) continue;
+
+        auto signal = std::find_if(_signals.begin(), _signals.end(), [&](const _Signal& s) { return s.field == field && s.value == value; });
+        if (signal == _signals.end()) {
+            step.known = false;
+            continue;
+        }
+        step.signals.push_back(&*signal);
+        step.reads |= signal->reads;
+        step.writes |= signal->writes;
+        step.barrier |= signal->barrier;
+    }
+
+    if ((word & ~covered) || !step.known) {
+        step.known = false;
+        step.barrier = true;
+    }
+    return step;
+}
+
+int MicrocodeOptimizer::_length(const uint64_t* steps) {
+    // Up to and including the step that ends the instruction, 0 when none does (hlt)
+    for (const auto& signal : _signals) {
+        if (signal.name != "EP") continue;
+        for (int substep = 0; substep < SUBSTEPS; substep++) {
+            if (steps[substep] & signal.value) return substep + 1;
+        }
+    }
+    return 0;
+}
+
+bool MicrocodeOptimizer::_mergeable(uint64_t first, uint64_t second) {
+    // Each decoder field can only hold one of the two and a single bit can't fire twice
+    for (uint64_t field : _fields) {
+        if ((first & field) && (second & field)) return false;
+    }
+
+    _Step a = _decode(first);
+    _Step b = _decode(second);
+    if (a.barrier || b.barrier) return false;
+
+    // The pair must not depend on each other in either order, including through a bus
+    return !(a.writes & b.reads) && !(a.reads & b.writes) && !(a.writes & b.writes);
+}
+
+bool MicrocodeOptimizer::_dead(const std::vector<uint64_t>& steps, size_t index) {
+    _Step step = _decode(steps[index]);
+    if (step.barrier) return false;
+
+    uint32_t state = step.writes & ~BUSES;
+    for (size_t later = index + 1; later < steps.size() && state; later++) {
+        _Step next = _decode(steps[later]);
+        if (next.barrier || (next.reads & state)) return false;
+        state &= ~(next.writes & ~next.reads);
+    }
+
+    // Still set means the value outlives the instruction
+    return state == 0;
+}
+
+std::string MicrocodeOptimizer::_describe(uint64_t word) {
+    if (!word) return "0";
+
+    std::string text;
+    for (const _Signal* signal : _decode(word).signals) text += (text.empty() ? "" : "|") + signal->name;
+    return text.empty() ? "?" : text;
+}
+
+uint64_t MicrocodeOptimizer::_simulate(const std::vector<uint64_t>& steps) {
+    // Symbolic register transfer: every resource holds a hash of how its value was produced.
+    // Buses are driven first from the state at the start of the step, then every write lands
+    // together. Barriers fold the whole state into the trace, so anything they could observe
+    // has to match as well.
+    std::map<uint32_t, uint64_t> state;
+    for (uint32_t resource = 1; resource & ALL_RESOURCES; resource <<= 1) state[resource] = resource;
+
+    auto readAll = [&](uint64_t hash, uint32_t reads, const std::map<uint32_t, uint64_t>& values) {
+        for (uint32_t resource = 1; resource & ALL_RESOURCES; resource <<= 1) {
+            if (reads & resource) hash = mix(hash, values.at(resource));
+        }
+        return hash;
+    };
+
+    uint64_t trace = 0;
+    for (uint64_t word : steps) {
+        _Step step = _decode(word);
+        std::map<uint32_t, uint64_t> values = state;
+        for (uint32_t bus = 1; bus & BUSES; bus <<= 1) values[bus] = 0;
+
+        for (const _Signal* signal : step.signals) {
+            if (!(signal->writes & BUSES)) continue;
+            uint64_t driven = readAll(hashName(signal->name), signal->reads & ~BUSES, state);
+            for (uint32_t bus = 1; bus & BUSES; bus <<= 1) {
+                if (signal->writes & bus) values[bus] += driven;
+            }
+        }
+
+        std::map<uint32_t, uint64_t> writes;
+        for (const _Signal* signal : step.signals) {
+            uint64_t result = readAll(hashName(signal->name), signal->reads, values);
+            for (uint32_t resource = 1; resource & ALL_RESOURCES; resource <<= 1) {
+                if ((signal->writes & ~BUSES) & resource) writes[resource] += result;
+            }
+            if (signal->barrier) trace = mix(trace, result);
+        }
+        if (!step.known) trace = mix(trace, word);
+
+        for (const auto& [resource, value] : writes) state[resource] = value;
+    }
+
+    return readAll(trace, ALL_RESOURCES & ~BUSES, state);
+}
+
+void MicrocodeOptimizer::_optimizeProgram(_Program& program) {
+    std::vector<uint64_t> steps = program.original;
+    char finding[160];
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        _Step step = _decode(steps[i]);
+        for (uint32_t bus = 1; bus & BUSES; bus <<= 1) {
+            if ((step.writes & bus) && !(step.reads & bus) && !step.barrier) {
+                std::snprintf(finding, sizeof(finding), "step %zu drives a bus nothing reads: %s", i, _describe(steps[i]).c_str());
+                program.findings.push_back(finding);
+            }
+        }
+    }
+
+    // Steps with no lasting effect, then neighbours that fit in one cycle
+    for (size_t i = 0; i + 1 < steps.size();) {
+        if (!_dead(steps, i)) {
+            i++;
+            continue;
+        }
+        std::snprintf(finding, sizeof(finding), "step %zu has no effect: %s", i, _describe(steps[i]).c_str());
+        program.findings.push_back(finding);
+        steps.erase(steps.begin() + i);
+    }
+
+    for (size_t i = 0; i + 1 < steps.size();) {
+        if (!_mergeable(steps[i], steps[i + 1])) {
+            i++;
+            continue;
+        }
+        std::snprintf(finding, sizeof(finding), "%s step %zu into step %zu: %s + %s", i + 2 == steps.size() ? "end early, merge" : "merge",
+                      i + 1, i, _describe(steps[i]).c_str(), _describe(steps[i + 1]).c_str());
+        program.findings.push_back(finding);
+        steps[i] |= steps[i + 1];
+        steps.erase(steps.begin() + i + 1);
+    }
+
+    program.optimized = steps;
+}
+
+// Main Functions
+
+void MicrocodeOptimizer::load(const std::string& romPath) {
+    std::ifstream file(romPath, std::ios::binary);
+    std::vector<uint8_t> bytes;
+    if (file) bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    if (bytes.size() != static_cast<size_t>(ROM_SIZE) * WORD_BYTES) {
+        std::cerr << "Error: '" << romPath << "' is not a " << ROM_SIZE * WORD_BYTES << " byte control ROM" << std::endl;
+        exit(ERROR);
+    }
+
+    _rom.assign(ROM_SIZE, 0);
+    for (size_t address = 0; address < _rom.size(); address++) {
+        for (int byte = 0; byte < WORD_BYTES; byte++) _rom[address] |= static_cast<uint64_t>(bytes[address * WORD_BYTES + byte]) << (8 * byte);
+    }
+
+    // Flag states that leave an opcode's steps unchanged share one program
+    std::map<std::pair<int, std::vector<uint64_t>>, int> seen;
+    _programs.clear();
+    _programAt.assign(FLAG_STATES * OPCODE_SPACE, -1);
+
+    for (int flags = 0; flags < FLAG_STATES; flags++) {
+        for (int opcode = 0; opcode < OPCODE_SPACE; opcode++) {
+            const uint64_t* steps = &_rom[flags * PAGE_SIZE + opcode * SUBSTEPS];
+            int length = _length(steps);
+            if (!length) continue;
+
+            std::vector<uint64_t> program(steps, steps + length);
+            auto [entry, inserted] = seen.insert({{opcode, program}, static_cast<int>(_programs.size())});
+            if (inserted) _programs.push_back({flags, opcode, program, program, {}});
+            _programAt[flags * OPCODE_SPACE + opcode] = entry->second;
+        }
+    }
+}
+
+void MicrocodeOptimizer::optimize() {
+    for (auto& program : _programs) _optimizeProgram(program);
+}
+
+bool MicrocodeOptimizer::verify() {
+    bool ok = true;
+    for (const auto& program : _programs) {
+        if (_simulate(program.original) == _simulate(program.optimized)) continue;
+
+        std::cerr << "Error: optimized opcode " << program.opcode << " (flags $" << std::hex << program.flags << std::dec
+                  << ") does not match the original" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+void MicrocodeOptimizer::printReport() {
+    // Cycle range over every flag state, before and after
+    struct Cycles { int min = 99, max = 0, newMin = 99, newMax = 0; };
+    std::map<int, Cycles> cycles;
+    std::map<int, std::vector<std::string>> findings;
+
+    for (int flags = 0; flags < FLAG_STATES; flags++) {
+        for (int opcode = 0; opcode < OPCODE_SPACE; opcode++) {
+            int index = _programAt[flags * OPCODE_SPACE + opcode];
+            if (index < 0) continue;
+
+            const _Program& program = _programs[index];
+            Cycles& range = cycles[opcode];
+            range.min = std::min<int>(range.min, program.original.size());
+            range.max = std::max<int>(range.max, program.original.size());
+            range.newMin = std::min<int>(range.newMin, program.optimized.size());
+            range.newMax = std::max<int>(range.newMax, program.optimized.size());
+        }
+    }
+    for (const auto& program : _programs) {
+        for (const auto& finding : program.findings) {
+            auto& list = findings[program.opcode];
+            if (std::find(list.begin(), list.end(), finding) == list.end()) list.push_back(finding);
+        }
+    }
+
+    char row[128];
+    int saved = 0;
+    std::cout << "Microcode findings" << std::endl;
+    for (const auto& [opcode, list] : findings) {
+        const Opcode& op = OPCODE_TABLE[opcode];
+        std::snprintf(row, sizeof(row), "  %3d %-4s %-14s", opcode, op.legal() ? op.mnemonic.data() : "???", op.legal() ? modeName(op.mode).data() : "");
+        for (size_t i = 0; i < list.size(); i++) std::cout << (i ? std::string(25, ' ') : std::string(row)) << list[i] << std::endl;
+    }
+
+    std::cout << "\nCycle savings" << std::endl;
+    std::snprintf(row, sizeof(row), "  %3s %-4s %-14s %7s %7s %5s", "op", "name", "mode", "before", "after", "saved");
+    std::cout << row << std::endl;
+    for (const auto& [opcode, range] : cycles) {
+        if (range.newMax == range.max && range.newMin == range.min) continue;
+
+        const Opcode& op = OPCODE_TABLE[opcode];
+        std::string before = range.min == range.max ? std::to_string(range.max) : std::to_string(range.min) + "/" + std::to_string(range.max);
+        std::string after = range.newMin == range.newMax ? std::to_string(range.newMax) : std::to_string(range.newMin) + "/" + std::to_string(range.newMax);
+        std::snprintf(row, sizeof(row), "  %3d %-4s %-14s %7s %7s %5d", opcode, op.legal() ? op.mnemonic.data() : "???", op.legal() ? modeName(op.mode).data() : "",
+                      before.c_str(), after.c_str(), range.max - range.newMax);
+        std::cout << row << std::endl;
+        saved += range.max - range.newMax;
+    }
+    std::cout << "  " << saved << " cycles saved over " << cycles.size() << " opcodes" << std::endl;
+}
+
+void MicrocodeOptimizer::writeRom(const std::string& romPath) {
+    // Steps after the end of an instruction never run, so the freed slots are cleared
+    std::vector<uint64_t> rom = _rom;
+    for (int flags = 0; flags < FLAG_STATES; flags++) {
+        for (int opcode = 0; opcode < OPCODE_SPACE; opcode++) {
+            int index = _programAt[flags * OPCODE_SPACE + opcode];
+            if (index < 0) continue;
+
+            uint64_t* steps = &rom[flags * PAGE_SIZE + opcode * SUBSTEPS];
+            const _Program& program = _programs[index];
+            for (size_t substep = program.optimized.size(); substep < program.original.size(); substep++) steps[substep] = 0;
+            std::copy(program.optimized.begin(), program.optimized.end(), steps);
+        }
+    }
+
+    std::vector<uint8_t> bytes(rom.size() * WORD_BYTES);
+    for (size_t address = 0; address < rom.size(); address++) {
+        for (int byte = 0; byte < WORD_BYTES; byte++) bytes[address * WORD_BYTES + byte] = static_cast<uint8_t>(rom[address] >> (8 * byte));
+    }
+
+    std::ofstream file(romPath, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size())) {
+        std::cerr << "Error: unable to write '" << romPath << "'" << std::endl;
+        exit(ERROR);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "main.hpp"
+
+// What a control signal touches during its substep. Buses only carry a value within the step,
+// everything else is state that later steps or the next instruction can observe.
+enum Resource : uint32_t {
+    ADDRESS_BUS     = 1 << 0,
+    DATA_BUS        = 1 << 1,
+    AUX_BUS_1       = 1 << 2,
+    AUX_BUS_2       = 1 << 3,
+    MAR             = 1 << 4,
+    PC              = 1 << 5,
+    RAM             = 1 << 6,
+    REG_A           = 1 << 7,
+    REG_X           = 1 << 8,
+    REG_Y           = 1 << 9,
+    STATUS          = 1 << 10,
+    STACK           = 1 << 11,
+    TRANSFER        = 1 << 12,
+    ALU             = 1 << 13,          // Operand latch and function select
+    OUTPUT          = 1 << 14,
+    PIPELINE        = 1 << 15,
+    INSTRUCTION     = 1 << 16,
+    SEQUENCER       = 1 << 17,
+
+    BUSES           = ADDRESS_BUS | DATA_BUS | AUX_BUS_1 | AUX_BUS_2,
+    ALL_RESOURCES   = (1 << 18) - 1,
+};
+
+// Finds substeps of microcode.bin that do nothing or can share a clock cycle with their
+// neighbour, and builds a ROM with them folded. Signals that change clock edges or jump the
+// sequencer are barriers: steps holding one are never moved.
+class MicrocodeOptimizer {
+public:
+    MicrocodeOptimizer(const std::map<std::string, uint64_t>& signals);
+
+    void load(const std::string& romPath);
+    void optimize();
+    bool verify();
+
+    void printReport();
+    void writeRom(const std::string& romPath);
+
+private:
+    struct _Signal {
+        std::string name;
+        uint64_t value;
+        uint64_t field;                 // Bits decoded together with this signal
+        uint32_t reads;
+        uint32_t writes;
+        bool barrier;
+    };
+
+    struct _Step {
+        uint32_t reads = 0;
+        uint32_t writes = 0;
+        bool barrier = false;
+        bool known = true;              // Every field decodes to a defined signal
+        std::vector<const _Signal*> signals;
+    };
+
+    // One opcode under one combination of flags, as it runs: the steps up to the one with EP
+    struct _Program {
+        int flags;
+        int opcode;
+        std::vector<uint64_t> original;
+        std::vector<uint64_t> optimized;
+        std::vector<std::string> findings;
+    };
+
+    std::vector<_Signal> _signals;
+    std::vector<uint64_t> _fields;
+    std::vector<uint64_t> _rom;
+    std::vector<_Program> _programs;
+    std::vector<int> _programAt;        // ROM page and opcode to its program, shared by identical pages
+
+    _Step _decode(uint64_t word);
+    int _length(const uint64_t* steps);
+    bool _mergeable(uint64_t first, uint64_t second);
+    bool _dead(const std::vector<uint64_t>& steps, size_t index);
+    std::string _describe(uint64_t word);
+    uint64_t _simulate(const std::vector<uint64_t>& steps);
+    void _optimizeProgram(_Program& program);
+};
+
+#endif
@@ -400,7 +400,7 @@ def main():
         [MI|COA|CE|FEC|RO|EI|ES1|YOX1|ES2|ADD, EO|TRLI|RTR, MI|TRO, RO|AI, ROL|EI, MI|COA|CE|II|EO|AI|EP],                                                     # 137 - zeropage,Y   ; oper,Y
         [MI|COA|CE|RO|TRLI, MI|COA|CE|FEC|RO|TRHI, MI|TRO, RO|AI, ROL|EI, MI|COA|CE|II|EO|AI|EP],                                                              # 138 - absolute     ; oper
         [MI|COA|CE|RO|EI|ES1|ES2|ADD|CTR|XOX1, MI|COA|CE|FEC|RO|EO|TRLI|TRHI|ECLK|CTR, MI|TRO, RO|AI, ROL|EI, MI|COA|CE|II|EO|AI|EP],                          # 139 - absolute,X   ; oper,X
-        [MI|COA|CE|RO|EI|ES1|ES2|ADD|CTR|YOX1, MI|COA|CE|FEC|RO|EO|TRLI|TRHI|ECLK|CTR, MI|TRO, RO|AI, ROL|EI, MI|COA|CE|II|EO|AI|EP],                          # 140 - zeropage,Y   ; oper,Y
+        [MI|COA|CE|RO|EI|ES1|ES2|ADD|CTR|YOX1, MI|COA|CE|FEC|RO|EO|TRLI|TRHI|ECLK|CTR, MI|TRO, RO|AI, ROL|EI, MI|COA|CE|II|EO|AI|EP],                          # 140 - absolute,Y   ; oper,Y
         
         # ROR # Rotate One Bit Right (Memory or Accumulator)                                                                                                   # OPC - ADDRESSING   ; ASSEMBLER
         [MI|COA|CE|FEC|ROR|EI, MI|COA|EO|AI, CE|II|EP],                                                                                                        # 141 - accumulator  ; A
@@ -409,7 +409,7 @@ def main():
         [MI|COA|CE|FEC|RO|EI|ES1|YOX1|ES2|ADD, EO|TRLI|RTR, MI|TRO, RO|AI, ROR|EI, MI|COA|CE|II|EO|AI|EP],                                                     # 144 - zeropage,Y   ; oper,Y
         [MI|COA|CE|RO|TRLI, MI|COA|CE|FEC|RO|TRHI, MI|TRO, RO|AI, ROR|EI, MI|COA|CE|II|EO|AI|EP],                                                              # 145 - absolute     ; oper
         [MI|COA|CE|RO|EI|ES1|ES2|ADD|CTR|XOX1, MI|COA|CE|FEC|RO|EO|TRLI|TRHI|ECLK|CTR, MI|TRO, RO|AI, ROR|EI, MI|COA|CE|II|EO|AI|EP],                          # 146 - absolute,X   ; oper,X
-        [MI|COA|CE|RO|EI|ES1|ES2|ADD|CTR|YOX1, MI|COA|CE|FEC|RO|EO|TRLI|TRHI|ECLK|CTR, MI|TRO, RO|AI, ROR|EI, MI|COA|CE|II|EO|AI|EP],                          # 147 - zeropage,Y   ; oper,Y
+        [MI|COA|CE|RO|EI|ES1|ES2|ADD|CTR|YOX1, MI|COA|CE|FEC|RO|EO|TRLI|TRHI|ECLK|CTR, MI|TRO, RO|AI, ROR|EI, MI|COA|CE|II|EO|AI|EP],                          # 147 - absolute,Y   ; oper,Y
         
         # RTI # Return from Interrupt                                                                                                                          # OPC - ADDRESSING   ; ASSEMBLER
         [DSP|SPE|ECLK, MI|SPAO|RO|SRDI|DSP|SPE|FI|ECLK, MI|SPAO|RO|CIDL|DSP|SPE, MI|SPAO|RO|CIDH, J, MI|COA|CE|IE|EP|CI],                                      # 148 - implied      ;